@@ -17,8 +17,10 @@ limitations under the License.
 #pragma once
 
 #include <filesystem>
+#include <memory>
 #include <string>
 #include <thread>
+#include <vector>
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 
@@ -37,12 +39,41 @@ absl::StatusOr<std::string> RunCommand(const std::string &command);
 // Returns the directory of the currently running executable.
 absl::StatusOr<std::filesystem::path> GetExecutableDirectory();
 
+// Runs command lines. Tests can provide an implementation that stands in for adb and a device.
+class CommandRunner
+{
+public:
+    virtual ~CommandRunner() = default;
+
+    // Returns the output of the command if it finished successfully, or error status otherwise
+    virtual absl::StatusOr<std::string> Run(const std::string &command) const = 0;
+};
+
+// Runs the commands with RunCommand.
+class SystemCommandRunner : public CommandRunner
+{
+public:
+    absl::StatusOr<std::string> Run(const std::string &command) const override
+    {
+        return RunCommand(command);
+    }
+};
+
+inline std::shared_ptr<const CommandRunner> GetSystemCommandRunner()
+{
+    static const std::shared_ptr<const CommandRunner> runner = std::make_shared<
+    SystemCommandRunner>();
+    return runner;
+}
+
 class AdbSession
 {
 public:
     AdbSession() = default;
-    AdbSession(const std::string &serial) :
-        m_serial(serial)
+    AdbSession(const std::string                   &serial,
+               std::shared_ptr<const CommandRunner> runner = GetSystemCommandRunner()) :
+        m_serial(serial),
+        m_runner(std::move(runner))
     {
     }
     ~AdbSession()
@@ -59,26 +90,29 @@ public:
     // Run runs the commands and returns the status of that commands.
     inline absl::Status Run(const std::string &command) const
     {
-        return RunCommand("adb -s " + m_serial + " " + command).status();
+        return m_runner->Run("adb -s " + m_serial + " " + command).status();
     }
 
     // RunAndGetResult runs the commands and returns the output of the command if it finished
     // successfully, or error status otherwise
     inline absl::StatusOr<std::string> RunAndGetResult(const std::string &command) const
     {
-        return RunCommand("adb -s " + m_serial + " " + command);
+        return m_runner->Run("adb -s " + m_serial + " " + command);
     }
 
     inline absl::Status RunCommandBackground(const std::string &command)
     {
         std::string full_command = "adb -s " + m_serial + " " + command;
-        auto        worker = [full_command]() { RunCommand(full_command).IgnoreError(); };
+        auto        worker = [runner = m_runner, full_command]() {
+            runner->Run(full_command).IgnoreError();
+        };
         m_background_threads.emplace_back(std::thread(worker));
         return absl::OkStatus();
     }
 
 private:
-    std::string              m_serial;
-    std::vector<std::thread> m_background_threads;
+    std::string                          m_serial;
+    std::shared_ptr<const CommandRunner> m_runner = GetSystemCommandRunner();
+    std::vector<std::thread>             m_background_threads;
 };
 }  // namespace Dive
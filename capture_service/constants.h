@@ -47,6 +47,7 @@ inline constexpr char kProfilingPluginName[] = "dive_drawcall_metrics";
 // is the base path since GFXR can reliably write there.
 inline constexpr char kReplayStateLoadedSignalFile[] = "/sdcard/Download/replay_state_loaded";
 inline constexpr char kGpuTimingFile[] = "gpu_time.csv";  // produced by GFXR replay
+inline constexpr char kGpuTimingRecordFile[] = "gpu_time.bin";  // produced by GFXR replay
 inline constexpr char
 kCaptureScreenshotFile[] = "capture_screenshot.png";  // produced during GFXR capture
 
@@ -54,6 +55,7 @@ kCaptureScreenshotFile[] = "capture_screenshot.png";  // produced during GFXR ca
 // it, but a unique suffix to indicate its type
 inline constexpr char kProfilingMetricsCsvSuffix[] = "_profiling_metrics.csv";
 inline constexpr char kGpuTimingCsvSuffix[] = "_gpu_time.csv";
+inline constexpr char kGpuTimingRecordSuffix[] = "_gpu_time.bin";
 inline constexpr char kPm4RdSuffix[] = ".rd";
 inline constexpr char kRenderDocRdcSuffix[] = "_capture.rdc";
 inline constexpr char kGfxrSuffix[] = ".gfxr";
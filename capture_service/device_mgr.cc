@@ -16,9 +16,12 @@ limitations under the License.
 
 #include "device_mgr.h"
 
+#include <algorithm>
 #include <filesystem>
 #include <future>
 #include <memory>
+#include <mutex>
+#include <thread>
 
 #include "../dive_core/common/common.h"
 #include "absl/status/status.h"
@@ -34,6 +37,7 @@ limitations under the License.
 #include "common/macros.h"
 #include "common/defer.h"
 #include "remote_files.h"
+#include "task_queue.h"
 
 namespace Dive
 {
@@ -271,8 +275,14 @@ absl::StatusOr<GfxrReplaySettings> ValidateGfxrReplaySettings(const GfxrReplaySe
 }
 
 AndroidDevice::AndroidDevice(const std::string &serial) :
+    AndroidDevice(serial, GetSystemCommandRunner())
+{
+}
+
+AndroidDevice::AndroidDevice(const std::string                   &serial,
+                             std::shared_ptr<const CommandRunner> runner) :
     m_serial(serial),
-    m_adb(serial),
+    m_adb(serial, std::move(runner)),
     m_gfxr_enabled(false),
     m_port(kFirstPort)
 {
@@ -888,6 +898,28 @@ absl::Status DeviceManager::RunReplayGfxrScript(const GfxrReplaySettings &settin
         LOGI("Gpu time file %s downloaded to %s\n",
              remote_gpu_time_path.c_str(),
              settings.local_download_dir.c_str());
+
+        // The binary records are optional, older replay binaries only produce the CSV file
+        std::string remote_gpu_time_record_path = absl::StrFormat(
+        "%s/%s",
+        parse_remote_capture.parent_path().string().c_str(),
+        kGpuTimingRecordFile);
+        if (m_device->FileExists(remote_gpu_time_record_path))
+        {
+            std::string gpu_time_record_local_name = absl::StrFormat("%s%s",
+                                                                     parse_remote_capture.stem(),
+                                                                     kGpuTimingRecordSuffix);
+            if (absl::Status s = m_device->RetrieveFile(remote_gpu_time_record_path,
+                                                        settings.local_download_dir,
+                                                        /*delete_after_retrieve=*/true,
+                                                        gpu_time_record_local_name);
+                !s.ok())
+            {
+                return absl::InternalError(
+                absl::StrFormat("Failed to download the gpu time record file: %s\n",
+                                remote_gpu_time_record_path.c_str()));
+            }
+        }
     }
     else if (settings.run_type == GfxrReplayOptions::kRenderDoc)
     {
@@ -1095,6 +1127,101 @@ absl::Status AndroidDevice::RetrieveFile(const std::string &remote_file_path,
     return Adb().Run(absl::StrFormat("shell rm -rf %s", remote_file_path));
 }
 
+absl::Status AndroidDevice::RetrieveFiles(const std::vector<FileRetrieval> &files,
+                                          const std::string                &local_save_dir,
+                                          const RetrieveFilesOptions       &options)
+{
+    if (!std::filesystem::is_directory(local_save_dir))
+    {
+        return absl::FailedPreconditionError("Invalid local_save_dir: " + local_save_dir);
+    }
+    if (files.empty())
+    {
+        return absl::OkStatus();
+    }
+
+    std::mutex progress_mutex;
+    size_t     files_done = 0;
+    uint64_t   bytes_done = 0;
+    auto       RetrieveWithRetries = [&](const FileRetrieval &file) {
+        absl::Status              status;
+        std::chrono::milliseconds delay = options.retry_delay;
+        for (uint32_t attempt = 0; attempt < std::max(options.max_attempts, 1u); ++attempt)
+        {
+            if (attempt > 0)
+            {
+                LOGI("Retrying to retrieve %s (attempt %u): %s\n",
+                     file.remote_file_path.c_str(),
+                     attempt + 1,
+                     std::string(status.message()).c_str());
+                std::this_thread::sleep_for(delay);
+                delay *= 2;
+            }
+            status = RetrieveFile(file.remote_file_path,
+                                  local_save_dir,
+                                  file.delete_after_retrieve,
+                                  file.new_file_name);
+            // Retrying doesn't help with invalid arguments
+            if (status.ok() || absl::IsFailedPrecondition(status))
+            {
+                break;
+            }
+        }
+        if (!status.ok())
+        {
+            return status;
+        }
+
+        std::filesystem::path local_path = local_save_dir;
+        local_path /= file.new_file_name.empty() ?
+                      std::filesystem::path(file.remote_file_path).filename() :
+                      std::filesystem::path(file.new_file_name);
+        std::error_code             ec;
+        uint64_t                    file_size = std::filesystem::file_size(local_path, ec);
+        std::lock_guard<std::mutex> lock(progress_mutex);
+        ++files_done;
+        bytes_done += ec ? 0 : file_size;
+        if (options.progress_callback)
+        {
+            options.progress_callback(files_done, files.size(), bytes_done);
+        }
+        return status;
+    };
+
+    // Each file is a separate adb pull, so the transfers overlap their setup latency
+    TaskRunner::Options runner_options;
+    runner_options.num_workers = static_cast<uint32_t>(
+    std::clamp<size_t>(options.max_parallel_files, 1, files.size()));
+    std::vector<std::future<absl::Status>> results;
+    {
+        TaskRunner runner(runner_options);
+        for (const FileRetrieval &file : files)
+        {
+            results.push_back(
+            runner.Submit([&RetrieveWithRetries, &file]() { return RetrieveWithRetries(file); }));
+        }
+        runner.WaitForIdle();
+    }
+
+    std::vector<std::string> errors;
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        absl::Status status = results[i].get();
+        if (!status.ok())
+        {
+            errors.push_back(absl::StrCat(files[i].remote_file_path, ": ", status.message()));
+        }
+    }
+    if (!errors.empty())
+    {
+        return absl::InternalError(absl::StrFormat("Failed to retrieve %d of %d files: %s",
+                                                   errors.size(),
+                                                   files.size(),
+                                                   absl::StrJoin(errors, "; ")));
+    }
+    return absl::OkStatus();
+}
+
 void AndroidDevice::EnableGfxr(bool enable_gfxr)
 {
     m_gfxr_enabled = enable_gfxr;
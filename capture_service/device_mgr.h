@@ -23,7 +23,9 @@ limitations under the License.
 #include "constants.h"
 
 #include <cassert>
+#include <chrono>
 #include <filesystem>
+#include <functional>
 #include <memory>
 #include <optional>
 #include <string>
@@ -98,10 +100,36 @@ struct GfxrReplaySettings
 absl::StatusOr<GfxrReplaySettings> ValidateGfxrReplaySettings(const GfxrReplaySettings &settings,
                                                               bool is_adreno_gpu);
 
+// A file to fetch with AndroidDevice::RetrieveFiles
+struct FileRetrieval
+{
+    std::string remote_file_path;
+    // If not empty, the local file is renamed. The extension must match the remote file
+    std::string new_file_name;
+    // If false, the remote file is not deleted after it is fetched
+    bool delete_after_retrieve = true;
+};
+
+struct RetrieveFilesOptions
+{
+    // Maximum number of files fetched at the same time
+    uint32_t max_parallel_files = 4;
+    // Number of times fetching a file is attempted before giving up on it
+    uint32_t max_attempts = 3;
+    // Delay before the first retry of a file, doubled for each following retry
+    std::chrono::milliseconds retry_delay{ 200 };
+    // Called after each file is fetched, with the number of files and bytes fetched so far.
+    // Calls are serialized, but come from the fetching threads.
+    std::function<void(size_t files_done, size_t files_total, uint64_t bytes_done)>
+    progress_callback;
+};
+
 class AndroidDevice
 {
 public:
     explicit AndroidDevice(const std::string &serial);
+    // Runs the adb commands with runner, e.g. to stand in for a device in tests
+    AndroidDevice(const std::string &serial, std::shared_ptr<const CommandRunner> runner);
     ~AndroidDevice();
 
     AndroidDevice &operator=(const AndroidDevice &) = delete;
@@ -158,6 +186,13 @@ public:
                               bool               delete_after_retrieve = true,
                               const std::string &new_file_name = "");
 
+    // Fetches several files to local_save_dir concurrently, see RetrieveFile.
+    // A file that fails to be fetched is retried, and the other files are still fetched. Returns
+    // an error listing the files that couldn't be fetched, if any.
+    absl::Status RetrieveFiles(const std::vector<FileRetrieval> &files,
+                               const std::string                &local_save_dir,
+                               const RetrieveFilesOptions       &options = RetrieveFilesOptions());
+
     // Pins GPU clock to freq_mhz [MHz]
     absl::Status             PinGpuClock(uint32_t freq_mhz) const;
     absl::Status             UnpinGpuClock() const;
@@ -16,8 +16,15 @@ limitations under the License.
 
 #include "device_mgr.h"
 
+#include <atomic>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <thread>
+
 #include "absl/status/status.h"
 #include "absl/status/status_matchers.h"
+#include "absl/strings/str_split.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
@@ -363,5 +370,208 @@ TEST(DeviceManagerTest, EmptySerialIsInvalidForSelectDevice)
     ASSERT_EQ(DeviceManager().SelectDevice("").status().code(), absl::StatusCode::kInvalidArgument);
 }
 
+// Stands in for adb with a local directory as the device file system. Handles `pull` and
+// `shell rm -rf`, and succeeds without output for any other command.
+class FakeDeviceCommandRunner : public CommandRunner
+{
+public:
+    explicit FakeDeviceCommandRunner(std::filesystem::path device_root) :
+        m_device_root(std::move(device_root))
+    {
+    }
+
+    absl::StatusOr<std::string> Run(const std::string &command) const override
+    {
+        // "adb -s <serial> <command...>"
+        std::vector<std::string> args = absl::StrSplit(command, ' ', absl::SkipEmpty());
+        if (args.size() < 4 || args[0] != "adb" || args[1] != "-s")
+        {
+            return absl::InvalidArgumentError("Not an adb command: " + command);
+        }
+        if (args[3] == "pull" && args.size() == 6)
+        {
+            return Pull(args[4], args[5]);
+        }
+        if (args[3] == "shell" && args.size() == 7 && args[4] == "rm" && args[5] == "-rf")
+        {
+            std::filesystem::remove_all(DevicePath(args[6]));
+            return std::string();
+        }
+        return std::string();
+    }
+
+    // The next `count` pulls of remote_path fail
+    void FailPulls(const std::string &remote_path, int count)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_failures[remote_path] = count;
+    }
+
+    int GetMaxConcurrentPulls() const { return m_max_concurrent_pulls; }
+
+private:
+    std::filesystem::path DevicePath(const std::string &remote_path) const
+    {
+        return m_device_root / std::filesystem::path(remote_path).relative_path();
+    }
+
+    absl::StatusOr<std::string> Pull(const std::string &remote_path,
+                                     const std::string &local_path) const
+    {
+        int concurrent_pulls = ++m_concurrent_pulls;
+        int max_pulls = m_max_concurrent_pulls;
+        while (concurrent_pulls > max_pulls &&
+               !m_max_concurrent_pulls.compare_exchange_weak(max_pulls, concurrent_pulls))
+        {
+        }
+        // Gives the other pulls time to start
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        --m_concurrent_pulls;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto                        it = m_failures.find(remote_path);
+            if (it != m_failures.end() && it->second > 0)
+            {
+                --it->second;
+                return absl::UnknownError("adb: error: failed to copy " + remote_path);
+            }
+        }
+
+        std::filesystem::path destination = local_path;
+        if (std::filesystem::is_directory(destination))
+        {
+            destination /= std::filesystem::path(remote_path).filename();
+        }
+        std::error_code ec;
+        std::filesystem::copy_file(DevicePath(remote_path),
+                                   destination,
+                                   std::filesystem::copy_options::overwrite_existing,
+                                   ec);
+        if (ec)
+        {
+            return absl::UnknownError("adb: error: " + ec.message());
+        }
+        return std::string();
+    }
+
+    std::filesystem::path              m_device_root;
+    mutable std::mutex                 m_mutex;
+    mutable std::map<std::string, int> m_failures;
+    mutable std::atomic<int>           m_concurrent_pulls = 0;
+    mutable std::atomic<int>           m_max_concurrent_pulls = 0;
+};
+
+class RetrieveFilesTest : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        m_dir = std::filesystem::temp_directory_path() / "dive_retrieve_files_test";
+        std::filesystem::remove_all(m_dir);
+        std::filesystem::create_directories(m_dir / "device/sdcard/capture");
+        std::filesystem::create_directories(m_dir / "local");
+        m_runner = std::make_shared<FakeDeviceCommandRunner>(m_dir / "device");
+        m_device = std::make_unique<AndroidDevice>("FAKE_SERIAL", m_runner);
+    }
+
+    void TearDown() override
+    {
+        m_device.reset();
+        std::filesystem::remove_all(m_dir);
+    }
+
+    // Creates a file on the fake device and returns its remote path
+    std::string CreateRemoteFile(const std::string &name, size_t size)
+    {
+        std::string   remote_path = "/sdcard/capture/" + name;
+        std::ofstream out(m_dir / "device" / std::filesystem::path(remote_path).relative_path(),
+                          std::ios::binary);
+        out << std::string(size, 'x');
+        return remote_path;
+    }
+
+    std::filesystem::path                    m_dir;
+    std::shared_ptr<FakeDeviceCommandRunner> m_runner;
+    std::unique_ptr<AndroidDevice>           m_device;
+};
+
+TEST_F(RetrieveFilesTest, RetrievesFilesConcurrently)
+{
+    std::vector<FileRetrieval> files;
+    uint64_t                   total_size = 0;
+    for (size_t i = 0; i < 6; ++i)
+    {
+        FileRetrieval file;
+        file.remote_file_path = CreateRemoteFile("file" + std::to_string(i) + ".gfxa", 100 + i);
+        files.push_back(file);
+        total_size += 100 + i;
+    }
+    files[0].new_file_name = "renamed.gfxa";
+    files[1].delete_after_retrieve = false;
+
+    RetrieveFilesOptions options;
+    options.max_parallel_files = 3;
+    size_t   last_files_done = 0;
+    uint64_t last_bytes_done = 0;
+    options.progress_callback = [&](size_t files_done, size_t files_total, uint64_t bytes_done) {
+        EXPECT_EQ(files_done, last_files_done + 1);
+        EXPECT_EQ(files_total, files.size());
+        EXPECT_GT(bytes_done, last_bytes_done);
+        last_files_done = files_done;
+        last_bytes_done = bytes_done;
+    };
+
+    ASSERT_TRUE(m_device->RetrieveFiles(files, (m_dir / "local").string(), options).ok());
+    EXPECT_EQ(last_files_done, files.size());
+    EXPECT_EQ(last_bytes_done, total_size);
+    EXPECT_GT(m_runner->GetMaxConcurrentPulls(), 1);
+    EXPECT_LE(m_runner->GetMaxConcurrentPulls(), 3);
+
+    EXPECT_TRUE(std::filesystem::exists(m_dir / "local/renamed.gfxa"));
+    EXPECT_FALSE(std::filesystem::exists(m_dir / "local/file0.gfxa"));
+    for (size_t i = 1; i < files.size(); ++i)
+    {
+        EXPECT_EQ(std::filesystem::file_size(m_dir / "local" /
+                                             ("file" + std::to_string(i) + ".gfxa")),
+                  100 + i);
+    }
+    EXPECT_FALSE(std::filesystem::exists(m_dir / "device/sdcard/capture/file0.gfxa"));
+    EXPECT_TRUE(std::filesystem::exists(m_dir / "device/sdcard/capture/file1.gfxa"));
+}
+
+TEST_F(RetrieveFilesTest, RetriesFailedFiles)
+{
+    std::vector<FileRetrieval> files(2);
+    files[0].remote_file_path = CreateRemoteFile("capture.gfxr", 10);
+    files[1].remote_file_path = CreateRemoteFile("capture.gfxa", 20);
+    m_runner->FailPulls(files[0].remote_file_path, 2);
+
+    RetrieveFilesOptions options;
+    options.retry_delay = std::chrono::milliseconds(0);
+    ASSERT_TRUE(m_device->RetrieveFiles(files, (m_dir / "local").string(), options).ok());
+    EXPECT_TRUE(std::filesystem::exists(m_dir / "local/capture.gfxr"));
+    EXPECT_TRUE(std::filesystem::exists(m_dir / "local/capture.gfxa"));
+}
+
+TEST_F(RetrieveFilesTest, ReportsFilesThatKeepFailing)
+{
+    std::vector<FileRetrieval> files(3);
+    files[0].remote_file_path = CreateRemoteFile("capture.gfxr", 10);
+    files[1].remote_file_path = "/sdcard/capture/missing.gfxa";
+    files[2].remote_file_path = CreateRemoteFile("screenshot.png", 30);
+    m_runner->FailPulls(files[0].remote_file_path, 3);
+
+    RetrieveFilesOptions options;
+    options.retry_delay = std::chrono::milliseconds(0);
+    absl::Status status = m_device->RetrieveFiles(files, (m_dir / "local").string(), options);
+    EXPECT_EQ(status.code(), absl::StatusCode::kInternal);
+    EXPECT_THAT(std::string(status.message()), testing::HasSubstr("2 of 3"));
+    EXPECT_THAT(std::string(status.message()), testing::HasSubstr("capture.gfxr"));
+    EXPECT_THAT(std::string(status.message()), testing::HasSubstr("missing.gfxa"));
+    // The other files are still retrieved
+    EXPECT_TRUE(std::filesystem::exists(m_dir / "local/screenshot.png"));
+}
+
 }  // namespace
 }  // namespace Dive
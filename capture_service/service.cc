@@ -20,10 +20,12 @@ limitations under the License.
 #include <filesystem>
 #include <fstream>
 #include <memory>
+#include <mutex>
 #include <string>
 
 #include "constants.h"
 #include "common/log.h"
+#include "network/file_transfer.h"
 #include "trace_mgr.h"
 
 namespace Dive
@@ -37,14 +39,15 @@ absl::Status SendPong(Network::SocketConnection *client_conn)
 
 absl::Status Handshake(Network::HandshakeRequest *request, Network::SocketConnection *client_conn)
 {
-    Network::HandshakeResponse response;
-    response.SetMajorVersion(request->GetMajorVersion());
-    response.SetMinorVersion(request->GetMinorVersion());
+    Network::HandshakeResponse response = Network::NegotiateHandshake(*request);
     return Network::SendMessage(client_conn, response);
 }
 
 absl::Status StartPm4Capture(Network::SocketConnection *client_conn)
 {
+    // Clients are served concurrently, but only one capture can run at a time.
+    static std::mutex           capture_mutex;
+    std::lock_guard<std::mutex> lock(capture_mutex);
     GetTraceMgr().TriggerTrace();
     GetTraceMgr().WaitForTraceDone();
     std::string capture_file_path = GetTraceMgr().GetTraceFilePath();
@@ -194,6 +197,26 @@ void ServerMessageHandler::HandleMessage(std::unique_ptr<Network::ISerializable>
         }
         break;
     }
+    case Network::MessageType::DOWNLOAD_FILE_RANGE_REQUEST:
+    {
+        LOGI("Message received: DownloadFileRangeRequest");
+        auto *request = dynamic_cast<Network::DownloadFileRangeRequest *>(message.get());
+        if (request)
+        {
+            auto status = Network::SendFileRange(client_conn, *request);
+            if (!status.ok())
+            {
+                LOGI("DownloadFileRange failed: %.*s",
+                     (int)status.message().length(),
+                     status.message().data());
+            }
+        }
+        else
+        {
+            LOGI("DownloadFileRangeRequest message is null.");
+        }
+        break;
+    }
     case Network::MessageType::FILE_SIZE_REQUEST:
     {
         LOGI("Message received: FileSizeRequest");
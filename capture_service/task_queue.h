@@ -14,11 +14,24 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <condition_variable>
+#include <cstddef>
+#include <cstdint>
 #include <deque>
+#include <exception>
 #include <functional>
+#include <future>
+#include <memory>
 #include <mutex>
+#include <stdexcept>
 #include <thread>
+#include <type_traits>
+#include <vector>
 
 namespace Dive
 {
@@ -60,71 +73,307 @@ public:
     // operator()() runs the task.
     void operator()() const { m_func(); }
 
+    explicit operator bool() const { return static_cast<bool>(m_func); }
+
 private:
     Function m_func;
 };
 
+// Tasks of a higher priority lane are always started before the ones of a lower lane.
+enum class TaskPriority : uint32_t
+{
+    kHigh = 0,    // Latency sensitive, e.g. triggering a capture.
+    kNormal = 1,  // Default.
+    kLow = 2,     // Bulk work, e.g. file transfers.
+};
+
+// Shared flag to cancel tasks. A task still queued when its token is cancelled is not run, and
+// its future holds a TaskCancelledError. A running task can poll IsCancelled() to stop early.
+class CancellationToken
+{
+public:
+    CancellationToken() :
+        m_cancelled(std::make_shared<std::atomic<bool>>(false))
+    {
+    }
+
+    void Cancel() { m_cancelled->store(true, std::memory_order_relaxed); }
+    bool IsCancelled() const { return m_cancelled->load(std::memory_order_relaxed); }
+
+private:
+    std::shared_ptr<std::atomic<bool>> m_cancelled;
+};
+
+class TaskCancelledError : public std::runtime_error
+{
+public:
+    TaskCancelledError() :
+        std::runtime_error("Task cancelled")
+    {
+    }
+};
+
+// A pool of worker threads running tasks by priority, then in submission order within a priority.
 class TaskRunner
 {
 public:
-    TaskRunner()
+    struct Options
+    {
+        uint32_t num_workers = 2;
+        // Workers that only run TaskPriority::kHigh tasks, so those never wait for a long task of a
+        // lower priority to finish. Included in num_workers.
+        uint32_t num_high_priority_workers = 0;
+        // Maximum number of queued tasks per priority, 0 for no limit. Scheduling to a full lane
+        // blocks until a worker takes one of its tasks, except from a worker, which runs the task
+        // inline instead since it could be the one expected to make room.
+        size_t max_queued_tasks = 0;
+    };
+
+    TaskRunner() :
+        TaskRunner(Options())
+    {
+    }
+
+    explicit TaskRunner(const Options& options) :
+        m_max_queued_tasks(options.max_queued_tasks)
     {
-        m_worker_thread = std::thread([this]() {
-            while (!this->m_shutdown)
+        const uint32_t num_workers = std::max(options.num_workers, 1u);
+        const uint32_t num_high_priority_workers = std::min(options.num_high_priority_workers,
+                                                            num_workers - 1);
+        m_worker_threads.reserve(num_workers);
+        for (uint32_t i = 0; i < num_workers; ++i)
+        {
+            const bool high_priority_only = i < num_high_priority_workers;
+            m_worker_threads.emplace_back([this, high_priority_only]() {
+                this->WorkerLoop(high_priority_only);
+            });
+        }
+    }
+
+    // Runs the tasks already started to completion. Queued tasks are cancelled.
+    ~TaskRunner()
+    {
+        NotifyShutdown();
+        for (auto& worker_thread : m_worker_threads)
+        {
+            if (worker_thread.joinable())
+            {
+                worker_thread.join();
+            }
+        }
+        for (auto& lane : m_lanes)
+        {
+            for (auto& entry : lane)
+            {
+                entry.cancel();
+            }
+            lane.clear();
+        }
+    }
+
+    TaskRunner(const TaskRunner&) = delete;
+    TaskRunner& operator=(const TaskRunner&) = delete;
+
+    // Queues a task without a way to get its result.
+    template<typename Function>
+    inline void Schedule(Function&&        f,
+                         TaskPriority      priority = TaskPriority::kNormal,
+                         CancellationToken token = CancellationToken())
+    {
+        Entry entry;
+        entry.run = Task(std::function<void()>(std::forward<Function>(f)));
+        entry.cancel = Task([]() {});
+        entry.token = std::move(token);
+        Enqueue(std::move(entry), priority);
+    }
+
+    // Queues a task and returns a future for its result. The future holds the exception thrown by
+    // the task, or TaskCancelledError if the task was cancelled before it started.
+    template<typename Function>
+    auto Submit(Function&&        f,
+                TaskPriority      priority = TaskPriority::kNormal,
+                CancellationToken token = CancellationToken())
+    -> std::future<std::invoke_result_t<std::decay_t<Function>>>
+    {
+        using Result = std::invoke_result_t<std::decay_t<Function>>;
+        auto promise = std::make_shared<std::promise<Result>>();
+        auto future = promise->get_future();
+
+        Entry entry;
+        entry.run = Task([promise, func = std::forward<Function>(f)]() mutable {
+            try
+            {
+                if constexpr (std::is_void_v<Result>)
+                {
+                    func();
+                    promise->set_value();
+                }
+                else
+                {
+                    promise->set_value(func());
+                }
+            }
+            catch (...)
             {
-                this->WaitForWork();
+                promise->set_exception(std::current_exception());
             }
         });
+        entry.cancel = Task([promise]() {
+            promise->set_exception(std::make_exception_ptr(TaskCancelledError()));
+        });
+        entry.token = std::move(token);
+        Enqueue(std::move(entry), priority);
+        return future;
     }
 
-    ~TaskRunner()
+    // Returns the number of tasks waiting for a worker.
+    size_t GetQueuedTaskCount() const
     {
-        NotifyShutdown();
-        if (m_worker_thread.joinable())
+        std::unique_lock<std::mutex> lock(m_mutex);
+        size_t                       count = 0;
+        for (const auto& lane : m_lanes)
         {
-            m_worker_thread.join();
+            count += lane.size();
         }
+        return count;
     }
 
-    template<typename Function> inline void Schedule(Function&& f)
+    // Blocks until no task is queued or running.
+    void WaitForIdle()
     {
-        Enqueue(Task(std::forward<Function>(f)));
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_idle_cond.wait(lock, [&]() { return m_num_running == 0 && IsEmpty(); });
     }
 
 private:
-    void Enqueue(Task&& task)
+    static constexpr size_t kNumPriorities = 3;
+
+    struct Entry
+    {
+        Task              run;
+        Task              cancel;
+        CancellationToken token;
+    };
+
+    void Enqueue(Entry&& entry, TaskPriority priority)
     {
         std::unique_lock<std::mutex> lock(m_mutex);
-        m_task_queue.push_back(std::move(task));
-        m_cond.notify_one();
+        auto&                        lane = m_lanes[static_cast<size_t>(priority)];
+        if (!m_shutdown && m_max_queued_tasks != 0 && lane.size() >= m_max_queued_tasks &&
+            IsWorkerThread())
+        {
+            // Waiting here could deadlock if every worker is waiting for room in the lane.
+            lock.unlock();
+            RunEntry(entry);
+            return;
+        }
+        m_space_cond.wait(lock, [&]() {
+            return m_shutdown || m_max_queued_tasks == 0 || lane.size() < m_max_queued_tasks;
+        });
+        if (m_shutdown)
+        {
+            lock.unlock();
+            entry.cancel();
+            return;
+        }
+        lane.push_back(std::move(entry));
+        // Some workers only wait for high priority tasks, so wake them all.
+        m_cond.notify_all();
     }
 
     void NotifyShutdown()
     {
         std::unique_lock<std::mutex> lock(m_mutex);
         m_shutdown = true;
-        m_cond.notify_one();
+        m_cond.notify_all();
+        m_space_cond.notify_all();
     }
 
-    void WaitForWork()
+    bool IsWorkerThread() const
     {
-        std::unique_lock<std::mutex> lock(m_mutex);
-        m_cond.wait(lock, [&]() { return !m_task_queue.empty() || m_shutdown; });
-        if (m_shutdown)
+        const std::thread::id id = std::this_thread::get_id();
+        return std::any_of(m_worker_threads.begin(),
+                           m_worker_threads.end(),
+                           [id](const std::thread& worker) { return worker.get_id() == id; });
+    }
+
+    static void RunEntry(Entry& entry)
+    {
+        if (entry.token.IsCancelled())
         {
-            return;
+            entry.cancel();
         }
-        auto work = std::move(m_task_queue.front());
-        m_task_queue.pop_front();
-        lock.unlock();
+        else
+        {
+            entry.run();
+        }
+    }
 
-        work();
+    bool IsEmpty() const
+    {
+        for (const auto& lane : m_lanes)
+        {
+            if (!lane.empty())
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Returns the queue the worker should take its next task from, or nullptr if there is none.
+    std::deque<Entry>* GetNextLane(bool high_priority_only)
+    {
+        const size_t num_lanes = high_priority_only ? 1 : kNumPriorities;
+        for (size_t i = 0; i < num_lanes; ++i)
+        {
+            if (!m_lanes[i].empty())
+            {
+                return &m_lanes[i];
+            }
+        }
+        return nullptr;
+    }
+
+    void WorkerLoop(bool high_priority_only)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true)
+        {
+            std::deque<Entry>* lane = nullptr;
+            m_cond.wait(lock, [&]() {
+                lane = GetNextLane(high_priority_only);
+                return m_shutdown || lane != nullptr;
+            });
+            if (m_shutdown)
+            {
+                return;
+            }
+            Entry entry = std::move(lane->front());
+            lane->pop_front();
+            ++m_num_running;
+            m_space_cond.notify_all();
+            lock.unlock();
+
+            RunEntry(entry);
+
+            lock.lock();
+            --m_num_running;
+            if (m_num_running == 0 && IsEmpty())
+            {
+                m_idle_cond.notify_all();
+            }
+        }
     }
 
-    std::mutex              m_mutex;
-    std::condition_variable m_cond;
-    std::deque<Task>        m_task_queue;
-    bool                    m_shutdown = false;
-    std::thread             m_worker_thread;
+    mutable std::mutex                            m_mutex;
+    std::condition_variable                       m_cond;
+    std::condition_variable                       m_space_cond;
+    std::condition_variable                       m_idle_cond;
+    std::array<std::deque<Entry>, kNumPriorities> m_lanes;
+    const size_t                                  m_max_queued_tasks;
+    uint32_t                                      m_num_running = 0;
+    bool                                          m_shutdown = false;
+    std::vector<std::thread>                      m_worker_threads;
 };
-}  // namespace Dive
\ No newline at end of file
+}  // namespace Dive
@@ -0,0 +1,250 @@
+/*
+Copyright 2025 Google Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "task_queue.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace Dive
+{
+namespace
+{
+
+// Blocks a worker until released
+class Gate
+{
+public:
+    void Wait()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_entered = true;
+        m_cond.notify_all();
+        m_cond.wait(lock, [this] { return m_open; });
+    }
+
+    void WaitEntered()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cond.wait(lock, [this] { return m_entered; });
+    }
+
+    void Open()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_open = true;
+        m_cond.notify_all();
+    }
+
+private:
+    std::mutex              m_mutex;
+    std::condition_variable m_cond;
+    bool                    m_entered = false;
+    bool                    m_open = false;
+};
+
+TEST(TaskRunnerTest, SubmitReturnsResult)
+{
+    TaskRunner       runner;
+    std::future<int> result = runner.Submit([]() { return 42; });
+    EXPECT_EQ(result.get(), 42);
+
+    std::future<void> thrown = runner.Submit([]() { throw std::runtime_error("failed"); });
+    EXPECT_THROW(thrown.get(), std::runtime_error);
+}
+
+TEST(TaskRunnerTest, HigherPriorityRunsFirst)
+{
+    TaskRunner::Options options;
+    options.num_workers = 1;
+    TaskRunner runner(options);
+
+    // Keep the only worker busy while the other tasks are queued
+    Gate gate;
+    runner.Schedule([&gate]() { gate.Wait(); });
+    gate.WaitEntered();
+
+    std::mutex               order_mutex;
+    std::vector<std::string> order;
+    auto                     Record = [&](std::string name) {
+        return [&, name]() {
+            std::lock_guard<std::mutex> lock(order_mutex);
+            order.push_back(name);
+        };
+    };
+    runner.Schedule(Record("low1"), TaskPriority::kLow);
+    runner.Schedule(Record("normal1"), TaskPriority::kNormal);
+    runner.Schedule(Record("high1"), TaskPriority::kHigh);
+    runner.Schedule(Record("low2"), TaskPriority::kLow);
+    runner.Schedule(Record("high2"), TaskPriority::kHigh);
+    EXPECT_EQ(runner.GetQueuedTaskCount(), 5u);
+
+    gate.Open();
+    runner.WaitForIdle();
+    EXPECT_EQ(order,
+              (std::vector<std::string>{ "high1", "high2", "normal1", "low1", "low2" }));
+}
+
+TEST(TaskRunnerTest, HighPriorityWorkerIsNotBlockedByBulkTasks)
+{
+    TaskRunner::Options options;
+    options.num_workers = 2;
+    options.num_high_priority_workers = 1;
+    TaskRunner runner(options);
+
+    // The bulk task occupies the only general worker
+    Gate bulk;
+    runner.Schedule([&bulk]() { bulk.Wait(); }, TaskPriority::kLow);
+    bulk.WaitEntered();
+
+    std::future<int> normal = runner.Submit([]() { return 1; }, TaskPriority::kNormal);
+    std::future<int> high = runner.Submit([]() { return 2; }, TaskPriority::kHigh);
+    EXPECT_EQ(high.get(), 2);
+    EXPECT_EQ(normal.wait_for(std::chrono::milliseconds(50)), std::future_status::timeout);
+
+    bulk.Open();
+    EXPECT_EQ(normal.get(), 1);
+}
+
+TEST(TaskRunnerTest, CancelledTaskDoesNotRun)
+{
+    TaskRunner::Options options;
+    options.num_workers = 1;
+    TaskRunner runner(options);
+
+    Gate gate;
+    runner.Schedule([&gate]() { gate.Wait(); });
+    gate.WaitEntered();
+
+    CancellationToken token;
+    std::atomic<bool> ran = false;
+    std::future<void> cancelled = runner.Submit([&ran]() { ran = true; },
+                                                TaskPriority::kNormal,
+                                                token);
+    std::future<int>  other = runner.Submit([]() { return 7; });
+    token.Cancel();
+
+    gate.Open();
+    EXPECT_THROW(cancelled.get(), TaskCancelledError);
+    EXPECT_EQ(other.get(), 7);
+    EXPECT_FALSE(ran);
+}
+
+TEST(TaskRunnerTest, RunningTaskObservesCancellation)
+{
+    TaskRunner        runner;
+    CancellationToken token;
+    Gate              started;
+    std::future<int>  result = runner.Submit(
+    [&started, token]() {
+        int iterations = 0;
+        started.Open();
+        while (!token.IsCancelled())
+        {
+            ++iterations;
+            std::this_thread::yield();
+        }
+        return iterations;
+    },
+    TaskPriority::kLow,
+    token);
+
+    started.Wait();
+    token.Cancel();
+    EXPECT_GE(result.get(), 0);
+}
+
+TEST(TaskRunnerTest, BoundedQueueBlocksProducer)
+{
+    TaskRunner::Options options;
+    options.num_workers = 1;
+    options.max_queued_tasks = 1;
+    TaskRunner runner(options);
+
+    Gate gate;
+    runner.Schedule([&gate]() { gate.Wait(); });
+    gate.WaitEntered();
+    runner.Schedule([]() {});
+
+    // The lane is full, so the producer waits for the worker
+    std::atomic<bool> scheduled = false;
+    std::thread       producer([&]() {
+        runner.Schedule([]() {});
+        scheduled = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_FALSE(scheduled);
+
+    // Other lanes are not affected
+    std::future<int> high = runner.Submit([]() { return 3; }, TaskPriority::kHigh);
+
+    gate.Open();
+    producer.join();
+    EXPECT_TRUE(scheduled);
+    EXPECT_EQ(high.get(), 3);
+    runner.WaitForIdle();
+    EXPECT_EQ(runner.GetQueuedTaskCount(), 0u);
+}
+
+TEST(TaskRunnerTest, BoundedQueueRunsInlineOnWorker)
+{
+    TaskRunner::Options options;
+    options.num_workers = 1;
+    options.max_queued_tasks = 1;
+    TaskRunner runner(options);
+
+    // The only worker fills the lane, then schedules more: waiting for room would deadlock
+    std::atomic<int>  ran = 0;
+    std::future<void> producer = runner.Submit([&]() {
+        for (int i = 0; i < 3; ++i)
+        {
+            runner.Schedule([&ran]() { ++ran; });
+        }
+    });
+    producer.get();
+    runner.WaitForIdle();
+    EXPECT_EQ(ran, 3);
+}
+
+TEST(TaskRunnerTest, DestructorCancelsQueuedTasks)
+{
+    Gate              gate;
+    std::thread       opener;
+    std::future<void> queued;
+    {
+        TaskRunner::Options options;
+        options.num_workers = 1;
+        TaskRunner runner(options);
+
+        runner.Schedule([&gate]() { gate.Wait(); });
+        gate.WaitEntered();
+        queued = runner.Submit([]() {});
+
+        // Let the destructor signal the shutdown before the running task returns
+        opener = std::thread([&gate]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            gate.Open();
+        });
+    }
+    opener.join();
+    EXPECT_THROW(queued.get(), TaskCancelledError);
+}
+
+}  // namespace
+}  // namespace Dive
@@ -34,7 +34,18 @@ std::string FileFormatVersion();
 
 //--------------------------------------------------------------------------------------------------
 // Dive Capture / Crash Analysis related
-int ExtractCapture(const char *filename, const char *extract_assets);
+struct ExtractOptions
+{
+    // Also write the disassembly of each shader, and the data of each captured memory block
+    bool m_dump_shaders = false;
+    bool m_dump_buffers = false;
+    // Number of threads writing the outputs, 0 for one per hardware thread
+    uint32_t m_num_workers = 0;
+};
+
+int ExtractCapture(const char           *filename,
+                   const char           *extract_assets,
+                   const ExtractOptions &options = ExtractOptions());
 
 }  // namespace cli
 }  // namespace Dive
@@ -0,0 +1,1024 @@
+/*
+ Copyright 2025 Google LLC
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <numeric>
+
+#include "dive_core/capture_event_info.h"
+#include "dive_core/common/mapped_file.h"
+#include "dive_core/data_core.h"
+#include "dive_core/dive_strings.h"
+#include "pm4_info.h"
+
+#include "columnar_export.h"
+#include "format_output.h"
+
+namespace Dive
+{
+namespace cli
+{
+
+namespace
+{
+
+const char *kRenderModeStrings[] = {
+    "Direct", "Binning", "Tiled", "Resolve", "Dispatch", "Unknown",
+};
+static_assert(sizeof(kRenderModeStrings) / sizeof(kRenderModeStrings[0]) ==
+              static_cast<size_t>(Dive::RenderModeType::kUnknown) + 1,
+              "Missing render mode string");
+
+const char *kEventTypeStrings[] = {
+    "Draw",
+    "Dispatch",
+    "Blit",
+    "GmemToSysmemResolve",
+    "GmemToSysMemResolveAndClearGmem",
+    "ClearGmem",
+    "SysmemToGmemResolve",
+    "WaitMemWrites",
+    "WaitForIdle",
+    "WaitForMe",
+    "EventWriteStart",
+    "EventWriteEnd",
+};
+static_assert(sizeof(kEventTypeStrings) / sizeof(kEventTypeStrings[0]) ==
+              static_cast<size_t>(Dive::EventInfo::EventType::kEventWriteEnd) + 1,
+              "Missing event type string");
+
+//--------------------------------------------------------------------------------------------------
+// Smallest byte width that holds the values, with the all ones value of the width left for nulls
+uint32_t GetValueWidth(const std::vector<uint64_t> &values)
+{
+    uint64_t max_value = 0;
+    for (uint64_t value : values)
+    {
+        if (value != Column::kNull)
+            max_value = std::max(max_value, value);
+    }
+    if (max_value < UINT8_MAX)
+        return 1;
+    if (max_value < UINT16_MAX)
+        return 2;
+    if (max_value < UINT32_MAX)
+        return 4;
+    return 8;
+}
+
+//--------------------------------------------------------------------------------------------------
+void WriteString(std::ostream &out, const std::string &str)
+{
+    uint32_t size = static_cast<uint32_t>(str.size());
+    out.write(reinterpret_cast<const char *>(&size), sizeof(size));
+    out.write(str.data(), size);
+}
+
+//--------------------------------------------------------------------------------------------------
+bool ReadBytes(const uint8_t **data, const uint8_t *end, void *dst, size_t size)
+{
+    if (static_cast<size_t>(end - *data) < size)
+        return false;
+    memcpy(dst, *data, size);
+    *data += size;
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+bool ReadString(const uint8_t **data, const uint8_t *end, std::string *str)
+{
+    uint32_t size = 0;
+    if (!ReadBytes(data, end, &size, sizeof(size)) || static_cast<size_t>(end - *data) < size)
+        return false;
+    str->assign(reinterpret_cast<const char *>(*data), size);
+    *data += size;
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Adds the packets and register writes of the capture to their tables, while counting the events
+// the same way as CaptureMetadataCreator, so that their event column indexes the events table.
+class ColumnarExportCreator : public Dive::EmulateCallbacksBase
+{
+public:
+    ColumnarExportCreator(Table &packets, Table &registers);
+
+    void OnSubmitStart(uint32_t submit_index, const Dive::SubmitInfo &submit_info) override {}
+    void OnSubmitEnd(uint32_t submit_index, const Dive::SubmitInfo &submit_info) override {}
+
+    bool OnIbStart(uint32_t                        submit_index,
+                   uint32_t                        ib_index,
+                   const Dive::IndirectBufferInfo &ib_info,
+                   Dive::IbType                    type) override;
+
+    bool OnPacket(const Dive::IMemoryManager &mem_manager,
+                  uint32_t                    submit_index,
+                  uint32_t                    ib_index,
+                  uint64_t                    va_addr,
+                  Dive::Pm4Header             header) override;
+
+private:
+    uint32_t m_ib_level = 1;
+    uint64_t m_num_events = 0;
+
+    Column &m_packet_index;
+    Column &m_packet_submit;
+    Column &m_packet_ib_level;
+    Column &m_packet_va;
+    Column &m_packet_opcode;
+    Column &m_packet_dwords;
+    Column &m_packet_event;
+
+    Column &m_reg_packet;
+    Column &m_reg_submit;
+    Column &m_reg_event;
+    Column &m_reg_va;
+    Column &m_reg_offset;
+    Column &m_reg_name;
+    Column &m_reg_value;
+};
+
+//--------------------------------------------------------------------------------------------------
+ColumnarExportCreator::ColumnarExportCreator(Table &packets, Table &registers) :
+    m_packet_index(packets.AddColumn("index", ColumnType::kUint)),
+    m_packet_submit(packets.AddColumn("submit", ColumnType::kUint)),
+    m_packet_ib_level(packets.AddColumn("ib_level", ColumnType::kUint)),
+    m_packet_va(packets.AddColumn("va", ColumnType::kUint)),
+    m_packet_opcode(packets.AddColumn("opcode", ColumnType::kString)),
+    m_packet_dwords(packets.AddColumn("dwords", ColumnType::kUint)),
+    m_packet_event(packets.AddColumn("event", ColumnType::kUint)),
+    m_reg_packet(registers.AddColumn("packet", ColumnType::kUint)),
+    m_reg_submit(registers.AddColumn("submit", ColumnType::kUint)),
+    m_reg_event(registers.AddColumn("event", ColumnType::kUint)),
+    m_reg_va(registers.AddColumn("va", ColumnType::kUint)),
+    m_reg_offset(registers.AddColumn("offset", ColumnType::kUint)),
+    m_reg_name(registers.AddColumn("name", ColumnType::kString)),
+    m_reg_value(registers.AddColumn("value", ColumnType::kUint))
+{
+}
+
+//--------------------------------------------------------------------------------------------------
+bool ColumnarExportCreator::OnIbStart(uint32_t                        submit_index,
+                                      uint32_t                        ib_index,
+                                      const Dive::IndirectBufferInfo &ib_info,
+                                      Dive::IbType                    type)
+{
+    EmulateCallbacksBase::OnIbStart(submit_index, ib_index, ib_info, type);
+    m_ib_level = ib_info.m_ib_level;
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+bool ColumnarExportCreator::OnPacket(const Dive::IMemoryManager &mem_manager,
+                                     uint32_t                    submit_index,
+                                     uint32_t                    ib_index,
+                                     uint64_t                    va_addr,
+                                     Dive::Pm4Header             header)
+{
+    if (!EmulateCallbacksBase::OnPacket(mem_manager, submit_index, ib_index, va_addr, header))
+        return false;
+    if ((header.type != 4) && (header.type != 7))
+        return true;
+
+    // A packet belongs to the next event, i.e. the one its register writes are set up for
+    uint64_t packet_index = m_packet_index.GetNumRows();
+    m_packet_index.AppendUint(packet_index);
+    m_packet_submit.AppendUint(submit_index);
+    m_packet_ib_level.AppendUint(m_ib_level);
+    m_packet_va.AppendUint(va_addr);
+    if (header.type == 4)
+    {
+        m_packet_opcode.AppendString("TYPE4 REGWRITE");
+        m_packet_dwords.AppendUint(header.type4.count);
+    }
+    else
+    {
+        m_packet_opcode.AppendString(GetOpCodeString(header.type7.opcode));
+        m_packet_dwords.AppendUint(header.type7.count);
+    }
+    m_packet_event.AppendUint(m_num_events);
+
+    auto add_register = [&](uint32_t reg_offset, uint64_t reg_value, const RegInfo *reg_info_ptr) {
+        m_reg_packet.AppendUint(packet_index);
+        m_reg_submit.AppendUint(submit_index);
+        m_reg_event.AppendUint(m_num_events);
+        m_reg_va.AppendUint(va_addr);
+        m_reg_offset.AppendUint(reg_offset);
+        m_reg_name.AppendString(reg_info_ptr ? reg_info_ptr->m_name : "Unknown");
+        m_reg_value.AppendUint(reg_value);
+    };
+    ForEachRegisterWrite(mem_manager, submit_index, va_addr, header, add_register);
+
+    if (header.type == 7 &&
+        Util::IsEvent(mem_manager, submit_index, va_addr, header.type7.opcode, m_state_tracker))
+    {
+        m_num_events++;
+    }
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// The render mode of the event of each row of a table with an event column
+void AddRenderModeColumn(Table &table, const std::vector<Dive::EventInfo> &event_info)
+{
+    const Column &event_column = *table.FindColumn("event");
+    Column       &render_mode_column = table.AddColumn("render_mode", ColumnType::kString);
+    for (uint64_t event : event_column.GetValues())
+    {
+        if (event < event_info.size())
+        {
+            uint32_t render_mode = static_cast<uint32_t>(event_info[event].m_render_mode);
+            render_mode_column.AppendString(kRenderModeStrings[render_mode]);
+        }
+        else
+        {
+            render_mode_column.AppendString(nullptr);
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Appends the value of the state of the event, or a null if the state isn't set
+#define APPEND_STATE(column, state, to_value)                                    \
+    column.AppendUint(event_state_it->Is##state##Set() ?                         \
+                      static_cast<uint64_t>(to_value(event_state_it->state())) : \
+                      Column::kNull)
+#define APPEND_STATE_STRING(column, state, to_string)                                        \
+    column.AppendString(event_state_it->Is##state##Set() ? to_string(event_state_it->state()) : \
+                                                           nullptr)
+
+void AddEventsTable(Table &events, const Dive::CaptureMetadata &meta_data)
+{
+    auto as_is = [](auto value) { return value; };
+
+    Column &index = events.AddColumn("index", ColumnType::kUint);
+    Column &submit = events.AddColumn("submit", ColumnType::kUint);
+    Column &type = events.AddColumn("type", ColumnType::kString);
+    Column &render_mode = events.AddColumn("render_mode", ColumnType::kString);
+    Column &num_indices = events.AddColumn("num_indices", ColumnType::kUint);
+    Column &description = events.AddColumn("description", ColumnType::kString);
+    Column &topology = events.AddColumn("topology", ColumnType::kString);
+    Column &prim_restart = events.AddColumn("prim_restart", ColumnType::kUint);
+    Column &polygon_mode = events.AddColumn("polygon_mode", ColumnType::kString);
+    Column &cull_mode = events.AddColumn("cull_mode", ColumnType::kString);
+    Column &front_face = events.AddColumn("front_face", ColumnType::kString);
+    Column &rasterizer_discard = events.AddColumn("rasterizer_discard", ColumnType::kUint);
+    Column &depth_clamp = events.AddColumn("depth_clamp", ColumnType::kUint);
+    Column &depth_bias = events.AddColumn("depth_bias", ColumnType::kUint);
+    Column &samples = events.AddColumn("samples", ColumnType::kString);
+    Column &depth_test = events.AddColumn("depth_test", ColumnType::kUint);
+    Column &depth_write = events.AddColumn("depth_write", ColumnType::kUint);
+    Column &depth_compare_op = events.AddColumn("depth_compare_op", ColumnType::kString);
+    Column &depth_bounds_test = events.AddColumn("depth_bounds_test", ColumnType::kUint);
+    Column &stencil_test = events.AddColumn("stencil_test", ColumnType::kUint);
+    Column &lrz = events.AddColumn("lrz", ColumnType::kUint);
+    Column &lrz_write = events.AddColumn("lrz_write", ColumnType::kUint);
+    Column &lrz_dir_status = events.AddColumn("lrz_dir_status", ColumnType::kUint);
+    Column &z_test_mode = events.AddColumn("z_test_mode", ColumnType::kUint);
+    Column &bin_w = events.AddColumn("bin_w", ColumnType::kUint);
+    Column &bin_h = events.AddColumn("bin_h", ColumnType::kUint);
+    Column &window_scissor_tl_x = events.AddColumn("window_scissor_tl_x", ColumnType::kUint);
+    Column &window_scissor_tl_y = events.AddColumn("window_scissor_tl_y", ColumnType::kUint);
+    Column &window_scissor_br_x = events.AddColumn("window_scissor_br_x", ColumnType::kUint);
+    Column &window_scissor_br_y = events.AddColumn("window_scissor_br_y", ColumnType::kUint);
+    Column &buffers_location = events.AddColumn("buffers_location", ColumnType::kUint);
+    Column &thread_size = events.AddColumn("thread_size", ColumnType::kUint);
+
+    const Dive::EventStateInfo &event_state = meta_data.m_event_state;
+    for (size_t event = 0; event < meta_data.m_event_info.size(); ++event)
+    {
+        const Dive::EventInfo &info = meta_data.m_event_info[event];
+        index.AppendUint(event);
+        submit.AppendUint(info.m_submit_index);
+        type.AppendString(kEventTypeStrings[static_cast<uint32_t>(info.m_type)]);
+        render_mode.AppendString(kRenderModeStrings[static_cast<uint32_t>(info.m_render_mode)]);
+        num_indices.AppendUint((info.m_type == Dive::EventInfo::EventType::kDraw) ?
+                               info.m_num_indices :
+                               Column::kNull);
+        description.AppendString(info.m_str.c_str());
+
+        auto event_state_it = event_state.find(static_cast<Dive::EventStateId>(event));
+        APPEND_STATE_STRING(topology, Topology, GetVkPrimitiveTopology);
+        APPEND_STATE(prim_restart, PrimRestartEnabled, as_is);
+        APPEND_STATE_STRING(polygon_mode, PolygonMode, GetVkPolygonMode);
+        APPEND_STATE_STRING(cull_mode, CullMode, GetVkCullModeFlags);
+        APPEND_STATE_STRING(front_face, FrontFace, GetVkFrontFace);
+        APPEND_STATE(rasterizer_discard, RasterizerDiscardEnabled, as_is);
+        APPEND_STATE(depth_clamp, DepthClampEnabled, as_is);
+        APPEND_STATE(depth_bias, DepthBiasEnabled, as_is);
+        APPEND_STATE_STRING(samples, RasterizationSamples, GetVkSampleCountFlags);
+        APPEND_STATE(depth_test, DepthTestEnabled, as_is);
+        APPEND_STATE(depth_write, DepthWriteEnabled, as_is);
+        APPEND_STATE_STRING(depth_compare_op, DepthCompareOp, GetVkCompareOp);
+        APPEND_STATE(depth_bounds_test, DepthBoundsTestEnabled, as_is);
+        APPEND_STATE(stencil_test, StencilTestEnabled, as_is);
+        APPEND_STATE(lrz, LRZEnabled, as_is);
+        APPEND_STATE(lrz_write, LRZWrite, as_is);
+        APPEND_STATE(lrz_dir_status, LRZDirStatus, as_is);
+        APPEND_STATE(z_test_mode, ZTestMode, as_is);
+        APPEND_STATE(bin_w, BinW, as_is);
+        APPEND_STATE(bin_h, BinH, as_is);
+        APPEND_STATE(window_scissor_tl_x, WindowScissorTLX, as_is);
+        APPEND_STATE(window_scissor_tl_y, WindowScissorTLY, as_is);
+        APPEND_STATE(window_scissor_br_x, WindowScissorBRX, as_is);
+        APPEND_STATE(window_scissor_br_y, WindowScissorBRY, as_is);
+        APPEND_STATE(buffers_location, BuffersLocation, as_is);
+        APPEND_STATE(thread_size, ThreadSize, as_is);
+    }
+}
+
+#undef APPEND_STATE
+#undef APPEND_STATE_STRING
+
+//--------------------------------------------------------------------------------------------------
+// Keeps the rows of the selection for which matches(value) is true, in place
+template<typename Matches>
+void FilterRows(const std::vector<uint64_t> &values, std::vector<size_t> *rows, Matches matches)
+{
+    size_t num_kept = 0;
+    for (size_t row : *rows)
+    {
+        if (matches(values[row]))
+            (*rows)[num_kept++] = row;
+    }
+    rows->resize(num_kept);
+}
+
+//--------------------------------------------------------------------------------------------------
+bool ApplyFilter(const Table &table, const ColumnQuery::Filter &filter, std::vector<size_t> *rows)
+{
+    using CompareOp = ColumnQuery::CompareOp;
+    const Column *column = table.FindColumn(filter.m_column);
+    if (column == nullptr)
+    {
+        std::cerr << "Unknown column: " << filter.m_column << std::endl;
+        return false;
+    }
+
+    // "-" stands for the null value, which only == and != can compare with
+    const bool is_null = (filter.m_value == "-");
+    const bool is_ordered = (filter.m_op != CompareOp::kEqual &&
+                             filter.m_op != CompareOp::kNotEqual);
+    uint64_t value = Column::kNull;
+    if (is_null)
+    {
+        if (is_ordered)
+        {
+            std::cerr << "Only == and != can compare with a null value" << std::endl;
+            return false;
+        }
+    }
+    else if (column->GetType() == ColumnType::kString)
+    {
+        if (is_ordered)
+        {
+            std::cerr << "Only == and != can compare the string column: " << filter.m_column
+                      << std::endl;
+            return false;
+        }
+        value = column->FindString(filter.m_value);
+        if (value == Column::kNull)
+        {
+            // No row holds the string
+            if (filter.m_op == CompareOp::kEqual)
+            {
+                rows->clear();
+            }
+            else
+            {
+                auto is_not_null = [](uint64_t v) { return v != Column::kNull; };
+                FilterRows(column->GetValues(), rows, is_not_null);
+            }
+            return true;
+        }
+    }
+    else
+    {
+        char *end = nullptr;
+        errno = 0;
+        value = strtoull(filter.m_value.c_str(), &end, 0);
+        if (filter.m_value.empty() || *end != '\0')
+        {
+            std::cerr << "Invalid value for column " << filter.m_column << ": " << filter.m_value
+                      << std::endl;
+            return false;
+        }
+        // strtoull() negates negative values, and the largest value is the null value
+        if (errno == ERANGE || filter.m_value.find('-') != std::string::npos ||
+            value == Column::kNull)
+        {
+            std::cerr << "Out of range value for column " << filter.m_column << ": "
+                      << filter.m_value << std::endl;
+            return false;
+        }
+    }
+
+    const std::vector<uint64_t> &values = column->GetValues();
+    if (is_null)
+    {
+        // Both sides are nulls, so plain (in)equality is right
+        if (filter.m_op == CompareOp::kEqual)
+            FilterRows(values, rows, [](uint64_t v) { return v == Column::kNull; });
+        else
+            FilterRows(values, rows, [](uint64_t v) { return v != Column::kNull; });
+        return true;
+    }
+
+    // The null rows never match a comparison with a value
+    switch (filter.m_op)
+    {
+    case CompareOp::kEqual:
+        FilterRows(values, rows, [value](uint64_t v) { return v == value; });
+        break;
+    case CompareOp::kNotEqual:
+        FilterRows(values, rows, [value](uint64_t v) {
+            return v != value && v != Column::kNull;
+        });
+        break;
+    case CompareOp::kLess:
+        FilterRows(values, rows, [value](uint64_t v) { return v < value; });
+        break;
+    case CompareOp::kLessEqual:
+        FilterRows(values, rows, [value](uint64_t v) { return v <= value && v != Column::kNull; });
+        break;
+    case CompareOp::kGreater:
+        FilterRows(values, rows, [value](uint64_t v) { return v > value && v != Column::kNull; });
+        break;
+    case CompareOp::kGreaterEqual:
+        FilterRows(values, rows, [value](uint64_t v) { return v >= value && v != Column::kNull; });
+        break;
+    }
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+struct Accumulator
+{
+    uint64_t m_count = 0;
+    uint64_t m_sum = 0;
+    uint64_t m_min = Column::kNull;
+    uint64_t m_max = Column::kNull;
+
+    void Add(uint64_t value)
+    {
+        m_count++;
+        if (value == Column::kNull)
+            return;
+        m_sum += value;
+        m_min = (m_min == Column::kNull) ? value : std::min(m_min, value);
+        m_max = (m_max == Column::kNull) ? value : std::max(m_max, value);
+    }
+};
+
+//--------------------------------------------------------------------------------------------------
+bool RunAggregate(std::ostream              &out,
+                  const Table               &table,
+                  const ColumnQuery         &query,
+                  const std::vector<size_t> &rows)
+{
+    using Aggregate = ColumnQuery::Aggregate;
+    const Column *group_by = nullptr;
+    if (!query.m_group_by.empty())
+    {
+        group_by = table.FindColumn(query.m_group_by);
+        if (group_by == nullptr)
+        {
+            std::cerr << "Unknown column: " << query.m_group_by << std::endl;
+            return false;
+        }
+    }
+    const Column *aggregated = nullptr;
+    if (query.m_aggregate != Aggregate::kNone && query.m_aggregate != Aggregate::kCount)
+    {
+        aggregated = table.FindColumn(query.m_aggregate_column);
+        if (aggregated == nullptr || aggregated->GetType() != ColumnType::kUint)
+        {
+            std::cerr << "Not an integer column: " << query.m_aggregate_column << std::endl;
+            return false;
+        }
+    }
+
+    // Single group when there is no group-by column
+    std::unordered_map<uint64_t, Accumulator> groups;
+    const std::vector<uint64_t>              *keys = group_by ? &group_by->GetValues() : nullptr;
+    const std::vector<uint64_t>              *values = aggregated ? &aggregated->GetValues() :
+                                                                    nullptr;
+    for (size_t row : rows)
+    {
+        Accumulator &accumulator = groups[keys ? (*keys)[row] : 0];
+        accumulator.Add(values ? (*values)[row] : 0);
+    }
+
+    std::vector<uint64_t> sorted_keys;
+    sorted_keys.reserve(groups.size());
+    for (const auto &group : groups)
+        sorted_keys.push_back(group.first);
+    if (group_by && group_by->GetType() == ColumnType::kString)
+    {
+        std::sort(sorted_keys.begin(), sorted_keys.end(), [group_by](uint64_t a, uint64_t b) {
+            if (a == Column::kNull || b == Column::kNull)
+                return b == Column::kNull && a != Column::kNull;
+            return group_by->GetString(a) < group_by->GetString(b);
+        });
+    }
+    else
+    {
+        std::sort(sorted_keys.begin(), sorted_keys.end());
+    }
+    if (group_by == nullptr && sorted_keys.empty())
+        sorted_keys.push_back(0);
+
+    if (group_by)
+        out << group_by->GetName() << "\t";
+    switch (query.m_aggregate)
+    {
+    case Aggregate::kNone:
+    case Aggregate::kCount:
+        out << "count";
+        break;
+    case Aggregate::kSum:
+        out << "sum(" << aggregated->GetName() << ")";
+        break;
+    case Aggregate::kMin:
+        out << "min(" << aggregated->GetName() << ")";
+        break;
+    case Aggregate::kMax:
+        out << "max(" << aggregated->GetName() << ")";
+        break;
+    }
+    out << "\n";
+
+    uint64_t num_printed = 0;
+    for (uint64_t key : sorted_keys)
+    {
+        if (num_printed++ == query.m_limit)
+            break;
+        if (group_by)
+        {
+            if (key == Column::kNull)
+                out << "-";
+            else if (group_by->GetType() == ColumnType::kString)
+                out << group_by->GetString(key);
+            else
+                out << key;
+            out << "\t";
+        }
+        const Accumulator &accumulator = groups[key];
+        uint64_t           result = Column::kNull;
+        switch (query.m_aggregate)
+        {
+        case Aggregate::kNone:
+        case Aggregate::kCount:
+            result = accumulator.m_count;
+            break;
+        case Aggregate::kSum:
+            result = accumulator.m_sum;
+            break;
+        case Aggregate::kMin:
+            result = accumulator.m_min;
+            break;
+        case Aggregate::kMax:
+            result = accumulator.m_max;
+            break;
+        }
+        if (result == Column::kNull)
+            out << "-";
+        else
+            out << result;
+        out << "\n";
+    }
+    return true;
+}
+
+}  // namespace
+
+//--------------------------------------------------------------------------------------------------
+Column::Column(std::string name, ColumnType type) :
+    m_name(std::move(name)),
+    m_type(type)
+{
+}
+
+//--------------------------------------------------------------------------------------------------
+void Column::AppendUint(uint64_t value)
+{
+    m_values.push_back(value);
+}
+
+//--------------------------------------------------------------------------------------------------
+void Column::AppendString(const char *str)
+{
+    if (str == nullptr)
+    {
+        m_values.push_back(kNull);
+        return;
+    }
+    auto it = m_dictionary_ids.find(str);
+    if (it == m_dictionary_ids.end())
+    {
+        it = m_dictionary_ids.emplace(str, m_dictionary.size()).first;
+        m_dictionary.push_back(str);
+    }
+    m_values.push_back(it->second);
+}
+
+//--------------------------------------------------------------------------------------------------
+uint64_t Column::FindString(const std::string &str) const
+{
+    auto it = m_dictionary_ids.find(str);
+    return (it != m_dictionary_ids.end()) ? it->second : kNull;
+}
+
+//--------------------------------------------------------------------------------------------------
+void Column::PrintValue(std::ostream &out, size_t row) const
+{
+    uint64_t value = m_values[row];
+    if (value == kNull)
+        out << "-";
+    else if (m_type == ColumnType::kString)
+        out << m_dictionary[value];
+    else
+        out << value;
+}
+
+//--------------------------------------------------------------------------------------------------
+bool Column::Save(std::ostream &out) const
+{
+    uint8_t type = static_cast<uint8_t>(m_type);
+    uint8_t width = static_cast<uint8_t>(GetValueWidth(m_values));
+    WriteString(out, m_name);
+    out.write(reinterpret_cast<const char *>(&type), sizeof(type));
+    out.write(reinterpret_cast<const char *>(&width), sizeof(width));
+    if (m_type == ColumnType::kString)
+    {
+        uint32_t dictionary_size = static_cast<uint32_t>(m_dictionary.size());
+        out.write(reinterpret_cast<const char *>(&dictionary_size), sizeof(dictionary_size));
+        for (const std::string &str : m_dictionary)
+            WriteString(out, str);
+    }
+
+    // Narrowed in chunks, nulls become the all ones value of the width
+    const uint64_t       null_value = (width == 8) ? kNull : (1ull << (width * 8)) - 1;
+    std::vector<uint8_t> chunk;
+    const size_t         kChunkRows = 64 * 1024;
+    for (size_t start = 0; start < m_values.size(); start += kChunkRows)
+    {
+        size_t num_rows = std::min(kChunkRows, m_values.size() - start);
+        chunk.resize(num_rows * width);
+        for (size_t i = 0; i < num_rows; ++i)
+        {
+            uint64_t value = m_values[start + i];
+            value = (value == kNull) ? null_value : value;
+            memcpy(&chunk[i * width], &value, width);  // Little endian
+        }
+        out.write(reinterpret_cast<const char *>(chunk.data()), chunk.size());
+    }
+    return static_cast<bool>(out);
+}
+
+//--------------------------------------------------------------------------------------------------
+bool Column::Load(const uint8_t **data, const uint8_t *end, uint64_t num_rows)
+{
+    uint8_t type = 0;
+    uint8_t width = 0;
+    if (!ReadString(data, end, &m_name) || !ReadBytes(data, end, &type, sizeof(type)) ||
+        !ReadBytes(data, end, &width, sizeof(width)))
+        return false;
+    if (type > static_cast<uint8_t>(ColumnType::kString) ||
+        (width != 1 && width != 2 && width != 4 && width != 8))
+        return false;
+    m_type = static_cast<ColumnType>(type);
+
+    m_dictionary.clear();
+    m_dictionary_ids.clear();
+    if (m_type == ColumnType::kString)
+    {
+        uint32_t dictionary_size = 0;
+        if (!ReadBytes(data, end, &dictionary_size, sizeof(dictionary_size)))
+            return false;
+        for (uint32_t i = 0; i < dictionary_size; ++i)
+        {
+            std::string str;
+            if (!ReadString(data, end, &str))
+                return false;
+            m_dictionary_ids.emplace(str, m_dictionary.size());
+            m_dictionary.push_back(std::move(str));
+        }
+    }
+
+    if (static_cast<uint64_t>(end - *data) / width < num_rows)
+        return false;
+    const uint64_t null_value = (width == 8) ? kNull : (1ull << (width * 8)) - 1;
+    m_values.resize(num_rows);
+    for (uint64_t row = 0; row < num_rows; ++row)
+    {
+        uint64_t value = 0;
+        memcpy(&value, *data + row * width, width);
+        if (value == null_value)
+            value = kNull;
+        else if (m_type == ColumnType::kString && value >= m_dictionary.size())
+            return false;
+        m_values[row] = value;
+    }
+    *data += num_rows * width;
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+Table::Table(std::string name) :
+    m_name(std::move(name))
+{
+}
+
+//--------------------------------------------------------------------------------------------------
+size_t Table::GetNumRows() const
+{
+    return m_columns.empty() ? 0 : m_columns.front().GetNumRows();
+}
+
+//--------------------------------------------------------------------------------------------------
+Column &Table::AddColumn(std::string name, ColumnType type)
+{
+    m_columns.emplace_back(std::move(name), type);
+    return m_columns.back();
+}
+
+//--------------------------------------------------------------------------------------------------
+const Column *Table::FindColumn(const std::string &name) const
+{
+    for (const Column &column : m_columns)
+    {
+        if (column.GetName() == name)
+            return &column;
+    }
+    return nullptr;
+}
+
+//--------------------------------------------------------------------------------------------------
+Table &ColumnarCapture::AddTable(std::string name)
+{
+    m_tables.emplace_back(std::move(name));
+    return m_tables.back();
+}
+
+//--------------------------------------------------------------------------------------------------
+const Table *ColumnarCapture::FindTable(const std::string &name) const
+{
+    for (const Table &table : m_tables)
+    {
+        if (table.GetName() == name)
+            return &table;
+    }
+    return nullptr;
+}
+
+//--------------------------------------------------------------------------------------------------
+bool ColumnarCapture::Save(const char *file_name) const
+{
+    std::ofstream out(file_name, std::ios::out | std::ios::binary);
+    if (!out.is_open())
+    {
+        std::cerr << "Not able to open: " << file_name << std::endl;
+        return false;
+    }
+
+    uint32_t num_tables = static_cast<uint32_t>(m_tables.size());
+    out.write(kMagic, sizeof(kMagic));
+    out.write(reinterpret_cast<const char *>(&kVersion), sizeof(kVersion));
+    out.write(reinterpret_cast<const char *>(&num_tables), sizeof(num_tables));
+    for (const Table &table : m_tables)
+    {
+        uint64_t num_rows = table.GetNumRows();
+        uint32_t num_columns = static_cast<uint32_t>(table.GetColumns().size());
+        WriteString(out, table.GetName());
+        out.write(reinterpret_cast<const char *>(&num_rows), sizeof(num_rows));
+        out.write(reinterpret_cast<const char *>(&num_columns), sizeof(num_columns));
+        for (const Column &column : table.GetColumns())
+        {
+            if (!column.Save(out))
+                break;
+        }
+    }
+    out.close();
+    if (!out)
+    {
+        std::cerr << "Failed to write: " << file_name << std::endl;
+        return false;
+    }
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+bool ColumnarCapture::Load(const char *file_name)
+{
+    std::unique_ptr<MappedFile> file = MappedFile::Open(file_name);
+    if (!file)
+    {
+        std::cerr << "Not able to open: " << file_name << std::endl;
+        return false;
+    }
+    const uint8_t *data = file->GetData();
+    const uint8_t *end = data + file->GetSize();
+
+    char     magic[sizeof(kMagic)] = {};
+    uint32_t version = 0;
+    uint32_t num_tables = 0;
+    if (!ReadBytes(&data, end, magic, sizeof(magic)) || memcmp(magic, kMagic, sizeof(magic)) != 0 ||
+        !ReadBytes(&data, end, &version, sizeof(version)) || version != kVersion ||
+        !ReadBytes(&data, end, &num_tables, sizeof(num_tables)))
+    {
+        std::cerr << "Not a columnar capture file: " << file_name << std::endl;
+        return false;
+    }
+
+    m_tables.clear();
+    for (uint32_t t = 0; t < num_tables; ++t)
+    {
+        std::string name;
+        uint64_t    num_rows = 0;
+        uint32_t    num_columns = 0;
+        if (!ReadString(&data, end, &name) || !ReadBytes(&data, end, &num_rows, sizeof(num_rows)) ||
+            !ReadBytes(&data, end, &num_columns, sizeof(num_columns)))
+        {
+            std::cerr << "Truncated columnar capture file: " << file_name << std::endl;
+            return false;
+        }
+        Table &table = AddTable(std::move(name));
+        for (uint32_t c = 0; c < num_columns; ++c)
+        {
+            Column &column = table.AddColumn(std::string(), ColumnType::kUint);
+            if (!column.Load(&data, end, num_rows))
+            {
+                std::cerr << "Corrupted columnar capture file: " << file_name << std::endl;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+void ColumnarCapture::PrintSchema(std::ostream &out) const
+{
+    for (const Table &table : m_tables)
+    {
+        out << table.GetName() << " (" << table.GetNumRows() << " rows)\n";
+        for (const Column &column : table.GetColumns())
+        {
+            out << "  " << column.GetName()
+                << (column.GetType() == ColumnType::kString ? " string" : " integer") << "\n";
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+bool CreateColumnarCapture(const char *capture_file_name, ColumnarCapture *out_capture)
+{
+    std::unique_ptr<Dive::DataCore> data = std::make_unique<Dive::DataCore>();
+    if (data->LoadPm4CaptureData(capture_file_name) != Dive::CaptureData::LoadResult::kSuccess)
+    {
+        std::cerr << "Load capture failed." << std::endl;
+        return false;
+    }
+    if (!data->ParsePm4CaptureData())
+    {
+        std::cerr << "Parse capture data failed." << std::endl;
+        return false;
+    }
+
+    Table &packets = out_capture->AddTable("packets");
+    Table &registers = out_capture->AddTable("registers");
+    Table &events = out_capture->AddTable("events");
+
+    const Dive::Pm4CaptureData &capture_data = data->GetPm4CaptureData();
+    ColumnarExportCreator       creator(packets, registers);
+    if (!creator.ProcessSubmits(capture_data.GetSubmits(), capture_data.GetMemoryManager()))
+    {
+        std::cerr << "Emulation of the capture failed." << std::endl;
+        return false;
+    }
+
+    const Dive::CaptureMetadata &meta_data = data->GetCaptureMetadata();
+    AddRenderModeColumn(packets, meta_data.m_event_info);
+    AddRenderModeColumn(registers, meta_data.m_event_info);
+    AddEventsTable(events, meta_data);
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+bool ParseColumnFilter(const char *str, ColumnQuery::Filter *out_filter)
+{
+    using CompareOp = ColumnQuery::CompareOp;
+    const char *op = strpbrk(str, "=!<>");
+    if (op == nullptr || op == str)
+        return false;
+
+    const char *value = op + 1;
+    if (op[0] == '!' && op[1] == '=')
+    {
+        out_filter->m_op = CompareOp::kNotEqual;
+        value++;
+    }
+    else if (op[0] == '<' && op[1] == '=')
+    {
+        out_filter->m_op = CompareOp::kLessEqual;
+        value++;
+    }
+    else if (op[0] == '>' && op[1] == '=')
+    {
+        out_filter->m_op = CompareOp::kGreaterEqual;
+        value++;
+    }
+    else if (op[0] == '=')
+    {
+        out_filter->m_op = CompareOp::kEqual;
+        if (op[1] == '=')
+            value++;
+    }
+    else if (op[0] == '<')
+        out_filter->m_op = CompareOp::kLess;
+    else if (op[0] == '>')
+        out_filter->m_op = CompareOp::kGreater;
+    else
+        return false;
+
+    out_filter->m_column.assign(str, op);
+    out_filter->m_value = value;
+    return !out_filter->m_value.empty();
+}
+
+//--------------------------------------------------------------------------------------------------
+bool RunColumnQuery(std::ostream &out, const ColumnarCapture &capture, const ColumnQuery &query)
+{
+    const Table *table = capture.FindTable(query.m_table);
+    if (table == nullptr)
+    {
+        std::cerr << "Unknown table: " << query.m_table << std::endl;
+        return false;
+    }
+
+    std::vector<size_t> rows(table->GetNumRows());
+    std::iota(rows.begin(), rows.end(), 0);
+    for (const ColumnQuery::Filter &filter : query.m_filters)
+    {
+        if (!ApplyFilter(*table, filter, &rows))
+            return false;
+    }
+
+    if (query.m_aggregate != ColumnQuery::Aggregate::kNone || !query.m_group_by.empty())
+        return RunAggregate(out, *table, query, rows);
+
+    std::vector<const Column *> columns;
+    if (query.m_select.empty())
+    {
+        for (const Column &column : table->GetColumns())
+            columns.push_back(&column);
+    }
+    for (const std::string &name : query.m_select)
+    {
+        const Column *column = table->FindColumn(name);
+        if (column == nullptr)
+        {
+            std::cerr << "Unknown column: " << name << std::endl;
+            return false;
+        }
+        columns.push_back(column);
+    }
+
+    for (size_t i = 0; i < columns.size(); ++i)
+        out << (i ? "\t" : "") << columns[i]->GetName();
+    out << "\n";
+    uint64_t num_rows = std::min<uint64_t>(rows.size(), query.m_limit);
+    for (uint64_t i = 0; i < num_rows; ++i)
+    {
+        for (size_t c = 0; c < columns.size(); ++c)
+        {
+            if (c != 0)
+                out << "\t";
+            columns[c]->PrintValue(out, rows[i]);
+        }
+        out << "\n";
+    }
+    return true;
+}
+
+}  // namespace cli
+}  // namespace Dive
@@ -0,0 +1,179 @@
+/*
+ Copyright 2025 Google LLC
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Columnar export of a capture, for bulk queries over its packets, register writes and events
+// without going through the text outputs.
+//
+// File layout (little endian):
+//   "DIVECOLS", uint32 version, uint32 table count, then for each table:
+//     string name, uint64 row count, uint32 column count, then for each column:
+//       string name, uint8 ColumnType, uint8 byte width of the values (1, 2, 4 or 8), then
+//       kUint:   row count values
+//       kString: uint32 dictionary size, the dictionary strings, then row count dictionary ids
+// Strings are a uint32 length followed by the characters.
+
+namespace Dive
+{
+namespace cli
+{
+
+enum class ColumnType : uint8_t
+{
+    kUint = 0,
+    kString = 1,
+};
+
+//--------------------------------------------------------------------------------------------------
+class Column
+{
+public:
+    // Value of the rows without a value (e.g. state not set for an event). The kUint values of a
+    // capture (register values, 48-bit GPU addresses, counts) never reach it, and query filters
+    // reject it.
+    static constexpr uint64_t kNull = UINT64_MAX;
+
+    Column(std::string name, ColumnType type);
+
+    const std::string &GetName() const { return m_name; }
+    ColumnType         GetType() const { return m_type; }
+    size_t             GetNumRows() const { return m_values.size(); }
+
+    void AppendUint(uint64_t value);
+    // Dictionary encoded, a nullptr string is a null
+    void AppendString(const char *str);
+
+    // The value of a kUint row, or the dictionary id of a kString row
+    const std::vector<uint64_t> &GetValues() const { return m_values; }
+    const std::string           &GetString(uint64_t id) const { return m_dictionary[id]; }
+    // Returns the dictionary id of str, or kNull if no row holds it
+    uint64_t FindString(const std::string &str) const;
+
+    // Writes the row as text, "-" for nulls
+    void PrintValue(std::ostream &out, size_t row) const;
+
+    bool Save(std::ostream &out) const;
+    // Reads a column saved by Save() from [*data, end), and advances *data past it
+    bool Load(const uint8_t **data, const uint8_t *end, uint64_t num_rows);
+
+private:
+    std::string                               m_name;
+    ColumnType                                m_type;
+    std::vector<uint64_t>                     m_values;
+    std::vector<std::string>                  m_dictionary;
+    std::unordered_map<std::string, uint64_t> m_dictionary_ids;
+};
+
+//--------------------------------------------------------------------------------------------------
+class Table
+{
+public:
+    explicit Table(std::string name);
+
+    const std::string &GetName() const { return m_name; }
+    size_t             GetNumRows() const;
+
+    // The columns don't move once added, so a table can be filled through the returned references
+    Column                   &AddColumn(std::string name, ColumnType type);
+    const std::deque<Column> &GetColumns() const { return m_columns; }
+    // Returns nullptr if there is no such column
+    const Column *FindColumn(const std::string &name) const;
+
+private:
+    std::string        m_name;
+    std::deque<Column> m_columns;
+};
+
+//--------------------------------------------------------------------------------------------------
+class ColumnarCapture
+{
+public:
+    static constexpr char     kMagic[8] = { 'D', 'I', 'V', 'E', 'C', 'O', 'L', 'S' };
+    static constexpr uint32_t kVersion = 1;
+
+    Table &AddTable(std::string name);
+    // Returns nullptr if there is no such table
+    const Table             *FindTable(const std::string &name) const;
+    const std::deque<Table> &GetTables() const { return m_tables; }
+
+    bool Save(const char *file_name) const;
+    bool Load(const char *file_name);
+
+    // Lists the tables with their row counts and columns
+    void PrintSchema(std::ostream &out) const;
+
+private:
+    std::deque<Table> m_tables;
+};
+
+// Loads and emulates a .dive/.rd capture into the "packets", "registers" and "events" tables
+bool CreateColumnarCapture(const char *capture_file_name, ColumnarCapture *out_capture);
+
+//--------------------------------------------------------------------------------------------------
+// Filter/aggregate query over a single table. Filters are ANDed. Without an aggregate, the selected
+// columns of the matching rows are printed; with one, a single row per group-by value.
+struct ColumnQuery
+{
+    enum class CompareOp
+    {
+        kEqual,
+        kNotEqual,
+        kLess,
+        kLessEqual,
+        kGreater,
+        kGreaterEqual,
+    };
+    struct Filter
+    {
+        std::string m_column;
+        CompareOp   m_op;
+        std::string m_value;
+    };
+    enum class Aggregate
+    {
+        kNone,
+        kCount,
+        kSum,
+        kMin,
+        kMax,
+    };
+
+    std::string              m_table;
+    std::vector<Filter>      m_filters;
+    std::vector<std::string> m_select;  // All columns when empty
+    std::string              m_group_by;
+    Aggregate                m_aggregate = Aggregate::kNone;
+    std::string              m_aggregate_column;  // Not used by kCount
+    uint64_t                 m_limit = UINT64_MAX;
+};
+
+// Parses "<column><op><value>" with op one of ==, !=, <=, >=, <, > or =
+bool ParseColumnFilter(const char *str, ColumnQuery::Filter *out_filter);
+
+// Prints the result as tab separated values with a header line. Returns false, with the reason on
+// std::cerr, for unknown tables or columns and invalid values.
+bool RunColumnQuery(std::ostream &out, const ColumnarCapture &capture, const ColumnQuery &query);
+
+}  // namespace cli
+}  // namespace Dive
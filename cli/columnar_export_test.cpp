@@ -0,0 +1,138 @@
+/*
+ Copyright 2025 Google LLC
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#include "columnar_export.h"
+
+#include <sstream>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "pm4_info.h"
+
+namespace Dive
+{
+namespace cli
+{
+namespace
+{
+
+// Runs the query, returning its output or "failed"
+std::string Query(const ColumnarCapture &capture, const ColumnQuery &query)
+{
+    std::ostringstream out;
+    return RunColumnQuery(out, capture, query) ? out.str() : "failed";
+}
+
+ColumnQuery CountWhere(const char *table, const char *filter)
+{
+    ColumnQuery query;
+    query.m_table = table;
+    query.m_aggregate = ColumnQuery::Aggregate::kCount;
+    ColumnQuery::Filter parsed_filter;
+    EXPECT_TRUE(ParseColumnFilter(filter, &parsed_filter)) << filter;
+    query.m_filters.push_back(parsed_filter);
+    return query;
+}
+
+// A table with a null in each column, and values that need each byte width
+ColumnarCapture CreateTestCapture()
+{
+    ColumnarCapture capture;
+    Table          &table = capture.AddTable("test");
+    Column         &number = table.AddColumn("number", ColumnType::kUint);
+    Column         &name = table.AddColumn("name", ColumnType::kString);
+    const uint64_t  numbers[] = { 0, 0xff, 0x10000, 1ull << 40, Column::kNull };
+    const char     *names[] = { "a", nullptr, "b", "a", "a" };
+    for (uint64_t value : numbers)
+        number.AppendUint(value);
+    for (const char *str : names)
+        name.AppendString(str);
+    return capture;
+}
+
+TEST(ColumnarExportTest, SaveLoadRoundTrip)
+{
+    const std::string file_name = ::testing::TempDir() + "columnar_export_test.cols";
+    ColumnarCapture   saved = CreateTestCapture();
+    ASSERT_TRUE(saved.Save(file_name.c_str()));
+    ColumnarCapture loaded;
+    ASSERT_TRUE(loaded.Load(file_name.c_str()));
+
+    const Table *table = loaded.FindTable("test");
+    ASSERT_NE(table, nullptr);
+    ASSERT_EQ(table->GetNumRows(), 5u);
+    const Column *number = table->FindColumn("number");
+    const Column *name = table->FindColumn("name");
+    ASSERT_NE(number, nullptr);
+    ASSERT_NE(name, nullptr);
+    EXPECT_EQ(number->GetValues(), saved.FindTable("test")->FindColumn("number")->GetValues());
+    EXPECT_EQ(name->GetValues(), saved.FindTable("test")->FindColumn("name")->GetValues());
+    EXPECT_EQ(name->GetString(name->FindString("b")), "b");
+}
+
+TEST(ColumnarExportTest, CountsMatchingRows)
+{
+    ColumnarCapture capture = CreateTestCapture();
+    EXPECT_EQ(Query(capture, CountWhere("test", "name==a")), "count\n3\n");
+    EXPECT_EQ(Query(capture, CountWhere("test", "name!=a")), "count\n1\n");
+    EXPECT_EQ(Query(capture, CountWhere("test", "name==-")), "count\n1\n");
+    EXPECT_EQ(Query(capture, CountWhere("test", "number>=0xff")), "count\n3\n");
+    EXPECT_EQ(Query(capture, CountWhere("test", "number<0x10000")), "count\n2\n");
+    EXPECT_EQ(Query(capture, CountWhere("test", "number!=0")), "count\n3\n");
+    EXPECT_EQ(Query(capture, CountWhere("test", "number==-")), "count\n1\n");
+}
+
+// The largest value stands for null, so it can't be compared with
+TEST(ColumnarExportTest, RejectsNullValue)
+{
+    ColumnarCapture capture = CreateTestCapture();
+    EXPECT_EQ(Query(capture, CountWhere("test", "number==-1")), "failed");
+    EXPECT_EQ(Query(capture, CountWhere("test", "number<-2")), "failed");
+    EXPECT_EQ(Query(capture, CountWhere("test", "number==0xffffffffffffffff")), "failed");
+    EXPECT_EQ(Query(capture, CountWhere("test", "number<18446744073709551616")), "failed");
+}
+
+TEST(ColumnarExportTest, ExportedCaptureRoundTrip)
+{
+    Pm4InfoInit();
+    const std::string capture_file = std::string(TEST_DATA_DIR) +
+                                     "/bloom-frame-0080-compressed.rd";
+    const std::string file_name = ::testing::TempDir() + "bloom-frame-0080-compressed.cols";
+    ColumnarCapture   exported;
+    ASSERT_TRUE(CreateColumnarCapture(capture_file.c_str(), &exported));
+    ASSERT_TRUE(exported.Save(file_name.c_str()));
+    ColumnarCapture loaded;
+    ASSERT_TRUE(loaded.Load(file_name.c_str()));
+
+    ASSERT_EQ(loaded.GetTables().size(), exported.GetTables().size());
+    for (const Table &table : exported.GetTables())
+    {
+        SCOPED_TRACE(table.GetName());
+        EXPECT_GT(table.GetNumRows(), 0u);
+
+        ColumnQuery query;
+        query.m_table = table.GetName();
+        query.m_aggregate = ColumnQuery::Aggregate::kCount;
+        EXPECT_EQ(Query(loaded, query), "count\n" + std::to_string(table.GetNumRows()) + "\n");
+
+        query.m_aggregate = ColumnQuery::Aggregate::kNone;
+        EXPECT_EQ(Query(loaded, query), Query(exported, query));
+    }
+}
+
+}  // namespace
+}  // namespace cli
+}  // namespace Dive
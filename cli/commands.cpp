@@ -21,6 +21,7 @@
 #include <map>
 #include <string>
 
+#include "columnar_export.h"
 #include "commands.h"
 #include "format_output.h"
 
@@ -92,7 +93,12 @@ int HelpCommand::operator()(int argc, int at, char** argv) const
     std::cout << std::endl;
 
     std::cout << "Usage: " << std::endl;
-    std::cout << "  " << ProgramName(argv[0]) << " <command> [<args>]" << std::endl;
+    std::cout << "  " << ProgramName(argv[0]) << " [--trace <file.json>] <command> [<args>]"
+              << std::endl;
+    std::cout << std::endl;
+    std::cout << "  --trace <file.json>: write a Chrome JSON trace of the command, to open in "
+                 "ui.perfetto.dev"
+              << std::endl;
     std::cout << std::endl;
 
     std::cout << "Available Commands:" << std::endl;
@@ -159,7 +165,7 @@ std::string VersionCommand::Description() const
 struct ExtractCommand : Command
 {
     ExtractCommand();
-    static int  Run(const char* dive_file, const char* output_dir);
+    static int  Run(const char* dive_file, const char* output_dir, const ExtractOptions& options);
     int         operator()(int argc, int at, char** argv) const override;
     int         Help(int argc, int at, char** argv) const override;
     std::string Description() const override;
@@ -170,7 +176,9 @@ ExtractCommand::ExtractCommand() :
 {
 }
 
-int ExtractCommand::Run(const char* dive_file, const char* output_dir)
+int ExtractCommand::Run(const char*           dive_file,
+                        const char*           output_dir,
+                        const ExtractOptions& options)
 {
     std::string out;
     if (output_dir != nullptr)
@@ -190,21 +198,46 @@ int ExtractCommand::Run(const char* dive_file, const char* output_dir)
             out = out + "_out";
         }
     }
-    return Dive::cli::ExtractCapture(dive_file, out.c_str());
+    return Dive::cli::ExtractCapture(dive_file, out.c_str(), options);
 }
 
 int ExtractCommand::operator()(int argc, int at, char** argv) const
 {
-    if (argc - at == 2)
-    {
-        return Run(argv[at + 1], nullptr);
-    }
-    else if (argc - at == 4)
+    const char*    dive_file = nullptr;
+    const char*    output_dir = nullptr;
+    ExtractOptions options;
+    for (int i = at + 1; i < argc; ++i)
     {
-        if (strcmp(argv[at + 1], "-o") == 0 || strcmp(argv[at + 1], "--output") == 0)
+        bool has_value = (i + 1 < argc);
+        if ((strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--output") == 0) && has_value)
+        {
+            output_dir = argv[++i];
+        }
+        else if ((strcmp(argv[i], "-j") == 0 || strcmp(argv[i], "--jobs") == 0) && has_value)
+        {
+            options.m_num_workers = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "--shaders") == 0)
         {
-            return Run(argv[at + 3], argv[at + 2]);
+            options.m_dump_shaders = true;
         }
+        else if (strcmp(argv[i], "--buffers") == 0)
+        {
+            options.m_dump_buffers = true;
+        }
+        else if (dive_file == nullptr && argv[i][0] != '-')
+        {
+            dive_file = argv[i];
+        }
+        else
+        {
+            dive_file = nullptr;
+            break;
+        }
+    }
+    if (dive_file != nullptr)
+    {
+        return Run(dive_file, output_dir, options);
     }
     Help(argc, at, argv);
     return EXIT_FAILURE;
@@ -212,9 +245,13 @@ int ExtractCommand::operator()(int argc, int at, char** argv) const
 
 int ExtractCommand::Help(int argc, int at, char** argv) const
 {
-    std::cout << "usage: " << ProgramName(argv[0]) << " " << GetName() << " [-o <dir>] <.dive>"
-              << std::endl;
+    std::cout << "usage: " << ProgramName(argv[0]) << " " << GetName()
+              << " [-o <dir>] [-j <jobs>] [--shaders] [--buffers] <.dive>" << std::endl;
     std::cout << "  -o,--output <dir>: output directory name" << std::endl;
+    std::cout << "  -j,--jobs <jobs>: number of threads writing the files, default one per core"
+              << std::endl;
+    std::cout << "  --shaders: also write the disassembly of each shader" << std::endl;
+    std::cout << "  --buffers: also write the data of each captured memory block" << std::endl;
     return EXIT_SUCCESS;
 }
 
@@ -223,6 +260,213 @@ std::string ExtractCommand::Description() const
     return "extract the content of a dive file";
 }
 
+//--------------------------------------------------------------------------------------------------
+struct ExportCommand : Command
+{
+    ExportCommand();
+    int         operator()(int argc, int at, char** argv) const override;
+    int         Help(int argc, int at, char** argv) const override;
+    std::string Description() const override;
+};
+
+ExportCommand::ExportCommand() :
+    Command("export", kNormal)
+{
+}
+
+int ExportCommand::operator()(int argc, int at, char** argv) const
+{
+    const char* dive_file = nullptr;
+    const char* output_file = nullptr;
+    for (int i = at + 1; i < argc; ++i)
+    {
+        if ((strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--output") == 0) && i + 1 < argc)
+        {
+            output_file = argv[++i];
+        }
+        else if (dive_file == nullptr && argv[i][0] != '-')
+        {
+            dive_file = argv[i];
+        }
+        else
+        {
+            dive_file = nullptr;
+            break;
+        }
+    }
+    if (dive_file == nullptr)
+    {
+        Help(argc, at, argv);
+        return EXIT_FAILURE;
+    }
+
+    std::string out;
+    if (output_file != nullptr)
+    {
+        out = output_file;
+    }
+    else
+    {
+        out = std::filesystem::path(dive_file).replace_extension(".cols").string();
+    }
+
+    ColumnarCapture capture;
+    if (!CreateColumnarCapture(dive_file, &capture) || !capture.Save(out.c_str()))
+    {
+        return EXIT_FAILURE;
+    }
+    capture.PrintSchema(std::cout);
+    std::cout << "Exported to " << out << std::endl;
+    return EXIT_SUCCESS;
+}
+
+int ExportCommand::Help(int argc, int at, char** argv) const
+{
+    std::cout << "usage: " << ProgramName(argv[0]) << " " << GetName()
+              << " [-o <file.cols>] <.dive>" << std::endl;
+    std::cout << "  -o,--output <file.cols>: output file name, default the .dive file name with a"
+              << " .cols extension" << std::endl;
+    std::cout << "The packets, registers and events tables can then be queried with: "
+              << ProgramName(argv[0]) << " query" << std::endl;
+    return EXIT_SUCCESS;
+}
+
+std::string ExportCommand::Description() const
+{
+    return "export packets, register writes and events to a queryable columnar file";
+}
+
+//--------------------------------------------------------------------------------------------------
+struct QueryCommand : Command
+{
+    QueryCommand();
+    int         operator()(int argc, int at, char** argv) const override;
+    int         Help(int argc, int at, char** argv) const override;
+    std::string Description() const override;
+};
+
+QueryCommand::QueryCommand() :
+    Command("query", kNormal)
+{
+}
+
+int QueryCommand::operator()(int argc, int at, char** argv) const
+{
+    if (at + 2 > argc)
+    {
+        Help(argc, at, argv);
+        return EXIT_FAILURE;
+    }
+    const char* cols_file = argv[at + 1];
+
+    using Aggregate = ColumnQuery::Aggregate;
+    ColumnQuery query;
+    bool        valid = true;
+    for (int i = at + 2; i < argc && valid; ++i)
+    {
+        bool has_value = (i + 1 < argc);
+        if (strcmp(argv[i], "--where") == 0 && has_value)
+        {
+            ColumnQuery::Filter filter;
+            valid = ParseColumnFilter(argv[++i], &filter);
+            query.m_filters.push_back(filter);
+        }
+        else if (strcmp(argv[i], "--select") == 0 && has_value)
+        {
+            std::string            columns = argv[++i];
+            std::string::size_type start = 0;
+            while (start <= columns.size())
+            {
+                std::string::size_type end = std::min(columns.find(',', start), columns.size());
+                query.m_select.push_back(columns.substr(start, end - start));
+                start = end + 1;
+            }
+        }
+        else if (strcmp(argv[i], "--group-by") == 0 && has_value)
+        {
+            query.m_group_by = argv[++i];
+        }
+        else if (strcmp(argv[i], "--count") == 0)
+        {
+            query.m_aggregate = Aggregate::kCount;
+        }
+        else if (strcmp(argv[i], "--sum") == 0 && has_value)
+        {
+            query.m_aggregate = Aggregate::kSum;
+            query.m_aggregate_column = argv[++i];
+        }
+        else if (strcmp(argv[i], "--min") == 0 && has_value)
+        {
+            query.m_aggregate = Aggregate::kMin;
+            query.m_aggregate_column = argv[++i];
+        }
+        else if (strcmp(argv[i], "--max") == 0 && has_value)
+        {
+            query.m_aggregate = Aggregate::kMax;
+            query.m_aggregate_column = argv[++i];
+        }
+        else if (strcmp(argv[i], "--limit") == 0 && has_value)
+        {
+            query.m_limit = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (query.m_table.empty() && argv[i][0] != '-')
+        {
+            query.m_table = argv[i];
+        }
+        else
+        {
+            valid = false;
+        }
+    }
+    if (!valid)
+    {
+        Help(argc, at, argv);
+        return EXIT_FAILURE;
+    }
+
+    ColumnarCapture capture;
+    if (!capture.Load(cols_file))
+    {
+        return EXIT_FAILURE;
+    }
+    if (query.m_table.empty())
+    {
+        capture.PrintSchema(std::cout);
+        return EXIT_SUCCESS;
+    }
+    return RunColumnQuery(std::cout, capture, query) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int QueryCommand::Help(int argc, int at, char** argv) const
+{
+    std::cout << "usage: " << ProgramName(argv[0]) << " " << GetName()
+              << " <file.cols> [<table> [--where <filter>]... [--select <columns>]"
+              << " [--group-by <column>] [--count | --sum | --min | --max <column>]"
+              << " [--limit <rows>]]" << std::endl;
+    std::cout << "  <file.cols>: written by " << ProgramName(argv[0])
+              << " export, lists its tables and columns when no table is given" << std::endl;
+    std::cout << "  --where <filter>: <column><op><value>, with op one of == != < <= > >=."
+              << std::endl;
+    std::cout << "      Strings only compare with == and !=. A '-' value matches the rows without"
+              << " a value," << std::endl;
+    std::cout << "      which no other comparison matches. Filters are combined with AND."
+              << std::endl;
+    std::cout << "  --select <columns>: comma separated columns to print, default all" << std::endl;
+    std::cout << "  --group-by <column>: aggregate per value of the column, default --count"
+              << std::endl;
+    std::cout << "  --count, --sum, --min, --max: aggregate the matching rows" << std::endl;
+    std::cout << "  --limit <rows>: maximum number of rows printed" << std::endl;
+    std::cout << "example: " << ProgramName(argv[0]) << " " << GetName()
+              << " capture.cols registers --where name==RB_DEPTH_CNTL --where render_mode==Tiled"
+              << " --group-by value" << std::endl;
+    return EXIT_SUCCESS;
+}
+
+std::string QueryCommand::Description() const
+{
+    return "filter and aggregate the tables of an exported capture";
+}
+
 //--------------------------------------------------------------------------------------------------
 struct PacketCommand : Command
 {
@@ -421,21 +665,6 @@ std::string RawPM4Command::Description() const
 
 bool RawPM4Command::PrintRawPm4(const char* file_name, int raw_cmd_buffer_type)
 {
-    std::fstream raw_file(file_name, std::ios::in | std::ios::binary);
-    if (!raw_file.is_open())
-        return false;
-
-    raw_file.seekg(0, std::ios::end);
-    std::streamsize size = raw_file.tellg();
-    raw_file.seekg(0, std::ios::beg);
-
-    std::vector<char> buffer(size);
-    if (!raw_file.read(buffer.data(), size))
-        return false;
-
-    std::vector<uint32_t> dword_buffer(size / sizeof(uint32_t));
-    memcpy(dword_buffer.data(), buffer.data(), size);
-
     Dive::EngineType engine_type = Dive::EngineType::kUniversal;
     Dive::QueueType  queue_type = Dive::QueueType::kUniversal;
     switch (raw_cmd_buffer_type)
@@ -448,26 +677,7 @@ bool RawPM4Command::PrintRawPm4(const char* file_name, int raw_cmd_buffer_type)
         break;
     }
 
-    Dive::CommandHierarchy        command_hierarchy;
-    Pm4CaptureData                capture_data;
-    Dive::CommandHierarchyCreator cmd_hier_creator(command_hierarchy, capture_data);
-    if (!cmd_hier_creator.CreateTrees(engine_type,
-                                      queue_type,
-                                      dword_buffer,
-                                      static_cast<uint32_t>(dword_buffer.size())))
-        return false;
-
-    const Dive::SharedNodeTopology* topology_ptr = &command_hierarchy.GetSubmitHierarchyTopology();
-    uint64_t                        root_num_children = topology_ptr->GetNumChildren(
-    Dive::SharedNodeTopology::kRootNodeIndex);
-    for (uint64_t child = 0; child < root_num_children; ++child)
-    {
-        uint64_t child_node_index = topology_ptr
-                                    ->GetChildNodeIndex(Dive::SharedNodeTopology::kRootNodeIndex,
-                                                        child);
-        PrintNodes(std::cout, &command_hierarchy, *topology_ptr, child_node_index, true);
-    }
-    return true;
+    return Dive::cli::PrintRawPm4(std::cout, file_name, engine_type, queue_type);
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -485,6 +695,8 @@ template<typename T> const Command& CommandOf<T>::Get()
 
 template const Command& CommandOf<VersionCommand>::Get();
 template const Command& CommandOf<ExtractCommand>::Get();
+template const Command& CommandOf<ExportCommand>::Get();
+template const Command& CommandOf<QueryCommand>::Get();
 template const Command& CommandOf<PacketCommand>::Get();
 template const Command& CommandOf<InfoCommand>::Get();
 template const Command& CommandOf<RawPM4Command>::Get();
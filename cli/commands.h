@@ -57,6 +57,8 @@ private:
 struct HelpCommand;
 struct VersionCommand;
 struct ExtractCommand;
+struct ExportCommand;
+struct QueryCommand;
 
 // Internal utilities, originally from capture_reporter.
 // Hiding from user as they are not intended for normal end user flow.
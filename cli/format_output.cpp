@@ -16,7 +16,10 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <cstring>
 #include <filesystem>
+#include <fstream>
 #include <functional>
 #include <iomanip>
 #include <iostream>
@@ -26,11 +29,16 @@
 #include <set>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <vector>
 
+#include "dive_core/common/emulate_pm4.h"
+#include "dive_core/common/mapped_file.h"
 #include "dive_core/pm4_capture_data.h"
 #include "dive_core/command_hierarchy.h"
 #include "dive_core/data_core.h"
 #include "dive_core/dive_strings.h"
+#include "pm4_info.h"
 
 #include "../dive_core/shader_disassembly.h"
 
@@ -89,12 +97,12 @@ void PrintSharedNodes(std::ostream                   &out,
             out << "] ";
         }
 
-        out << command_hierarchy_ptr->GetNodeDesc(child_node_index) << std::endl;
+        out << command_hierarchy_ptr->GetNodeDesc(child_node_index) << "\n";
 
         for (uint32_t f = 0; f < topology.GetNumChildren(child_node_index); ++f)
         {
             uint64_t fc_idx = topology.GetChildNodeIndex(child_node_index, f);
-            out << "      " << command_hierarchy_ptr->GetNodeDesc(fc_idx) << std::endl;
+            out << "      " << command_hierarchy_ptr->GetNodeDesc(fc_idx) << "\n";
         }
     }
 }
@@ -134,7 +142,7 @@ void PrintNodes(std::ostream                   &out,
                    if (depth > 0)
                        out << "| ";
 
-                   out << command_hierarchy_ptr->GetNodeDesc(node_index) << std::endl;
+                   out << command_hierarchy_ptr->GetNodeDesc(node_index) << "\n";
 
                    if (verbose && 0 == topology.GetNumChildren(node_index))
                    {
@@ -198,41 +206,166 @@ bool IsPossibleBlock(const BlockInfo &info)
     return false;
 }
 
-LoadResult DiscoverBlocks(std::ostream &out, std::istream &capture_file)
+//--------------------------------------------------------------------------------------------------
+// Runs the tasks on up to num_workers threads, 0 for one per hardware thread. Each thread takes the
+// next task as soon as it is done with its previous one.
+void RunTasks(const std::vector<std::function<void()>> &tasks, uint32_t num_workers)
 {
-    std::vector<char> data{ std::istreambuf_iterator<char>(capture_file),
-                            std::istreambuf_iterator<char>() };
-    auto              stream_flags = out.flags();
-    out << "File size: " << std::dec << data.size() << " (0x" << std::hex << data.size() << ")"
-        << std::endl;
-    out << std::hex;
-    out << "Blocks found:" << std::endl;
-    for (size_t pos = 0; pos + sizeof(BlockInfo) < data.size(); pos++)
+    if (num_workers == 0)
     {
-        BlockInfo info;
-        memcpy(&info, &data[pos], sizeof(BlockInfo));
-        if (!IsPossibleBlock(info))
+        num_workers = std::max(1u, std::thread::hardware_concurrency());
+    }
+    num_workers = std::min(num_workers, static_cast<uint32_t>(tasks.size()));
+
+    std::atomic<size_t> next_task{ 0 };
+    const auto          worker = [&]() {
+        for (size_t i = next_task++; i < tasks.size(); i = next_task++)
+        {
+            tasks[i]();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (uint32_t i = 1; i < num_workers; ++i)
+    {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Bit 7 of each byte of the result is set if that byte of the word is an upper case letter, which
+// all the characters of the BlockType four-character codes are.
+uint64_t UpperCaseByteMask(uint64_t word)
+{
+    constexpr uint64_t kOnes = 0x0101010101010101ull;
+    constexpr uint64_t kHighBits = 0x8080808080808080ull;
+    // Without their high bit, adding to the bytes can't carry into the next byte
+    uint64_t low_bits = word & ~kHighBits;
+    uint64_t at_least_a = low_bits + kOnes * (0x80 - 'A');
+    uint64_t above_z = low_bits + kOnes * (0x80 - 'Z' - 1);
+    return at_least_a & ~above_z & ~word & kHighBits;
+}
+
+//--------------------------------------------------------------------------------------------------
+bool IsPossibleBlockAt(const uint8_t *data)
+{
+    BlockInfo info;
+    memcpy(&info, data, sizeof(BlockInfo));
+    return IsPossibleBlock(info);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Appends the offsets in [begin, end) that hold a possible BlockInfo. 8 offsets are tested at once
+// for 4 upper case letters in a row, so only the rare offsets that pass are fully checked.
+void FindPossibleBlocks(const uint8_t       *data,
+                        size_t               begin,
+                        size_t               end,
+                        std::vector<size_t> *positions)
+{
+    size_t pos = begin;
+    for (; pos + 8 <= end; pos += 8)
+    {
+        uint64_t words[4];
+        memcpy(words, data + pos, 8);
+        memcpy(words + 1, data + pos + 1, 8);
+        memcpy(words + 2, data + pos + 2, 8);
+        memcpy(words + 3, data + pos + 3, 8);
+        uint64_t candidates = UpperCaseByteMask(words[0]) & UpperCaseByteMask(words[1]) &
+                              UpperCaseByteMask(words[2]) & UpperCaseByteMask(words[3]);
+        if (candidates == 0)
         {
             continue;
         }
-        size_t next_block = pos + info.m_data_size + sizeof(BlockInfo);
-        bool   likely_block = false;
-        if (next_block == data.size())
+        for (size_t byte = 0; byte < 8; ++byte)
         {
-            likely_block = true;
+            if ((candidates & (0x80ull << (byte * 8))) && IsPossibleBlockAt(data + pos + byte))
+            {
+                positions->push_back(pos + byte);
+            }
         }
-        if (next_block + sizeof(BlockInfo) < data.size())
+    }
+    for (; pos < end; ++pos)
+    {
+        if (IsPossibleBlockAt(data + pos))
+        {
+            positions->push_back(pos);
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Looks for the blocks of a corrupted capture. The file is memory mapped and searched for possible
+// block headers in parallel chunks. A block is likely if the next one follows right after it, in
+// which case the search continues after it instead of inside its data. The capture block is the
+// exception, since the other blocks are inside it.
+LoadResult DiscoverBlocks(std::ostream &out, const char *file_name)
+{
+    std::unique_ptr<MappedFile> file = MappedFile::Open(file_name);
+    if (!file)
+    {
+        std::cerr << "Not able to map: " << file_name << std::endl;
+        return LoadResult::kFileIoError;
+    }
+    const uint8_t *data = file->GetData();
+    const size_t   size = file->GetSize();
+
+    auto stream_flags = out.flags();
+    out << "File size: " << std::dec << size << " (0x" << std::hex << size << ")\n";
+    out << std::hex;
+    out << "Blocks found:\n";
+
+    // A block header must be followed by at least one byte
+    const size_t num_positions = (size > sizeof(BlockInfo)) ? size - sizeof(BlockInfo) : 0;
+
+    constexpr size_t kChunkSize = 16 * 1024 * 1024;
+    const size_t     num_chunks = (num_positions + kChunkSize - 1) / kChunkSize;
+    std::vector<std::vector<size_t>>   chunk_positions(num_chunks);
+    std::vector<std::function<void()>> tasks;
+    for (size_t chunk = 0; chunk < num_chunks; ++chunk)
+    {
+        tasks.push_back([data, num_positions, chunk, &chunk_positions]() {
+            size_t begin = chunk * kChunkSize;
+            size_t end = std::min(begin + kChunkSize, num_positions);
+            FindPossibleBlocks(data, begin, end, &chunk_positions[chunk]);
+        });
+    }
+    RunTasks(tasks, 0);
+
+    size_t next_unchained = 0;
+    for (const std::vector<size_t> &positions : chunk_positions)
+    {
+        for (size_t pos : positions)
         {
-            BlockInfo next_block_info;
-            memcpy(&next_block_info, &data[next_block], sizeof(BlockInfo));
-            if (IsPossibleBlock(next_block_info))
+            if (pos < next_unchained)
+            {
+                continue;
+            }
+            BlockInfo info;
+            memcpy(&info, data + pos, sizeof(BlockInfo));
+
+            bool   likely_block = false;
+            size_t next_block = 0;
+            if (info.m_data_size <= size - pos - sizeof(BlockInfo))
+            {
+                next_block = pos + info.m_data_size + sizeof(BlockInfo);
+                likely_block = (next_block == size) ||
+                               (next_block + sizeof(BlockInfo) < size &&
+                                IsPossibleBlockAt(data + next_block));
+            }
+            out << "  " << BlockTypeToString(info.m_block_type) << (likely_block ? " " : "?")
+                << " " << std::setfill('0') << std::setw(8) << pos << "-" << std::setfill('0')
+                << std::setw(8) << pos + info.m_data_size + sizeof(BlockInfo) << "\n";
+
+            if (likely_block && info.m_block_type != BlockType::kCapture)
             {
-                likely_block = true;
+                next_unchained = next_block;
             }
         }
-        out << "  " << BlockTypeToString(info.m_block_type) << (likely_block ? " " : "?") << " "
-            << std::setfill('0') << std::setw(8) << pos << "-" << std::setfill('0') << std::setw(8)
-            << pos + info.m_data_size + sizeof(BlockInfo) << std::endl;
     }
     out.flags(stream_flags);
     return LoadResult::kSuccess;
@@ -311,12 +444,12 @@ LoadResult PrintBlock(std::ostream      &out,
                       << kCaptureMinorVersion << std::endl;
         }
 
-        out << std::endl;
+        out << "\n";
         out << prefix << " |   ";
-        out << "Capture Type: " << CaptureTypeToString(data_header.m_capture_type) << std::endl;
+        out << "Capture Type: " << CaptureTypeToString(data_header.m_capture_type) << "\n";
         out << prefix << " --> ";
         out << "GPU device ID 0x" << std::hex << data_header.m_device_id << ", revision 0x"
-            << data_header.m_device_revision << std::dec << std::endl;
+            << data_header.m_device_revision << std::dec << "\n";
 
         std::streampos end_pos = (std::streampos)block_offset +
                                  (std::streampos)block_info.m_data_size;
@@ -334,7 +467,7 @@ LoadResult PrintBlock(std::ostream      &out,
         if (!capture_file.read((char *)&memory_raw_data_header, sizeof(memory_raw_data_header)))
             return LoadResult::kFileIoError;
 
-        out << std::endl;
+        out << "\n";
         out << prefix << " --> ";
         auto f = out.flags();
         out << "[";
@@ -360,7 +493,7 @@ LoadResult PrintBlock(std::ostream      &out,
         if (!std::getline(capture_file, name, '\0'))
             return LoadResult::kFileIoError;
 
-        out << std::endl;
+        out << "\n";
         out << prefix << " --> ";
         out << "text: " << name << ", " << text_header.m_size_in_bytes << " bytes";
     }
@@ -370,7 +503,7 @@ LoadResult PrintBlock(std::ostream      &out,
         break;
     }
 
-    out << std::endl;
+    out << "\n";
     return LoadResult::kSuccess;
 }
 
@@ -401,11 +534,10 @@ LoadResult PrintCaptureFileBlocks(std::ostream &out, const char *file_name)
     LoadResult res = PrintBlocks(out, capture_file, "");
     if (res == LoadResult::kCorruptData)
     {
-        capture_file.clear();
-        capture_file.seekg(0, std::ios::beg);
-        out << std::endl;
-        out << "File is corrupted." << std::endl;
-        DiscoverBlocks(out, capture_file);
+        capture_file.close();
+        out << "\n";
+        out << "File is corrupted.\n";
+        DiscoverBlocks(out, file_name);
     }
     return res;
 }
@@ -449,12 +581,37 @@ LoadResult ReadCaptureDataHeader(const char *file_name, Dive::CaptureDataHeader
     return LoadResult::kCorruptData;
 }
 
+//--------------------------------------------------------------------------------------------------
+// Output file with a large buffer, so that the many small writes of the text outputs are not each
+// passed on to the OS.
+class BufferedOutputFile
+{
+public:
+    explicit BufferedOutputFile(const std::filesystem::path &path,
+                                std::ios::openmode           mode = std::ios::out) :
+        m_buffer(kBufferSize)
+    {
+        // The buffer has to be set before the file is opened to be used by every implementation
+        m_out.rdbuf()->pubsetbuf(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+        m_out.open(path, mode);
+    }
+
+    explicit operator bool() const { return static_cast<bool>(m_out); }
+    std::ostream &Stream() { return m_out; }
+
+private:
+    static constexpr size_t kBufferSize = 1024 * 1024;
+
+    std::vector<char> m_buffer;  // Declared first, as m_out flushes into it when destroyed
+    std::ofstream     m_out;
+};
+
 //--------------------------------------------------------------------------------------------------
 void ExtractTopology(std::filesystem::path           path,
                      const Dive::CommandHierarchy   *command_hierarchy_ptr,
                      const Dive::SharedNodeTopology *topology_ptr)
 {
-    std::ofstream out(path);
+    BufferedOutputFile out(path);
     if (!out)
     {
         std::cerr << "Can't open " << path << " for writing" << std::endl;
@@ -468,7 +625,7 @@ void ExtractTopology(std::filesystem::path           path,
         uint64_t child_node_index = topology_ptr
                                     ->GetChildNodeIndex(Dive::SharedNodeTopology::kRootNodeIndex,
                                                         child);
-        PrintNodes(out, command_hierarchy_ptr, *topology_ptr, child_node_index, true);
+        PrintNodes(out.Stream(), command_hierarchy_ptr, *topology_ptr, child_node_index, true);
     }
 }
 //--------------------------------------------------------------------------------------------------
@@ -485,51 +642,399 @@ std::string CleanFilename(const std::string &in)
     return out;
 }
 
+//--------------------------------------------------------------------------------------------------
+void ExtractBinary(const std::filesystem::path &path, const char *data, size_t size)
+{
+    std::ofstream out(path, std::ios::out | std::ios::binary);
+    if (!out)
+    {
+        std::cerr << "Can't open " << path << " for writing" << std::endl;
+        return;
+    }
+    out.write(data, size);
+}
+
 //--------------------------------------------------------------------------------------------------
 // FIXME pointers?
+// The outputs don't depend on each other, so each one is written by its own task. The name and
+// content of every file are independent of the number of threads.
 void ExtractAssets(const char                   *dir,
                    const char                   *capture_filename,
                    const Dive::Pm4CaptureData   &capture_data,
-                   const Dive::CommandHierarchy *command_hierarchy)
+                   const Dive::CommandHierarchy *command_hierarchy,
+                   const Dive::CaptureMetadata  &meta_data,
+                   const ExtractOptions         &options)
 {
     auto dir_path = std::filesystem::path(dir);
     std::filesystem::create_directories(dir_path);
 
+    std::vector<std::function<void()>> tasks;
+
+    // The topologies take the longest, so they are started first
+    if (command_hierarchy)
     {
-        auto          out_path = dir_path / "blocks.txt";
-        std::ofstream out(out_path);
+        tasks.push_back([dir_path, command_hierarchy]() {
+            ExtractTopology(dir_path / "events.txt",
+                            command_hierarchy,
+                            &command_hierarchy->GetAllEventHierarchyTopology());
+        });
+        tasks.push_back([dir_path, command_hierarchy]() {
+            ExtractTopology(dir_path / "submits.txt",
+                            command_hierarchy,
+                            &command_hierarchy->GetSubmitHierarchyTopology());
+        });
+    }
+
+    tasks.push_back([dir_path, capture_filename]() {
+        auto               out_path = dir_path / "blocks.txt";
+        BufferedOutputFile out(out_path);
         if (!out)
         {
             std::cerr << "Can't open " << out_path << " for writing" << std::endl;
             return;
         }
-        PrintCaptureFileBlocks(out, capture_filename);
-    }
+        PrintCaptureFileBlocks(out.Stream(), capture_filename);
+    });
 
     if (capture_data.GetNumText() > 0)
     {
         std::filesystem::create_directories(dir_path / "text");
+
+        // Different names can clean to the same file name. Only the last block with a given file
+        // name is written, as it would be when writing the blocks in order, so that no two tasks
+        // write the same file.
+        std::map<std::string, uint32_t> text_files;
         for (uint32_t i = 0; i < capture_data.GetNumText(); i++)
         {
-            auto         &text = capture_data.GetText(i);
-            auto          out_path = dir_path / "text" / CleanFilename(text.GetName());
-            std::ofstream out(out_path, std::ios::out | std::ios::binary);
-            size_t        text_size = text.GetSize();
-            if (text_size > 0 && text.GetText()[text_size - 1] == 0)
-                text_size--;  // Don't write the trailing '\0'
-            out.write(text.GetText(), text_size);
+            text_files[CleanFilename(capture_data.GetText(i).GetName())] = i;
+        }
+        for (const auto &[file_name, i] : text_files)
+        {
+            tasks.push_back([dir_path, file_name, &text = capture_data.GetText(i)]() {
+                size_t text_size = text.GetSize();
+                if (text_size > 0 && text.GetText()[text_size - 1] == 0)
+                    text_size--;  // Don't write the trailing '\0'
+                ExtractBinary(dir_path / "text" / file_name, text.GetText(), text_size);
+            });
         }
     }
 
-    if (command_hierarchy)
+    if (options.m_dump_shaders && !meta_data.m_shaders.empty())
+    {
+        std::filesystem::create_directories(dir_path / "shaders");
+        for (size_t i = 0; i < meta_data.m_shaders.size(); i++)
+        {
+            tasks.push_back([dir_path, i, &shader = meta_data.m_shaders[i]]() {
+                std::ostringstream name;
+                name << "shader_" << i << "_" << std::hex << std::setfill('0') << std::setw(16)
+                     << shader.GetShaderAddr() << ".txt";
+                std::string listing = shader.GetListing();
+                ExtractBinary(dir_path / "shaders" / name.str(), listing.data(), listing.size());
+            });
+        }
+    }
+
+    const auto &memory_blocks = capture_data.GetMemoryManager().GetMemoryBlocks();
+    if (options.m_dump_buffers && !memory_blocks.empty())
     {
-        ExtractTopology(dir_path / "submits.txt",
-                        command_hierarchy,
-                        &command_hierarchy->GetSubmitHierarchyTopology());
-        ExtractTopology(dir_path / "events.txt",
-                        command_hierarchy,
-                        &command_hierarchy->GetAllEventHierarchyTopology());
+        std::filesystem::create_directories(dir_path / "buffers");
+        for (size_t i = 0; i < memory_blocks.size(); i++)
+        {
+            tasks.push_back([dir_path, i, &block = memory_blocks[i]]() {
+                std::ostringstream name;
+                name << "buffer_" << i << "_submit_" << block.m_submit_index << "_" << std::hex
+                     << std::setfill('0') << std::setw(16) << block.m_va_addr << ".bin";
+                ExtractBinary(dir_path / "buffers" / name.str(),
+                              reinterpret_cast<const char *>(block.m_data_ptr),
+                              block.m_data_size);
+            });
+        }
     }
+
+    RunTasks(tasks, options.m_num_workers);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Memory of a raw command buffer file, in which the addresses are offsets
+class RawPm4MemoryManager : public Dive::IMemoryManager
+{
+public:
+    RawPm4MemoryManager(const uint8_t *data, uint64_t size) :
+        m_data(data),
+        m_size(size)
+    {
+    }
+
+    bool RetrieveMemoryData(void    *buffer_ptr,
+                            uint32_t submit_index,
+                            uint64_t va_addr,
+                            uint64_t size) const override
+    {
+        if (!IsValid(submit_index, va_addr, size))
+            return false;
+        memcpy(buffer_ptr, m_data + va_addr, size);
+        return true;
+    }
+
+    bool GetMemoryOfUnknownSizeViaCallback(uint32_t     submit_index,
+                                           uint64_t     va_addr,
+                                           PfnGetMemory data_callback,
+                                           void        *user_ptr) const override
+    {
+        if (va_addr >= m_size)
+            return false;
+        data_callback(m_data + va_addr, va_addr, m_size - va_addr, user_ptr);
+        return true;
+    }
+
+    uint64_t GetMaxContiguousSize(uint32_t submit_index, uint64_t va_addr) const override
+    {
+        return (va_addr < m_size) ? m_size - va_addr : 0;
+    }
+
+    bool IsValid(uint32_t submit_index, uint64_t addr, uint64_t size) const override
+    {
+        return addr <= m_size && size <= m_size - addr;
+    }
+
+private:
+    const uint8_t *m_data;
+    uint64_t       m_size;
+};
+
+//--------------------------------------------------------------------------------------------------
+// Prints each packet as soon as it is emulated, with the same lines as the verbose submit topology
+// of PrintNodes(), followed by the fields of each register. Unlike CommandHierarchyCreator, nothing
+// is kept once a packet is printed.
+class Pm4StreamPrinter : public Dive::EmulateCallbacksBase
+{
+public:
+    explicit Pm4StreamPrinter(std::ostream &out) :
+        m_out(out)
+    {
+    }
+
+    void OnSubmitStart(uint32_t submit_index, const Dive::SubmitInfo &submit_info) override;
+    void OnSubmitEnd(uint32_t submit_index, const Dive::SubmitInfo &submit_info) override {}
+
+    bool OnIbStart(uint32_t                        submit_index,
+                   uint32_t                        ib_index,
+                   const Dive::IndirectBufferInfo &ib_info,
+                   Dive::IbType                    type) override;
+
+    bool OnPacket(const Dive::IMemoryManager &mem_manager,
+                  uint32_t                    submit_index,
+                  uint32_t                    ib_index,
+                  uint64_t                    va_addr,
+                  Dive::Pm4Header             header) override;
+
+private:
+    void PrintRegister(uint64_t reg_value, const RegInfo *reg_info_ptr);
+
+    void PrintPacketFields(const Dive::IMemoryManager &mem_manager,
+                           uint32_t                    submit_index,
+                           uint64_t                    va_addr,
+                           uint32_t                    dword_count,
+                           bool                        append_extra_dwords,
+                           const PacketInfo           *packet_info_ptr);
+
+    std::ostream &m_out;
+    uint32_t      m_ib_level = 1;
+};
+
+//--------------------------------------------------------------------------------------------------
+void Pm4StreamPrinter::OnSubmitStart(uint32_t submit_index, const Dive::SubmitInfo &submit_info)
+{
+    uint32_t engine_index = static_cast<uint32_t>(submit_info.GetEngineType());
+    uint32_t queue_index = static_cast<uint32_t>(submit_info.GetQueueType());
+    m_out << "Submit: " << submit_index << ", Num IBs: " << submit_info.GetNumIndirectBuffers()
+          << ", Engine: " << kEngineTypeStrings[engine_index]
+          << ", Queue: " << kQueueTypeStrings[queue_index]
+          << ", Engine Index: " << (uint32_t)submit_info.GetEngineIndex()
+          << ", Dummy Submit: " << (uint32_t)submit_info.IsDummySubmit() << "\n";
+    m_ib_level = 1;
+    m_state_tracker.Reset();
+}
+
+//--------------------------------------------------------------------------------------------------
+bool Pm4StreamPrinter::OnIbStart(uint32_t                        submit_index,
+                                 uint32_t                        ib_index,
+                                 const Dive::IndirectBufferInfo &ib_info,
+                                 Dive::IbType                    type)
+{
+    EmulateCallbacksBase::OnIbStart(submit_index, ib_index, ib_info, type);
+    m_ib_level = ib_info.m_ib_level;
+
+    for (uint32_t tab = 0; tab < m_ib_level; ++tab)
+        m_out << "  ";
+    m_out << "| ";
+    switch (type)
+    {
+    case Dive::IbType::kNormal:
+        m_out << "IB: " << ib_index;
+        break;
+    case Dive::IbType::kCall:
+        m_out << "Call IB";
+        break;
+    case Dive::IbType::kChain:
+        m_out << "Chain IB";
+        break;
+    case Dive::IbType::kContextSwitchIb:
+        m_out << "ContextSwitch IB";
+        break;
+    case Dive::IbType::kDrawState:
+        m_out << "DrawState IB";
+        break;
+    case Dive::IbType::kBinPrefix:
+        m_out << "Bin Prefix IB";
+        break;
+    case Dive::IbType::kBinCommon:
+        m_out << "Bin Common IB";
+        break;
+    case Dive::IbType::kFixedStrideDrawTable:
+        m_out << "Fixed Stride Draw Table IB";
+        break;
+    }
+    m_out << ", Address: 0x" << std::hex << ib_info.m_va_addr
+          << ", Size (DWORDS): " << std::dec << ib_info.m_size_in_dwords;
+    if (ib_info.m_skip)
+        m_out << ", NOT CAPTURED";
+    m_out << "\n";
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+bool Pm4StreamPrinter::OnPacket(const Dive::IMemoryManager &mem_manager,
+                                uint32_t                    submit_index,
+                                uint32_t                    ib_index,
+                                uint64_t                    va_addr,
+                                Dive::Pm4Header             header)
+{
+    if (!EmulateCallbacksBase::OnPacket(mem_manager, submit_index, ib_index, va_addr, header))
+        return false;
+    if ((header.type != 4) && (header.type != 7))
+        return true;
+
+    for (uint32_t tab = 0; tab < m_ib_level + 1; ++tab)
+        m_out << "  ";
+    auto f = m_out.flags();
+    m_out << "[" << std::setfill('0') << std::setw(16) << std::hex << va_addr << "] ";
+    m_out.flags(f);
+
+    if (header.type == 4)
+    {
+        m_out << "TYPE4 REGWRITE 0x" << std::hex << header.u32All << std::dec << "\n";
+    }
+    else
+    {
+        m_out << GetOpCodeString(header.type7.opcode) << " 0x" << std::hex << header.u32All
+              << std::dec << "\n";
+    }
+    if (header.type == 4 || header.type7.opcode == CP_CONTEXT_REG_BUNCH)
+    {
+        ForEachRegisterWrite(mem_manager,
+                             submit_index,
+                             va_addr,
+                             header,
+                             [&](uint32_t reg_offset, uint64_t value, const RegInfo *info) {
+                                 PrintRegister(value, info);
+                             });
+        return true;
+    }
+
+    // The CP_LOAD_STATE6_* dwords past the fields are the loaded data, not missing fields
+    bool append_extra_dwords = (header.type7.opcode != CP_LOAD_STATE6 &&
+                                header.type7.opcode != CP_LOAD_STATE6_GEOM &&
+                                header.type7.opcode != CP_LOAD_STATE6_FRAG);
+    const PacketInfo *packet_info_ptr = GetPacketInfo(header.type7.opcode);
+    if (packet_info_ptr != nullptr)
+    {
+        PrintPacketFields(mem_manager,
+                          submit_index,
+                          va_addr + sizeof(header),
+                          header.type7.count,
+                          append_extra_dwords,
+                          packet_info_ptr);
+    }
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+void Pm4StreamPrinter::PrintRegister(uint64_t reg_value, const RegInfo *reg_info_ptr)
+{
+    m_out << "      ";
+    OutputRegister(m_out, reg_info_ptr, reg_value);
+    m_out << "\n";
+    if (reg_info_ptr == nullptr)
+        return;
+
+    for (const RegField &reg_field : reg_info_ptr->m_fields)
+    {
+        m_out << "        ";
+        OutputRegField(m_out, *reg_info_ptr, reg_field, reg_value);
+        m_out << "\n";
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void Pm4StreamPrinter::PrintPacketFields(const Dive::IMemoryManager &mem_manager,
+                                         uint32_t                    submit_index,
+                                         uint64_t                    va_addr,
+                                         uint32_t                    dword_count,
+                                         bool                        append_extra_dwords,
+                                         const PacketInfo           *packet_info_ptr)
+{
+    // The array index of packets with arrays is printed before the fields of each element
+    const char *indent = "      ";
+    ForEachPacketField(
+    mem_manager,
+    submit_index,
+    va_addr,
+    dword_count,
+    append_extra_dwords,
+    packet_info_ptr,
+    [&](uint32_t array_index) {
+        m_out << "      " << array_index << "\n";
+        indent = "        ";
+    },
+    [&](const PacketField &packet_field, uint32_t dword_value) {
+        m_out << indent;
+        OutputPacketField(m_out, packet_field, dword_value);
+        m_out << "\n";
+    },
+    [&](uint32_t dword, uint32_t dword_value) {
+        m_out << "      ";
+        OutputExtraDword(m_out, dword, dword_value);
+        m_out << "\n";
+    });
+}
+
+//--------------------------------------------------------------------------------------------------
+bool PrintRawPm4(std::ostream    &out,
+                 const char      *file_name,
+                 Dive::EngineType engine_type,
+                 Dive::QueueType  queue_type)
+{
+    std::unique_ptr<MappedFile> file = MappedFile::Open(file_name);
+    if (!file)
+    {
+        std::cerr << "Not able to open: " << file_name << std::endl;
+        return false;
+    }
+
+    Dive::IndirectBufferInfo ib_info = {};
+    ib_info.m_va_addr = 0x0;
+    ib_info.m_size_in_dwords = static_cast<uint32_t>(file->GetSize() / sizeof(uint32_t));
+    ib_info.m_enable_mask = UINT32_MAX;
+    ib_info.m_skip = false;
+    DiveVector<Dive::IndirectBufferInfo> ib_array;
+    ib_array.push_back(ib_info);
+    DiveVector<Dive::SubmitInfo> submits;
+    submits.push_back(Dive::SubmitInfo(engine_type, queue_type, 0, false, std::move(ib_array)));
+
+    RawPm4MemoryManager mem_manager(file->GetData(), file->GetSize());
+    Pm4StreamPrinter    printer(out);
+    return printer.ProcessSubmits(submits, mem_manager);
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -610,7 +1115,7 @@ int PrintTopology(const char *filename, TopologyName topology, bool verbose)
 }
 
 //--------------------------------------------------------------------------------------------------
-int ExtractCapture(const char *filename, const char *extract_assets)
+int ExtractCapture(const char *filename, const char *extract_assets, const ExtractOptions &options)
 {
     std::unique_ptr<Dive::DataCore> data = std::make_unique<Dive::DataCore>();
     if (data->LoadPm4CaptureData(filename) != Dive::CaptureData::LoadResult::kSuccess)
@@ -630,7 +1135,12 @@ int ExtractCapture(const char *filename, const char *extract_assets)
         return EXIT_FAILURE;
     }
 
-    ExtractAssets(extract_assets, filename, data->GetPm4CaptureData(), command_hierarchy);
+    ExtractAssets(extract_assets,
+                  filename,
+                  data->GetPm4CaptureData(),
+                  command_hierarchy,
+                  data->GetCaptureMetadata(),
+                  options);
 
     return EXIT_SUCCESS;
 }
@@ -36,6 +36,21 @@ void PrintNodes(std::ostream                   &out,
                 uint64_t                        node_index,
                 bool                            verbose);
 
+// Prints the packets shared by node_index, num_tabs deep, each followed by the descriptions of its
+// registers and fields
+void PrintSharedNodes(std::ostream                   &out,
+                      const Dive::CommandHierarchy   *command_hierarchy_ptr,
+                      const Dive::SharedNodeTopology &topology,
+                      uint64_t                        node_index,
+                      uint32_t                        num_tabs);
+
+// Decodes a raw PM4 command buffer file, printing each packet with its registers and fields as soon
+// as it is emulated. The file is mapped rather than read, and no CommandHierarchy is built.
+bool PrintRawPm4(std::ostream    &out,
+                 const char      *file_name,
+                 Dive::EngineType engine_type,
+                 Dive::QueueType  queue_type);
+
 bool ParseCapture(const char                              *filename,
                   std::unique_ptr<Dive::CaptureData>      *out_capture_data,
                   std::unique_ptr<Dive::CommandHierarchy> *out_command_hierarchy);
@@ -0,0 +1,173 @@
+/*
+ Copyright 2025 Google LLC
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#include "format_output.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "dive_core/pm4_capture_data.h"
+#include "gtest/gtest.h"
+#include "pm4_info.h"
+
+namespace Dive
+{
+namespace cli
+{
+namespace
+{
+
+uint32_t OddParity(uint32_t value)
+{
+    uint32_t parity = 1;
+    for (; value != 0; value >>= 1)
+        parity ^= value & 1;
+    return parity;
+}
+
+uint32_t Type4Header(uint32_t reg_offset, uint32_t count)
+{
+    Pm4Header header = {};
+    header.type4.type = 4;
+    header.type4.count = count;
+    header.type4.count_parity = OddParity(count);
+    header.type4.offset = reg_offset;
+    header.type4.offset_parity = OddParity(reg_offset);
+    return header.u32All;
+}
+
+uint32_t Type7Header(uint32_t opcode, uint32_t count)
+{
+    Pm4Header header = {};
+    header.type7.type = 7;
+    header.type7.count = count;
+    header.type7.count_parity = OddParity(count);
+    header.type7.opcode = opcode;
+    header.type7.opcode_parity = OddParity(opcode);
+    return header.u32All;
+}
+
+std::vector<std::string> SplitLines(const std::string &text)
+{
+    std::vector<std::string> lines;
+    std::istringstream       stream(text);
+    for (std::string line; std::getline(stream, line);)
+        lines.push_back(line);
+    return lines;
+}
+
+class FormatOutputTest : public ::testing::Test
+{
+protected:
+    static void SetUpTestSuite()
+    {
+        Pm4InfoInit();
+        SetGPUID(640);
+    }
+
+    // Lines of the submit topology of the command hierarchy of the dwords, with the packets of the
+    // submit under its IB, as rawpm4 prints them
+    std::vector<std::string> CommandHierarchyLines(std::vector<uint32_t> dwords)
+    {
+        CommandHierarchy        command_hierarchy;
+        Pm4CaptureData          capture_data;
+        CommandHierarchyCreator creator(command_hierarchy, capture_data);
+        EXPECT_TRUE(creator.CreateTrees(EngineType::kUniversal,
+                                        QueueType::kUniversal,
+                                        dwords,
+                                        static_cast<uint32_t>(dwords.size())));
+
+        std::ostringstream        out;
+        const SharedNodeTopology &topology = command_hierarchy.GetSubmitHierarchyTopology();
+        for (uint64_t child = 0; child < topology.GetNumChildren(Topology::kRootNodeIndex); ++child)
+        {
+            uint64_t submit_index = topology.GetChildNodeIndex(Topology::kRootNodeIndex, child);
+            PrintNodes(out, &command_hierarchy, topology, submit_index, false);
+            PrintSharedNodes(out, &command_hierarchy, topology, submit_index, 2);
+        }
+        return SplitLines(out.str());
+    }
+
+    std::vector<std::string> PrintRawPm4Lines(const std::vector<uint32_t> &dwords)
+    {
+        const std::string file_name = ::testing::TempDir() + "format_output_test.pm4";
+        std::ofstream     file(file_name, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(dwords.data()), dwords.size() * sizeof(uint32_t));
+        file.close();
+
+        std::ostringstream out;
+        EXPECT_TRUE(
+        PrintRawPm4(out, file_name.c_str(), EngineType::kUniversal, QueueType::kUniversal));
+        return SplitLines(out.str());
+    }
+};
+
+// rawpm4 prints the lines of the submit topology, and the fields of the registers one level deeper
+TEST_F(FormatOutputTest, RawPm4MatchesCommandHierarchy)
+{
+    const std::vector<uint32_t> dwords = {
+        // RB_DEPTH_BUFFER_PITCH, RB_DEPTH_BUFFER_ARRAY_PITCH and the 64-bit RB_DEPTH_BUFFER_BASE
+        Type4Header(0x8873, 4),
+        0x40,
+        0x80,
+        0x1000,
+        0x1,
+        // RB_DEPTH_CNTL, the 64-bit RB_DEPTH_BUFFER_BASE and an unknown register
+        Type7Header(CP_CONTEXT_REG_BUNCH, 8),
+        0x8871,
+        0x13,
+        0x8875,
+        0x2000,
+        0x8876,
+        0x2,
+        0x1,
+        0x7,
+        // Two fields followed by two dwords of data
+        Type7Header(CP_MEM_WRITE, 4),
+        0x3000,
+        0x0,
+        0xaaaa,
+        0xbbbb,
+        Type7Header(CP_NOP, 0),
+    };
+
+    std::vector<std::string> raw_lines = PrintRawPm4Lines(dwords);
+    std::vector<std::string> register_field_lines;
+    std::vector<std::string> node_lines;
+    for (const std::string &line : raw_lines)
+    {
+        if (line.compare(0, 8, "        ") == 0)
+            register_field_lines.push_back(line);
+        else
+            node_lines.push_back(line);
+    }
+    EXPECT_EQ(node_lines, CommandHierarchyLines(dwords));
+
+    // The extra dwords are the data of the packet, not the header of the next one
+    EXPECT_NE(std::find(node_lines.begin(), node_lines.end(), "      (DWORD 4): 0xbbbb"),
+              node_lines.end());
+    EXPECT_NE(std::find(register_field_lines.begin(),
+                        register_field_lines.end(),
+                        "        Z_TEST_ENABLE: True"),
+              register_field_lines.end());
+}
+
+}  // namespace
+}  // namespace cli
+}  // namespace Dive
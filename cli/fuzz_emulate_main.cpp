@@ -0,0 +1,38 @@
+/*
+ Copyright 2025 Google LLC
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#include <optional>
+
+#include "dive_core/command_hierarchy.h"
+#include "dive_core/pm4_capture_data.h"
+
+// Fuzzes the PM4 emulation of loaded captures, by building the command hierarchy of each input
+// that loads. As in fuzz_main.cpp, the capture data is reused across inputs.
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    static Dive::Pm4CaptureData   capture_data;
+    static Dive::CommandHierarchy command_hierarchy;
+
+    capture_data.Reset();
+    if (capture_data.LoadCaptureBuffer(data, size) != Dive::CaptureData::LoadResult::kSuccess)
+    {
+        return 0;
+    }
+
+    Dive::CommandHierarchyCreator creator(command_hierarchy, capture_data);
+    creator.CreateTrees(true, std::nullopt);
+    return 0;
+}
@@ -0,0 +1,45 @@
+/*
+ Copyright 2025 Google LLC
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+// Simple program to help debug Fuzz failures. Runs the fuzz target on each given input file.
+int main(int argc, char *argv[])
+{
+    int res = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        FILE *f = fopen(argv[i], "rb");
+        if (f == nullptr)
+        {
+            fprintf(stderr, "Not able to open: %s\n", argv[i]);
+            return 1;
+        }
+        fseek(f, 0, SEEK_END);
+        long size = ftell(f);
+        fseek(f, 0, SEEK_SET);
+        std::vector<uint8_t> data(size > 0 ? size : 0);
+        size_t               read_size = fread(data.data(), 1, data.size(), f);
+        fclose(f);
+
+        res |= LLVMFuzzerTestOneInput(data.data(), read_size);
+    }
+    return res;
+}
@@ -13,9 +13,13 @@
  See the License for the specific language governing permissions and
  limitations under the License.
 */
+#include <cstdlib>
+#include <iostream>
+#include <string>
 #include <vector>
 
 #include "commands.h"
+#include "common/trace.h"
 #include "pm4_info.h"
 
 using namespace Dive::cli;
@@ -31,6 +35,8 @@ int main(int argc, char** argv)
         &CommandOf<HelpCommand>::Get(&commands),
         &CommandOf<VersionCommand>::Get(),
         &CommandOf<ExtractCommand>::Get(),
+        &CommandOf<ExportCommand>::Get(),
+        &CommandOf<QueryCommand>::Get(),
         // Internal, use `divecli help --internal`
         // It's hidden to not cause confusion.
         &CommandOf<PacketCommand>::Get(),
@@ -42,14 +48,41 @@ int main(int argc, char** argv)
         commands[cmd->GetName()] = cmd;
     }
 
-    if (argc > 1)
+    // Global options come before the command
+    int         at = 1;
+    std::string trace_file_path;
+    if (at + 1 < argc && std::string("--trace") == argv[at])
     {
-        auto iter = commands.find(argv[1]);
+        trace_file_path = argv[at + 1];
+        at += 2;
+    }
+
+    if (at < argc)
+    {
+        auto iter = commands.find(argv[at]);
         if (iter != commands.end())
         {
-            return (*iter->second)(argc, 1, argv);
+            if (trace_file_path.empty())
+            {
+                return (*iter->second)(argc, at, argv);
+            }
+
+            if (!Dive::Tracer::IsCompiledIn())
+            {
+                std::cerr << "--trace: built without DIVE_ENABLE_TRACING, the trace will be empty"
+                          << std::endl;
+            }
+            Dive::Tracer::Get().Start();
+            int result = (*iter->second)(argc, at, argv);
+            Dive::Tracer::Get().Stop();
+            if (!Dive::Tracer::Get().WriteChromeJson(trace_file_path))
+            {
+                std::cerr << "Failed to write trace: " << trace_file_path << std::endl;
+                return EXIT_FAILURE;
+            }
+            return result;
         }
     }
 
-    return (*commands.find("help")->second)(argc, 0, argv);
+    return (*commands.find("help")->second)(argc, at - 1, argv);
 }
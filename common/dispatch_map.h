@@ -0,0 +1,217 @@
+/*
+Copyright 2025 Google Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Dive
+{
+// A read-mostly map from a dispatch key to the per-instance/per-device data of a layer.
+// Lookups in the table are wait-free (a bounded linear probe over atomics) so they can run on
+// every intercepted call from any thread. Inserts and removals are serialized by a mutex, and
+// happen only when an instance or device is created or destroyed.
+// Removed slots become tombstones that keep the probe sequences of the other keys intact, and are
+// reused by later inserts. Once the table has no free slot left, entries go to a fallback map
+// that is looked up under the mutex, so lookups are only slower after kCapacity live objects.
+// A replaced value is kept alive until the key is removed since another thread might still be
+// using it. Vulkan requires destroying an object to be synchronized with all its uses, so the
+// value of a removed key is freed right away.
+template<typename T, size_t kCapacity = 64> class DispatchMap
+{
+    static_assert((kCapacity & (kCapacity - 1)) == 0, "kCapacity must be a power of 2");
+
+public:
+    DispatchMap() = default;
+    DispatchMap(const DispatchMap &) = delete;
+    DispatchMap &operator=(const DispatchMap &) = delete;
+
+    // Returns nullptr if the key is not in the map
+    T *Get(uintptr_t key) const
+    {
+        const size_t start = Hash(key);
+        for (size_t i = 0; i < kCapacity; ++i)
+        {
+            const Slot     &slot = m_slots[(start + i) & (kCapacity - 1)];
+            const uintptr_t slot_key = slot.key.load(std::memory_order_acquire);
+            if (slot_key == key)
+            {
+                return slot.value.load(std::memory_order_acquire);
+            }
+            if (slot_key == kEmptyKey)
+            {
+                return nullptr;
+            }
+        }
+        if (m_fallback_size.load(std::memory_order_acquire) == 0)
+        {
+            return nullptr;
+        }
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto                        it = m_fallback.find(key);
+        return (it != m_fallback.end()) ? it->second : nullptr;
+    }
+
+    // Returns false only for the reserved keys 0 and 1, which are never valid dispatch keys
+    bool Insert(uintptr_t key, std::unique_ptr<T> value)
+    {
+        if ((key == kEmptyKey) || (key == kTombstoneKey))
+        {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        T                          *value_ptr = value.get();
+        m_values.push_back({ key, std::move(value) });
+
+        auto fallback_it = m_fallback.find(key);
+        if (fallback_it != m_fallback.end())
+        {
+            fallback_it->second = value_ptr;
+            return true;
+        }
+
+        // Replace the value of the key if present, otherwise take the first tombstone or empty
+        // slot of its probe sequence
+        Slot        *free_slot = nullptr;
+        const size_t start = Hash(key);
+        for (size_t i = 0; i < kCapacity; ++i)
+        {
+            Slot           &slot = m_slots[(start + i) & (kCapacity - 1)];
+            const uintptr_t slot_key = slot.key.load(std::memory_order_relaxed);
+            if (slot_key == key)
+            {
+                slot.value.store(value_ptr, std::memory_order_release);
+                return true;
+            }
+            if ((slot_key == kTombstoneKey) && (free_slot == nullptr))
+            {
+                free_slot = &slot;
+            }
+            if (slot_key == kEmptyKey)
+            {
+                if (free_slot == nullptr)
+                {
+                    free_slot = &slot;
+                }
+                break;
+            }
+        }
+
+        if (free_slot == nullptr)
+        {
+            m_fallback[key] = value_ptr;
+            m_fallback_size.store(m_fallback.size(), std::memory_order_release);
+            return true;
+        }
+
+        // Publish the value before the key, so that a reader finding the key also sees the value
+        free_slot->value.store(value_ptr, std::memory_order_release);
+        free_slot->key.store(key, std::memory_order_release);
+        return true;
+    }
+
+    // Frees the values of the key. Returns false if the key is not in the map
+    bool Remove(uintptr_t key)
+    {
+        if ((key == kEmptyKey) || (key == kTombstoneKey))
+        {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        T                          *value_ptr = nullptr;
+        auto                        fallback_it = m_fallback.find(key);
+        if (fallback_it != m_fallback.end())
+        {
+            value_ptr = fallback_it->second;
+            m_fallback.erase(fallback_it);
+            m_fallback_size.store(m_fallback.size(), std::memory_order_release);
+        }
+        else
+        {
+            const size_t start = Hash(key);
+            for (size_t i = 0; i < kCapacity; ++i)
+            {
+                Slot           &slot = m_slots[(start + i) & (kCapacity - 1)];
+                const uintptr_t slot_key = slot.key.load(std::memory_order_relaxed);
+                if (slot_key == key)
+                {
+                    value_ptr = slot.value.load(std::memory_order_relaxed);
+                    slot.key.store(kTombstoneKey, std::memory_order_release);
+                    slot.value.store(nullptr, std::memory_order_release);
+                    break;
+                }
+                if (slot_key == kEmptyKey)
+                {
+                    break;
+                }
+            }
+        }
+
+        if (value_ptr == nullptr)
+        {
+            return false;
+        }
+
+        // Also frees the values the key had before being replaced
+        auto it = std::remove_if(m_values.begin(),
+                                 m_values.end(),
+                                 [key](const std::pair<uintptr_t, std::unique_ptr<T>> &value) {
+                                     return value.first == key;
+                                 });
+        m_values.erase(it, m_values.end());
+        return true;
+    }
+
+private:
+    static constexpr uintptr_t kEmptyKey = 0;
+    static constexpr uintptr_t kTombstoneKey = 1;
+
+    struct Slot
+    {
+        std::atomic<uintptr_t> key = kEmptyKey;
+        std::atomic<T *>       value = nullptr;
+    };
+
+    static size_t Hash(uintptr_t key)
+    {
+        // The keys are pointers to the loader dispatch tables, mix the aligned low bits away
+        uint64_t h = static_cast<uint64_t>(key);
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        return static_cast<size_t>(h) & (kCapacity - 1);
+    }
+
+    std::array<Slot, kCapacity> m_slots;
+    // Owns the values of the keys in the map with their replaced values, guarded by m_mutex
+    mutable std::mutex                                      m_mutex;
+    std::vector<std::pair<uintptr_t, std::unique_ptr<T>>> m_values;
+    // Keys that did not fit in m_slots, guarded by m_mutex
+    std::unordered_map<uintptr_t, T *> m_fallback;
+    std::atomic<size_t>                m_fallback_size = 0;
+};
+}  // namespace Dive
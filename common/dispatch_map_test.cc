@@ -0,0 +1,141 @@
+/*
+Copyright 2025 Google Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "common/dispatch_map.h"
+
+#include <gtest/gtest.h>
+
+namespace Dive
+{
+namespace
+{
+
+constexpr size_t kCapacity = 8;
+
+// Dispatch keys are pointers to the loader dispatch tables, so they are aligned
+uintptr_t MakeKey(size_t i)
+{
+    return 0x1000 + i * 16;
+}
+
+TEST(DispatchMapTest, InsertAndGet)
+{
+    DispatchMap<int, kCapacity> map;
+    EXPECT_EQ(map.Get(MakeKey(0)), nullptr);
+
+    ASSERT_TRUE(map.Insert(MakeKey(0), std::make_unique<int>(10)));
+    ASSERT_TRUE(map.Insert(MakeKey(1), std::make_unique<int>(11)));
+    ASSERT_NE(map.Get(MakeKey(0)), nullptr);
+    EXPECT_EQ(*map.Get(MakeKey(0)), 10);
+    EXPECT_EQ(*map.Get(MakeKey(1)), 11);
+    EXPECT_EQ(map.Get(MakeKey(2)), nullptr);
+}
+
+TEST(DispatchMapTest, InsertReservedKeyFails)
+{
+    DispatchMap<int, kCapacity> map;
+    EXPECT_FALSE(map.Insert(0, std::make_unique<int>(0)));
+    EXPECT_FALSE(map.Insert(1, std::make_unique<int>(1)));
+    EXPECT_EQ(map.Get(0), nullptr);
+    EXPECT_EQ(map.Get(1), nullptr);
+}
+
+TEST(DispatchMapTest, InsertReplacesValue)
+{
+    DispatchMap<int, kCapacity> map;
+    ASSERT_TRUE(map.Insert(MakeKey(0), std::make_unique<int>(10)));
+    int *old_value = map.Get(MakeKey(0));
+    ASSERT_TRUE(map.Insert(MakeKey(0), std::make_unique<int>(20)));
+    EXPECT_EQ(*map.Get(MakeKey(0)), 20);
+    // The replaced value stays alive for readers that still hold it
+    EXPECT_EQ(*old_value, 10);
+}
+
+TEST(DispatchMapTest, RemoveKeepsOtherKeys)
+{
+    DispatchMap<int, kCapacity> map;
+    for (size_t i = 0; i < kCapacity; ++i)
+    {
+        ASSERT_TRUE(map.Insert(MakeKey(i), std::make_unique<int>(static_cast<int>(i))));
+    }
+    EXPECT_TRUE(map.Remove(MakeKey(3)));
+    EXPECT_FALSE(map.Remove(MakeKey(3)));
+    EXPECT_EQ(map.Get(MakeKey(3)), nullptr);
+    for (size_t i = 0; i < kCapacity; ++i)
+    {
+        if (i != 3)
+        {
+            ASSERT_NE(map.Get(MakeKey(i)), nullptr);
+            EXPECT_EQ(*map.Get(MakeKey(i)), static_cast<int>(i));
+        }
+    }
+}
+
+TEST(DispatchMapTest, FullTableFallsBack)
+{
+    DispatchMap<int, kCapacity> map;
+    constexpr size_t            kCount = kCapacity * 4;
+    for (size_t i = 0; i < kCount; ++i)
+    {
+        ASSERT_TRUE(map.Insert(MakeKey(i), std::make_unique<int>(static_cast<int>(i))));
+    }
+    for (size_t i = 0; i < kCount; ++i)
+    {
+        ASSERT_NE(map.Get(MakeKey(i)), nullptr);
+        EXPECT_EQ(*map.Get(MakeKey(i)), static_cast<int>(i));
+    }
+    EXPECT_EQ(map.Get(MakeKey(kCount)), nullptr);
+}
+
+// Creating and destroying more objects than the capacity, as an app recreating its device does
+TEST(DispatchMapTest, CreateDestroyCycles)
+{
+    DispatchMap<int, kCapacity> map;
+    for (size_t i = 0; i < kCapacity * 16; ++i)
+    {
+        ASSERT_TRUE(map.Insert(MakeKey(i), std::make_unique<int>(static_cast<int>(i))));
+        ASSERT_NE(map.Get(MakeKey(i)), nullptr);
+        EXPECT_EQ(*map.Get(MakeKey(i)), static_cast<int>(i));
+        if (i > 0)
+        {
+            EXPECT_TRUE(map.Remove(MakeKey(i - 1)));
+            EXPECT_EQ(map.Get(MakeKey(i - 1)), nullptr);
+        }
+    }
+}
+
+TEST(DispatchMapTest, RemoveFromFallback)
+{
+    DispatchMap<int, kCapacity> map;
+    for (size_t i = 0; i < kCapacity + 2; ++i)
+    {
+        ASSERT_TRUE(map.Insert(MakeKey(i), std::make_unique<int>(static_cast<int>(i))));
+    }
+    // Remove one key of the table and one of the fallback, then reuse the freed slot
+    EXPECT_TRUE(map.Remove(MakeKey(0)));
+    EXPECT_TRUE(map.Remove(MakeKey(kCapacity + 1)));
+    EXPECT_EQ(map.Get(MakeKey(kCapacity + 1)), nullptr);
+    ASSERT_TRUE(map.Insert(MakeKey(100), std::make_unique<int>(100)));
+    EXPECT_EQ(*map.Get(MakeKey(100)), 100);
+    for (size_t i = 1; i <= kCapacity; ++i)
+    {
+        ASSERT_NE(map.Get(MakeKey(i)), nullptr);
+        EXPECT_EQ(*map.Get(MakeKey(i)), static_cast<int>(i));
+    }
+}
+
+}  // namespace
+}  // namespace Dive
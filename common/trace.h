@@ -0,0 +1,272 @@
+/*
+Copyright 2025 Google Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Scoped trace instrumentation, used to see where the time goes when loading a capture. Spans nest
+// per thread and are written, with counter samples, as a Chrome JSON trace that can be opened in
+// ui.perfetto.dev or chrome://tracing:
+//
+//     DIVE_TRACE_SCOPE("CreateTrees");             // Span until the end of the enclosing scope
+//     DIVE_TRACE_COUNTER("Nodes", num_nodes);      // Counter sample, num_nodes is only evaluated
+//                                                  // while recording
+//
+// Names must be string literals. Nothing is recorded until Tracer::Get().Start(), and the macros
+// compile to nothing unless DIVE_ENABLE_TRACING is defined.
+
+namespace Dive
+{
+
+class Tracer
+{
+public:
+    static Tracer &Get()
+    {
+        static Tracer tracer;
+        return tracer;
+    }
+
+    // Whether the DIVE_TRACE_* instrumentation is compiled in
+    static constexpr bool IsCompiledIn()
+    {
+#ifdef DIVE_ENABLE_TRACING
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // Discard previously recorded events and start recording
+    void Start()
+    {
+        std::lock_guard<std::mutex> lock(m_threads_mutex);
+        for (auto &thread_events : m_threads)
+        {
+            std::lock_guard<std::mutex> thread_lock(thread_events->m_mutex);
+            thread_events->m_events.clear();
+        }
+        m_start_ns.store(SteadyClockNs(), std::memory_order_relaxed);
+        m_recording.store(true, std::memory_order_release);
+    }
+
+    void Stop() { m_recording.store(false, std::memory_order_release); }
+
+    bool IsRecording() const { return m_recording.load(std::memory_order_relaxed); }
+
+    // Nanoseconds since Start()
+    uint64_t Now() const { return SteadyClockNs() - m_start_ns.load(std::memory_order_relaxed); }
+
+    void AddSpan(const char *name, uint64_t begin_ns, uint64_t end_ns)
+    {
+        AddEvent({ name, begin_ns, end_ns - begin_ns, EventType::kSpan });
+    }
+
+    void AddCounter(const char *name, int64_t value)
+    {
+        AddEvent({ name, Now(), static_cast<uint64_t>(value), EventType::kCounter });
+    }
+
+    // Write the events recorded since Start() to a Chrome JSON trace file
+    bool WriteChromeJson(const std::string &file_path)
+    {
+        std::ofstream file(file_path, std::ios::out | std::ios::trunc);
+        if (!file.is_open())
+        {
+            return false;
+        }
+
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,"
+                "\"args\":{\"name\":\"Dive\"}}";
+
+        std::lock_guard<std::mutex> lock(m_threads_mutex);
+        for (const auto &thread_events : m_threads)
+        {
+            std::lock_guard<std::mutex> thread_lock(thread_events->m_mutex);
+            if (thread_events->m_events.empty())
+            {
+                continue;
+            }
+
+            uint32_t tid = thread_events->m_thread_index;
+            file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+                 << ",\"args\":{\"name\":\"Thread " << tid << "\"}}";
+            for (const Event &event : thread_events->m_events)
+            {
+                file << ",\n{\"name\":\"";
+                WriteJsonString(file, event.m_name);
+                if (event.m_type == EventType::kSpan)
+                {
+                    file << "\",\"cat\":\"dive\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+                         << ",\"ts\":";
+                    WriteMicroseconds(file, event.m_timestamp);
+                    file << ",\"dur\":";
+                    WriteMicroseconds(file, event.m_value);
+                    file << "}";
+                }
+                else
+                {
+                    file << "\",\"ph\":\"C\",\"pid\":1,\"tid\":" << tid << ",\"ts\":";
+                    WriteMicroseconds(file, event.m_timestamp);
+                    file << ",\"args\":{\"value\":" << static_cast<int64_t>(event.m_value)
+                         << "}}";
+                }
+            }
+        }
+        file << "\n]}\n";
+        file.close();
+        return !file.fail();
+    }
+
+private:
+    enum class EventType : uint8_t
+    {
+        kSpan,
+        kCounter,
+    };
+
+    struct Event
+    {
+        const char *m_name;
+        uint64_t    m_timestamp;
+        // Duration of a span, value of a counter
+        uint64_t  m_value;
+        EventType m_type;
+    };
+
+    // Events of one thread. The mutex is only contended while starting or writing a trace
+    struct ThreadEvents
+    {
+        uint32_t           m_thread_index;
+        std::mutex         m_mutex;
+        std::vector<Event> m_events;
+    };
+
+    Tracer() = default;
+
+    void AddEvent(const Event &event)
+    {
+        if (!IsRecording())
+        {
+            return;
+        }
+        ThreadEvents               &thread_events = GetThreadEvents();
+        std::lock_guard<std::mutex> lock(thread_events.m_mutex);
+        thread_events.m_events.push_back(event);
+    }
+
+    // ThreadEvents are never freed, so the per-thread pointer stays valid across Start()
+    ThreadEvents &GetThreadEvents()
+    {
+        static thread_local ThreadEvents *thread_events = nullptr;
+        if (thread_events == nullptr)
+        {
+            std::lock_guard<std::mutex> lock(m_threads_mutex);
+            m_threads.push_back(std::make_unique<ThreadEvents>());
+            thread_events = m_threads.back().get();
+            thread_events->m_thread_index = static_cast<uint32_t>(m_threads.size());
+        }
+        return *thread_events;
+    }
+
+    static uint64_t SteadyClockNs()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+    }
+
+    static void WriteMicroseconds(std::ostream &file, uint64_t ns)
+    {
+        uint64_t fraction = ns % 1000;
+        file << (ns / 1000) << '.' << (fraction < 100 ? "0" : "") << (fraction < 10 ? "0" : "")
+             << fraction;
+    }
+
+    static void WriteJsonString(std::ostream &file, const char *str)
+    {
+        for (; *str != '\0'; ++str)
+        {
+            if (*str == '"' || *str == '\\')
+            {
+                file << '\\';
+            }
+            file << *str;
+        }
+    }
+
+    std::atomic<bool>                          m_recording{ false };
+    std::atomic<uint64_t>                      m_start_ns{ 0 };
+    std::mutex                                 m_threads_mutex;
+    std::vector<std::unique_ptr<ThreadEvents>> m_threads;
+};
+
+// Records a span from construction to destruction, if the tracer was recording at construction
+class ScopedTrace
+{
+public:
+    explicit ScopedTrace(const char *name) :
+        m_name(name),
+        m_recording(Tracer::Get().IsRecording()),
+        m_begin(m_recording ? Tracer::Get().Now() : 0)
+    {
+    }
+
+    ~ScopedTrace()
+    {
+        if (m_recording)
+        {
+            Tracer::Get().AddSpan(m_name, m_begin, Tracer::Get().Now());
+        }
+    }
+
+    ScopedTrace(const ScopedTrace &) = delete;
+    ScopedTrace &operator=(const ScopedTrace &) = delete;
+
+private:
+    const char *m_name;
+    bool        m_recording;
+    uint64_t    m_begin;
+};
+
+}  // namespace Dive
+
+#define DIVE_TRACE_CONCAT_INNER(x, y) x##y
+#define DIVE_TRACE_CONCAT(x, y) DIVE_TRACE_CONCAT_INNER(x, y)
+
+#ifdef DIVE_ENABLE_TRACING
+#    define DIVE_TRACE_SCOPE(name) \
+        Dive::ScopedTrace DIVE_TRACE_CONCAT(dive_trace_scope_, __LINE__)(name)
+#    define DIVE_TRACE_COUNTER(name, value)                                        \
+        do                                                                         \
+        {                                                                          \
+            if (Dive::Tracer::Get().IsRecording())                                 \
+                Dive::Tracer::Get().AddCounter(name, static_cast<int64_t>(value)); \
+        } while (0)
+#else
+#    define DIVE_TRACE_SCOPE(name) ((void)0)
+// sizeof keeps value referenced, without evaluating it
+#    define DIVE_TRACE_COUNTER(name, value) ((void)sizeof(value))
+#endif
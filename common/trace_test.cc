@@ -0,0 +1,219 @@
+/*
+Copyright 2025 Google Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "common/trace.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Dive
+{
+namespace
+{
+
+static_assert(Tracer::IsCompiledIn(), "trace_test must be built with DIVE_ENABLE_TRACING");
+
+// An event line of the JSON trace, which has one event per line
+struct TraceEvent
+{
+    std::string m_name;
+    std::string m_phase;
+    int         m_tid = 0;
+    double      m_ts = 0;
+    double      m_dur = 0;
+    std::string m_line;
+};
+
+class TraceTest : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        m_path = testing::TempDir() + "trace_test.json";
+        Tracer::Get().Start();
+    }
+
+    void TearDown() override
+    {
+        Tracer::Get().Stop();
+        std::remove(m_path.c_str());
+    }
+
+    // Stops recording, writes the trace and reads back its events
+    std::vector<TraceEvent> WriteAndReadEvents()
+    {
+        Tracer::Get().Stop();
+        EXPECT_TRUE(Tracer::Get().WriteChromeJson(m_path));
+
+        std::ifstream     file(m_path);
+        std::stringstream contents;
+        contents << file.rdbuf();
+        m_json = contents.str();
+
+        static const std::regex kEventRegex(R"re(^\{"name":"((?:[^"\\]|\\.)*)".*"ph":"(\w)")re"
+                                            R"re(,"pid":1,"tid":(\d+)(?:,"ts":([\d.]+))?)re"
+                                            R"re((?:,"dur":([\d.]+))?)re");
+        std::vector<TraceEvent> events;
+        std::istringstream      lines(m_json);
+        std::string             line;
+        while (std::getline(lines, line))
+        {
+            std::smatch match;
+            if (!std::regex_search(line, match, kEventRegex))
+            {
+                continue;
+            }
+            TraceEvent event;
+            event.m_name = match[1];
+            event.m_phase = match[2];
+            event.m_tid = std::stoi(match[3]);
+            event.m_ts = match[4].matched ? std::stod(match[4]) : 0;
+            event.m_dur = match[5].matched ? std::stod(match[5]) : 0;
+            event.m_line = line;
+            events.push_back(event);
+        }
+        return events;
+    }
+
+    static const TraceEvent *FindEvent(const std::vector<TraceEvent> &events,
+                                       const std::string             &name)
+    {
+        for (const TraceEvent &event : events)
+        {
+            if (event.m_name == name)
+            {
+                return &event;
+            }
+        }
+        return nullptr;
+    }
+
+    std::string m_path;
+    std::string m_json;
+};
+
+TEST_F(TraceTest, WritesChromeJson)
+{
+    {
+        DIVE_TRACE_SCOPE("Load");
+        DIVE_TRACE_COUNTER("Bytes read", 1234);
+    }
+    std::vector<TraceEvent> events = WriteAndReadEvents();
+
+    EXPECT_EQ(m_json.rfind("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", 0), 0u);
+    EXPECT_EQ(m_json.substr(m_json.size() - 4), "\n]}\n");
+
+    const TraceEvent *process_name = FindEvent(events, "process_name");
+    ASSERT_NE(process_name, nullptr);
+    EXPECT_EQ(process_name->m_phase, "M");
+
+    const TraceEvent *span = FindEvent(events, "Load");
+    ASSERT_NE(span, nullptr);
+    EXPECT_EQ(span->m_phase, "X");
+    EXPECT_NE(span->m_line.find("\"cat\":\"dive\""), std::string::npos);
+
+    const TraceEvent *counter = FindEvent(events, "Bytes read");
+    ASSERT_NE(counter, nullptr);
+    EXPECT_EQ(counter->m_phase, "C");
+    EXPECT_EQ(counter->m_tid, span->m_tid);
+    EXPECT_NE(counter->m_line.find("\"args\":{\"value\":1234}"), std::string::npos);
+}
+
+TEST_F(TraceTest, SpansNest)
+{
+    {
+        DIVE_TRACE_SCOPE("Outer");
+        {
+            DIVE_TRACE_SCOPE("Inner");
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+    }
+    std::vector<TraceEvent> events = WriteAndReadEvents();
+
+    const TraceEvent *outer = FindEvent(events, "Outer");
+    const TraceEvent *inner = FindEvent(events, "Inner");
+    ASSERT_NE(outer, nullptr);
+    ASSERT_NE(inner, nullptr);
+    EXPECT_EQ(outer->m_tid, inner->m_tid);
+    EXPECT_GE(inner->m_dur, 2000.0);
+    EXPECT_LE(outer->m_ts, inner->m_ts);
+    EXPECT_GE(outer->m_ts + outer->m_dur, inner->m_ts + inner->m_dur);
+}
+
+TEST_F(TraceTest, ThreadsHaveTheirOwnTrack)
+{
+    {
+        DIVE_TRACE_SCOPE("Main");
+    }
+    std::thread thread([]() { DIVE_TRACE_SCOPE("Worker"); });
+    thread.join();
+    std::vector<TraceEvent> events = WriteAndReadEvents();
+
+    const TraceEvent *main_span = FindEvent(events, "Main");
+    const TraceEvent *worker_span = FindEvent(events, "Worker");
+    ASSERT_NE(main_span, nullptr);
+    ASSERT_NE(worker_span, nullptr);
+    EXPECT_NE(main_span->m_tid, worker_span->m_tid);
+
+    int num_thread_names = 0;
+    for (const TraceEvent &event : events)
+    {
+        num_thread_names += (event.m_name == "thread_name") ? 1 : 0;
+    }
+    EXPECT_EQ(num_thread_names, 2);
+}
+
+TEST_F(TraceTest, RecordsOnlyWhileStarted)
+{
+    {
+        DIVE_TRACE_SCOPE("Discarded");
+    }
+    Tracer::Get().Start();
+    {
+        DIVE_TRACE_SCOPE("Recorded");
+    }
+    Tracer::Get().Stop();
+    {
+        DIVE_TRACE_SCOPE("Stopped");
+        DIVE_TRACE_COUNTER("Stopped counter", 1);
+    }
+    std::vector<TraceEvent> events = WriteAndReadEvents();
+
+    EXPECT_EQ(FindEvent(events, "Discarded"), nullptr);
+    EXPECT_NE(FindEvent(events, "Recorded"), nullptr);
+    EXPECT_EQ(FindEvent(events, "Stopped"), nullptr);
+    EXPECT_EQ(FindEvent(events, "Stopped counter"), nullptr);
+}
+
+TEST_F(TraceTest, EscapesNames)
+{
+    {
+        DIVE_TRACE_SCOPE("Quote\" and backslash\\");
+    }
+    std::vector<TraceEvent> events = WriteAndReadEvents();
+
+    EXPECT_NE(FindEvent(events, "Quote\\\" and backslash\\\\"), nullptr);
+}
+
+}  // namespace
+}  // namespace Dive
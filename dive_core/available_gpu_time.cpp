@@ -16,14 +16,19 @@
 
 #include "dive_core/available_gpu_time.h"
 
+#include <algorithm>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <sstream>
 #include <string>
 #include <vector>
 #include <optional>
 
+#include "dive_core/common/mapped_file.h"
+
 namespace Dive
 {
 
@@ -168,6 +173,197 @@ bool AvailableGpuTiming::LoadFromString(const std::string& full_text)
     return IsValid();
 }
 
+bool AvailableGpuTiming::LoadFromRecords(const std::filesystem::path& file_path)
+{
+    std::cout << "Loading GPU timing records from file..." << std::endl;
+    if (m_loaded)
+    {
+        std::cerr << "Cannot load this object again" << std::endl;
+        return false;
+    }
+
+    std::unique_ptr<MappedFile> file = MappedFile::Open(file_path);
+    if (!file)
+    {
+        m_loaded = true;
+        std::cerr << "Failed to open file: " << file_path << std::endl;
+        return false;
+    }
+    return LoadFromRecordData(file->GetView());
+}
+
+bool AvailableGpuTiming::LoadFromRecordData(std::string_view data)
+{
+    if (m_loaded)
+    {
+        std::cerr << "Cannot load this object again" << std::endl;
+        return false;
+    }
+    m_loaded = true;
+
+    GpuTimeRecordHeader header;
+    if (data.size() < sizeof(header))
+    {
+        std::cerr << "Missing GPU timing record header" << std::endl;
+        return false;
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+    if ((std::memcmp(header.magic, kGpuTimeRecordMagic, sizeof(header.magic)) != 0) ||
+        (header.version != kGpuTimeRecordVersion) || (header.sample_size != sizeof(GpuTimeSample)))
+    {
+        std::cerr << "Unsupported GPU timing record file, version: " << header.version
+                  << std::endl;
+        return false;
+    }
+    m_timestamp_period_ns = header.timestamp_period_ns;
+
+    // A replay killed while writing can leave a partial sample at the end, ignore it
+    const char*  samples = data.data() + sizeof(header);
+    const size_t num_samples = (data.size() - sizeof(header)) / sizeof(GpuTimeSample);
+    auto         ReadSample = [samples](size_t index) {
+        // The data is not necessarily aligned, unlike a mapped file
+        GpuTimeSample sample;
+        std::memcpy(&sample, samples + index * sizeof(GpuTimeSample), sizeof(GpuTimeSample));
+        return sample;
+    };
+
+    // Object types of the samples of a frame, in file order. The ids are implied by the order.
+    std::vector<ObjectType> layout;
+    std::vector<ObjectType> frame_layout;
+    std::vector<uint64_t>   frame_ticks;
+    size_t                  index = 0;
+    while (index < num_samples)
+    {
+        const uint32_t frame_index = ReadSample(index).frame_index;
+        uint32_t       next_ids[static_cast<uint8_t>(ObjectType::nObjectTypes)] = {};
+        frame_layout.clear();
+        frame_ticks.clear();
+        for (; index < num_samples; ++index)
+        {
+            const GpuTimeSample sample = ReadSample(index);
+            if (sample.frame_index != frame_index)
+            {
+                break;
+            }
+            if (sample.object_type >= static_cast<uint8_t>(ObjectType::nObjectTypes))
+            {
+                std::cerr << "Unexpected object_type (" << static_cast<int>(sample.object_type)
+                          << ") in frame " << frame_index << std::endl;
+                return false;
+            }
+            if (sample.object_id != next_ids[sample.object_type]++)
+            {
+                std::cerr << "Unexpected id (" << sample.object_id << ") in frame " << frame_index
+                          << " for object_type: "
+                          << GetObjectTypeString(static_cast<ObjectType>(sample.object_type))
+                          << std::endl;
+                return false;
+            }
+            frame_layout.push_back(static_cast<ObjectType>(sample.object_type));
+            frame_ticks.push_back(sample.ticks);
+        }
+
+        // A killed replay leaves the samples of its last frame incomplete, so a last frame with
+        // other objects is dropped rather than restarting the statistics
+        if ((index == num_samples) && !layout.empty() && (frame_layout != layout))
+        {
+            m_dropped_frames++;
+            break;
+        }
+
+        // Like GPUTime, a change of the objects of a frame restarts the statistics since the ids
+        // no longer refer to the same objects
+        if (frame_layout != layout)
+        {
+            layout.swap(frame_layout);
+            m_sample_ticks.clear();
+            m_total_frames = 0;
+        }
+        m_sample_ticks.insert(m_sample_ticks.end(), frame_ticks.begin(), frame_ticks.end());
+        m_total_frames++;
+    }
+
+    if (m_total_frames == 0)
+    {
+        std::cerr << "No GPU timing records" << std::endl;
+        return false;
+    }
+
+    ComputeStatsFromSamples(layout);
+    Validate();
+    return IsValid();
+}
+
+void AvailableGpuTiming::ComputeStatsFromSamples(const std::vector<ObjectType>& layout)
+{
+    const double kNanoToMilli = 1.0 / 1000000.0;
+    const size_t num_entries = layout.size();
+
+    std::vector<double> column(m_total_frames);
+    for (size_t entry_index = 0; entry_index < num_entries; ++entry_index)
+    {
+        double sum = 0.0;
+        for (uint32_t frame = 0; frame < m_total_frames; ++frame)
+        {
+            column[frame] = static_cast<double>(m_sample_ticks[frame * num_entries + entry_index]) *
+                            m_timestamp_period_ns * kNanoToMilli;
+            sum += column[frame];
+        }
+
+        // Same median as GPUTime: average of the two middle samples for an even count
+        const size_t middle = column.size() / 2;
+        std::nth_element(column.begin(), column.begin() + middle, column.end());
+        double median = column[middle];
+        if (column.size() % 2 == 0)
+        {
+            median = (median + *std::max_element(column.begin(), column.begin() + middle)) / 2.0;
+        }
+
+        const ObjectType object_type = layout[entry_index];
+        const uint8_t    index = static_cast<uint8_t>(object_type);
+        Entry            entry;
+        entry.object_type = object_type;
+        entry.per_frame_id = static_cast<uint32_t>(m_stats[index].size());
+        m_ordered_entries.push_back(entry);
+
+        Stats stats;
+        stats.mean_ms = static_cast<float>(sum / m_total_frames);
+        stats.median_ms = static_cast<float>(median);
+        m_stats[index].push_back(stats);
+    }
+}
+
+std::vector<double> AvailableGpuTiming::GetSamplesMs(ObjectType object_type,
+                                                     uint32_t   object_id) const
+{
+    std::vector<double> samples;
+    if (!m_valid || m_sample_ticks.empty())
+    {
+        return samples;
+    }
+
+    const size_t num_entries = m_ordered_entries.size();
+    for (size_t entry_index = 0; entry_index < num_entries; ++entry_index)
+    {
+        const Entry& entry = m_ordered_entries[entry_index];
+        if ((entry.object_type != object_type) || (entry.per_frame_id != object_id))
+        {
+            continue;
+        }
+
+        const double kNanoToMilli = 1.0 / 1000000.0;
+        samples.reserve(m_total_frames);
+        for (uint32_t frame = 0; frame < m_total_frames; ++frame)
+        {
+            samples.push_back(static_cast<double>(
+                              m_sample_ticks[frame * num_entries + entry_index]) *
+                              m_timestamp_period_ns * kNanoToMilli);
+        }
+        break;
+    }
+    return samples;
+}
+
 bool AvailableGpuTiming::LoadFromStream(std::istream& stream)
 {
     std::string line;
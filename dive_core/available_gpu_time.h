@@ -19,16 +19,20 @@
 #include <filesystem>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "gpu_time/gpu_time_record.h"
+
 namespace Dive
 {
 
 /*
-AvailableGpuTiming parses CSV format file (gpu_time.csv) produced by looping GFXR replay into
-available timing info statistics.
+AvailableGpuTiming loads the timing info statistics produced by looping GFXR replay, either from
+the binary records of every frame (gpu_time.bin, see gpu_time/gpu_time_record.h) or from the CSV
+export of the statistics of the last frame (gpu_time.csv).
 
-TODO: Retrieve GPU timing info from device to host through network/ rather than using a CSV file.
+TODO: Retrieve GPU timing info from device to host through network/ rather than using a file.
 */
 
 namespace
@@ -39,16 +43,9 @@ constexpr int kDisplayFloatPrecision = 3;
 class AvailableGpuTiming
 {
 public:
-    // TODO(b/444500681): Consider moving enums (ObjectType, ColumnType) and kDisplayFloatPrecision
-    // to gpu_time/ where the statistics are produced and refactoring so that it is no longer
-    // hard-coded
-    enum class ObjectType : uint8_t
-    {
-        kFrame = 0,
-        kCommandBuffer = 1,
-        kRenderPass = 2,
-        nObjectTypes = 3,  // Also used for invalid ObjectTypes
-    };
+    // TODO(b/444500681): Consider moving ColumnType and kDisplayFloatPrecision to gpu_time/ where
+    // the statistics are produced and refactoring so that it is no longer hard-coded
+    using ObjectType = GpuTimeObjectType;
 
     // Columns expected in the .csv file
     enum class ColumnType : uint8_t
@@ -86,6 +83,24 @@ public:
     // For unit testing
     bool LoadFromString(const std::string& full_text);
 
+    // Load the samples from a binary record file, compute their statistics and flag as loaded
+    // afterwards. The file is memory mapped rather than parsed.
+    bool LoadFromRecords(const std::filesystem::path& file_path);
+
+    // Load the samples from the content of a binary record file and flag as loaded afterwards
+    // For unit testing
+    bool LoadFromRecordData(std::string_view data);
+
+    // Get the duration in ms of the object in each frame the statistics were computed from. Only
+    // available when loaded from binary records, empty otherwise.
+    std::vector<double> GetSamplesMs(ObjectType object_type, uint32_t object_id) const;
+
+    // Get the number of frames the statistics were collected from
+    uint32_t GetTotalFrames() const { return m_total_frames; }
+
+    // Get the number of trailing frames dropped from the binary records for being incomplete
+    uint32_t GetDroppedFrames() const { return m_dropped_frames; }
+
     // Get the statistic info with the ObjectType and the object_id (nth object
     // of type ObjectType) If the object_type is kFrame, the object_id value
     // will be disregarded
@@ -126,6 +141,9 @@ private:
     // Load statistics from non-header CSV row
     bool LoadLine(uint32_t row, const std::string& line);
 
+    // Compute m_ordered_entries and m_stats from the raw samples
+    void ComputeStatsFromSamples(const std::vector<ObjectType>& layout);
+
     // Check m_ordered_entries against info stored in *_stats members
     void Validate();
 
@@ -135,9 +153,14 @@ private:
     // Statistics from file, indexed by ObjectType
     std::vector<std::vector<Stats>> m_stats = {};
 
-    uint32_t m_total_frames = 0;  // The number of frames the statistics were collected from
-    bool     m_loaded = false;    // If true, prevent further loading
-    bool     m_valid = false;     // Validated at loading time
+    // Raw samples from binary records, a row of m_ordered_entries.size() ticks per frame
+    std::vector<uint64_t> m_sample_ticks = {};
+    double                m_timestamp_period_ns = 0.0;
+
+    uint32_t m_total_frames = 0;    // The number of frames the statistics were collected from
+    uint32_t m_dropped_frames = 0;  // The number of incomplete trailing frames dropped
+    bool     m_loaded = false;      // If true, prevent further loading
+    bool     m_valid = false;       // Validated at loading time
 };
 
 }  // namespace Dive
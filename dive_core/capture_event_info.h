@@ -52,6 +52,13 @@ struct ShaderReference
             return m_stage < other.m_stage;
         return m_enable_mask < other.m_enable_mask;
     }
+
+    // To support std::unordered_set, if needed
+    bool operator==(const ShaderReference &other) const
+    {
+        return m_shader_index == other.m_shader_index && m_stage == other.m_stage &&
+               m_enable_mask == other.m_enable_mask;
+    }
 };
 
 enum class RenderModeType
@@ -24,6 +24,7 @@
 #include <map>
 #include <sstream>
 #include <string>
+#include "common/trace.h"
 #include "dive_core/common/common.h"
 #include "dive_core/common/pm4_packets/me_pm4_packets.h"
 #include "pm4_capture_data.h"
@@ -522,6 +523,7 @@ CommandHierarchyCreator::CommandHierarchyCreator(CommandHierarchy     &command_h
 bool CommandHierarchyCreator::CreateTrees(bool                    flatten_chain_nodes,
                                           std::optional<uint64_t> reserve_size)
 {
+    DIVE_TRACE_SCOPE("CreateTrees");
     // Clear/Reset internal data structures, just in case
     m_command_hierarchy = CommandHierarchy();
 
@@ -562,6 +564,7 @@ bool CommandHierarchyCreator::CreateTrees(bool                    flatten_chain_
     // Convert the info in m_node_children into CommandHierarchy's topologies
     CreateTopologies();
 
+    DIVE_TRACE_COUNTER("Nodes", m_command_hierarchy.size());
     return true;
 }
 
@@ -570,6 +573,7 @@ bool CommandHierarchyCreator::CreateTrees(const Pm4CaptureData   &capture_data,
                                           bool                    flatten_chain_nodes,
                                           std::optional<uint64_t> reserve_size)
 {
+    DIVE_TRACE_SCOPE("CreateTrees");
     // Clear/Reset internal data structures, just in case
     m_command_hierarchy = CommandHierarchy();
 
@@ -610,6 +614,7 @@ bool CommandHierarchyCreator::CreateTrees(const Pm4CaptureData   &capture_data,
     // Convert the info in m_node_children into CommandHierarchy's topologies
     CreateTopologies();
 
+    DIVE_TRACE_COUNTER("Nodes", m_command_hierarchy.size());
     return true;
 }
 
@@ -699,8 +704,7 @@ bool CommandHierarchyCreator::CreateTrees(EngineType             engine_type,
         }
         virtual bool IsValid(uint32_t submit_index, uint64_t addr, uint64_t size) const
         {
-            DIVE_ASSERT(false);
-            return true;
+            return (addr + size) <= (m_size_in_dwords * sizeof(uint32_t));
         }
 
     private:
@@ -1333,11 +1337,7 @@ uint64_t CommandHierarchyCreator::AddPacketNode(const IMemoryManager &mem_manage
 
         if (header.type7.opcode == CP_CONTEXT_REG_BUNCH)
         {
-            AppendRegNodes(mem_manager,
-                           submit_index,
-                           va_addr + sizeof(Pm4Type7Header),  // skip the type7 PM4
-                           header.type7.count,
-                           packet_node_index);
+            AppendRegNodes(mem_manager, submit_index, va_addr, header, packet_node_index);
         }
         else
         {
@@ -1381,12 +1381,13 @@ uint64_t CommandHierarchyCreator::AddPacketNode(const IMemoryManager &mem_manage
 }
 
 //--------------------------------------------------------------------------------------------------
-void OutputValue(std::ostringstream &string_stream,
-                 ValueType           type,
-                 uint64_t            value,
-                 uint32_t            bit_width = 0,
-                 uint32_t            radix = 0)
+void OutputValue(std::ostream &string_stream,
+                 uint32_t      value_type,
+                 uint64_t      value,
+                 uint32_t      bit_width,
+                 uint32_t      radix)
 {
+    ValueType type = static_cast<ValueType>(value_type);
     if (type == ValueType::kBoolean)
     {
         if (value != 0)
@@ -1454,59 +1455,245 @@ void OutputValue(std::ostringstream &string_stream,
 }
 
 //--------------------------------------------------------------------------------------------------
-uint64_t CommandHierarchyCreator::AddRegisterNode(uint32_t       reg,
-                                                  uint64_t       reg_value,
-                                                  const RegInfo *reg_info_ptr)
+void OutputRegister(std::ostream &string_stream, const RegInfo *reg_info_ptr, uint64_t reg_value)
 {
-    // Should never have an "unknown register" unless something is seriously wrong!
-    DIVE_ASSERT(reg_info_ptr != nullptr);
-    reg_value = reg_value << reg_info_ptr->m_shr;
-    // Reg item
-    std::ostringstream reg_string_stream;
-    if (reg_info_ptr->m_enum_handle != UINT8_MAX)
+    if (reg_info_ptr == nullptr)
     {
-        const char *enum_str = GetEnumString(reg_info_ptr->m_enum_handle, (uint32_t)reg_value);
-        DIVE_ASSERT(enum_str != nullptr);
-        reg_string_stream << reg_info_ptr->m_name << ": " << enum_str;
+        RegInfo unknown_reg_info = {};
+        unknown_reg_info.m_name = "Unknown";
+        unknown_reg_info.m_enum_handle = UINT8_MAX;
+        OutputRegister(string_stream, &unknown_reg_info, reg_value);
+        return;
     }
+
+    reg_value = reg_value << reg_info_ptr->m_shr;
+    string_stream << reg_info_ptr->m_name << ": ";
+    const char *enum_str = nullptr;
+    if (reg_info_ptr->m_enum_handle != UINT8_MAX)
+        enum_str = GetEnumString(reg_info_ptr->m_enum_handle, (uint32_t)reg_value);
+    if (enum_str != nullptr)
+        string_stream << enum_str;
     else
-    {
-        reg_string_stream << reg_info_ptr->m_name << ": ";
-        OutputValue(reg_string_stream,
-                    (ValueType)reg_info_ptr->m_type,
+        OutputValue(string_stream,
+                    reg_info_ptr->m_type,
                     reg_value,
                     reg_info_ptr->m_bit_width,
                     reg_info_ptr->m_radix);
+}
+
+//--------------------------------------------------------------------------------------------------
+void OutputRegField(std::ostream   &string_stream,
+                    const RegInfo  &reg_info,
+                    const RegField &reg_field,
+                    uint64_t        reg_value)
+{
+    reg_value = reg_value << reg_info.m_shr;
+    uint64_t field_value = ((reg_value & reg_field.m_mask) >> reg_field.m_shift)
+                           << reg_field.m_shr;
+    string_stream << reg_field.m_name << ": ";
+    if (reg_field.m_enum_handle != UINT8_MAX)
+    {
+        const char *enum_str = GetEnumString(reg_field.m_enum_handle, (uint32_t)field_value);
+        if (enum_str != nullptr)
+            string_stream << enum_str;
+        else
+            OutputValue(string_stream, reg_field.m_type, field_value);
     }
+    else
+        OutputValue(string_stream,
+                    reg_field.m_type,
+                    field_value,
+                    reg_field.m_bit_width,
+                    reg_field.m_radix);
+}
+
+//--------------------------------------------------------------------------------------------------
+void OutputPacketField(std::ostream      &string_stream,
+                       const PacketField &packet_field,
+                       uint32_t           dword_value)
+{
+    uint32_t field_value = ((dword_value & packet_field.m_mask) >> packet_field.m_shift)
+                           << packet_field.m_shr;
+    string_stream << packet_field.m_name << ": ";
+    const char *enum_str = nullptr;
+    if (packet_field.m_enum_handle != UINT8_MAX)
+        enum_str = GetEnumString(packet_field.m_enum_handle, field_value);
+    if (enum_str != nullptr)
+        string_stream << enum_str;
+    else
+        OutputValue(string_stream, packet_field.m_type, field_value);
+}
+
+//--------------------------------------------------------------------------------------------------
+void OutputExtraDword(std::ostream &string_stream, uint32_t dword, uint32_t dword_value)
+{
+    string_stream << "(DWORD " << dword << "): 0x" << std::hex << dword_value << std::dec;
+}
+
+//--------------------------------------------------------------------------------------------------
+bool ForEachRegisterWrite(const IMemoryManager        &mem_manager,
+                          uint32_t                     submit_index,
+                          uint64_t                     va_addr,
+                          Pm4Header                    header,
+                          const RegisterWriteCallback &callback)
+{
+    if (header.type == 4)
+    {
+        // A contiguous sequence of register values, starting at the offset of the header
+        uint64_t reg_va_addr = va_addr + sizeof(header);
+        uint32_t dword = 0;
+        while (dword < header.type4.count)
+        {
+            uint32_t       reg_offset = header.type4.offset + dword;
+            const RegInfo *reg_info_ptr = GetRegInfo(reg_offset);
+
+            bool     is_64_bit = (reg_info_ptr != nullptr) && reg_info_ptr->m_is_64_bit;
+            uint32_t size_to_read = is_64_bit ? sizeof(uint64_t) : sizeof(uint32_t);
+            uint64_t reg_value = 0;
+            if (!mem_manager.RetrieveMemoryData(&reg_value,
+                                                submit_index,
+                                                reg_va_addr,
+                                                size_to_read))
+                return false;
+            callback(reg_offset, reg_value, reg_info_ptr);
+
+            reg_va_addr += size_to_read;
+            dword += size_to_read / sizeof(uint32_t);
+        }
+        return true;
+    }
+    if (header.type != 7 || header.type7.opcode != CP_CONTEXT_REG_BUNCH)
+        return true;
+
+    // Register offset + value pairs
+    struct RegPair
+    {
+        uint32_t m_reg_offset;
+        uint32_t m_reg_value;
+    };
+    uint64_t pairs_va_addr = va_addr + sizeof(header);
+    uint32_t dword = 0;
+    while (dword < header.type7.count)
+    {
+        RegPair reg_pair;
+        if (!mem_manager.RetrieveMemoryData(&reg_pair,
+                                            submit_index,
+                                            pairs_va_addr + dword * sizeof(uint32_t),
+                                            sizeof(reg_pair)))
+            return false;
+        dword += 2;
+
+        const RegInfo *reg_info_ptr = GetRegInfo(reg_pair.m_reg_offset);
+        uint64_t       reg_value = reg_pair.m_reg_value;
+        RegPair        high_pair;
+        // The upper 32 bits are not always set, probably when they are 0
+        if ((reg_info_ptr != nullptr) && reg_info_ptr->m_is_64_bit &&
+            mem_manager.RetrieveMemoryData(&high_pair,
+                                           submit_index,
+                                           pairs_va_addr + dword * sizeof(uint32_t),
+                                           sizeof(high_pair)) &&
+            high_pair.m_reg_offset == reg_pair.m_reg_offset + 1)
+        {
+            dword += 2;
+            reg_value |= ((uint64_t)high_pair.m_reg_value) << 32;
+        }
+        callback(reg_pair.m_reg_offset, reg_value, reg_info_ptr);
+    }
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+bool ForEachPacketField(const IMemoryManager      &mem_manager,
+                        uint32_t                   submit_index,
+                        uint64_t                   va_addr,
+                        uint32_t                   dword_count,
+                        bool                       append_extra_dwords,
+                        const PacketInfo          *packet_info_ptr,
+                        const PacketArrayCallback &array_callback,
+                        const PacketFieldCallback &field_callback,
+                        const ExtraDwordCallback  &extra_dword_callback)
+{
+    uint32_t base_dword = 0;  // For tracking non-0 array fields
+    uint32_t end_dword = UINT32_MAX;
+
+    // Assumption here is that the array (i.e. the part that repeats) covers the whole packet
+    bool packet_end_early = false;
+    for (uint32_t array = 0; array < packet_info_ptr->m_max_array_size; array++)
+    {
+        base_dword = (array != 0) ? end_dword : 0;
+        if ((packet_info_ptr->m_max_array_size > 1) && (base_dword < dword_count))
+            array_callback(array);
+
+        for (const PacketField &packet_field : packet_info_ptr->m_fields)
+        {
+            // packet_field.m_dword keeps the total dword count so far, including current field
+            uint32_t field_dword = base_dword + packet_field.m_dword;
+            end_dword = field_dword;
+
+            // Some packets end early sometimes and do not use all fields (e.g. CP_EVENT_WRITE with
+            // CACHE_CLEAN)
+            if (field_dword > dword_count)
+            {
+                packet_end_early = true;
+                break;
+            }
+
+            // (field_dword - 1) since each field is always 1 32bit register, we don't have any
+            // 64bit field
+            uint32_t dword_value = 0;
+            if (!mem_manager.RetrieveMemoryData(&dword_value,
+                                                submit_index,
+                                                va_addr + (field_dword - 1) * sizeof(uint32_t),
+                                                sizeof(uint32_t)))
+                return false;
+            field_callback(packet_field, dword_value);
+        }
+
+        if (packet_end_early)
+            break;
+    }
+
+    if (append_extra_dwords && end_dword < dword_count)
+    {
+        // va_addr is the first dword after the header, so dword i is at (i - 1)
+        for (uint32_t i = end_dword + 1; i <= dword_count; i++)
+        {
+            uint32_t dword_value = 0;
+            if (!mem_manager.RetrieveMemoryData(&dword_value,
+                                                submit_index,
+                                                va_addr + (i - 1) * sizeof(uint32_t),
+                                                sizeof(uint32_t)))
+                return false;
+            extra_dword_callback(i, dword_value);
+        }
+    }
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+uint64_t CommandHierarchyCreator::AddRegisterNode(uint32_t       reg,
+                                                  uint64_t       reg_value,
+                                                  const RegInfo *reg_info_ptr)
+{
+    // Reg item
+    std::ostringstream reg_string_stream;
+    OutputRegister(reg_string_stream, reg_info_ptr, reg_value);
 
     CommandHierarchy::AuxInfo aux_info = CommandHierarchy::AuxInfo::RegFieldNode(false);
     uint64_t reg_node_index = AddNode(NodeType::kRegNode, reg_string_stream.str(), aux_info);
+    if (reg_info_ptr == nullptr)
+        return reg_node_index;
 
     // Go through each field of this register, create a FieldNode out of it and append as child
     // to reg_node_ptr
     for (uint32_t field = 0; field < reg_info_ptr->m_fields.size(); ++field)
     {
-        const RegField &reg_field = reg_info_ptr->m_fields[field];
-        uint64_t        field_value = ((reg_value & reg_field.m_mask) >> reg_field.m_shift)
-                               << reg_field.m_shr;
-
         // Field item
         std::ostringstream field_string_stream;
-        field_string_stream << reg_field.m_name << ": ";
-        if (reg_field.m_enum_handle != UINT8_MAX)
-        {
-            const char *enum_str = GetEnumString(reg_field.m_enum_handle, (uint32_t)field_value);
-            if (enum_str != nullptr)
-                field_string_stream << enum_str;
-            else
-                OutputValue(field_string_stream, (ValueType)reg_field.m_type, field_value);
-        }
-        else
-            OutputValue(field_string_stream,
-                        (ValueType)reg_field.m_type,
-                        field_value,
-                        reg_field.m_bit_width,
-                        reg_field.m_radix);
+        OutputRegField(field_string_stream,
+                       *reg_info_ptr,
+                       reg_info_ptr->m_fields[field],
+                       reg_value);
 
         uint64_t field_node_index = AddNode(NodeType::kFieldNode,
                                             field_string_stream.str(),
@@ -1542,66 +1729,6 @@ bool CommandHierarchyCreator::IsBeginDebugMarkerNode(uint64_t node_index)
     return false;
 }
 
-//--------------------------------------------------------------------------------------------------
-void CommandHierarchyCreator::AppendRegNodes(const IMemoryManager &mem_manager,
-                                             uint32_t              submit_index,
-                                             uint64_t              va_addr,
-                                             uint32_t              dword_count,
-                                             uint64_t              packet_node_index)
-{
-    // This version of AppendRegNodes takes in a raw buffer consisting of register offset + value
-    // pairs
-    uint32_t dword = 0;
-    while (dword < dword_count)
-    {
-        struct RegPair
-        {
-            uint32_t m_reg_offset;
-            uint32_t m_reg_value;
-        };
-        RegPair  reg_pair;
-        uint64_t pair_addr = va_addr + dword * sizeof(uint32_t);
-        DIVE_VERIFY(
-        mem_manager.RetrieveMemoryData(&reg_pair, submit_index, pair_addr, sizeof(reg_pair)));
-        dword += 2;
-
-        const RegInfo *reg_info_ptr = GetRegInfo(reg_pair.m_reg_offset);
-
-        RegInfo temp = {};
-        temp.m_name = "Unknown";
-        temp.m_enum_handle = UINT8_MAX;
-        if (reg_info_ptr == nullptr)
-            reg_info_ptr = &temp;
-
-        uint64_t reg_value = reg_pair.m_reg_value;
-        if (reg_info_ptr->m_is_64_bit)
-        {
-            RegPair  new_reg_pair;
-            uint64_t new_pair_addr = va_addr + dword * sizeof(uint32_t);
-            DIVE_VERIFY(mem_manager.RetrieveMemoryData(&new_reg_pair,
-                                                       submit_index,
-                                                       new_pair_addr,
-                                                       sizeof(new_reg_pair)));
-
-            // Sometimes the upper 32-bits are not set
-            // Probably because they're 0s and there's no need to set it
-            if (new_reg_pair.m_reg_offset == reg_pair.m_reg_offset + 1)
-            {
-                dword += 2;
-                reg_value |= ((uint64_t)new_reg_pair.m_reg_value) << 32;
-            }
-        }
-
-        // Create the register node, as well as all its children nodes that describe the various
-        // fields set in the single 32-bit register
-        uint64_t reg_node_index = AddRegisterNode(reg_pair.m_reg_offset, reg_value, reg_info_ptr);
-
-        // Add it as child to packet node
-        AddChild(CommandHierarchy::kSubmitTopology, packet_node_index, reg_node_index);
-        AddChild(CommandHierarchy::kAllEventTopology, packet_node_index, reg_node_index);
-    }
-}
-
 //--------------------------------------------------------------------------------------------------
 void CommandHierarchyCreator::AppendRegNodes(const IMemoryManager &mem_manager,
                                              uint32_t              submit_index,
@@ -1609,44 +1736,17 @@ void CommandHierarchyCreator::AppendRegNodes(const IMemoryManager &mem_manager,
                                              Pm4Header             header,
                                              uint64_t              packet_node_index)
 {
-    // This version of AppendRegNodes takes in an offset from the header, and expects a contiguous
-    // sequence of register values
-
-    // Go through each register set by this packet
-    uint32_t offset_in_bytes = 0;
-    uint32_t dword = 0;
-    while (dword < header.type4.count)
-    {
-        uint64_t       reg_va_addr = va_addr + sizeof(header) + offset_in_bytes;
-        uint32_t       reg_offset = header.type4.offset + dword;
-        const RegInfo *reg_info_ptr = GetRegInfo(reg_offset);
-
-        RegInfo temp = {};
-        temp.m_name = "Unknown";
-        temp.m_enum_handle = UINT8_MAX;
-        if (reg_info_ptr == nullptr)
-            reg_info_ptr = &temp;
-
-        uint32_t size_to_read = sizeof(uint32_t);
-        if (reg_info_ptr->m_is_64_bit)
-            size_to_read = sizeof(uint64_t);
-        offset_in_bytes += size_to_read;
-
-        uint64_t reg_value = 0;
-        DIVE_VERIFY(
-        mem_manager.RetrieveMemoryData(&reg_value, submit_index, reg_va_addr, size_to_read));
+    // Go through each register set by this type4 packet or CP_CONTEXT_REG_BUNCH
+    auto append_reg_node = [&](uint32_t reg_offset, uint64_t reg_value, const RegInfo *reg_info) {
         // Create the register node, as well as all its children nodes that describe the various
         // fields set in the single 32-bit register
-        uint64_t reg_node_index = AddRegisterNode(reg_offset, reg_value, reg_info_ptr);
+        uint64_t reg_node_index = AddRegisterNode(reg_offset, reg_value, reg_info);
 
         // Add it as child to packet node
         AddChild(CommandHierarchy::kSubmitTopology, packet_node_index, reg_node_index);
         AddChild(CommandHierarchy::kAllEventTopology, packet_node_index, reg_node_index);
-
-        dword++;
-        if (reg_info_ptr->m_is_64_bit)
-            dword++;
-    }
+    };
+    DIVE_VERIFY(ForEachRegisterWrite(mem_manager, submit_index, va_addr, header, append_reg_node));
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -1714,120 +1814,60 @@ void CommandHierarchyCreator::AppendPacketFieldNodes(const IMemoryManager &mem_m
                                                      uint64_t              packet_node_index,
                                                      const char           *prefix)
 {
-    // Loop through each field and append it to packet
-    uint32_t base_dword = 0;  // For tracking non-0 array fields
-    uint32_t end_dword = UINT32_MAX;
-
-    // Assumption here is that the array (i.e. the part that repeats) covers the whole packet
-    bool packet_end_early = false;
-    for (uint32_t array = 0; array < packet_info_ptr->m_max_array_size; array++)
-    {
-        base_dword = (array != 0) ? end_dword : 0;
-
-        // If this is a packet with arrays, and there are more dwords left,
-        // then add a parent node for each index
-        uint64_t parent_node_index = packet_node_index;
-        if ((packet_info_ptr->m_max_array_size > 1) && (base_dword < dword_count))
-        {
-            std::ostringstream field_string_stream;
-            field_string_stream << array;
-            CommandHierarchy::AuxInfo aux_info = CommandHierarchy::AuxInfo::RegFieldNode(false);
-            uint64_t                  array_node_index = AddNode(NodeType::kFieldNode,
-                                                field_string_stream.str(),
-                                                aux_info);
-
-            // Add it as child to packet_node
-            AddChild(CommandHierarchy::kSubmitTopology, packet_node_index, array_node_index);
-            AddChild(CommandHierarchy::kAllEventTopology, packet_node_index, array_node_index);
-            parent_node_index = array_node_index;
-        }
-
-        for (size_t field = 0; field < packet_info_ptr->m_fields.size(); ++field)
-        {
-            const PacketField &packet_field = packet_info_ptr->m_fields[field];
+    CommandHierarchy::AuxInfo aux_info = CommandHierarchy::AuxInfo::RegFieldNode(false);
 
-            // packet_field.m_dword keeps the total dword count so far, including current field
-            uint32_t field_dword = base_dword + packet_field.m_dword;
-            end_dword = field_dword;
+    // If this is a packet with arrays, add a parent node for each index
+    uint64_t parent_node_index = packet_node_index;
+    auto     append_array_node = [&](uint32_t array_index) {
+        std::ostringstream field_string_stream;
+        field_string_stream << array_index;
+        uint64_t array_node_index = AddNode(NodeType::kFieldNode,
+                                            field_string_stream.str(),
+                                            aux_info);
 
-            // Some packets end early sometimes and do not use all fields (e.g. CP_EVENT_WRITE with
-            // CACHE_CLEAN)
-            if (field_dword > dword_count)
-            {
-                packet_end_early = true;
-                break;
-            }
+        // Add it as child to packet_node
+        AddChild(CommandHierarchy::kSubmitTopology, packet_node_index, array_node_index);
+        AddChild(CommandHierarchy::kAllEventTopology, packet_node_index, array_node_index);
+        parent_node_index = array_node_index;
+    };
 
-            uint32_t dword_value = 0;
-            // (field_dword - 1) since each field is always 1 32bit register, we don't have any
-            // 64bit field
-            uint64_t dword_va_addr = va_addr + (field_dword - 1) * sizeof(uint32_t);
-            DIVE_VERIFY(mem_manager.RetrieveMemoryData(&dword_value,
-                                                       submit_index,
-                                                       dword_va_addr,
-                                                       sizeof(uint32_t)));
-
-            uint32_t field_value = ((dword_value & packet_field.m_mask) >> packet_field.m_shift)
-                                   << packet_field.m_shr;
-
-            // Field item
-            std::ostringstream field_string_stream;
-            field_string_stream << prefix << packet_field.m_name << ": ";
-            if (packet_field.m_enum_handle != UINT8_MAX)
-            {
-                const char *enum_str = GetEnumString(packet_field.m_enum_handle, field_value);
-                if (enum_str != nullptr)
-                    field_string_stream << enum_str;
-                else
-                    OutputValue(field_string_stream, (ValueType)packet_field.m_type, field_value);
-            }
-            else
-                OutputValue(field_string_stream, (ValueType)packet_field.m_type, field_value);
+    auto append_field_node = [&](const PacketField &packet_field, uint32_t dword_value) {
+        // Field item
+        std::ostringstream field_string_stream;
+        field_string_stream << prefix;
+        OutputPacketField(field_string_stream, packet_field, dword_value);
+        uint64_t field_node_index = AddNode(NodeType::kFieldNode,
+                                            field_string_stream.str(),
+                                            aux_info);
 
-            CommandHierarchy::AuxInfo aux_info = CommandHierarchy::AuxInfo::RegFieldNode(false);
-            uint64_t                  field_node_index = AddNode(NodeType::kFieldNode,
-                                                field_string_stream.str(),
-                                                aux_info);
+        // Add it as child to packet_node
+        AddChild(CommandHierarchy::kSubmitTopology, parent_node_index, field_node_index);
+        AddChild(CommandHierarchy::kAllEventTopology, parent_node_index, field_node_index);
+    };
 
-            // Add it as child to packet_node
-            AddChild(CommandHierarchy::kSubmitTopology, parent_node_index, field_node_index);
-            AddChild(CommandHierarchy::kAllEventTopology, parent_node_index, field_node_index);
-        }
+    // If there are missing packet fields, then output the raw DWORDS directly
+    auto append_extra_dword_node = [&](uint32_t dword, uint32_t dword_value) {
+        std::ostringstream field_string_stream;
+        field_string_stream << prefix;
+        OutputExtraDword(field_string_stream, dword, dword_value);
+        uint64_t field_node_index = AddNode(NodeType::kFieldNode,
+                                            field_string_stream.str(),
+                                            aux_info);
 
-        if (packet_end_early)
-            break;
-    }
+        // Add it as child to packet_node
+        AddChild(CommandHierarchy::kSubmitTopology, packet_node_index, field_node_index);
+        AddChild(CommandHierarchy::kAllEventTopology, packet_node_index, field_node_index);
+    };
 
-    // If there are missing packet fields, then output the raw DWORDS directly
-    // Some packets, such as CP_LOAD_STATE6_* handle this explicitly elsewhere
-    if (append_extra_dwords)
-    {
-        if (end_dword < dword_count)
-        {
-            for (size_t i = end_dword + 1; i <= dword_count; i++)
-            {
-                uint32_t dword_value = 0;
-                uint64_t dword_va_addr = va_addr + i * sizeof(uint32_t);
-                DIVE_VERIFY(mem_manager.RetrieveMemoryData(&dword_value,
-                                                           submit_index,
-                                                           dword_va_addr,
-                                                           sizeof(uint32_t)));
-
-                std::ostringstream field_string_stream;
-                field_string_stream << prefix << "(DWORD " << i << "): 0x" << std::hex
-                                    << dword_value;
-
-                CommandHierarchy::AuxInfo aux_info = CommandHierarchy::AuxInfo::RegFieldNode(false);
-                uint64_t                  field_node_index = AddNode(NodeType::kFieldNode,
-                                                    field_string_stream.str(),
-                                                    aux_info);
-
-                // Add it as child to packet_node
-                AddChild(CommandHierarchy::kSubmitTopology, packet_node_index, field_node_index);
-                AddChild(CommandHierarchy::kAllEventTopology, packet_node_index, field_node_index);
-            }
-        }
-    }
+    DIVE_VERIFY(ForEachPacketField(mem_manager,
+                                   submit_index,
+                                   va_addr,
+                                   dword_count,
+                                   append_extra_dwords,
+                                   packet_info_ptr,
+                                   append_array_node,
+                                   append_field_node,
+                                   append_extra_dword_node));
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -2165,6 +2205,7 @@ uint64_t CommandHierarchyCreator::GetChildCount(CommandHierarchy::TopologyType t
 //--------------------------------------------------------------------------------------------------
 void CommandHierarchyCreator::CreateTopologies()
 {
+    DIVE_TRACE_SCOPE("CreateTopologies");
     uint64_t total_num_children[CommandHierarchy::kTopologyTypeCount] = {};
     uint64_t total_num_shared_children[CommandHierarchy::kTopologyTypeCount] = {};
 
@@ -20,7 +20,9 @@
 // =====================================================================================================================
 
 #pragma once
+#include <functional>
 #include <optional>
+#include <ostream>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -34,7 +36,9 @@
 #include "dive_core/stl_replacement.h"
 
 // Forward declarations
+struct PacketField;
 struct PacketInfo;
+struct RegField;
 struct RegInfo;
 
 namespace Dive
@@ -535,11 +539,6 @@ private:
                             uint64_t              va_addr,
                             Pm4Header             header,
                             uint64_t              packet_node_index);
-    void     AppendRegNodes(const IMemoryManager &mem_manager,
-                            uint32_t              submit_index,
-                            uint64_t              va_addr,
-                            uint32_t              dword_count,
-                            uint64_t              packet_node_index);
     void     AppendContextRegRmwNodes(const IMemoryManager        &mem_manager,
                                       uint32_t                     submit_index,
                                       uint64_t                     va_addr,
@@ -698,4 +697,62 @@ private:
                                                     [kChildrenNodeTypeCount];
 };
 
+//--------------------------------------------------------------------------------------------------
+// Output a register or packet field value, as shown in the descriptions of the nodes. value_type
+// is the ValueType of the RegInfo, RegField or PacketField.
+void OutputValue(std::ostream &string_stream,
+                 uint32_t      value_type,
+                 uint64_t      value,
+                 uint32_t      bit_width = 0,
+                 uint32_t      radix = 0);
+
+// Output the "name: value" description of a register written with reg_value, as shown in the
+// register nodes. reg_info_ptr is nullptr for registers unknown to the PM4 info.
+void OutputRegister(std::ostream &string_stream, const RegInfo *reg_info_ptr, uint64_t reg_value);
+
+// Output the "name: value" description of a field of a register written with reg_value, as shown
+// in the field nodes of the register nodes
+void OutputRegField(std::ostream   &string_stream,
+                    const RegInfo  &reg_info,
+                    const RegField &reg_field,
+                    uint64_t        reg_value);
+
+// Output the "name: value" description of a packet field stored in dword_value
+void OutputPacketField(std::ostream      &string_stream,
+                       const PacketField &packet_field,
+                       uint32_t           dword_value);
+
+// Output a packet dword past the packet fields. dword counts from 1, the first dword after the
+// header.
+void OutputExtraDword(std::ostream &string_stream, uint32_t dword, uint32_t dword_value);
+
+// Calls the callback for each register written by a type4 packet or a CP_CONTEXT_REG_BUNCH, in
+// packet order. reg_info_ptr is nullptr for registers unknown to the PM4 info. Returns false if
+// the packet isn't fully captured.
+using RegisterWriteCallback =
+std::function<void(uint32_t reg_offset, uint64_t reg_value, const RegInfo *reg_info_ptr)>;
+bool ForEachRegisterWrite(const IMemoryManager        &mem_manager,
+                          uint32_t                     submit_index,
+                          uint64_t                     va_addr,
+                          Pm4Header                    header,
+                          const RegisterWriteCallback &callback);
+
+// Walks the fields of the dword_count dwords at va_addr, laid out as described by the PacketInfo.
+// For packets with arrays, array_callback is called with the index of each element before its
+// fields. With append_extra_dwords, extra_dword_callback is called for each dword past the fields.
+// Returns false if the packet isn't fully captured.
+using PacketArrayCallback = std::function<void(uint32_t array_index)>;
+using PacketFieldCallback =
+std::function<void(const PacketField &packet_field, uint32_t dword_value)>;
+using ExtraDwordCallback = std::function<void(uint32_t dword, uint32_t dword_value)>;
+bool ForEachPacketField(const IMemoryManager      &mem_manager,
+                        uint32_t                   submit_index,
+                        uint64_t                   va_addr,
+                        uint32_t                   dword_count,
+                        bool                       append_extra_dwords,
+                        const PacketInfo          *packet_info_ptr,
+                        const PacketArrayCallback &array_callback,
+                        const PacketFieldCallback &field_callback,
+                        const ExtraDwordCallback  &extra_dword_callback);
+
 }  // namespace Dive
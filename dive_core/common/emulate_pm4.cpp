@@ -21,6 +21,7 @@
 
 #include "adreno.h"
 #include "common.h"
+#include "common/trace.h"
 #include "dive_capture_format.h"
 #include "dive_core/pm4_capture_data.h"
 #include "dive_core/stl_replacement.h"
@@ -866,6 +867,7 @@ uint32_t GetPacketSize(Pm4Header header)
 bool EmulateCallbacksBase::ProcessSubmits(const DiveVector<SubmitInfo> &submits,
                                           const IMemoryManager         &mem_manager)
 {
+    DIVE_TRACE_SCOPE("EmulateSubmits");
     for (uint32_t submit_index = 0; submit_index < submits.size(); ++submit_index)
     {
         const Dive::SubmitInfo &submit_info = submits[submit_index];
@@ -0,0 +1,134 @@
+/*
+ Copyright 2025 Google LLC
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#include "dive_core/common/mapped_file.h"
+
+#if defined(WIN32)
+#    ifndef NOMINMAX
+#        define NOMINMAX
+#    endif
+#    include <windows.h>
+#else
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+namespace Dive
+{
+
+std::unique_ptr<MappedFile> MappedFile::Open(const std::filesystem::path& file_path)
+{
+    std::unique_ptr<MappedFile> file(new MappedFile());
+#if defined(WIN32)
+    HANDLE handle = CreateFileW(file_path.c_str(),
+                                GENERIC_READ,
+                                FILE_SHARE_READ,
+                                nullptr,
+                                OPEN_EXISTING,
+                                FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+                                nullptr);
+    if (handle == INVALID_HANDLE_VALUE)
+    {
+        return nullptr;
+    }
+    file->m_file = handle;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(handle, &size))
+    {
+        return nullptr;
+    }
+    file->m_size = static_cast<size_t>(size.QuadPart);
+    if (file->m_size == 0)
+    {
+        // An empty file can't be mapped
+        return file;
+    }
+
+    HANDLE mapping = CreateFileMappingW(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr)
+    {
+        return nullptr;
+    }
+    file->m_mapping = mapping;
+    file->m_data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (file->m_data == nullptr)
+    {
+        return nullptr;
+    }
+#else
+    int fd = open(file_path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return nullptr;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+    {
+        close(fd);
+        return nullptr;
+    }
+    file->m_size = static_cast<size_t>(st.st_size);
+    if (file->m_size == 0)
+    {
+        // An empty file can't be mapped
+        close(fd);
+        return file;
+    }
+
+    void* data = mmap(nullptr, file->m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping stays valid after the file is closed
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        file->m_size = 0;
+        return nullptr;
+    }
+#    if defined(POSIX_MADV_SEQUENTIAL)
+    posix_madvise(data, file->m_size, POSIX_MADV_SEQUENTIAL);
+#    endif
+    file->m_data = static_cast<const uint8_t*>(data);
+#endif
+    return file;
+}
+
+MappedFile::~MappedFile()
+{
+#if defined(WIN32)
+    if (m_data != nullptr)
+    {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mapping != nullptr)
+    {
+        CloseHandle(m_mapping);
+    }
+    if (m_file != nullptr)
+    {
+        CloseHandle(m_file);
+    }
+#else
+    if (m_data != nullptr)
+    {
+        munmap(const_cast<uint8_t*>(m_data), m_size);
+    }
+#endif
+}
+
+}  // namespace Dive
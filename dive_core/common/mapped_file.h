@@ -0,0 +1,58 @@
+/*
+ Copyright 2025 Google LLC
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string_view>
+
+namespace Dive
+{
+
+// Read-only view of the whole content of a file, memory mapped so that reading it doesn't copy it
+// through a stream buffer. The pages are only loaded as they are accessed.
+class MappedFile
+{
+public:
+    // Returns nullptr if the file can't be opened or mapped.
+    [[nodiscard]] static std::unique_ptr<MappedFile> Open(const std::filesystem::path& file_path);
+
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const uint8_t*   GetData() const { return m_data; }
+    size_t           GetSize() const { return m_size; }
+    std::string_view GetView() const
+    {
+        return std::string_view(reinterpret_cast<const char*>(m_data), m_size);
+    }
+
+private:
+    MappedFile() = default;
+
+    const uint8_t* m_data = nullptr;
+    size_t         m_size = 0;
+#if defined(WIN32)
+    void* m_file = nullptr;
+    void* m_mapping = nullptr;
+#endif
+};
+
+}  // namespace Dive
@@ -17,6 +17,7 @@
 #include "data_core.h"
 #include <assert.h>
 #include <optional>
+#include "common/trace.h"
 #include "pm4_info.h"
 
 namespace Dive
@@ -119,6 +120,7 @@ bool DataCore::CreateGfxrCommandHierarchy()
 //--------------------------------------------------------------------------------------------------
 bool DataCore::CreateDiveMetaData()
 {
+    DIVE_TRACE_SCOPE("CreateMetaData");
     CaptureMetadataCreator metadata_creator(m_capture_metadata);
     if (!metadata_creator
          .ProcessSubmits(m_dive_capture_data.GetPm4CaptureData().GetSubmits(),
@@ -126,18 +128,21 @@ bool DataCore::CreateDiveMetaData()
     {
         return false;
     }
+    DIVE_TRACE_COUNTER("PM4 packets", m_capture_metadata.m_num_pm4_packets);
     return true;
 }
 
 //--------------------------------------------------------------------------------------------------
 bool DataCore::CreatePm4MetaData()
 {
+    DIVE_TRACE_SCOPE("CreateMetaData");
     CaptureMetadataCreator metadata_creator(m_capture_metadata);
     if (!metadata_creator.ProcessSubmits(m_pm4_capture_data.GetSubmits(),
                                          m_pm4_capture_data.GetMemoryManager()))
     {
         return false;
     }
+    DIVE_TRACE_COUNTER("PM4 packets", m_capture_metadata.m_num_pm4_packets);
     return true;
 }
 
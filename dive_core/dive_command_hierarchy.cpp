@@ -12,6 +12,7 @@
 */
 
 #include "dive_command_hierarchy.h"
+#include "common/trace.h"
 #include "dive_core/common/emulate_pm4.h"
 #include "dive_strings.h"
 #include <cstdint>
@@ -34,6 +35,7 @@ bool DiveCommandHierarchyCreator::CreateTrees(Dive::CommandHierarchy &command_hi
                                               bool                    flatten_chain_nodes,
                                               std::optional<uint64_t> reserve_size)
 {
+    DIVE_TRACE_SCOPE("CreateDiveTrees");
     CommandHierarchyCreator pm4_command_hierarchy_creator(m_command_hierarchy,
                                                           dive_capture_data.GetPm4CaptureData());
     GfxrVulkanCommandHierarchyCreator
@@ -60,6 +62,7 @@ bool DiveCommandHierarchyCreator::CreateTrees(Dive::CommandHierarchy &command_hi
 
     CreateTopologies(pm4_command_hierarchy_creator, gfxr_command_hierarchy_creator);
 
+    DIVE_TRACE_COUNTER("Nodes", m_command_hierarchy.size());
     return true;
 }
 
@@ -139,6 +139,7 @@ uint32_t          GetRegOffsetByName(const char *name);
 const char       *GetEnumString(uint32_t enum_handle, uint32_t val);
 const PacketInfo *GetPacketInfo(uint32_t op_code);
 const PacketInfo *GetPacketInfo(uint32_t op_code, const char *name);
+// The GPU set by a thread is used by that thread, and by the threads that never set one
 void              SetGPUID(uint32_t gpu_id);
 uint32_t          GetGPUID();
 GPUVariantType    GetGPUVariantType();
@@ -152,6 +153,7 @@ def outputHeaderCpp(pm4_info_header_file_name, pm4_info_file):
   pm4_info_file.writelines('''
 #include <assert.h>
 #include <algorithm>
+#include <atomic>
 #include <cstring>
 #include <map>
 #include <string>
@@ -167,8 +169,23 @@ static DiveVector<DiveVector<const char*>> g_sEnumReflection;
 static DiveVector<PacketInfo> g_sPacketInfo;
 static std::unordered_map<uint32_t, PacketInfo> g_sPacketInfoVariant;
 static std::multimap<uint32_t, PacketInfo> g_sPacketInfoMultiple;
-static GPUVariantType g_sGPU_variant = kGPUVariantNone;
-static uint32_t g_sGPU_id = 0;
+
+// The GPU of the capture loaded last. A thread that set a GPU itself keeps decoding with it, so
+// captures of different GPUs can be loaded and decoded on several threads at once.
+static std::atomic<uint32_t> g_sGPU_id = 0;
+static thread_local bool g_sThread_has_GPU_id = false;
+static thread_local uint32_t g_sThread_GPU_id = 0;
+static thread_local GPUVariantType g_sThread_GPU_variant = kGPUVariantNone;
+
+static GPUVariantType GetGPUVariantFromID(uint32_t gpu_id)
+{
+    uint32_t gpu_series = gpu_id / 100;
+    if((gpu_series >= 2) && (gpu_series <= 7))
+    {
+        return static_cast<GPUVariantType>(1 << (gpu_series - 2));
+    }
+    return kGPUVariantNone;
+}
 
 std::string GetGPUStr(GPUVariantType variant)
 {
@@ -929,7 +946,7 @@ const RegInfo *GetRegInfo(uint32_t reg)
     if (g_sRegInfo[reg].m_name == nullptr)
     {
         // check with variant as key
-        uint32_t key = (reg << kGPUVariantsBits) | g_sGPU_variant;
+        uint32_t key = (reg << kGPUVariantsBits) | GetGPUVariantType();
         auto it = g_sRegInfoVariant.find(key);
         if (it == g_sRegInfoVariant.end())
         {
@@ -967,12 +984,13 @@ const RegField *GetRegFieldByName(const char *name, const RegInfo *info)
 
 uint32_t GetRegOffsetByName(const char *name)
 {
-    DIVE_ASSERT(g_sGPU_variant != kGPUVariantNone);
+    const GPUVariantType gpu_variant = GetGPUVariantType();
+    DIVE_ASSERT(gpu_variant != kGPUVariantNone);
     std::string str = std::string(name);
     auto i = g_sRegNameToIndex.find(str);
     if (i == g_sRegNameToIndex.end())
     {
-        std::string name_with_variant = str + "_" + GetGPUStr(g_sGPU_variant);
+        std::string name_with_variant = str + "_" + GetGPUStr(gpu_variant);
         i = g_sRegNameToIndex.find(name_with_variant);
         if (i == g_sRegNameToIndex.end())
         {
@@ -997,7 +1015,7 @@ const PacketInfo *GetPacketInfo(uint32_t op_code)
     if (g_sPacketInfo[op_code].m_name == nullptr)
     {
         // check with variant as key
-        uint32_t key = (op_code << kGPUVariantsBits) | g_sGPU_variant;
+        uint32_t key = (op_code << kGPUVariantsBits) | GetGPUVariantType();
         auto it = g_sPacketInfoVariant.find(key);
         if (it == g_sPacketInfoVariant.end())
         {
@@ -1026,31 +1044,26 @@ const PacketInfo *GetPacketInfo(uint32_t op_code, const char *name)
 void SetGPUID(uint32_t gpu_id)
 {
     g_sGPU_id = gpu_id;
-    uint32_t gpu_series = gpu_id / 100;
-    if((gpu_series >= 2) && (gpu_series <= 7))
-    {
-        g_sGPU_variant = static_cast<GPUVariantType>(1 << (gpu_series - 2));
-    }
-    else
-    {
-        g_sGPU_variant = kGPUVariantNone;
-    }
+    g_sThread_has_GPU_id = true;
+    g_sThread_GPU_id = gpu_id;
+    g_sThread_GPU_variant = GetGPUVariantFromID(gpu_id);
 }
 
 uint32_t GetGPUID()
 {
-    return g_sGPU_id;
+    return g_sThread_has_GPU_id ? g_sThread_GPU_id : g_sGPU_id.load();
 }
 
 GPUVariantType GetGPUVariantType()
 {
-    return g_sGPU_variant;
+    return g_sThread_has_GPU_id ? g_sThread_GPU_variant : GetGPUVariantFromID(g_sGPU_id.load());
 }
 
 bool IsFieldEnabled(const RegField* field)
 {
-    DIVE_ASSERT(g_sGPU_variant != kGPUVariantNone);
-    return (g_sGPU_variant & field->m_gpu_variants) != 0;
+    const GPUVariantType gpu_variant = GetGPUVariantType();
+    DIVE_ASSERT(gpu_variant != kGPUVariantNone);
+    return (gpu_variant & field->m_gpu_variants) != 0;
 }
 '''
   )
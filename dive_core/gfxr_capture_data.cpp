@@ -17,6 +17,7 @@
 #include "gfxr_capture_data.h"
 
 #include <iostream>
+#include "common/trace.h"
 #include "dive_core/common/common.h"
 #include "generated/generated_vulkan_dive_consumer.h"
 #include "gfxr_ext/decode/dive_file_processor.h"
@@ -31,6 +32,7 @@ namespace Dive
 //--------------------------------------------------------------------------------------------------
 CaptureData::LoadResult GfxrCaptureData::LoadCaptureFile(const std::string& file_name)
 {
+    DIVE_TRACE_SCOPE("LoadGfxrCapture");
     if (m_gfxr_capture_block_data != nullptr)
     {
         std::cerr << "Error: cannot load another gfxr file with one currently stored: " << file_name
@@ -67,6 +69,7 @@ CaptureData::LoadResult GfxrCaptureData::LoadCaptureFile(const std::string& file
     }
 
     m_gfxr_submits = dive_annotation_processor.TakeSubmits();
+    DIVE_TRACE_COUNTER("GFXR submits", m_gfxr_submits.size());
     DIVE_ASSERT(!m_gfxr_submits.empty());
     m_gfxr_command_buffers = dive_annotation_processor.TakeVkCommandsCache();
     m_gfxr_draw_call_counts = dive_annotation_processor.TakeDrawCallMap();
@@ -12,6 +12,7 @@
 */
 
 #include "gfxr_vulkan_command_hierarchy.h"
+#include "common/trace.h"
 #include "dive_strings.h"
 
 namespace Dive
@@ -203,6 +204,7 @@ bool GfxrVulkanCommandHierarchyCreator::ProcessGfxrSubmits(const GfxrCaptureData
 //--------------------------------------------------------------------------------------------------
 bool GfxrVulkanCommandHierarchyCreator::CreateTrees(bool used_in_mixed_command_hierarchy)
 {
+    DIVE_TRACE_SCOPE("CreateGfxrTrees");
     m_used_in_mixed_command_hierarchy = used_in_mixed_command_hierarchy;
     // Clear/Reset internal data structures, just in case
     ClearCreatedDiveIndices();
@@ -221,6 +223,7 @@ bool GfxrVulkanCommandHierarchyCreator::CreateTrees(bool used_in_mixed_command_h
 
         // Convert the info in m_gfxr_node_children into GfxrVulkanCommandHierarchy's topologies
         CreateTopologies();
+        DIVE_TRACE_COUNTER("Nodes", m_command_hierarchy.size());
     }
 
     return true;
@@ -13,25 +13,39 @@
 
 #include "dive_core/perf_metrics_data.h"
 
+#include <algorithm>
 #include <cctype>
 #include <cerrno>
+#include <charconv>
 #include <cmath>
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <functional>
 #include <iostream>
 #include <filesystem>
 #include <limits>
 #include <optional>
 #include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
 #include <vector>
 #include <array>
 #include <unordered_map>
 #include <unordered_set>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    include <emmintrin.h>
+#    if defined(_MSC_VER)
+#        include <intrin.h>
+#    endif
+#endif
+
 #include "dive_core/command_hierarchy.h"
 #include "dive_core/available_metrics.h"
+#include "dive_core/common/mapped_file.h"
 #include "dive_core/common/string_utils.h"
 
 namespace Dive
@@ -159,72 +173,213 @@ std::optional<ParseHeadersResult> ParseHeaders(const std::string&      line,
     return ParseHeadersResult{ std::move(metric_names), std::move(metric_infos) };
 }
 
-std::optional<PerfMetricsRecord> ParseRecordFixedFields(const std::vector<std::string>& fields)
+// Returns the first ',' or '\n' in [begin, end), or end if there is none.
+const char* FindFieldEnd(const char* begin, const char* end)
 {
-    if (fields.size() < kFixedPerfMetricsDataHeaderCount)
+    const char* at = begin;
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (; end - at >= 16; at += 16)
+    {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(at));
+        const int     mask = _mm_movemask_epi8(
+        _mm_or_si128(_mm_cmpeq_epi8(chunk, comma), _mm_cmpeq_epi8(chunk, newline)));
+        if (mask != 0)
+        {
+#    if defined(_MSC_VER)
+            unsigned long index;
+            _BitScanForward(&index, static_cast<unsigned long>(mask));
+            return at + index;
+#    else
+            return at + __builtin_ctz(static_cast<unsigned>(mask));
+#    endif
+        }
+    }
+#endif
+    for (; at != end; ++at)
     {
-        return std::nullopt;
+        if (*at == ',' || *at == '\n')
+        {
+            return at;
+        }
     }
+    return end;
+}
 
-    PerfMetricsRecord record{};
-    if (!StringUtils::SafeConvertFromString(fields[0], record.m_context_id) ||
-        !StringUtils::SafeConvertFromString(fields[1], record.m_process_id) ||
-        !StringUtils::SafeConvertFromString(fields[2], record.m_frame_id) ||
-        !StringUtils::SafeConvertFromString(fields[3], record.m_cmd_buffer_id) ||
-        !StringUtils::SafeConvertFromString(fields[4], record.m_draw_id) ||
-        !StringUtils::SafeConvertFromString(fields[5], record.m_draw_type) ||
-        !StringUtils::SafeConvertFromString(fields[6], record.m_draw_label) ||
-        !StringUtils::SafeConvertFromString(fields[7], record.m_program_id) ||
-        !StringUtils::SafeConvertFromString(fields[8], record.m_lrz_state))
+// Same as StringUtils::Trim followed by StringUtils::RemoveQuotes, without copying the field.
+std::string_view TrimField(std::string_view field)
+{
+    auto is_space = [](char c) { return std::isspace(static_cast<unsigned char>(c)) != 0; };
+    while (!field.empty() && is_space(field.front()))
     {
-        return std::nullopt;  // Parsing failed
+        field.remove_prefix(1);
     }
-    return record;
+    while (!field.empty() && is_space(field.back()))
+    {
+        field.remove_suffix(1);
+    }
+    if (field.size() >= 2 && field.front() == '"' && field.back() == '"')
+    {
+        field = field.substr(1, field.size() - 2);
+    }
+    return field;
 }
 
-bool ParseMetrics(const std::vector<std::string>&       fields,
-                  const std::vector<const MetricInfo*>& metric_infos,
-                  PerfMetricsRecord&                    record)
+template<typename T> bool ParseNumber(std::string_view field, T& out)
 {
-    for (size_t i = 0; i < metric_infos.size(); ++i)
-    {
-        const std::string& value_str = fields[kFixedPerfMetricsDataHeaderCount + i];
-        const MetricInfo*  info = metric_infos[i];
-        if (info == nullptr)
+    if constexpr (std::is_floating_point_v<T>)
+    {
+#if defined(__cpp_lib_to_chars)
+        auto [end, ec] = std::from_chars(field.data(), field.data() + field.size(), out);
+        return ec == std::errc() && end == field.data() + field.size() && !field.empty();
+#else
+        // No floating point std::from_chars in this standard library.
+        char buffer[64];
+        if (field.empty() || field.size() >= sizeof(buffer))
         {
-            // Unknown metric, this is an error. The number of metric values
-            // will not match the number of metric names.
             return false;
         }
+        std::memcpy(buffer, field.data(), field.size());
+        buffer[field.size()] = '\0';
+        char* end = nullptr;
+        errno = 0;
+        out = std::strtod(buffer, &end);
+        return errno != ERANGE && end == buffer + field.size();
+#endif
+    }
+    else
+    {
+        auto [end, ec] = std::from_chars(field.data(), field.data() + field.size(), out);
+        return ec == std::errc() && end == field.data() + field.size() && !field.empty();
+    }
+}
 
-        double value;
-        if (!StringUtils::SafeConvertFromString(value_str, value))
+// Records and metric columns parsed from a range of lines.
+struct ParsedRows
+{
+    std::vector<PerfMetricsRecord> records;
+    PerfMetricsColumns             metric_columns;
+};
+
+// Parses one data row into record and metric_values. Returns false for a malformed row.
+bool ParseRow(std::string_view     line,
+              PerfMetricsRecord&   record,
+              std::vector<double>& metric_values)
+{
+    const size_t field_count = kFixedPerfMetricsDataHeaderCount + metric_values.size();
+    const char*  at = line.data();
+    const char*  end = line.data() + line.size();
+    size_t       field_index = 0;
+    bool         ok = true;
+    while (ok)
+    {
+        const char*      field_end = FindFieldEnd(at, end);
+        std::string_view field = TrimField(std::string_view(at, field_end - at));
+        if (field_index >= field_count)
         {
-            return false;
+            return false;  // Too many columns
+        }
+        switch (field_index)
+        {
+        case kContextID:
+            ok = ParseNumber(field, record.m_context_id);
+            break;
+        case kProcessID:
+            ok = ParseNumber(field, record.m_process_id);
+            break;
+        case kFrameID:
+            ok = ParseNumber(field, record.m_frame_id);
+            break;
+        case kCmdBufferID:
+            ok = ParseNumber(field, record.m_cmd_buffer_id);
+            break;
+        case kDrawID:
+            ok = ParseNumber(field, record.m_draw_id);
+            break;
+        case kDrawType:
+            ok = ParseNumber(field, record.m_draw_type);
+            break;
+        case kDrawLabel:
+            ok = ParseNumber(field, record.m_draw_label);
+            break;
+        case kProgramID:
+            ok = ParseNumber(field, record.m_program_id);
+            break;
+        case kLRZState:
+            ok = ParseNumber(field, record.m_lrz_state);
+            break;
+        default:
+            ok = ParseNumber(field, metric_values[field_index - kFixedPerfMetricsDataHeaderCount]);
+            break;
+        }
+        ++field_index;
+        if (field_end == end)
+        {
+            break;
+        }
+        at = field_end + 1;
+    }
+    return ok && field_index == field_count;
+}
+
+// Parses the complete lines of [begin, end).
+ParsedRows ParseRows(const char* begin, const char* end, size_t metric_count)
+{
+    ParsedRows result;
+    result.metric_columns.resize(metric_count);
+
+    std::vector<double> metric_values(metric_count);
+    const char*         at = begin;
+    while (at < end)
+    {
+        const char* line_end = static_cast<const char*>(std::memchr(at, '\n', end - at));
+        if (line_end == nullptr)
+        {
+            line_end = end;
         }
-        record.m_metric_values.emplace_back(value);
+        std::string_view  line(at, line_end - at);
+        PerfMetricsRecord record{};
+        if (ParseRow(line, record, metric_values))
+        {
+            result.records.push_back(record);
+            for (size_t i = 0; i < metric_count; ++i)
+            {
+                result.metric_columns[i].push_back(metric_values[i]);
+            }
+        }
+        at = line_end + 1;
     }
-    return true;
+    return result;
 }
 
+// Below this size, a single thread parses the file
+constexpr size_t kMinBytesPerParseThread = 4 * 1024 * 1024;
+
 }  // namespace
 
 std::unique_ptr<PerfMetricsData> PerfMetricsData::LoadFromCsv(
 const std::filesystem::path& file_path,
 const AvailableMetrics&      available_metrics)
 {
-    std::vector<PerfMetricsRecord> records;
-
-    std::ifstream file(file_path);
-    if (!file.is_open())
+    auto file = MappedFile::Open(file_path);
+    if (!file)
     {
         std::cerr << "Failed to open file: " << file_path << std::endl;
         return nullptr;
     }
+    return LoadFromCsvData(file->GetView(), available_metrics);
+}
 
-    std::string line;
+std::unique_ptr<PerfMetricsData> PerfMetricsData::LoadFromCsvData(
+std::string_view        csv,
+const AvailableMetrics& available_metrics)
+{
     // Read header line
-    if (!StringUtils::GetTrimmedLine(file, line) || line.empty())
+    const size_t header_end = std::min(csv.find('\n'), csv.size());
+    std::string  line(csv.substr(0, header_end));
+    StringUtils::Trim(line);
+    if (line.empty())
     {
         return nullptr;
     }
@@ -257,44 +412,86 @@ const AvailableMetrics&      available_metrics)
             return nullptr;
         }
     }
-    // Read data lines
-    while (StringUtils::GetTrimmedLine(file, line))
+
+    // Read data lines, split in ranges of whole lines parsed in parallel
+    const char*  data_begin = csv.data() + std::min(header_end + 1, csv.size());
+    const char*  data_end = csv.data() + csv.size();
+    const size_t data_size = static_cast<size_t>(data_end - data_begin);
+    const size_t max_thread_count = std::max(1u, std::thread::hardware_concurrency());
+    const size_t thread_count = std::clamp<size_t>(data_size / kMinBytesPerParseThread,
+                                                   1,
+                                                   max_thread_count);
+    std::vector<const char*> range_begins = { data_begin };
+    for (size_t i = 1; i < thread_count; ++i)
     {
-        std::stringstream        ss(line);
-        std::string              field;
-        std::vector<std::string> fields;
-        while (StringUtils::GetTrimmedField(ss, field, ','))
-        {
-            fields.push_back(field);
-        }
+        const char* at = std::max(range_begins.back(), data_begin + data_size * i / thread_count);
+        const char* line_end = static_cast<const char*>(std::memchr(at, '\n', data_end - at));
+        range_begins.push_back(line_end ? line_end + 1 : data_end);
+    }
+    range_begins.push_back(data_end);
+
+    const size_t             metric_count = metric_names.size();
+    std::vector<ParsedRows>  ranges(thread_count);
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < thread_count; ++i)
+    {
+        threads.emplace_back([&, i]() {
+            ranges[i] = ParseRows(range_begins[i], range_begins[i + 1], metric_count);
+        });
+    }
+    ranges[0] = ParseRows(range_begins[0], range_begins[1], metric_count);
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
 
-        if (fields.size() != kFixedPerfMetricsDataHeaderCount + metric_names.size())
+    // Concatenate the ranges
+    std::vector<PerfMetricsRecord> records;
+    PerfMetricsColumns             metric_columns;
+    if (ranges.size() == 1)
+    {
+        records = std::move(ranges[0].records);
+        metric_columns = std::move(ranges[0].metric_columns);
+    }
+    else
+    {
+        size_t record_count = 0;
+        for (const auto& range : ranges)
         {
-            continue;  // Skip malformed lines
+            record_count += range.records.size();
         }
-
-        auto record = ParseRecordFixedFields(fields);
-        if (!record.has_value())
+        records.reserve(record_count);
+        for (const auto& range : ranges)
         {
-            continue;  // Skip malformed lines
+            records.insert(records.end(), range.records.begin(), range.records.end());
         }
-
-        if (ParseMetrics(fields, metric_infos, *record))
+        metric_columns.resize(metric_count);
+        for (size_t i = 0; i < metric_count; ++i)
         {
-            records.push_back(*std::move(record));
+            metric_columns[i].reserve(record_count);
+            for (const auto& range : ranges)
+            {
+                metric_columns[i].insert(metric_columns[i].end(),
+                                         range.metric_columns[i].begin(),
+                                         range.metric_columns[i].end());
+            }
         }
     }
 
-    return std::unique_ptr<PerfMetricsData>(
-    new PerfMetricsData(std::move(metric_names), std::move(metric_infos), std::move(records)));
+    return std::unique_ptr<PerfMetricsData>(new PerfMetricsData(std::move(metric_names),
+                                                                std::move(metric_infos),
+                                                                std::move(records),
+                                                                std::move(metric_columns)));
 }
 
 PerfMetricsData::PerfMetricsData(std::vector<std::string>       metric_names,
                                  std::vector<const MetricInfo*> metric_infos,
-                                 std::vector<PerfMetricsRecord> records) :
+                                 std::vector<PerfMetricsRecord> records,
+                                 PerfMetricsColumns             metric_columns) :
     m_metric_names(std::move(metric_names)),
     m_metric_infos(std::move(metric_infos)),
-    m_records(std::move(records))
+    m_records(std::move(records)),
+    m_metric_columns(std::move(metric_columns))
 {
 }
 
@@ -321,18 +518,25 @@ public:
 
         m_draw_to_metric.clear();
         m_metric_to_draw.clear();
-
-        m_record_to_metric.clear();
     }
 
     void AnalyzeCommands(const CommandHierarchy&);
 
-    void AnalyzeRecords(const std::vector<PerfMetricsRecord>&);
+    // Records of one frame matched to the pattern, in record order.
+    struct FrameMatch
+    {
+        std::vector<RecordIndex> m_records;
+        std::vector<MetricIndex> m_metrics;
+    };
+
+    // Matches the records to the pattern, the largest frame of the capture. Calls on_frame for
+    // every frame that has the draws of the pattern in the same order; the other frames are
+    // incomplete or reordered and skipped. Returns the number of records skipped.
+    size_t AnalyzeRecords(const std::vector<PerfMetricsRecord>&,
+                          const std::function<void(const FrameMatch&)>& on_frame);
 
     size_t GetPatternSize() const { return m_metric_to_draw.size(); }
 
-    MetricIndex MatchOf(RecordIndex index) const { return index.Into(m_record_to_metric); }
-
     NodeIndex GetNodeFromDraw(DrawIndex index) const { return index.Into(m_draw_to_node); }
     DrawIndex GetDrawFromNode(NodeIndex index) const { return index.Into(m_node_to_draw); }
     DrawIndex GetDrawFromMetric(MetricIndex index) const
@@ -354,20 +558,19 @@ public:
 
 private:
     template<typename, typename U> using ArrayMap = std::vector<U>;
-    template<typename T, typename U> using HashMap = std::unordered_map<T, U, typename T::Hash>;
+    template<typename T, typename U, typename Hash = typename T::Hash>
+    using HashMap = std::unordered_map<T, U, Hash>;
 
     static void ExtractDraws(const CommandHierarchy&         command_hierarchy,
                              ArrayMap<DrawIndex, NodeIndex>& out_draw_to_node,
                              HashMap<NodeIndex, DrawIndex>&  out_node_to_draw);
 
-    struct DrawSignatures
+    struct FrameRange
     {
-        const PerfMetricsRecord* m_begin;
-        const PerfMetricsRecord* m_end;
+        size_t m_begin;
+        size_t m_end;
     };
-    static bool MatchDrawSignatures(const DrawSignatures&,
-                                    const PerfMetricsRecord* begin,
-                                    const PerfMetricsRecord* end);
+    static std::vector<FrameRange> SplitFrames(const std::vector<PerfMetricsRecord>&);
 
     bool CorrelationEnabled() const
     {
@@ -383,8 +586,6 @@ private:
 
     ArrayMap<DrawIndex, MetricIndex> m_draw_to_metric;
     ArrayMap<MetricIndex, DrawIndex> m_metric_to_draw;
-
-    ArrayMap<RecordIndex, MetricIndex> m_record_to_metric;
 };
 
 void PerfMetricsDataProvider::Correlator::ExtractDraws(
@@ -479,71 +680,49 @@ void PerfMetricsDataProvider::Correlator::AnalyzeCommands(const CommandHierarchy
     ExtractDraws(command_hierarchy, m_draw_to_node, m_node_to_draw);
 }
 
-bool PerfMetricsDataProvider::Correlator::MatchDrawSignatures(const DrawSignatures&    signatures,
-                                                              const PerfMetricsRecord* begin,
-                                                              const PerfMetricsRecord* end)
+std::vector<PerfMetricsDataProvider::Correlator::FrameRange> PerfMetricsDataProvider::Correlator::
+SplitFrames(const std::vector<PerfMetricsRecord>& records)
 {
-    const ptrdiff_t size = (signatures.m_end - signatures.m_begin);
-    if (size != end - begin)
+    std::vector<FrameRange> frames;
+    size_t                  frame_start = 0;
+    for (size_t i = 1; i <= records.size(); ++i)
     {
-        return false;
-    }
-    const PerfMetricsRecord* at = begin;
-    const PerfMetricsRecord* signatures_at = signatures.m_begin;
-    for (; at != end; ++at, ++signatures_at)
-    {
-
-        if (at->m_cmd_buffer_id != signatures_at->m_cmd_buffer_id)
+        if (i == records.size() || records[frame_start].m_frame_id != records[i].m_frame_id)
         {
-            return false;
-        }
-        if (at->m_draw_id != signatures_at->m_draw_id)
-        {
-            return false;
+            frames.push_back({ frame_start, i });
+            frame_start = i;
         }
     }
-    return true;
+    return frames;
 }
 
-void PerfMetricsDataProvider::Correlator::AnalyzeRecords(
-const std::vector<PerfMetricsRecord>& records)
+size_t PerfMetricsDataProvider::Correlator::AnalyzeRecords(
+const std::vector<PerfMetricsRecord>&         records,
+const std::function<void(const FrameMatch&)>& on_frame)
 {
-    m_record_to_metric.clear();
-
     if (records.empty())
     {
-        return;
+        return 0;
     }
-    size_t template_frame_start = 0;
-    size_t template_frame_size = 0;
 
-    // Find the frame with the max number of draw calls, and use that as template.
+    // Use the frame with the max number of draw calls as the pattern.
+    const std::vector<FrameRange> frames = SplitFrames(records);
+    FrameRange                    pattern = frames.front();
+    for (const FrameRange& frame : frames)
     {
-        size_t frame_start = 0;
-        auto   emit_frame = [&](size_t start, size_t end) {
-            if (end - start > template_frame_size)
-            {
-                template_frame_start = start;
-                template_frame_size = end - start;
-            }
-        };
-        for (size_t i = 0; i < records.size(); ++i)
+        if (frame.m_end - frame.m_begin > pattern.m_end - pattern.m_begin)
         {
-            if (records[frame_start].m_frame_id != records[i].m_frame_id)
-            {
-                emit_frame(frame_start, i);
-                frame_start = i;
-            }
+            pattern = frame;
         }
-        emit_frame(frame_start, records.size());
     }
+    const size_t pattern_size = pattern.m_end - pattern.m_begin;
 
     ArrayMap<DrawIndex, MetricIndex> draw_to_metric;
     ArrayMap<MetricIndex, DrawIndex> metric_to_draw;
-    metric_to_draw.resize(template_frame_size);
-    for (size_t i = 0; i < template_frame_size; ++i)
+    metric_to_draw.resize(pattern_size);
+    for (size_t i = 0; i < pattern_size; ++i)
     {
-        if (IsMetricsRecordDrawOrDispatch(records[template_frame_start + i]))
+        if (IsMetricsRecordDrawOrDispatch(records[pattern.m_begin + i]))
         {
             metric_to_draw[i] = DrawIndex(draw_to_metric.size());
             draw_to_metric.push_back(MetricIndex(i));
@@ -554,41 +733,42 @@ const std::vector<PerfMetricsRecord>& records)
     {
         std::cerr << "Mismatch draw calls in performance counter data." << std::endl;
     }
+    m_draw_to_metric = std::move(draw_to_metric);
+    m_metric_to_draw = std::move(metric_to_draw);
 
-    const DrawSignatures signature = {
-        records.data() + template_frame_start,
-        records.data() + template_frame_start + template_frame_size,
-    };
-
-    ArrayMap<RecordIndex, MetricIndex> record_to_metric(records.size());
+    // As with a sequence comparison, a frame only matches if each record has the key of the
+    // pattern record at the same position, so a frame with the same draws in another order is
+    // skipped.
+    const PerfMetricsRecord* pattern_records = records.data() + pattern.m_begin;
+    FrameMatch               match;
+    match.m_records.reserve(pattern_size);
+    match.m_metrics.reserve(pattern_size);
+    size_t skipped = 0;
+    for (const FrameRange& frame : frames)
     {
-        size_t frame_start = 0;
-        auto   emit_frame = [&](size_t start, size_t end) {
-            if (!MatchDrawSignatures(signature, records.data() + start, records.data() + end))
-            {
-                // Bad data?
-                return;
-            }
-            const size_t frame_size = end - start;
-            for (int i = 0; i < frame_size; ++i)
-            {
-                record_to_metric[start + i] = MetricIndex(i);
-            }
-        };
-        for (size_t i = 0; i < records.size(); ++i)
+        match.m_records.clear();
+        match.m_metrics.clear();
+        bool complete = (frame.m_end - frame.m_begin == pattern_size);
+        for (size_t i = frame.m_begin; complete && i < frame.m_end; ++i)
         {
-            if (records[frame_start].m_frame_id != records[i].m_frame_id)
+            const size_t position = i - frame.m_begin;
+            if (records[i].m_cmd_buffer_id != pattern_records[position].m_cmd_buffer_id ||
+                records[i].m_draw_id != pattern_records[position].m_draw_id)
             {
-                emit_frame(frame_start, i);
-                frame_start = i;
+                complete = false;
+                break;
             }
+            match.m_records.push_back(RecordIndex(i));
+            match.m_metrics.push_back(MetricIndex(position));
         }
-        emit_frame(frame_start, records.size());
+        if (!complete)
+        {
+            skipped += frame.m_end - frame.m_begin;
+            continue;
+        }
+        on_frame(match);
     }
-
-    m_record_to_metric = std::move(record_to_metric);
-    m_draw_to_metric = std::move(draw_to_metric);
-    m_metric_to_draw = std::move(metric_to_draw);
+    return skipped;
 }
 
 std::unique_ptr<PerfMetricsDataProvider> PerfMetricsDataProvider::Create(
@@ -623,6 +803,7 @@ void PerfMetricsDataProvider::Update(std::unique_ptr<PerfMetricsData> data)
 
     m_raw_data = std::move(data);
     m_computed_records.clear();
+    m_computed_statistics = {};
     m_correlator->Reset();
 }
 
@@ -639,74 +820,67 @@ void PerfMetricsDataProvider::Analyze(const CommandHierarchy* command_hierarchy)
     {
         m_correlator->AnalyzeCommands(*command_hierarchy);
     }
-    m_correlator->AnalyzeRecords(records);
-
-    const size_t pattern_size = m_correlator->GetPatternSize();
-    m_computed_records.resize(pattern_size);
-
-    // This map will store intermediate sums and counts for averaging.
-    // Key: {cmd_buffer_id, draw_id}
-    // Value: {vector of metric sums, count of records}
-    struct MetricSumWithRecordCount
-    {
-        std::vector<double> m_metric_sums{};
-        uint32_t            m_record_count = 0;
-    };
 
-    std::vector<MetricSumWithRecordCount> sums_and_counts;
-    sums_and_counts.resize(pattern_size);
-
-    size_t skipped = 0;
-    for (size_t record_index = 0; record_index < records.size(); ++record_index)
-    {
-        auto pattern_index = m_correlator->MatchOf(Correlator::RecordIndex(record_index));
-        if (!pattern_index)
+    // Aggregate the matched frames in a single pass. The pattern frame always matches itself, so
+    // every computed record gets one sample per matching frame.
+    const PerfMetricsColumns& metric_columns = m_raw_data->GetMetricColumns();
+    PerfMetricsStatistics&    stats = m_computed_statistics;
+    PerfMetricsColumns        squared_deviation_sums;  // Welford's running sums for the variance
+    uint32_t                  frame_count = 0;
+    auto                      on_frame = [&](const Correlator::FrameMatch& match) {
+        ++frame_count;
+        if (frame_count == 1)
         {
-            ++skipped;
-            continue;
-        }
-        auto& record = records[record_index];
-        auto& draw_call_data = sums_and_counts[*pattern_index];
-        if (draw_call_data.m_record_count == 0)
-        {
-            draw_call_data.m_metric_sums.resize(num_metrics);
-
-            m_computed_records[*pattern_index] = record;
+            const size_t pattern_size = m_correlator->GetPatternSize();
+            m_computed_records.assign(pattern_size, PerfMetricsRecord{});
+            for (size_t i = 0; i < match.m_records.size(); ++i)
+            {
+                PerfMetricsRecord& record = m_computed_records[*match.m_metrics[i]];
+                record = records[*match.m_records[i]];
+                // frame_id for aggregated data is meaningless.
+                record.m_frame_id = 0;
+            }
+            for (PerfMetricsColumns* columns :
+                 { &stats.m_mean, &stats.m_min, &stats.m_max, &squared_deviation_sums })
+            {
+                columns->assign(num_metrics, std::vector<double>(pattern_size, 0.0));
+            }
         }
 
-        if (record.m_metric_values.size() == num_metrics)
+        for (size_t metric = 0; metric < num_metrics; ++metric)
         {
-            for (size_t i = 0; i < num_metrics; ++i)
+            const std::vector<double>& values = metric_columns[metric];
+            std::vector<double>&       mean = stats.m_mean[metric];
+            std::vector<double>&       min = stats.m_min[metric];
+            std::vector<double>&       max = stats.m_max[metric];
+            std::vector<double>&       m2 = squared_deviation_sums[metric];
+            for (size_t i = 0; i < match.m_records.size(); ++i)
             {
-                draw_call_data.m_metric_sums[i] += record.m_metric_values[i];
+                const size_t position = *match.m_metrics[i];
+                const double value = values[*match.m_records[i]];
+                const double delta = value - mean[position];
+                mean[position] += delta / frame_count;
+                m2[position] += delta * (value - mean[position]);
+                min[position] = (frame_count == 1) ? value : std::min(min[position], value);
+                max[position] = (frame_count == 1) ? value : std::max(max[position], value);
             }
-            draw_call_data.m_record_count++;
         }
-    }
+    };
+
+    const size_t skipped = m_correlator->AnalyzeRecords(records, on_frame);
     if (skipped)
     {
         std::cerr << "Skipping " << skipped << " metrics." << std::endl;
     }
 
-    // Now, build the final m_computed_records vector with averaged records in order.
-    for (size_t draw_index = 0; draw_index < pattern_size; ++draw_index)
+    // Population standard deviation over the matched frames.
+    stats.m_frame_count = frame_count;
+    stats.m_stddev = std::move(squared_deviation_sums);
+    for (std::vector<double>& column : stats.m_stddev)
     {
-        PerfMetricsRecord& averaged_record = m_computed_records[draw_index];
-        averaged_record.m_metric_values.clear();
-        // frame_id for aggregated data is meaningless.
-        averaged_record.m_frame_id = 0;
-
-        const auto count = sums_and_counts[draw_index].m_record_count;
-        auto&      sums = sums_and_counts[draw_index].m_metric_sums;
-        if (count == 0 || sums.empty())
-        {
-            continue;
-        }
-
-        averaged_record.m_metric_values.reserve(num_metrics);
-        for (size_t i = 0; i < num_metrics; ++i)
+        for (double& value : column)
         {
-            averaged_record.m_metric_values.emplace_back(sums[i] / count);
+            value = std::sqrt(value / frame_count);
         }
     }
 }
@@ -99,30 +99,47 @@ struct PerfMetricsKeyHash
 // The performance metrics result csv file is in the format of
 // "ContextID,ProcessID,FrameID,CmdBufferID,DrawID,DrawType,DrawLabel,ProgramID,LRZState,COUNTER_A,COUNTER_B,
 // ... "
+// A record holds the fixed fields of a row. The counter values are stored apart, in columns.
 struct PerfMetricsRecord
 {
-    uint64_t            m_context_id;
-    uint64_t            m_process_id;
-    uint64_t            m_frame_id;
-    uint64_t            m_cmd_buffer_id;
-    uint32_t            m_draw_id;
-    uint32_t            m_draw_label;
-    uint64_t            m_program_id;
-    uint8_t             m_draw_type;
-    uint8_t             m_lrz_state;
-    std::vector<double> m_metric_values;
+    uint64_t m_context_id;
+    uint64_t m_process_id;
+    uint64_t m_frame_id;
+    uint64_t m_cmd_buffer_id;
+    uint32_t m_draw_id;
+    uint32_t m_draw_label;
+    uint64_t m_program_id;
+    uint8_t  m_draw_type;
+    uint8_t  m_lrz_state;
 };
 
+// Counter values of a list of records, one contiguous column per metric:
+// columns[metric_index][record_index].
+using PerfMetricsColumns = std::vector<std::vector<double>>;
+
 class PerfMetricsData
 {
 public:
-    // Load performance metrics data from a CSV file
+    // Load performance metrics data from a CSV file. The file is memory mapped and large files are
+    // parsed by several threads, each on its own range of lines. Malformed rows are skipped.
     [[nodiscard]] static std::unique_ptr<PerfMetricsData> LoadFromCsv(
     const std::filesystem::path& file_path,
     const AvailableMetrics&      available_metrics);
+    // Load performance metrics data from the content of a CSV file
+    [[nodiscard]] static std::unique_ptr<PerfMetricsData> LoadFromCsvData(
+    std::string_view        csv,
+    const AvailableMetrics& available_metrics);
+
     // Get all performance metrics records
     const std::vector<PerfMetricsRecord>& GetRecords() const { return m_records; }
 
+    // Get the values of the performance metrics, a column per metric in record order
+    const PerfMetricsColumns& GetMetricColumns() const { return m_metric_columns; }
+    double                    GetMetricValue(size_t record_index, size_t metric_index) const
+    {
+        return m_metric_columns[metric_index][record_index];
+    }
+
     // Get the names of the performance metrics
     const std::vector<std::string>& GetMetricNames() const { return m_metric_names; }
 
@@ -131,12 +148,25 @@ public:
 
     PerfMetricsData(std::vector<std::string>       metric_names,
                     std::vector<const MetricInfo*> metric_infos,
-                    std::vector<PerfMetricsRecord> records);
+                    std::vector<PerfMetricsRecord> records,
+                    PerfMetricsColumns             metric_columns);
 
 private:
     std::vector<std::string>       m_metric_names;
     std::vector<const MetricInfo*> m_metric_infos;
     std::vector<PerfMetricsRecord> m_records;
+    PerfMetricsColumns             m_metric_columns;
+};
+
+// Statistics of the metric values of the computed records over the frames matching the pattern,
+// a column per metric like PerfMetricsData::GetMetricColumns().
+struct PerfMetricsStatistics
+{
+    PerfMetricsColumns m_mean;
+    PerfMetricsColumns m_min;
+    PerfMetricsColumns m_max;
+    PerfMetricsColumns m_stddev;  // population standard deviation
+    uint32_t           m_frame_count = 0;
 };
 
 class PerfMetricsDataProvider
@@ -169,6 +199,15 @@ public:
     // dataset, ordered by command buffer appearance and then draw ID appearance order.
     const std::vector<PerfMetricsRecord>& GetComputedRecords() const { return m_computed_records; }
 
+    // Get the averaged metric values of the computed records, a column per metric.
+    const PerfMetricsColumns& GetComputedMetricColumns() const
+    {
+        return m_computed_statistics.m_mean;
+    }
+
+    // Get the mean, min, max and standard deviation of the computed records.
+    const PerfMetricsStatistics& GetComputedStatistics() const { return m_computed_statistics; }
+
     // Returns the header for the record.
     const std::vector<std::string> GetRecordHeader() const;
 
@@ -186,7 +225,8 @@ private:
     std::unique_ptr<Correlator> m_correlator;
 
     std::unique_ptr<PerfMetricsData> m_raw_data;
-    std::vector<PerfMetricsRecord>   m_computed_records;  // calculated based on the |m_raw_data|
+    std::vector<PerfMetricsRecord>   m_computed_records;     // calculated based on the |m_raw_data|
+    PerfMetricsStatistics            m_computed_statistics;  // values of |m_computed_records|
 
     std::unique_ptr<AvailableMetrics> m_owned_desc;
 };
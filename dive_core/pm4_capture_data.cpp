@@ -23,6 +23,7 @@
 #include <iostream>
 #include <memory>
 #include "archive.h"
+#include "common/trace.h"
 #include "dive_core/command_hierarchy.h"
 #include "dive_core/common/common.h"
 #include "freedreno_dev_info.h"
@@ -44,6 +45,45 @@ constexpr const uint32_t kMaxStrLen = 100 << 20;          // 100 MiB
 constexpr const uint32_t kMaxNumWavesPerBlock = 1 << 20;  // 1 MiB
 constexpr const uint32_t kMaxNumSGPRPerWave = 1 << 20;    // 1 MiB
 constexpr const uint32_t kMaxNumVGPRPerWave = 1 << 20;    // 1 MiB
+constexpr const uint64_t kDataChunkSize = 4 << 20;        // 4 MiB
+
+//--------------------------------------------------------------------------------------------------
+// Read-only stream buffer over a capture in memory
+class CaptureBufferStreamBuf : public std::streambuf
+{
+public:
+    CaptureBufferStreamBuf(const uint8_t *data, size_t size)
+    {
+        // The get area is never written to
+        char *begin = reinterpret_cast<char *>(const_cast<uint8_t *>(data));
+        setg(begin, begin, begin + size);
+    }
+
+protected:
+    pos_type seekoff(off_type                off,
+                     std::ios_base::seekdir  dir,
+                     std::ios_base::openmode which) override
+    {
+        if ((which & std::ios_base::in) == 0)
+            return pos_type(off_type(-1));
+
+        char *base = gptr();
+        if (dir == std::ios_base::beg)
+            base = eback();
+        else if (dir == std::ios_base::end)
+            base = egptr();
+        if (off < eback() - base || off > egptr() - base)
+            return pos_type(off_type(-1));
+
+        setg(eback(), base + off, egptr());
+        return pos_type(off_type(gptr() - eback()));
+    }
+
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override
+    {
+        return seekoff(off_type(pos), std::ios_base::beg, which);
+    }
+};
 }  // namespace
 
 //--------------------------------------------------------------------------------------------------
@@ -55,6 +95,16 @@ FileReader::FileReader(const char *file_name) :
     DIVE_ASSERT(m_handle != nullptr);
 }
 
+//--------------------------------------------------------------------------------------------------
+FileReader::FileReader(const uint8_t *data, size_t size) :
+    m_data(data),
+    m_data_size(size),
+    m_handle(std::unique_ptr<struct archive, decltype(&archive_read_free)>(archive_read_new(),
+                                                                           &archive_read_free))
+{
+    DIVE_ASSERT(m_handle != nullptr);
+}
+
 //--------------------------------------------------------------------------------------------------
 int FileReader::Open()
 {
@@ -93,11 +143,24 @@ int FileReader::Open()
         return ret;
     }
 
-    ret = archive_read_open_filename(m_handle.get(), m_file_name.c_str(), 10240);
-    if (ret != ARCHIVE_OK)
+    if (m_data != nullptr)
     {
-        std::cerr << "error archive_read_open_filename: " << archive_error_string(m_handle.get());
-        return ret;
+        ret = archive_read_open_memory(m_handle.get(), m_data, m_data_size);
+        if (ret != ARCHIVE_OK)
+        {
+            std::cerr << "error archive_read_open_memory: " << archive_error_string(m_handle.get());
+            return ret;
+        }
+    }
+    else
+    {
+        ret = archive_read_open_filename(m_handle.get(), m_file_name.c_str(), 10240);
+        if (ret != ARCHIVE_OK)
+        {
+            std::cerr << "error archive_read_open_filename: "
+                      << archive_error_string(m_handle.get());
+            return ret;
+        }
     }
     struct archive_entry *entry;
     ret = archive_read_next_header(m_handle.get(), &entry);
@@ -194,12 +257,31 @@ void MemoryAllocationInfo::AddMemoryAllocations(uint32_t
 // =================================================================================================
 // MemoryManager
 // =================================================================================================
-MemoryManager::~MemoryManager()
+uint8_t *MemoryManager::AllocateBlockData(uint32_t size)
 {
-    for (uint32_t i = 0; i < m_memory_blocks.size(); ++i)
+    // Keep the data of each block 8-byte aligned
+    uint64_t aligned_size = (static_cast<uint64_t>(size) + 7) & ~uint64_t(7);
+    while (m_cur_chunk < m_data_chunks.size())
     {
-        delete[] m_memory_blocks[i].m_data_ptr;
+        DataChunk &chunk = m_data_chunks[m_cur_chunk];
+        if (m_cur_chunk_offset + aligned_size <= chunk.m_size)
+        {
+            uint8_t *data_ptr = chunk.m_data.get() + m_cur_chunk_offset;
+            m_cur_chunk_offset += aligned_size;
+            return data_ptr;
+        }
+        ++m_cur_chunk;
+        m_cur_chunk_offset = 0;
     }
+
+    // Large blocks get a chunk of their own
+    DataChunk chunk;
+    chunk.m_size = std::max(kDataChunkSize, aligned_size);
+    chunk.m_data.reset(new uint8_t[chunk.m_size]);
+    m_data_chunks.push_back(std::move(chunk));
+    m_cur_chunk = m_data_chunks.size() - 1;
+    m_cur_chunk_offset = aligned_size;
+    return m_data_chunks.back().m_data.get();
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -217,6 +299,17 @@ void MemoryManager::AddMemoryBlock(uint32_t submit_index, uint64_t va_addr, Memo
     data.m_data_ptr = nullptr;
 }
 
+//--------------------------------------------------------------------------------------------------
+void MemoryManager::Reset()
+{
+    m_last_used_block = LastUsedBlock();
+    m_memory_blocks.resize(0);
+    m_memory_allocations = MemoryAllocationInfo();
+    m_same_submit_only = true;
+    m_cur_chunk = 0;
+    m_cur_chunk_offset = 0;
+}
+
 //--------------------------------------------------------------------------------------------------
 void MemoryManager::AddMemoryAllocations(uint32_t                           submit_index,
                                          MemoryAllocationsDataHeader::Type  type,
@@ -228,6 +321,8 @@ void MemoryManager::AddMemoryAllocations(uint32_t                           subm
 //--------------------------------------------------------------------------------------------------
 void MemoryManager::Finalize(bool same_submit_copy_only, bool duplicate_ib_capture)
 {
+    DIVE_TRACE_SCOPE("FinalizeMemory");
+    DIVE_TRACE_COUNTER("Memory blocks", m_memory_blocks.size());
     m_same_submit_only = same_submit_copy_only;
 
     // Sorting required for GetMaxContiguousSize(), GetMemoryOfUnknownSizeViaCallback(), and others
@@ -279,17 +374,13 @@ void MemoryManager::Finalize(bool same_submit_copy_only, bool duplicate_ib_captu
                     // (i.e. whole or partial overwrite)
                     DIVE_ASSERT(memory_block.m_va_addr == prev_addr);
 
-                    // Use whichever one is bigger and get rid of the smaller one
+                    // Use whichever one is bigger and get rid of the smaller one. The data of the
+                    // smaller one stays in the block data storage until Reset()
                     if (memory_block.m_data_size >= temp_memory_blocks.back().m_data_size)
                     {
                         // Replace previous memory block with current one
-                        delete[] temp_memory_blocks.back().m_data_ptr;
                         temp_memory_blocks.back() = m_memory_blocks[i];
                     }
-                    else
-                    {
-                        delete[] m_memory_blocks[i].m_data_ptr;
-                    }
                 }
             }
             prev_addr = memory_block.m_va_addr;
@@ -354,9 +445,11 @@ bool MemoryManager::RetrieveMemoryData(void    *buffer_ptr,
                                        uint64_t size) const
 {
     // Check the last-used block first, because this is the desired block most of the time
-    if (m_last_used_block_ptr != nullptr)
+    const MemoryBlock *last_used_block_ptr = m_last_used_block.m_ptr.load(
+    std::memory_order_relaxed);
+    if (last_used_block_ptr != nullptr)
     {
-        const MemoryBlock &mem_block = *m_last_used_block_ptr;
+        const MemoryBlock &mem_block = *last_used_block_ptr;
         uint64_t           mem_block_end_addr = mem_block.m_va_addr + mem_block.m_data_size;
         uint64_t           end_addr = va_addr + size;
 
@@ -391,7 +484,7 @@ bool MemoryManager::RetrieveMemoryData(void    *buffer_ptr,
         bool overlaps = (va_addr < mem_block_end_addr) && (mem_block.m_va_addr < end_addr);
         if (valid_submit && overlaps)
         {
-            m_last_used_block_ptr = &mem_block;
+            m_last_used_block.m_ptr.store(&mem_block, std::memory_order_relaxed);
             uint64_t max_start_addr = std::max(va_addr, mem_block.m_va_addr);
             uint64_t min_end_addr = std::min(mem_block_end_addr, end_addr);
             uint64_t src_offset = max_start_addr - mem_block.m_va_addr;
@@ -858,6 +951,7 @@ Pm4CaptureData::Pm4CaptureData(ProgressTracker *progress_tracker) :
 // used purely for loading a .rd file.
 CaptureData::LoadResult Pm4CaptureData::LoadCaptureFile(const std::string &file_name)
 {
+    DIVE_TRACE_SCOPE("LoadPm4Capture");
     std::string file_name_(file_name);
     std::string file_extension = std::filesystem::path(file_name_).extension().generic_string();
 
@@ -925,6 +1019,7 @@ CaptureData::LoadResult Pm4CaptureData::LoadAdrenoRdFile(const std::string &file
 //--------------------------------------------------------------------------------------------------
 CaptureData::LoadResult Pm4CaptureData::LoadCaptureFileStream(std::istream &capture_file)
 {
+    DIVE_TRACE_SCOPE("LoadDiveFile");
     // Read file header
     FileHeader file_header;
     if (!capture_file.read((char *)&file_header, sizeof(file_header)))
@@ -982,9 +1077,45 @@ CaptureData::LoadResult Pm4CaptureData::LoadCaptureFileStream(std::istream &capt
     return LoadResult::kSuccess;
 }
 
+//--------------------------------------------------------------------------------------------------
+CaptureData::LoadResult Pm4CaptureData::LoadCaptureBuffer(const uint8_t *data, size_t size)
+{
+    FileHeader file_header;
+    if (size >= sizeof(file_header))
+        memcpy(&file_header, data, sizeof(file_header));
+    if (size >= sizeof(file_header) && file_header.m_file_id == kDiveFileId)
+    {
+        CaptureBufferStreamBuf buffer(data, size);
+        std::istream           capture_file(&buffer);
+        return LoadCaptureFileStream(capture_file);
+    }
+
+    // Anything else is assumed to be a (possibly compressed) .rd file
+    FileReader reader(data, size);
+    if (reader.Open() != 0)
+        return LoadResult::kFileIoError;
+    return LoadAdrenoRdFile(reader);
+}
+
+//--------------------------------------------------------------------------------------------------
+void Pm4CaptureData::Reset()
+{
+    m_data_header = {};
+    m_capture_type = m_data_header.m_capture_type;
+    m_submits.clear();
+    m_presents.clear();
+    m_rings.clear();
+    m_text.clear();
+    m_waves = WaveInfo();
+    m_registers = RegisterInfo();
+    m_memory.Reset();
+    m_cur_capture_file.clear();
+}
+
 //--------------------------------------------------------------------------------------------------
 CaptureData::LoadResult Pm4CaptureData::LoadAdrenoRdFile(FileReader &capture_file)
 {
+    DIVE_TRACE_SCOPE("LoadAdrenoRdFile");
     enum rd_sect_type
     {
         RD_NONE,
@@ -1017,14 +1148,17 @@ CaptureData::LoadResult Pm4CaptureData::LoadAdrenoRdFile(FileReader &capture_fil
     uint32_t  cur_size = UINT32_MAX;
     bool      is_new_submit = false;
     bool      skip_commands = false;
+    uint64_t  bytes_read = 0;
     while (capture_file.Read((char *)&block_info, sizeof(block_info)) > 0)
     {
         // Read and discard any trailing 0xffffffff padding from previous block
         while (block_info.m_block_type == 0xffffffff && block_info.m_data_size == 0xffffffff)
         {
+            bytes_read += sizeof(block_info);
             if (capture_file.Read((char *)&block_info, sizeof(block_info)) <= 0)
                 return LoadResult::kCorruptData;
         }
+        bytes_read += sizeof(block_info) + block_info.m_data_size;
 
         switch (block_info.m_block_type)
         {
@@ -1110,6 +1244,8 @@ CaptureData::LoadResult Pm4CaptureData::LoadAdrenoRdFile(FileReader &capture_fil
         break;
         }
     }
+    DIVE_TRACE_COUNTER("Bytes read", bytes_read);
+    DIVE_TRACE_COUNTER("Submits", m_submits.size());
     m_memory.Finalize(true, true);
     return LoadResult::kSuccess;
 }
@@ -1310,12 +1446,9 @@ bool Pm4CaptureData::LoadMemoryBlock(std::istream &capture_file)
         return false;
     MemoryData raw_memory;
     raw_memory.m_data_size = memory_raw_data_header.m_size_in_bytes;
-    raw_memory.m_data_ptr = new uint8_t[raw_memory.m_data_size];
+    raw_memory.m_data_ptr = m_memory.AllocateBlockData(raw_memory.m_data_size);
     if (!capture_file.read((char *)raw_memory.m_data_ptr, memory_raw_data_header.m_size_in_bytes))
-    {
-        delete[] raw_memory.m_data_ptr;
         return false;
-    }
 
     uint32_t submit_index = (uint32_t)(m_submits.size() - 1);
 
@@ -1509,14 +1642,13 @@ bool Pm4CaptureData::LoadMemoryBlockAdreno(FileReader &capture_file,
                                            uint64_t    gpu_addr,
                                            uint32_t    size)
 {
+    if (size > kMaxMemAllocSize)
+        return false;
     MemoryData raw_memory;
     raw_memory.m_data_size = size;
-    raw_memory.m_data_ptr = new uint8_t[raw_memory.m_data_size];
+    raw_memory.m_data_ptr = m_memory.AllocateBlockData(raw_memory.m_data_size);
     if (!capture_file.Read((char *)raw_memory.m_data_ptr, size))
-    {
-        delete[] raw_memory.m_data_ptr;
         return false;
-    }
 
     // Unlike with Dive, all memory blocks for a submit come *before* the submit
     uint32_t submit_index = (uint32_t)(m_submits.size());
@@ -15,10 +15,12 @@
 */
 
 #pragma once
+#include <atomic>
 #include <fstream>
 #include <map>
 #include <memory>
 #include <string>
+#include <vector>
 #include "third_party/libarchive/libarchive/archive.h"
 #include "common.h"
 #include "dive_core/common/dive_capture_format.h"
@@ -85,12 +87,32 @@ struct MemoryData
 class MemoryManager : public IMemoryManager
 {
 public:
-    virtual ~MemoryManager();
+    struct MemoryBlock
+    {
+        uint64_t m_va_addr;
+        uint32_t m_submit_index;
+        uint32_t m_data_size;
+        uint8_t *m_data_ptr;
+    };
+
+    MemoryManager() = default;
+    MemoryManager(MemoryManager &&) = default;
+    MemoryManager &operator=(MemoryManager &&) = default;
+    virtual ~MemoryManager() = default;
+
+    // Get storage for the data of a memory block. The storage is owned by the manager and is valid
+    // until Reset() or destruction. It is carved out of large chunks that Reset() keeps, so that
+    // loading one capture after another doesn't allocate per memory block
+    uint8_t *AllocateBlockData(uint32_t size);
 
     // Use an r-value reference instead of normal reference to prevent an extra copy
     // Given the amount of memory potentially in a capture, this can be significant
+    // The data must have been allocated with AllocateBlockData()
     void AddMemoryBlock(uint32_t submit_index, uint64_t va_addr, MemoryData &&data);
 
+    // Remove all memory blocks and allocation info, keeping the block data storage for reuse
+    void Reset();
+
     // Add memory allocation info to internal MemoryAllocationInfo object
     void AddMemoryAllocations(uint32_t                           submit_index,
                               MemoryAllocationsDataHeader::Type  type,
@@ -122,21 +144,45 @@ public:
     // Determine if given range is covered by memory blocks
     virtual bool IsValid(uint32_t submit_index, uint64_t addr, uint64_t size) const override;
 
+    // All the captured memory blocks
+    const DiveVector<MemoryBlock> &GetMemoryBlocks() const { return m_memory_blocks; }
+
 private:
-    struct MemoryBlock
+    // Chunk of storage handed out by AllocateBlockData()
+    struct DataChunk
     {
-        uint64_t m_va_addr;
-        uint32_t m_submit_index;
-        uint32_t m_data_size;
-        uint8_t *m_data_ptr;
+        std::unique_ptr<uint8_t[]> m_data;
+        uint64_t                   m_size;
+    };
+
+    // Cache of the last used block. The memory can be read from several threads at once (e.g. to
+    // disassemble shaders in parallel), so the cache is atomic. It isn't copied with the manager,
+    // since it points into the blocks of the source.
+    struct LastUsedBlock
+    {
+        LastUsedBlock() = default;
+        LastUsedBlock(const LastUsedBlock &) {}
+        LastUsedBlock &operator=(const LastUsedBlock &)
+        {
+            m_ptr.store(nullptr, std::memory_order_relaxed);
+            return *this;
+        }
+
+        std::atomic<const MemoryBlock *> m_ptr{ nullptr };
     };
 
     // mutable variable for caching reasons
-    mutable const MemoryBlock *m_last_used_block_ptr = nullptr;
+    mutable LastUsedBlock m_last_used_block;
 
     // Memory blocks containing all the captured memory data
     DiveVector<MemoryBlock> m_memory_blocks;
 
+    // Storage of the memory block data. Chunks before m_cur_chunk are in use, chunks after it are
+    // left over from before the last Reset()
+    std::vector<DataChunk> m_data_chunks;
+    uint64_t               m_cur_chunk = 0;
+    uint64_t               m_cur_chunk_offset = 0;
+
     // All the captured memory allocation info
     MemoryAllocationInfo m_memory_allocations;
 
@@ -316,12 +362,16 @@ class FileReader
 {
 public:
     FileReader(const char *file_name);
+    // Reads from memory instead of a file. The data must outlive the reader
+    FileReader(const uint8_t *data, size_t size);
     int     Open();
     int64_t Read(char *buf, int64_t size);
     int     Close();
 
 private:
     std::string                                                   m_file_name;
+    const uint8_t                                                *m_data = nullptr;
+    size_t                                                        m_data_size = 0;
     std::unique_ptr<struct archive, decltype(&archive_read_free)> m_handle;
 };
 
@@ -354,6 +404,14 @@ public:
     LoadResult LoadCaptureFileStream(std::istream &capture_file);
     LoadResult LoadAdrenoRdFile(FileReader &capture_file);
 
+    // Load a .dive or .rd capture from memory, the format being detected from the data. The data
+    // is copied, so it doesn't need to outlive the capture data
+    LoadResult LoadCaptureBuffer(const uint8_t *data, size_t size);
+
+    // Release the loaded capture so that another one can be loaded in this object. Storage of the
+    // memory blocks is kept and reused by the next load
+    void Reset();
+
     bool        HasPm4Data() const { return m_submits.size() > 0; }
     std::string GetFileFormatVersion() const;
 
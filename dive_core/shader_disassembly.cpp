@@ -16,6 +16,8 @@
 
 #include "shader_disassembly.h"
 #include <iostream>
+#include <mutex>
+#include "common/trace.h"
 #include "dive_core/common/memory_manager_base.h"
 #include "pm4_info.h"
 
@@ -49,8 +51,6 @@ std::string DisassembleA3XX(const uint8_t*       data,
                             struct shader_stats* stats,
                             enum debug_t         debug)
 {
-    disasm_a3xx_set_debug(debug);
-
 #ifdef _MSC_VER
     FILE*   disasm_file = NULL;
     errno_t err = tmpfile_s(&disasm_file);
@@ -65,6 +65,13 @@ std::string DisassembleA3XX(const uint8_t*       data,
     FILE*  disasm_file = open_memstream(&disasm_buf, &disasm_buf_size);
 #endif
 
+    // The disassembler keeps its debug flags in a global, so hold a lock for as long as the flags
+    // are in use. This allows shaders to be disassembled from several threads, such as the
+    // trace_stats batch workers and the divecli extract tasks.
+    static std::mutex           disasm_mutex;
+    std::lock_guard<std::mutex> lock(disasm_mutex);
+    disasm_a3xx_set_debug(debug);
+
     size_t code_size = max_size / sizeof(uint32_t);
     int    res = disasm_a3xx_stat(reinterpret_cast<uint32_t*>(const_cast<uint8_t*>(data)),
                                static_cast<int>(code_size),
@@ -113,6 +120,7 @@ void Disassembly::Disassemble()
 {
     if (!m_disassembled_data)
     {
+        DIVE_TRACE_SCOPE("DisassembleShader");
         DisassembledData disassembled_data;
         uint64_t         max_size = m_mem_manager.GetMaxContiguousSize(m_submit_index, m_address);
 
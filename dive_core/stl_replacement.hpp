@@ -14,6 +14,7 @@
  limitations under the License.
 */
 #include <algorithm>
+#include <memory>
 #include "common/common.h"
 
 namespace Dive
@@ -48,9 +49,10 @@ Vector<Type>::Vector(const Vector &a) :
 {
     // Do not call resize() directly, since it invokes default constructor
     // And not all classes have default constructors
+    // The reserved elements are not constructed, so copy-construct them rather than assign them
     reserve(a.m_size);
+    std::uninitialized_copy(a.m_buffer, a.m_buffer + a.m_size, m_buffer);
     m_size = a.m_size;
-    std::copy(a.m_buffer, a.m_buffer + a.m_size, m_buffer);
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -76,8 +78,8 @@ Vector<Type>::Vector(std::initializer_list<Type> a) :
     m_size(0)
 {
     reserve(a.size());
+    std::uninitialized_copy(a.begin(), a.end(), m_buffer);
     m_size = a.size();
-    std::copy(a.begin(), a.end(), m_buffer);
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -98,11 +100,8 @@ template<class Type> Vector<Type> &Vector<Type>::operator=(const Vector<Type> &a
 {
     if (&a != this)
     {
-        // Do not call resize() directly, since it invokes default constructor
-        // And not all classes have default constructors
-        reserve(a.m_size);
-        m_size = a.m_size;
-        std::copy(a.m_buffer, a.m_buffer + a.m_size, m_buffer);
+        // Copy-construct the elements, and destroy the current ones
+        *this = Vector<Type>(a);
     }
     return *this;
 }
@@ -112,6 +111,7 @@ template<class Type> Vector<Type> &Vector<Type>::operator=(Vector<Type> &&a)
 {
     if (&a != this)
     {
+        internal_clear();
         m_buffer = a.m_buffer;
         m_reserved = a.m_reserved;
         m_size = a.m_size;
@@ -16,7 +16,12 @@
 
 #include "dive_core/available_gpu_time.h"
 
+#include <cstddef>
+#include <cstring>
 #include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "gtest/gtest.h"
 
@@ -418,5 +423,147 @@ TEST(AvailableGpuTiming, GetCell_Fail)
     }
 }
 
+// Builds the content of a binary record file, a list of {object_type, ticks} per frame
+std::string MakeRecordData(
+const std::vector<std::vector<std::pair<AvailableGpuTiming::ObjectType, uint64_t>>>& frames,
+double timestamp_period_ns = 1000.0)
+{
+    GpuTimeRecordHeader header = {};
+    std::memcpy(header.magic, kGpuTimeRecordMagic, sizeof(header.magic));
+    header.version = kGpuTimeRecordVersion;
+    header.sample_size = sizeof(GpuTimeSample);
+    header.timestamp_period_ns = timestamp_period_ns;
+    std::string data(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    for (uint32_t frame_index = 0; frame_index < frames.size(); ++frame_index)
+    {
+        uint32_t next_ids[3] = {};
+        for (const auto& [object_type, ticks] : frames[frame_index])
+        {
+            GpuTimeSample sample = {};
+            sample.ticks = ticks;
+            sample.frame_index = frame_index;
+            sample.object_type = static_cast<uint8_t>(object_type);
+            sample.object_id = next_ids[sample.object_type]++;
+            data.append(reinterpret_cast<const char*>(&sample), sizeof(sample));
+        }
+    }
+    return data;
+}
+
+TEST(AvailableGpuTiming, LoadFromRecordData_Pass)
+{
+    using ObjectType = AvailableGpuTiming::ObjectType;
+    AvailableGpuTiming g;
+    // 1 tick = 1us
+    std::string data = MakeRecordData({
+    { { ObjectType::kFrame, 300 }, { ObjectType::kCommandBuffer, 300 } },
+    { { ObjectType::kFrame, 100 }, { ObjectType::kCommandBuffer, 100 } },
+    { { ObjectType::kFrame, 500 }, { ObjectType::kCommandBuffer, 500 } },
+    { { ObjectType::kFrame, 400 }, { ObjectType::kCommandBuffer, 400 } },
+    });
+    EXPECT_TRUE(g.LoadFromRecordData(data));
+    EXPECT_TRUE(g.IsValid());
+    EXPECT_EQ(g.GetRows(), 2);
+    EXPECT_EQ(g.GetTotalFrames(), 4u);
+
+    std::optional<AvailableGpuTiming::Stats> stats = g.GetStatsByType(ObjectType::kCommandBuffer,
+                                                                      0);
+    ASSERT_TRUE(stats.has_value());
+    EXPECT_FLOAT_EQ(stats->mean_ms, 0.325f);
+    EXPECT_FLOAT_EQ(stats->median_ms, 0.35f);
+    EXPECT_EQ(g.GetCell(1, 0), "CommandBuffer");
+    EXPECT_EQ(g.GetCell(1, 2), "0.325");
+
+    std::vector<double> samples = g.GetSamplesMs(ObjectType::kCommandBuffer, 0);
+    ASSERT_EQ(samples.size(), 4u);
+    EXPECT_DOUBLE_EQ(samples[0], 0.3);
+    EXPECT_DOUBLE_EQ(samples[3], 0.4);
+    EXPECT_TRUE(g.GetSamplesMs(ObjectType::kRenderPass, 0).empty());
+}
+
+TEST(AvailableGpuTiming, LoadFromRecordData_LayoutChangeRestartsStats)
+{
+    using ObjectType = AvailableGpuTiming::ObjectType;
+    AvailableGpuTiming g;
+    std::string data = MakeRecordData({
+    { { ObjectType::kFrame, 100 }, { ObjectType::kCommandBuffer, 100 } },
+    { { ObjectType::kFrame, 300 },
+      { ObjectType::kCommandBuffer, 100 },
+      { ObjectType::kRenderPass, 50 },
+      { ObjectType::kCommandBuffer, 200 } },
+    { { ObjectType::kFrame, 500 },
+      { ObjectType::kCommandBuffer, 300 },
+      { ObjectType::kRenderPass, 150 },
+      { ObjectType::kCommandBuffer, 200 } },
+    });
+    EXPECT_TRUE(g.LoadFromRecordData(data));
+    EXPECT_EQ(g.GetRows(), 4);
+    EXPECT_EQ(g.GetTotalFrames(), 2u);
+    EXPECT_EQ(g.GetCell(2, 0), "RenderPass");
+
+    std::optional<AvailableGpuTiming::Stats> stats = g.GetStatsByType(ObjectType::kRenderPass, 0);
+    ASSERT_TRUE(stats.has_value());
+    EXPECT_FLOAT_EQ(stats->mean_ms, 0.1f);
+    EXPECT_FLOAT_EQ(stats->median_ms, 0.1f);
+}
+
+TEST(AvailableGpuTiming, LoadFromRecordData_TruncatedLastFrameDropped)
+{
+    using ObjectType = AvailableGpuTiming::ObjectType;
+    std::string data = MakeRecordData({
+    { { ObjectType::kFrame, 300 }, { ObjectType::kCommandBuffer, 200 } },
+    { { ObjectType::kFrame, 100 }, { ObjectType::kCommandBuffer, 50 } },
+    { { ObjectType::kFrame, 500 }, { ObjectType::kCommandBuffer, 400 } },
+    });
+
+    // The replay was killed after the first sample of the last frame, and in the middle of the
+    // second one
+    AvailableGpuTiming g;
+    EXPECT_TRUE(g.LoadFromRecordData(data.substr(0, data.size() - sizeof(GpuTimeSample) / 2)));
+    EXPECT_TRUE(g.IsValid());
+    EXPECT_EQ(g.GetTotalFrames(), 2u);
+    EXPECT_EQ(g.GetDroppedFrames(), 1u);
+    EXPECT_EQ(g.GetRows(), 2);
+
+    std::vector<double> samples = g.GetSamplesMs(ObjectType::kCommandBuffer, 0);
+    ASSERT_EQ(samples.size(), 2u);
+    EXPECT_DOUBLE_EQ(samples[0], 0.2);
+    EXPECT_DOUBLE_EQ(samples[1], 0.05);
+
+    AvailableGpuTiming complete;
+    EXPECT_TRUE(complete.LoadFromRecordData(data));
+    EXPECT_EQ(complete.GetTotalFrames(), 3u);
+    EXPECT_EQ(complete.GetDroppedFrames(), 0u);
+}
+
+TEST(AvailableGpuTiming, LoadFromRecordData_MalformedFail)
+{
+    using ObjectType = AvailableGpuTiming::ObjectType;
+    std::string data = MakeRecordData({ { { ObjectType::kFrame, 100 } } });
+
+    AvailableGpuTiming no_header;
+    EXPECT_FALSE(no_header.LoadFromRecordData(data.substr(0, sizeof(GpuTimeRecordHeader) - 1)));
+    EXPECT_FALSE(no_header.IsValid());
+
+    AvailableGpuTiming bad_magic;
+    std::string        bad_magic_data = data;
+    bad_magic_data[0] = 'X';
+    EXPECT_FALSE(bad_magic.LoadFromRecordData(bad_magic_data));
+
+    AvailableGpuTiming bad_type;
+    std::string        bad_type_data = data;
+    bad_type_data[sizeof(GpuTimeRecordHeader) + offsetof(GpuTimeSample, object_type)] = 7;
+    EXPECT_FALSE(bad_type.LoadFromRecordData(bad_type_data));
+
+    AvailableGpuTiming no_samples;
+    EXPECT_FALSE(no_samples.LoadFromRecordData(data.substr(0, sizeof(GpuTimeRecordHeader))));
+
+    AvailableGpuTiming twice;
+    EXPECT_TRUE(twice.LoadFromRecordData(data));
+    EXPECT_FALSE(twice.LoadFromRecordData(data));
+    EXPECT_TRUE(twice.IsValid());
+}
+
 }  // namespace
 }  // namespace Dive
@@ -34,17 +34,46 @@ void PrintTo(const PerfMetricsRecord& record, std::ostream* os)
     *os << "  m_program_id: " << record.m_program_id << "," << std::endl;
     *os << "  m_draw_type: " << static_cast<int>(record.m_draw_type) << "," << std::endl;
     *os << "  m_lrz_state: " << static_cast<int>(record.m_lrz_state) << "," << std::endl;
-    *os << "  m_metric_values: [";
-    for (size_t i = 0; i < record.m_metric_values.size(); ++i)
+    *os << "}";
+}
+
+// A record with its values gathered from the metric columns.
+struct PerfMetricsRow
+{
+    PerfMetricsRecord   m_record;
+    std::vector<double> m_metric_values;
+};
+
+void PrintTo(const PerfMetricsRow& row, std::ostream* os)
+{
+    PrintTo(row.m_record, os);
+    *os << " m_metric_values: [";
+    for (size_t i = 0; i < row.m_metric_values.size(); ++i)
     {
-        *os << record.m_metric_values[i];
-        if (i < record.m_metric_values.size() - 1)
+        *os << row.m_metric_values[i];
+        if (i < row.m_metric_values.size() - 1)
         {
             *os << ", ";
         }
     }
-    *os << "]" << std::endl;
-    *os << "}";
+    *os << "]";
+}
+
+std::vector<PerfMetricsRow> GetRows(const std::vector<PerfMetricsRecord>& records,
+                                    const PerfMetricsColumns&             metric_columns)
+{
+    std::vector<PerfMetricsRow> rows;
+    for (size_t i = 0; i < records.size(); ++i)
+    {
+        PerfMetricsRow row{ records[i], {} };
+        for (const auto& column : metric_columns)
+        {
+            EXPECT_EQ(column.size(), records.size());
+            row.m_metric_values.push_back(column[i]);
+        }
+        rows.push_back(row);
+    }
+    return rows;
 }
 
 namespace
@@ -52,6 +81,8 @@ namespace
 
 using ::testing::AllOf;
 using ::testing::DoubleEq;
+using ::testing::DoubleNear;
+using ::testing::Each;
 using ::testing::ElementsAre;
 using ::testing::Field;
 using ::testing::FloatEq;
@@ -84,80 +115,81 @@ TEST(PerfMetricsData, LoadFromCsv)
                                                           *available_metrics);
     ASSERT_NE(perf_metrics_data, nullptr);
 
-    const auto& records = perf_metrics_data->GetRecords();
-    EXPECT_THAT(records,
+    const auto rows = GetRows(perf_metrics_data->GetRecords(),
+                              perf_metrics_data->GetMetricColumns());
+    EXPECT_THAT(rows,
                 ElementsAre(
                 // First incomplete frame
-                AllOf(PerfMetricsRecordEq(
-                      PerfMetricsRecord{ 1, 100, 999, 10001, 1, 1, 1, 7, 1, {} }),
-                      Field(&PerfMetricsRecord::m_metric_values,
+                AllOf(Field(&PerfMetricsRow::m_record,
+                      PerfMetricsRecordEq(PerfMetricsRecord{ 1, 100, 999, 10001, 1, 1, 1, 7, 1 })),
+                      Field(&PerfMetricsRow::m_metric_values,
                             ElementsAre(DoubleEq(2109), DoubleEq(2.109)))),
                 // First complete frame:
-                AllOf(PerfMetricsRecordEq(
-                      PerfMetricsRecord{ 1, 100, 1000, 10000, 1, 1, 1, 4, 1, {} }),
-                      Field(&PerfMetricsRecord::m_metric_values,
+                AllOf(Field(&PerfMetricsRow::m_record,
+                      PerfMetricsRecordEq(PerfMetricsRecord{ 1, 100, 1000, 10000, 1, 1, 1, 4, 1 })),
+                      Field(&PerfMetricsRow::m_metric_values,
                             ElementsAre(DoubleEq(1230), DoubleEq(1.230)))),
-                AllOf(PerfMetricsRecordEq(
-                      PerfMetricsRecord{ 1, 100, 1000, 10000, 2, 1, 1, 5, 1, {} }),
-                      Field(&PerfMetricsRecord::m_metric_values,
+                AllOf(Field(&PerfMetricsRow::m_record,
+                      PerfMetricsRecordEq(PerfMetricsRecord{ 1, 100, 1000, 10000, 2, 1, 1, 5, 1 })),
+                      Field(&PerfMetricsRow::m_metric_values,
                             ElementsAre(DoubleEq(1100), DoubleEq(1.100)))),
-                AllOf(PerfMetricsRecordEq(
-                      PerfMetricsRecord{ 1, 100, 1000, 10000, 3, 1, 1, 6, 1, {} }),
-                      Field(&PerfMetricsRecord::m_metric_values,
+                AllOf(Field(&PerfMetricsRow::m_record,
+                      PerfMetricsRecordEq(PerfMetricsRecord{ 1, 100, 1000, 10000, 3, 1, 1, 6, 1 })),
+                      Field(&PerfMetricsRow::m_metric_values,
                             ElementsAre(DoubleEq(1350), DoubleEq(1.350)))),
-                AllOf(PerfMetricsRecordEq(
-                      PerfMetricsRecord{ 1, 100, 1000, 10000, 1, 1, 1, 4, 1, {} }),
-                      Field(&PerfMetricsRecord::m_metric_values,
+                AllOf(Field(&PerfMetricsRow::m_record,
+                      PerfMetricsRecordEq(PerfMetricsRecord{ 1, 100, 1000, 10000, 1, 1, 1, 4, 1 })),
+                      Field(&PerfMetricsRow::m_metric_values,
                             ElementsAre(DoubleEq(1500), DoubleEq(1.500)))),
-                AllOf(PerfMetricsRecordEq(
-                      PerfMetricsRecord{ 1, 100, 1000, 10000, 2, 1, 1, 5, 1, {} }),
-                      Field(&PerfMetricsRecord::m_metric_values,
+                AllOf(Field(&PerfMetricsRow::m_record,
+                      PerfMetricsRecordEq(PerfMetricsRecord{ 1, 100, 1000, 10000, 2, 1, 1, 5, 1 })),
+                      Field(&PerfMetricsRow::m_metric_values,
                             ElementsAre(DoubleEq(1200), DoubleEq(1.300)))),
-                AllOf(PerfMetricsRecordEq(
-                      PerfMetricsRecord{ 1, 100, 1000, 10000, 3, 1, 1, 6, 1, {} }),
-                      Field(&PerfMetricsRecord::m_metric_values,
+                AllOf(Field(&PerfMetricsRow::m_record,
+                      PerfMetricsRecordEq(PerfMetricsRecord{ 1, 100, 1000, 10000, 3, 1, 1, 6, 1 })),
+                      Field(&PerfMetricsRow::m_metric_values,
                             ElementsAre(DoubleEq(1450), DoubleEq(1.450)))),
-                AllOf(PerfMetricsRecordEq(
-                      PerfMetricsRecord{ 1, 100, 1000, 10001, 1, 1, 1, 7, 1, {} }),
-                      Field(&PerfMetricsRecord::m_metric_values,
+                AllOf(Field(&PerfMetricsRow::m_record,
+                      PerfMetricsRecordEq(PerfMetricsRecord{ 1, 100, 1000, 10001, 1, 1, 1, 7, 1 })),
+                      Field(&PerfMetricsRow::m_metric_values,
                             ElementsAre(DoubleEq(2100), DoubleEq(2.100)))),
                 // Second complete frame:
-                AllOf(PerfMetricsRecordEq(
-                      PerfMetricsRecord{ 1, 100, 1001, 10000, 1, 1, 1, 4, 1, {} }),
-                      Field(&PerfMetricsRecord::m_metric_values,
+                AllOf(Field(&PerfMetricsRow::m_record,
+                      PerfMetricsRecordEq(PerfMetricsRecord{ 1, 100, 1001, 10000, 1, 1, 1, 4, 1 })),
+                      Field(&PerfMetricsRow::m_metric_values,
                             ElementsAre(DoubleEq(1232), DoubleEq(1.232)))),
-                AllOf(PerfMetricsRecordEq(
-                      PerfMetricsRecord{ 1, 100, 1001, 10000, 2, 1, 1, 5, 1, {} }),
-                      Field(&PerfMetricsRecord::m_metric_values,
+                AllOf(Field(&PerfMetricsRow::m_record,
+                      PerfMetricsRecordEq(PerfMetricsRecord{ 1, 100, 1001, 10000, 2, 1, 1, 5, 1 })),
+                      Field(&PerfMetricsRow::m_metric_values,
                             ElementsAre(DoubleEq(1102), DoubleEq(1.102)))),
-                AllOf(PerfMetricsRecordEq(
-                      PerfMetricsRecord{ 1, 100, 1001, 10000, 3, 1, 1, 6, 1, {} }),
-                      Field(&PerfMetricsRecord::m_metric_values,
+                AllOf(Field(&PerfMetricsRow::m_record,
+                      PerfMetricsRecordEq(PerfMetricsRecord{ 1, 100, 1001, 10000, 3, 1, 1, 6, 1 })),
+                      Field(&PerfMetricsRow::m_metric_values,
                             ElementsAre(DoubleEq(1352), DoubleEq(1.352)))),
-                AllOf(PerfMetricsRecordEq(
-                      PerfMetricsRecord{ 1, 100, 1001, 10000, 1, 1, 1, 4, 1, {} }),
-                      Field(&PerfMetricsRecord::m_metric_values,
+                AllOf(Field(&PerfMetricsRow::m_record,
+                      PerfMetricsRecordEq(PerfMetricsRecord{ 1, 100, 1001, 10000, 1, 1, 1, 4, 1 })),
+                      Field(&PerfMetricsRow::m_metric_values,
                             ElementsAre(DoubleEq(1502), DoubleEq(1.502)))),
-                AllOf(PerfMetricsRecordEq(
-                      PerfMetricsRecord{ 1, 100, 1001, 10000, 2, 1, 1, 5, 1, {} }),
-                      Field(&PerfMetricsRecord::m_metric_values,
+                AllOf(Field(&PerfMetricsRow::m_record,
+                      PerfMetricsRecordEq(PerfMetricsRecord{ 1, 100, 1001, 10000, 2, 1, 1, 5, 1 })),
+                      Field(&PerfMetricsRow::m_metric_values,
                             ElementsAre(DoubleEq(1202), DoubleEq(1.302)))),
-                AllOf(PerfMetricsRecordEq(
-                      PerfMetricsRecord{ 1, 100, 1001, 10000, 3, 1, 1, 6, 1, {} }),
-                      Field(&PerfMetricsRecord::m_metric_values,
+                AllOf(Field(&PerfMetricsRow::m_record,
+                      PerfMetricsRecordEq(PerfMetricsRecord{ 1, 100, 1001, 10000, 3, 1, 1, 6, 1 })),
+                      Field(&PerfMetricsRow::m_metric_values,
                             ElementsAre(DoubleEq(1452), DoubleEq(1.452)))),
-                AllOf(PerfMetricsRecordEq(
-                      PerfMetricsRecord{ 1, 100, 1001, 10001, 1, 1, 1, 7, 1, {} }),
-                      Field(&PerfMetricsRecord::m_metric_values,
+                AllOf(Field(&PerfMetricsRow::m_record,
+                      PerfMetricsRecordEq(PerfMetricsRecord{ 1, 100, 1001, 10001, 1, 1, 1, 7, 1 })),
+                      Field(&PerfMetricsRow::m_metric_values,
                             ElementsAre(DoubleEq(2102), DoubleEq(2.102)))),
                 // Incomplete frame at the end:
-                AllOf(PerfMetricsRecordEq(
-                      PerfMetricsRecord{ 1, 100, 1002, 10000, 1, 1, 1, 4, 1, {} }),
-                      Field(&PerfMetricsRecord::m_metric_values,
+                AllOf(Field(&PerfMetricsRow::m_record,
+                      PerfMetricsRecordEq(PerfMetricsRecord{ 1, 100, 1002, 10000, 1, 1, 1, 4, 1 })),
+                      Field(&PerfMetricsRow::m_metric_values,
                             ElementsAre(DoubleEq(1234), DoubleEq(1.234)))),
-                AllOf(PerfMetricsRecordEq(
-                      PerfMetricsRecord{ 1, 100, 1002, 10000, 2, 1, 1, 5, 1, {} }),
-                      Field(&PerfMetricsRecord::m_metric_values,
+                AllOf(Field(&PerfMetricsRow::m_record,
+                      PerfMetricsRecordEq(PerfMetricsRecord{ 1, 100, 1002, 10000, 2, 1, 1, 5, 1 })),
+                      Field(&PerfMetricsRow::m_metric_values,
                             ElementsAre(DoubleEq(1104), DoubleEq(1.104))))));
 
     ASSERT_THAT(perf_metrics_data->GetMetricNames(), ElementsAre("COUNTER_A", "COUNTER_B"));
@@ -182,10 +214,10 @@ TEST(PerfMetricsData, LoadFromCsvMalformedRowSkipped)
                                                           *available_metrics);
     ASSERT_NE(perf_metrics_data, nullptr);
     ASSERT_THAT(perf_metrics_data->GetRecords(), SizeIs(1));
-    EXPECT_THAT(perf_metrics_data->GetRecords(),
-                ElementsAre(AllOf(PerfMetricsRecordEq(
-                                  PerfMetricsRecord{ 2, 200, 2000, 20000, 2, 2, 2, 2, 2, {} }),
-                                  Field(&PerfMetricsRecord::m_metric_values,
+    EXPECT_THAT(GetRows(perf_metrics_data->GetRecords(), perf_metrics_data->GetMetricColumns()),
+                ElementsAre(AllOf(Field(&PerfMetricsRow::m_record,
+                                  PerfMetricsRecordEq(PerfMetricsRecord{ 2, 200, 2000, 20000, 2, 2, 2, 2, 2 })),
+                                  Field(&PerfMetricsRow::m_metric_values,
                                         ElementsAre(DoubleEq(456), DoubleEq(4.56))))));
 }
 
@@ -226,6 +258,72 @@ TEST(PerfMetricsData, LoadFromCsvUnknownMeticTypeSkipped)
     ASSERT_EQ(perf_metrics_data, nullptr);
 }
 
+TEST(PerfMetricsData, LoadFromCsvDataTrimsFields)
+{
+    auto available_metrics = AvailableMetrics::LoadFromCsv(TEST_DATA_DIR
+                                                           "/mock_available_metrics.csv");
+    ASSERT_NE(available_metrics, nullptr);
+
+    // Windows line endings, padded and quoted fields, and no newline at the end
+    auto perf_metrics_data = PerfMetricsData::LoadFromCsvData(
+    "ContextID,ProcessID,FrameID,CmdBufferID,DrawID,DrawType,DrawLabel,ProgramID,LRZState,"
+    "COUNTER_A,COUNTER_B\r\n"
+    " 1, 100 ,1000,10000,1,4,1,1,1,\"1230\",1.5\r\n"
+    "\r\n"
+    "1,100,1000,10000,2,5,1,1,1,1100,-2e3",
+    *available_metrics);
+    ASSERT_NE(perf_metrics_data, nullptr);
+    EXPECT_THAT(GetRows(perf_metrics_data->GetRecords(), perf_metrics_data->GetMetricColumns()),
+                ElementsAre(AllOf(Field(&PerfMetricsRow::m_record,
+                                        PerfMetricsRecordEq(
+                                        PerfMetricsRecord{ 1, 100, 1000, 10000, 1, 1, 1, 4, 1 })),
+                                  Field(&PerfMetricsRow::m_metric_values,
+                                        ElementsAre(DoubleEq(1230), DoubleEq(1.5)))),
+                            AllOf(Field(&PerfMetricsRow::m_record,
+                                        PerfMetricsRecordEq(
+                                        PerfMetricsRecord{ 1, 100, 1000, 10000, 2, 1, 1, 5, 1 })),
+                                  Field(&PerfMetricsRow::m_metric_values,
+                                        ElementsAre(DoubleEq(1100), DoubleEq(-2000))))));
+}
+
+TEST(PerfMetricsData, LoadFromCsvDataInParallel)
+{
+    auto available_metrics = AvailableMetrics::LoadFromCsv(TEST_DATA_DIR
+                                                           "/mock_available_metrics.csv");
+    ASSERT_NE(available_metrics, nullptr);
+
+    // Large enough to be split between several threads
+    constexpr uint32_t kRowCount = 400000;
+    std::string        csv = "ContextID,ProcessID,FrameID,CmdBufferID,DrawID,DrawType,DrawLabel,"
+                             "ProgramID,LRZState,COUNTER_A,COUNTER_B\n";
+    for (uint32_t i = 0; i < kRowCount; ++i)
+    {
+        csv += "1,100," + std::to_string(i / 10) + ",10000," + std::to_string(i % 10) +
+               ",1,1,1,1," + std::to_string(i) + "," + std::to_string(i) + ".5\n";
+        if (i == kRowCount / 2)
+        {
+            csv += "1,100,0,10000,1,1,1,1,1,bad-value,1.0\n";
+        }
+    }
+    ASSERT_GT(csv.size(), 8u * 1024 * 1024);
+
+    auto perf_metrics_data = PerfMetricsData::LoadFromCsvData(csv, *available_metrics);
+    ASSERT_NE(perf_metrics_data, nullptr);
+    const auto& records = perf_metrics_data->GetRecords();
+    const auto& columns = perf_metrics_data->GetMetricColumns();
+    ASSERT_THAT(records, SizeIs(kRowCount));
+    ASSERT_THAT(columns, SizeIs(2));
+    ASSERT_THAT(columns[0], SizeIs(kRowCount));
+    ASSERT_THAT(columns[1], SizeIs(kRowCount));
+    for (uint32_t i = 0; i < kRowCount; ++i)
+    {
+        ASSERT_EQ(records[i].m_frame_id, i / 10);
+        ASSERT_EQ(records[i].m_draw_id, i % 10);
+        ASSERT_EQ(columns[0][i], i);
+        ASSERT_EQ(perf_metrics_data->GetMetricValue(i, 1), i + 0.5);
+    }
+}
+
 std::unique_ptr<PerfMetricsDataProvider> CreateTestMetricProvider()
 {
     auto available_metrics = AvailableMetrics::LoadFromCsv(TEST_DATA_DIR
@@ -252,34 +350,84 @@ TEST(PerfMetricsDataProviderTest, GetComputedRecords)
     provider->Analyze(nullptr);
     const auto& computed_records = provider->GetComputedRecords();
     ASSERT_THAT(computed_records, SizeIs(7));
+    const auto computed_rows = GetRows(computed_records, provider->GetComputedMetricColumns());
 
     PerfMetricsRecord expected_record1{ 1, 100, 0, 10000, 1, 1, 1, 4, 1 };
     EXPECT_THAT(computed_records[0], PerfMetricsRecordEq(expected_record1));
-    EXPECT_THAT(computed_records[0].m_metric_values, ElementsAre(DoubleEq(1231), DoubleEq(1.231)));
+    EXPECT_THAT(computed_rows[0].m_metric_values, ElementsAre(DoubleEq(1231), DoubleEq(1.231)));
 
     PerfMetricsRecord expected_record2{ 1, 100, 0, 10000, 2, 1, 1, 5, 1 };
     EXPECT_THAT(computed_records[1], PerfMetricsRecordEq(expected_record2));
-    EXPECT_THAT(computed_records[1].m_metric_values, ElementsAre(DoubleEq(1101), DoubleEq(1.101)));
+    EXPECT_THAT(computed_rows[1].m_metric_values, ElementsAre(DoubleEq(1101), DoubleEq(1.101)));
 
     PerfMetricsRecord expected_record3{ 1, 100, 0, 10000, 3, 1, 1, 6, 1 };
     EXPECT_THAT(computed_records[2], PerfMetricsRecordEq(expected_record3));
-    EXPECT_THAT(computed_records[2].m_metric_values, ElementsAre(DoubleEq(1351), DoubleEq(1.351)));
+    EXPECT_THAT(computed_rows[2].m_metric_values, ElementsAre(DoubleEq(1351), DoubleEq(1.351)));
 
     PerfMetricsRecord expected_record4{ 1, 100, 0, 10000, 1, 1, 1, 4, 1 };
     EXPECT_THAT(computed_records[3], PerfMetricsRecordEq(expected_record4));
-    EXPECT_THAT(computed_records[3].m_metric_values, ElementsAre(DoubleEq(1501), DoubleEq(1.501)));
+    EXPECT_THAT(computed_rows[3].m_metric_values, ElementsAre(DoubleEq(1501), DoubleEq(1.501)));
 
     PerfMetricsRecord expected_record5{ 1, 100, 0, 10000, 2, 1, 1, 5, 1 };
     EXPECT_THAT(computed_records[4], PerfMetricsRecordEq(expected_record5));
-    EXPECT_THAT(computed_records[4].m_metric_values, ElementsAre(DoubleEq(1201), DoubleEq(1.301)));
+    EXPECT_THAT(computed_rows[4].m_metric_values, ElementsAre(DoubleEq(1201), DoubleEq(1.301)));
 
     PerfMetricsRecord expected_record6{ 1, 100, 0, 10000, 3, 1, 1, 6, 1 };
     EXPECT_THAT(computed_records[5], PerfMetricsRecordEq(expected_record6));
-    EXPECT_THAT(computed_records[5].m_metric_values, ElementsAre(DoubleEq(1451), DoubleEq(1.451)));
+    EXPECT_THAT(computed_rows[5].m_metric_values, ElementsAre(DoubleEq(1451), DoubleEq(1.451)));
 
     PerfMetricsRecord expected_record7{ 1, 100, 0, 10001, 1, 1, 1, 7, 1 };
     EXPECT_THAT(computed_records[6], PerfMetricsRecordEq(expected_record7));
-    EXPECT_THAT(computed_records[6].m_metric_values, ElementsAre(DoubleEq(2101), DoubleEq(2.101)));
+    EXPECT_THAT(computed_rows[6].m_metric_values, ElementsAre(DoubleEq(2101), DoubleEq(2.101)));
+}
+
+TEST(PerfMetricsDataProviderTest, GetComputedStatistics)
+{
+    auto provider = CreateTestMetricProvider();
+    ASSERT_NE(provider, nullptr);
+    provider->Analyze(nullptr);
+    const PerfMetricsStatistics& stats = provider->GetComputedStatistics();
+
+    // Frames 999 and 1002 are incomplete, only 1000 and 1001 are aggregated.
+    EXPECT_EQ(stats.m_frame_count, 2u);
+    ASSERT_THAT(stats.m_min, SizeIs(2));
+    ASSERT_THAT(stats.m_max, SizeIs(2));
+    ASSERT_THAT(stats.m_stddev, SizeIs(2));
+    EXPECT_THAT(stats.m_min[0], ElementsAre(1230, 1100, 1350, 1500, 1200, 1450, 2100));
+    EXPECT_THAT(stats.m_max[0], ElementsAre(1232, 1102, 1352, 1502, 1202, 1452, 2102));
+    EXPECT_THAT(stats.m_stddev[0], Each(DoubleEq(1)));
+    EXPECT_THAT(stats.m_stddev[1], Each(DoubleNear(0.001, 1e-9)));
+}
+
+TEST(PerfMetricsDataProviderTest, ReorderedFrameIsSkipped)
+{
+    auto available_metrics = AvailableMetrics::LoadFromCsv(TEST_DATA_DIR
+                                                           "/mock_available_metrics.csv");
+    ASSERT_NE(available_metrics, nullptr);
+
+    // Frame 1001 has the draws of the pattern, but not in the same order
+    auto perf_metrics_data = PerfMetricsData::LoadFromCsvData(
+    "ContextID,ProcessID,FrameID,CmdBufferID,DrawID,DrawType,DrawLabel,ProgramID,LRZState,"
+    "COUNTER_A,COUNTER_B\n"
+    "1,100,1000,10000,1,4,1,1,1,100,1\n"
+    "1,100,1000,10000,2,5,1,1,1,200,2\n"
+    "1,100,1000,10001,1,7,1,1,1,300,3\n"
+    "1,100,1001,10000,2,5,1,1,1,900,9\n"
+    "1,100,1001,10000,1,4,1,1,1,900,9\n"
+    "1,100,1001,10001,1,7,1,1,1,900,9\n"
+    "1,100,1002,10000,1,4,1,1,1,102,1\n"
+    "1,100,1002,10000,2,5,1,1,1,202,2\n"
+    "1,100,1002,10001,1,7,1,1,1,302,3\n",
+    *available_metrics);
+    ASSERT_NE(perf_metrics_data, nullptr);
+    auto provider = PerfMetricsDataProvider::CreateForTest(std::move(perf_metrics_data),
+                                                           std::move(available_metrics));
+    provider->Analyze(nullptr);
+
+    EXPECT_EQ(provider->GetComputedStatistics().m_frame_count, 2u);
+    ASSERT_THAT(provider->GetComputedMetricColumns(), SizeIs(2));
+    EXPECT_THAT(provider->GetComputedMetricColumns()[0],
+                ElementsAre(DoubleEq(101), DoubleEq(201), DoubleEq(301)));
 }
 
 TEST(PerfMetricsDataProviderTest, GetRecordHeader)
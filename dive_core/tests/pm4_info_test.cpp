@@ -0,0 +1,94 @@
+/*
+ Copyright 2025 Google LLC
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#include "pm4_info.h"
+
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace Dive
+{
+namespace
+{
+
+class Pm4InfoTest : public ::testing::Test
+{
+protected:
+    static void SetUpTestSuite() { Pm4InfoInit(); }
+};
+
+TEST_F(Pm4InfoTest, GPUIDIsPerThread)
+{
+    SetGPUID(640);
+    std::thread([] {
+        // A thread that never set a GPU uses the one set last
+        EXPECT_EQ(GetGPUID(), 640u);
+        SetGPUID(740);
+        EXPECT_EQ(GetGPUID(), 740u);
+        EXPECT_EQ(GetGPUVariantType(), kA7XX);
+    }).join();
+
+    EXPECT_EQ(GetGPUID(), 640u);
+    EXPECT_EQ(GetGPUVariantType(), kA6XX);
+    std::thread([] {
+        EXPECT_EQ(GetGPUID(), 740u);
+        EXPECT_EQ(GetGPUVariantType(), kA7XX);
+    }).join();
+}
+
+// Threads decoding captures of different GPUs must each look up the registers of their own GPU
+TEST_F(Pm4InfoTest, ConcurrentGPUsKeepTheirRegisters)
+{
+    const uint32_t kGPUIds[] = { 640, 740 };
+    uint32_t       expected_offsets[2] = {};
+    for (int i = 0; i < 2; ++i)
+    {
+        SetGPUID(kGPUIds[i]);
+        expected_offsets[i] = GetRegOffsetByName("HLSQ_CS_CNTL");
+    }
+    // The register moved between the a6xx and the a7xx
+    ASSERT_NE(expected_offsets[0], kInvalidRegOffset);
+    ASSERT_NE(expected_offsets[1], kInvalidRegOffset);
+    ASSERT_NE(expected_offsets[0], expected_offsets[1]);
+
+    std::vector<std::thread> threads;
+    std::vector<int>         mismatches(8, 0);
+    for (size_t t = 0; t < mismatches.size(); ++t)
+    {
+        threads.emplace_back([&, t] {
+            const uint32_t index = t % 2;
+            for (int i = 0; i < 1000; ++i)
+            {
+                SetGPUID(kGPUIds[index]);
+                if ((GetGPUVariantType() != (index ? kA7XX : kA6XX)) ||
+                    (GetRegOffsetByName("HLSQ_CS_CNTL") != expected_offsets[index]))
+                {
+                    mismatches[t]++;
+                }
+            }
+        });
+    }
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+    EXPECT_EQ(mismatches, std::vector<int>(mismatches.size(), 0));
+}
+
+}  // namespace
+}  // namespace Dive
@@ -0,0 +1,433 @@
+/*
+ Copyright 2025 Google LLC
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#include "dump_call_scanner.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+#include "gfxr_ext/decode/dive_block_index.h"
+
+#include "third_party/gfxreconstruct/framework/decode/api_decoder.h"
+#include "third_party/gfxreconstruct/framework/decode/struct_pointer_decoder.h"
+#include "third_party/gfxreconstruct/framework/format/format_util.h"
+#include "third_party/gfxreconstruct/framework/generated/generated_vulkan_consumer.h"
+#include "third_party/gfxreconstruct/framework/generated/generated_vulkan_decoder.h"
+#include "third_party/gfxreconstruct/framework/generated/generated_vulkan_struct_decoders.h"
+#include "third_party/gfxreconstruct/framework/util/compressor.h"
+#include "third_party/gfxreconstruct/framework/util/platform.h"
+
+namespace Dive::gfxr
+{
+
+namespace
+{
+
+using gfxrecon::format::ApiCallId;
+
+// Number of blocks read by a worker at once. The blocks of a task are read in file order.
+constexpr size_t kBlocksPerTask = 1024;
+
+// Records the calls decoded by a VulkanDecoder as DumpCalls.
+class DumpCallCollector : public gfxrecon::decode::VulkanConsumer
+{
+public:
+    void SetOutput(std::vector<DumpCall>* calls) { calls_ = calls; }
+
+    void Process_vkBeginCommandBuffer(
+    const gfxrecon::decode::ApiCallInfo& call_info,
+    VkResult                             returnValue,
+    gfxrecon::format::HandleId           commandBuffer,
+    gfxrecon::decode::StructPointerDecoder<gfxrecon::decode::Decoded_VkCommandBufferBeginInfo>*
+    pBeginInfo) override
+    {
+        Add(call_info, ApiCallId::ApiCall_vkBeginCommandBuffer, commandBuffer);
+    }
+
+    void Process_vkCmdBeginRenderPass(
+    const gfxrecon::decode::ApiCallInfo& call_info,
+    gfxrecon::format::HandleId           commandBuffer,
+    gfxrecon::decode::StructPointerDecoder<gfxrecon::decode::Decoded_VkRenderPassBeginInfo>*
+                      pRenderPassBegin,
+    VkSubpassContents contents) override
+    {
+        Add(call_info, ApiCallId::ApiCall_vkCmdBeginRenderPass, commandBuffer);
+    }
+
+    void Process_vkCmdBeginRenderPass2KHR(
+    const gfxrecon::decode::ApiCallInfo& call_info,
+    gfxrecon::format::HandleId           commandBuffer,
+    gfxrecon::decode::StructPointerDecoder<gfxrecon::decode::Decoded_VkRenderPassBeginInfo>*
+    pRenderPassBegin,
+    gfxrecon::decode::StructPointerDecoder<gfxrecon::decode::Decoded_VkSubpassBeginInfo>*
+    pSubpassBeginInfo) override
+    {
+        Add(call_info, ApiCallId::ApiCall_vkCmdBeginRenderPass2KHR, commandBuffer);
+    }
+
+    void Process_vkCmdDraw(const gfxrecon::decode::ApiCallInfo& call_info,
+                           gfxrecon::format::HandleId           commandBuffer,
+                           uint32_t                             vertexCount,
+                           uint32_t                             instanceCount,
+                           uint32_t                             firstVertex,
+                           uint32_t                             firstInstance) override
+    {
+        Add(call_info, ApiCallId::ApiCall_vkCmdDraw, commandBuffer);
+    }
+
+    void Process_vkCmdDrawIndexed(const gfxrecon::decode::ApiCallInfo& call_info,
+                                  gfxrecon::format::HandleId           commandBuffer,
+                                  uint32_t                             indexCount,
+                                  uint32_t                             instanceCount,
+                                  uint32_t                             firstIndex,
+                                  int32_t                              vertexOffset,
+                                  uint32_t                             firstInstance) override
+    {
+        Add(call_info, ApiCallId::ApiCall_vkCmdDrawIndexed, commandBuffer);
+    }
+
+    void Process_vkCmdEndRenderPass(const gfxrecon::decode::ApiCallInfo& call_info,
+                                    gfxrecon::format::HandleId           commandBuffer) override
+    {
+        Add(call_info, ApiCallId::ApiCall_vkCmdEndRenderPass, commandBuffer);
+    }
+
+    void Process_vkCmdEndRenderPass2KHR(
+    const gfxrecon::decode::ApiCallInfo& call_info,
+    gfxrecon::format::HandleId           commandBuffer,
+    gfxrecon::decode::StructPointerDecoder<gfxrecon::decode::Decoded_VkSubpassEndInfo>*
+    pSubpassEndInfo) override
+    {
+        Add(call_info, ApiCallId::ApiCall_vkCmdEndRenderPass2KHR, commandBuffer);
+    }
+
+    void Process_vkQueueSubmit(
+    const gfxrecon::decode::ApiCallInfo&                                            call_info,
+    VkResult                                                                        returnValue,
+    gfxrecon::format::HandleId                                                      queue,
+    uint32_t                                                                        submitCount,
+    gfxrecon::decode::StructPointerDecoder<gfxrecon::decode::Decoded_VkSubmitInfo>* pSubmits,
+    gfxrecon::format::HandleId                                                      fence) override
+    {
+        if (pSubmits == nullptr || pSubmits->IsNull())
+        {
+            return;
+        }
+        uint32_t submit_position = 0;
+        for (uint32_t submit_index = 0; submit_index < submitCount; submit_index++)
+        {
+            const gfxrecon::decode::Decoded_VkSubmitInfo&
+            submit = pSubmits->GetMetaStructPointer()[submit_index];
+            uint32_t command_buffer_count = pSubmits->GetPointer()[submit_index].commandBufferCount;
+            for (uint32_t command_buffer_index = 0; command_buffer_index < command_buffer_count;
+                 command_buffer_index++)
+            {
+                Add(call_info,
+                    ApiCallId::ApiCall_vkQueueSubmit,
+                    submit.pCommandBuffers.GetPointer()[command_buffer_index],
+                    submit_position++);
+            }
+        }
+    }
+
+private:
+    void Add(const gfxrecon::decode::ApiCallInfo& call_info,
+             ApiCallId                            call_id,
+             gfxrecon::format::HandleId           command_buffer,
+             uint32_t                             submit_position = 0)
+    {
+        calls_->push_back(
+        DumpCall{ call_info.index, call_info.thread_id, call_id, command_buffer, submit_position });
+    }
+
+    std::vector<DumpCall>* calls_ = nullptr;
+};
+
+// Reads function call blocks at random offsets of a .gfxr file and decodes them into DumpCalls.
+// Each worker thread has its own reader.
+class DumpCallReader
+{
+public:
+    DumpCallReader() { decoder_.AddConsumer(&collector_); }
+    ~DumpCallReader()
+    {
+        if (file_ != nullptr)
+        {
+            gfxrecon::util::platform::FileClose(file_);
+        }
+    }
+    DumpCallReader(const DumpCallReader&) = delete;
+    DumpCallReader& operator=(const DumpCallReader&) = delete;
+
+    bool Open(const char* filename, gfxrecon::format::CompressionType compression_type)
+    {
+        int result = gfxrecon::util::platform::FileOpen(&file_, filename, "rb");
+        if (result || file_ == nullptr)
+        {
+            file_ = nullptr;
+            std::cerr << "Failed to open input:" << filename << '\n';
+            return false;
+        }
+        if (compression_type != gfxrecon::format::CompressionType::kNone)
+        {
+            compressor_.reset(gfxrecon::format::CreateCompressor(compression_type));
+            if (compressor_ == nullptr)
+            {
+                std::cerr << "Unsupported compression type "
+                          << static_cast<uint32_t>(compression_type) << " in "
+                          << filename << '\n';
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool ReadBlock(uint64_t                                block_index,
+                   const gfxrecon::decode::DiveBlockIndex& index,
+                   std::vector<DumpCall>*                  calls)
+    {
+        const gfxrecon::decode::DiveBlockIndexEntry& entry = index.GetBlock(block_index);
+        block_buffer_.resize(entry.size);
+        if (!gfxrecon::util::platform::FileSeek(file_,
+                                                static_cast<int64_t>(entry.offset),
+                                                gfxrecon::util::platform::FileSeekSet) ||
+            !gfxrecon::util::platform::FileRead(block_buffer_.data(), block_buffer_.size(), file_))
+        {
+            std::cerr << "Failed to read block " << block_index << '\n';
+            return false;
+        }
+
+        // Same layout as read by FileProcessor::ProcessFunctionCall()
+        const bool is_compressed = gfxrecon::format::IsBlockCompressed(
+        static_cast<gfxrecon::format::BlockType>(entry.block_type));
+        size_t header_size = sizeof(gfxrecon::format::BlockHeader) + sizeof(ApiCallId) +
+                             sizeof(gfxrecon::format::ThreadId);
+        if (is_compressed)
+        {
+            header_size += sizeof(uint64_t);
+        }
+        if (block_buffer_.size() < header_size)
+        {
+            std::cerr << "Truncated block " << block_index << '\n';
+            return false;
+        }
+
+        const uint8_t*                data = block_buffer_.data();
+        gfxrecon::decode::ApiCallInfo call_info = {};
+        gfxrecon::format::ApiCallId   call_id = ApiCallId::ApiCall_Unknown;
+        const size_t                  call_id_offset = sizeof(gfxrecon::format::BlockHeader);
+        const size_t                  thread_id_offset = call_id_offset + sizeof(call_id);
+        std::memcpy(&call_id, data + call_id_offset, sizeof(call_id));
+        std::memcpy(&call_info.thread_id, data + thread_id_offset, sizeof(call_info.thread_id));
+        call_info.index = block_index;
+
+        const uint8_t* parameter_buffer = data + header_size;
+        size_t         parameter_buffer_size = block_buffer_.size() - header_size;
+        if (is_compressed)
+        {
+            uint64_t uncompressed_size = 0;
+            std::memcpy(&uncompressed_size,
+                        data + header_size - sizeof(uncompressed_size),
+                        sizeof(uncompressed_size));
+            compressed_buffer_.assign(parameter_buffer, parameter_buffer + parameter_buffer_size);
+            if (compressor_ == nullptr ||
+                compressor_->Decompress(parameter_buffer_size,
+                                        compressed_buffer_,
+                                        static_cast<size_t>(uncompressed_size),
+                                        &uncompressed_buffer_) != uncompressed_size)
+            {
+                std::cerr << "Failed to decompress block " << block_index << '\n';
+                return false;
+            }
+            parameter_buffer = uncompressed_buffer_.data();
+            parameter_buffer_size = static_cast<size_t>(uncompressed_size);
+        }
+
+        collector_.SetOutput(calls);
+        decoder_.DecodeFunctionCall(call_id, call_info, parameter_buffer, parameter_buffer_size);
+        return true;
+    }
+
+private:
+    std::FILE*                                  file_ = nullptr;
+    std::unique_ptr<gfxrecon::util::Compressor> compressor_;
+    gfxrecon::decode::VulkanDecoder             decoder_;
+    DumpCallCollector                           collector_;
+    std::vector<uint8_t>                        block_buffer_;
+    std::vector<uint8_t>                        compressed_buffer_;
+    std::vector<uint8_t>                        uncompressed_buffer_;
+};
+
+// Reads the compression type from the file options, as FileProcessor does.
+bool ReadCompressionType(const char* filename, gfxrecon::format::CompressionType* compression_type)
+{
+    std::FILE* file = nullptr;
+    int        result = gfxrecon::util::platform::FileOpen(&file, filename, "rb");
+    if (result || file == nullptr)
+    {
+        std::cerr << "Failed to open input:" << filename << '\n';
+        return false;
+    }
+
+    *compression_type = gfxrecon::format::CompressionType::kNone;
+    gfxrecon::format::FileHeader file_header = {};
+    bool success = gfxrecon::util::platform::FileRead(&file_header, sizeof(file_header), file) &&
+                   gfxrecon::format::ValidateFileHeader(file_header);
+    for (uint32_t i = 0; success && i < file_header.num_options; ++i)
+    {
+        gfxrecon::format::FileOptionPair option = {};
+        success = gfxrecon::util::platform::FileRead(&option, sizeof(option), file);
+        if (success && option.key == gfxrecon::format::FileOption::kCompressionType)
+        {
+            *compression_type = static_cast<gfxrecon::format::CompressionType>(option.value);
+        }
+    }
+    gfxrecon::util::platform::FileClose(file);
+
+    if (!success)
+    {
+        std::cerr << "Failed to read file header of " << filename << '\n';
+    }
+    return success;
+}
+
+}  // namespace
+
+bool IsDumpCall(uint32_t call_id)
+{
+    switch (call_id)
+    {
+    case ApiCallId::ApiCall_vkBeginCommandBuffer:
+    case ApiCallId::ApiCall_vkCmdBeginRenderPass:
+    case ApiCallId::ApiCall_vkCmdBeginRenderPass2KHR:
+    case ApiCallId::ApiCall_vkCmdDraw:
+    case ApiCallId::ApiCall_vkCmdDrawIndexed:
+    case ApiCallId::ApiCall_vkCmdEndRenderPass:
+    case ApiCallId::ApiCall_vkCmdEndRenderPass2KHR:
+    case ApiCallId::ApiCall_vkQueueSubmit:
+        return true;
+    default:
+        return false;
+    }
+}
+
+std::optional<std::vector<DumpCall>> ScanDumpCalls(
+const char*                             filename,
+const gfxrecon::decode::DiveBlockIndex& block_index,
+const std::vector<uint64_t>&            block_indices,
+uint32_t                                num_workers)
+{
+    gfxrecon::format::CompressionType compression_type = gfxrecon::format::CompressionType::kNone;
+    if (!ReadCompressionType(filename, &compression_type))
+    {
+        return std::nullopt;
+    }
+
+    const size_t num_tasks = (block_indices.size() + kBlocksPerTask - 1) / kBlocksPerTask;
+    std::vector<std::vector<DumpCall>> task_calls(num_tasks);
+    std::atomic<size_t>                next_task{ 0 };
+    std::atomic<bool>                  failed{ false };
+    auto                               worker = [&]() {
+        DumpCallReader reader;
+        if (!reader.Open(filename, compression_type))
+        {
+            failed = true;
+            return;
+        }
+        for (size_t task = next_task++; task < num_tasks && !failed; task = next_task++)
+        {
+            size_t begin = task * kBlocksPerTask;
+            size_t end = std::min(begin + kBlocksPerTask, block_indices.size());
+            for (size_t i = begin; i < end; ++i)
+            {
+                if (!reader.ReadBlock(block_indices[i], block_index, &task_calls[task]))
+                {
+                    failed = true;
+                    return;
+                }
+            }
+        }
+    };
+
+    num_workers = static_cast<uint32_t>(std::min<size_t>(std::max(num_workers, 1u), num_tasks));
+    std::vector<std::thread> threads;
+    for (uint32_t i = 1; i < num_workers; ++i)
+    {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    if (failed)
+    {
+        return std::nullopt;
+    }
+
+    std::vector<DumpCall> calls;
+    for (std::vector<DumpCall>& task : task_calls)
+    {
+        calls.insert(calls.end(), task.begin(), task.end());
+    }
+    return calls;
+}
+
+void ReplayDumpCall(const DumpCall& call, DumpResourcesBuilderConsumer& consumer)
+{
+    gfxrecon::decode::ApiCallInfo call_info = {};
+    call_info.index = call.block_index;
+    call_info.thread_id = call.thread_id;
+    switch (call.call_id)
+    {
+    case ApiCallId::ApiCall_vkBeginCommandBuffer:
+        consumer.Process_vkBeginCommandBuffer(call_info, VK_SUCCESS, call.command_buffer, nullptr);
+        break;
+    case ApiCallId::ApiCall_vkCmdBeginRenderPass:
+        consumer.Process_vkCmdBeginRenderPass(call_info,
+                                              call.command_buffer,
+                                              nullptr,
+                                              VK_SUBPASS_CONTENTS_INLINE);
+        break;
+    case ApiCallId::ApiCall_vkCmdBeginRenderPass2KHR:
+        consumer.Process_vkCmdBeginRenderPass2KHR(call_info, call.command_buffer, nullptr, nullptr);
+        break;
+    case ApiCallId::ApiCall_vkCmdDraw:
+        consumer.Process_vkCmdDraw(call_info, call.command_buffer, 0, 0, 0, 0);
+        break;
+    case ApiCallId::ApiCall_vkCmdDrawIndexed:
+        consumer.Process_vkCmdDrawIndexed(call_info, call.command_buffer, 0, 0, 0, 0, 0);
+        break;
+    case ApiCallId::ApiCall_vkCmdEndRenderPass:
+        consumer.Process_vkCmdEndRenderPass(call_info, call.command_buffer);
+        break;
+    case ApiCallId::ApiCall_vkCmdEndRenderPass2KHR:
+        consumer.Process_vkCmdEndRenderPass2KHR(call_info, call.command_buffer, nullptr);
+        break;
+    case ApiCallId::ApiCall_vkQueueSubmit:
+        consumer.ProcessSubmittedCommandBuffer(call_info, call.command_buffer);
+        break;
+    default:
+        break;
+    }
+}
+
+}  // namespace Dive::gfxr
@@ -0,0 +1,68 @@
+/*
+ Copyright 2025 Google LLC
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "dump_resources_builder_consumer.h"
+
+#include "third_party/gfxreconstruct/framework/format/api_call_id.h"
+#include "third_party/gfxreconstruct/framework/format/format.h"
+
+namespace gfxrecon::decode
+{
+class DiveBlockIndex;
+}  // namespace gfxrecon::decode
+
+namespace Dive::gfxr
+{
+
+// A Vulkan call handled by DumpResourcesBuilderConsumer, reduced to what the state machine uses.
+// A vkQueueSubmit is split into one DumpCall per submitted command buffer.
+struct DumpCall
+{
+    uint64_t                    block_index = 0;
+    gfxrecon::format::ThreadId  thread_id = 0;
+    gfxrecon::format::ApiCallId call_id = gfxrecon::format::ApiCallId::ApiCall_Unknown;
+    gfxrecon::format::HandleId  command_buffer = gfxrecon::format::kNullHandleId;
+    // Position of command_buffer among all the command buffers of its vkQueueSubmit, 0 for other
+    // calls. Used to emit the DumpEntry's of a submit in submission order.
+    uint32_t submit_position = 0;
+};
+
+// Whether DumpResourcesBuilderConsumer processes calls with this id. Other function call blocks
+// can be skipped from their header alone.
+bool IsDumpCall(uint32_t call_id);
+
+// Reads and decodes the function call blocks `block_indices` of a .gfxr file, located with
+// `block_index`, on up to `num_workers` threads. `block_indices` must be sorted; the returned calls
+// are in the same order.
+//
+// Returns std::nullopt on error.
+std::optional<std::vector<DumpCall>> ScanDumpCalls(
+const char*                             filename,
+const gfxrecon::decode::DiveBlockIndex& block_index,
+const std::vector<uint64_t>&            block_indices,
+uint32_t                                num_workers);
+
+// Forwards `call` to `consumer` as if it was decoded from the capture. The call only carries what
+// the state machine uses, so all other parameters are null.
+void ReplayDumpCall(const DumpCall& call, DumpResourcesBuilderConsumer& consumer);
+
+}  // namespace Dive::gfxr
@@ -164,21 +164,33 @@ gfxrecon::format::HandleId
     {
         const gfxrecon::decode::Decoded_VkSubmitInfo&
         submit = pSubmits->GetMetaStructPointer()[submit_index];
-        for (uint32_t command_buffer_index = 0;
-             command_buffer_index < pSubmits->GetPointer()->commandBufferCount;
+        uint32_t command_buffer_count = pSubmits->GetPointer()[submit_index].commandBufferCount;
+        for (uint32_t command_buffer_index = 0; command_buffer_index < command_buffer_count;
              command_buffer_index++)
         {
             gfxrecon::format::HandleId command_buffer_id = submit.pCommandBuffers
                                                            .GetPointer()[command_buffer_index];
-            GFXRECON_LOG_DEBUG("... for commandBuffer=%lu", command_buffer_id);
-            InvokeIfFound(command_buffer_id, [&](gfxrecon::decode::VulkanConsumer& consumer) {
-                consumer
-                .Process_vkQueueSubmit(call_info, returnValue, queue, submitCount, pSubmits, fence);
-            });
+            ProcessSubmittedCommandBuffer(call_info, command_buffer_id);
         }
     }
 }
 
+void DumpResourcesBuilderConsumer::ProcessSubmittedCommandBuffer(
+const gfxrecon::decode::ApiCallInfo& call_info,
+gfxrecon::format::HandleId           command_buffer)
+{
+    GFXRECON_LOG_DEBUG("... for commandBuffer=%lu", command_buffer);
+    InvokeIfFound(command_buffer, [&](gfxrecon::decode::VulkanConsumer& consumer) {
+        // InvokeIfFound() matched the command buffer, the state only needs the block index.
+        consumer.Process_vkQueueSubmit(call_info,
+                                       VK_SUCCESS,
+                                       gfxrecon::format::kNullHandleId,
+                                       0,
+                                       nullptr,
+                                       gfxrecon::format::kNullHandleId);
+    });
+}
+
 void DumpResourcesBuilderConsumer::InvokeIfFound(
 gfxrecon::format::HandleId                                    command_buffer,
 const std::function<void(gfxrecon::decode::VulkanConsumer&)>& function)
@@ -98,6 +98,12 @@ public:
     gfxrecon::decode::StructPointerDecoder<gfxrecon::decode::Decoded_VkSubmitInfo>* pSubmits,
     gfxrecon::format::HandleId                                                      fence) override;
 
+    // Processes a vkQueueSubmit for one of its command buffers. Process_vkQueueSubmit calls this
+    // for each submitted command buffer; it is also used to replay calls scanned without a full
+    // decode (see ScanDumpCalls).
+    void ProcessSubmittedCommandBuffer(const gfxrecon::decode::ApiCallInfo& call_info,
+                                       gfxrecon::format::HandleId           command_buffer);
+
 private:
     // Run `function` if we're processing state for `command_buffer` (i.e. vkBeginCommandBuffer has
     // been called). If we're not processing state for `command_buffer` then `function` is not
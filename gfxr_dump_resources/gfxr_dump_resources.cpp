@@ -16,21 +16,122 @@
 
 #include "gfxr_dump_resources.h"
 
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <iterator>
 #include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
+#include "dump_call_scanner.h"
 #include "dump_entry.h"
 #include "dump_resources_builder_consumer.h"
+#include "gfxr_ext/decode/dive_block_index.h"
 
 #include "third_party/gfxreconstruct/framework/decode/file_processor.h"
+#include "third_party/gfxreconstruct/framework/format/format_util.h"
 #include "third_party/gfxreconstruct/framework/generated/generated_vulkan_decoder.h"
 
 namespace Dive::gfxr
 {
 
-std::optional<std::vector<DumpEntry>> FindDumpableResources(const char* filename)
+namespace
+{
+
+// Accumulates the output in memory and writes it to the file in large chunks.
+class BufferedFileWriter
+{
+public:
+    ~BufferedFileWriter() { Close(); }
+
+    bool Open(const char* filename)
+    {
+        file_ = std::fopen(filename, "wb");
+        good_ = (file_ != nullptr);
+        buffer_.reserve(kBufferSize);
+        return good_;
+    }
+
+    void Write(char c)
+    {
+        buffer_.push_back(c);
+        FlushIfFull();
+    }
+
+    void Write(std::string_view str)
+    {
+        buffer_.append(str);
+        FlushIfFull();
+    }
+
+    void WriteUint(uint64_t value)
+    {
+        char digits[20];
+        auto result = std::to_chars(std::begin(digits), std::end(digits), value);
+        Write(std::string_view(digits, result.ptr - digits));
+    }
+
+    void WriteBytes(const void* data, size_t size)
+    {
+        Write(std::string_view(static_cast<const char*>(data), size));
+    }
+
+    // Flushes the buffer and closes the file. Returns false if any write failed.
+    bool Close()
+    {
+        if (file_ == nullptr)
+        {
+            return good_;
+        }
+        Flush();
+        good_ = (std::fclose(file_) == 0) && good_;
+        file_ = nullptr;
+        return good_;
+    }
+
+private:
+    static constexpr size_t kBufferSize = 1 << 20;
+
+    void FlushIfFull()
+    {
+        if (buffer_.size() >= kBufferSize)
+        {
+            Flush();
+        }
+    }
+
+    void Flush()
+    {
+        if (!buffer_.empty() &&
+            std::fwrite(buffer_.data(), 1, buffer_.size(), file_) != buffer_.size())
+        {
+            good_ = false;
+        }
+        buffer_.clear();
+    }
+
+    std::FILE*  file_ = nullptr;
+    bool        good_ = false;
+    std::string buffer_;
+};
+
+// A complete DumpEntry, and the position of its command buffer in the vkQueueSubmit completing it.
+struct FoundDumpEntry
+{
+    uint32_t  submit_position = 0;
+    DumpEntry dump_entry;
+};
+
+// Decodes every block of the capture.
+std::optional<std::vector<DumpEntry>> FindDumpableResourcesWithFullDecode(const char* filename)
 {
     gfxrecon::decode::FileProcessor file_processor;
     if (!file_processor.Initialize(filename))
@@ -53,90 +154,225 @@ std::optional<std::vector<DumpEntry>> FindDumpableResources(const char* filename
     return complete_dump_entries;
 }
 
-bool SaveAsJsonFile(const std::vector<DumpEntry>& dumpables, const char* filename)
+}  // namespace
+
+std::optional<std::vector<DumpEntry>> FindDumpableResources(const char* filename)
 {
-    std::ofstream out(filename);
-    if (!out.good() || !out.is_open())
+    // Only a few calls matter, so their blocks are picked from the block headers and only those are
+    // decoded.
+    gfxrecon::decode::DiveBlockIndex block_index;
+    if (!block_index.Build(filename))
     {
-        std::cerr << "Failed to open output:" << filename << '\n';
-        return false;
+        return FindDumpableResourcesWithFullDecode(filename);
     }
 
-    out << "{\n";
-
-    out << "  \"BeginCommandBuffer\": [";
-    for (int i = 0; i < dumpables.size(); ++i)
+    std::vector<uint64_t> block_indices;
+    for (uint64_t i = 0; i < block_index.GetBlockCount(); ++i)
     {
-        const DumpEntry& entry = dumpables[i];
-        if (i != 0)
+        const gfxrecon::decode::DiveBlockIndexEntry& block = block_index.GetBlock(i);
+        if (block.IsInAssetFile())
         {
-            out << ',';
+            // The headers of the blocks executed from an asset file aren't indexed.
+            return FindDumpableResourcesWithFullDecode(filename);
         }
-        out << entry.begin_command_buffer_block_index;
+        if ((gfxrecon::format::RemoveCompressedBlockBit(block.block_type) ==
+             gfxrecon::format::BlockType::kFunctionCallBlock) &&
+            IsDumpCall(block.id))
+        {
+            block_indices.push_back(i);
+        }
+    }
+
+    const uint32_t num_workers = std::max(std::thread::hardware_concurrency(), 1u);
+    std::optional<std::vector<DumpCall>> calls = ScanDumpCalls(filename,
+                                                               block_index,
+                                                               block_indices,
+                                                               num_workers);
+    if (!calls.has_value())
+    {
+        return std::nullopt;
     }
-    out << "],\n";
 
-    out << "  \"RenderPass\": [";
-    for (int i = 0; i < dumpables.size(); ++i)
+    // Command buffers are tracked independently by DumpResourcesBuilderConsumer, so the calls of
+    // each command buffer are replayed on their own, in parallel.
+    std::unordered_map<gfxrecon::format::HandleId, size_t> command_buffer_slots;
+    std::vector<std::vector<DumpCall>>                     command_buffer_calls;
+    for (const DumpCall& call : *calls)
     {
-        const DumpEntry& entry = dumpables[i];
-        if (i != 0)
+        auto [it, inserted] = command_buffer_slots.try_emplace(call.command_buffer,
+                                                               command_buffer_calls.size());
+        if (inserted)
         {
-            out << ',';
+            command_buffer_calls.emplace_back();
         }
-        out << '[';
-        for (int ii = 0; ii < entry.render_passes.size(); ++ii)
+        command_buffer_calls[it->second].push_back(call);
+    }
+
+    std::vector<std::vector<FoundDumpEntry>> found_dump_entries(command_buffer_calls.size());
+    std::atomic<size_t>                      next_command_buffer{ 0 };
+    auto                                     worker = [&]() {
+        for (size_t i = next_command_buffer++; i < command_buffer_calls.size();
+             i = next_command_buffer++)
         {
-            const DumpRenderPass& render_pass = entry.render_passes[ii];
-            if (ii != 0)
+            const DumpCall*              current_call = nullptr;
+            DumpResourcesBuilderConsumer consumer([&](DumpEntry dump_entry) {
+                found_dump_entries[i].push_back(
+                FoundDumpEntry{ current_call->submit_position, std::move(dump_entry) });
+            });
+            for (const DumpCall& call : command_buffer_calls[i])
             {
-                out << ',';
+                current_call = &call;
+                ReplayDumpCall(call, consumer);
             }
-            out << "[" << render_pass.begin_block_index << ',' << render_pass.end_block_index
-                << ']';
         }
-        out << ']';
+    };
+    std::vector<std::thread> threads;
+    for (uint32_t i = 1; i < std::min<size_t>(num_workers, command_buffer_calls.size()); ++i)
+    {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    // Same order as a full decode: by vkQueueSubmit, then by command buffer within the submit.
+    std::vector<FoundDumpEntry> all_found_dump_entries;
+    for (std::vector<FoundDumpEntry>& entries : found_dump_entries)
+    {
+        std::move(entries.begin(), entries.end(), std::back_inserter(all_found_dump_entries));
     }
-    out << "],\n";
+    std::sort(all_found_dump_entries.begin(),
+              all_found_dump_entries.end(),
+              [](const FoundDumpEntry& lhs, const FoundDumpEntry& rhs) {
+                  if (lhs.dump_entry.queue_submit_block_index !=
+                      rhs.dump_entry.queue_submit_block_index)
+                  {
+                      return lhs.dump_entry.queue_submit_block_index <
+                             rhs.dump_entry.queue_submit_block_index;
+                  }
+                  return lhs.submit_position < rhs.submit_position;
+              });
 
-    out << "  \"Draw\": [";
-    for (int i = 0; i < dumpables.size(); ++i)
+    std::vector<DumpEntry> complete_dump_entries;
+    complete_dump_entries.reserve(all_found_dump_entries.size());
+    for (FoundDumpEntry& found : all_found_dump_entries)
     {
-        const DumpEntry& entry = dumpables[i];
-        if (i != 0)
+        complete_dump_entries.push_back(std::move(found.dump_entry));
+    }
+    return complete_dump_entries;
+}
+
+bool SaveAsJsonFile(const std::vector<DumpEntry>& dumpables, const char* filename)
+{
+    BufferedFileWriter out;
+    if (!out.Open(filename))
+    {
+        std::cerr << "Failed to open output:" << filename << '\n';
+        return false;
+    }
+
+    // Writes "[item,item,...]" for all dumpables
+    auto write_array = [&out, &dumpables](const auto& write_item) {
+        out.Write('[');
+        for (size_t i = 0; i < dumpables.size(); ++i)
+        {
+            if (i != 0)
+            {
+                out.Write(',');
+            }
+            write_item(dumpables[i]);
+        }
+        out.Write(']');
+    };
+
+    out.Write("{\n");
+
+    out.Write("  \"BeginCommandBuffer\": ");
+    write_array([&out](const DumpEntry& entry) {
+        out.WriteUint(entry.begin_command_buffer_block_index);
+    });
+    out.Write(",\n");
+
+    out.Write("  \"RenderPass\": ");
+    write_array([&out](const DumpEntry& entry) {
+        out.Write('[');
+        for (size_t i = 0; i < entry.render_passes.size(); ++i)
         {
-            out << ',';
+            const DumpRenderPass& render_pass = entry.render_passes[i];
+            out.Write(i != 0 ? ",[" : "[");
+            out.WriteUint(render_pass.begin_block_index);
+            out.Write(',');
+            out.WriteUint(render_pass.end_block_index);
+            out.Write(']');
         }
-        out << '[';
-        for (int ii = 0; ii < entry.draws.size(); ++ii)
+        out.Write(']');
+    });
+    out.Write(",\n");
+
+    out.Write("  \"Draw\": ");
+    write_array([&out](const DumpEntry& entry) {
+        out.Write('[');
+        for (size_t i = 0; i < entry.draws.size(); ++i)
         {
-            uint64_t draw = entry.draws[ii];
-            if (ii != 0)
+            if (i != 0)
             {
-                out << ',';
+                out.Write(',');
             }
-            out << draw;
+            out.WriteUint(entry.draws[i]);
         }
-        out << ']';
+        out.Write(']');
+    });
+    out.Write(",\n");
+
+    out.Write("  \"QueueSubmit\": ");
+    write_array([&out](const DumpEntry& entry) { out.WriteUint(entry.queue_submit_block_index); });
+    out.Write("\n");
+
+    out.Write("}\n");
+
+    if (!out.Close())
+    {
+        std::cerr << "Failed to close output file: " << filename << '\n';
+        return false;
+    }
+
+    return true;
+}
+
+bool SaveAsBinaryFile(const std::vector<DumpEntry>& dumpables, const char* filename)
+{
+    BufferedFileWriter out;
+    if (!out.Open(filename))
+    {
+        std::cerr << "Failed to open output:" << filename << '\n';
+        return false;
     }
-    out << "],\n";
 
-    out << "  \"QueueSubmit\": [";
-    for (int i = 0; i < dumpables.size(); ++i)
+    DumpEntryFileHeader header = {};
+    std::memcpy(header.magic, kDumpEntryFileMagic, sizeof(header.magic));
+    header.version = kDumpEntryFileVersion;
+    header.entry_count = dumpables.size();
+    out.WriteBytes(&header, sizeof(header));
+    for (const DumpEntry& entry : dumpables)
     {
-        const DumpEntry& entry = dumpables[i];
-        if (i != 0)
+        DumpEntryRecord record = {};
+        record.begin_command_buffer_block_index = entry.begin_command_buffer_block_index;
+        record.queue_submit_block_index = entry.queue_submit_block_index;
+        record.render_pass_count = entry.render_passes.size();
+        record.draw_count = entry.draws.size();
+        out.WriteBytes(&record, sizeof(record));
+        for (const DumpRenderPass& render_pass : entry.render_passes)
         {
-            out << ',';
+            uint64_t block_indices[2] = { render_pass.begin_block_index,
+                                          render_pass.end_block_index };
+            out.WriteBytes(block_indices, sizeof(block_indices));
         }
-        out << entry.queue_submit_block_index;
+        out.WriteBytes(entry.draws.data(), entry.draws.size() * sizeof(uint64_t));
     }
-    out << "]\n";
 
-    out << "}\n";
-
-    out.close();
-    if (!out.good())
+    if (!out.Close())
     {
         std::cerr << "Failed to close output file: " << filename << '\n';
         return false;
@@ -145,4 +381,83 @@ bool SaveAsJsonFile(const std::vector<DumpEntry>& dumpables, const char* filenam
     return true;
 }
 
+bool IsBinaryFile(const char* filename)
+{
+    std::ifstream       in(filename, std::ios::binary);
+    DumpEntryFileHeader header = {};
+    return in.read(reinterpret_cast<char*>(&header), sizeof(header)) &&
+           std::memcmp(header.magic, kDumpEntryFileMagic, sizeof(header.magic)) == 0;
+}
+
+std::optional<std::vector<DumpEntry>> LoadBinaryFile(const char* filename)
+{
+    std::ifstream in(filename, std::ios::binary);
+    if (!in.is_open())
+    {
+        std::cerr << "Failed to open input:" << filename << '\n';
+        return std::nullopt;
+    }
+    in.seekg(0, std::ios::end);
+    const uint64_t file_size = static_cast<uint64_t>(in.tellg());
+    in.seekg(0, std::ios::beg);
+
+    DumpEntryFileHeader header = {};
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, kDumpEntryFileMagic, sizeof(header.magic)) != 0 ||
+        header.version != kDumpEntryFileVersion)
+    {
+        std::cerr << "Not a dump resources binary file: " << filename << '\n';
+        return std::nullopt;
+    }
+
+    // Every count is checked against the remaining file size before allocating.
+    uint64_t remaining = file_size - sizeof(header);
+    if (header.entry_count > remaining / sizeof(DumpEntryRecord))
+    {
+        std::cerr << "Truncated dump resources binary file: " << filename << '\n';
+        return std::nullopt;
+    }
+
+    std::vector<DumpEntry> dumpables(header.entry_count);
+    for (DumpEntry& entry : dumpables)
+    {
+        DumpEntryRecord record = {};
+        if (remaining < sizeof(record) ||
+            !in.read(reinterpret_cast<char*>(&record), sizeof(record)))
+        {
+            std::cerr << "Truncated dump resources binary file: " << filename << '\n';
+            return std::nullopt;
+        }
+        remaining -= sizeof(record);
+        const uint64_t max_block_indices = remaining / sizeof(uint64_t);
+        if (record.render_pass_count > max_block_indices / 2 ||
+            record.draw_count > max_block_indices - record.render_pass_count * 2)
+        {
+            std::cerr << "Truncated dump resources binary file: " << filename << '\n';
+            return std::nullopt;
+        }
+
+        entry.begin_command_buffer_block_index = record.begin_command_buffer_block_index;
+        entry.queue_submit_block_index = record.queue_submit_block_index;
+        entry.render_passes.resize(record.render_pass_count);
+        for (DumpRenderPass& render_pass : entry.render_passes)
+        {
+            uint64_t block_indices[2] = {};
+            in.read(reinterpret_cast<char*>(block_indices), sizeof(block_indices));
+            render_pass.begin_block_index = block_indices[0];
+            render_pass.end_block_index = block_indices[1];
+        }
+        entry.draws.resize(record.draw_count);
+        in.read(reinterpret_cast<char*>(entry.draws.data()), entry.draws.size() * sizeof(uint64_t));
+        remaining -= (record.render_pass_count * 2 + record.draw_count) * sizeof(uint64_t);
+        if (!in)
+        {
+            std::cerr << "Failed to read input: " << filename << '\n';
+            return std::nullopt;
+        }
+    }
+
+    return dumpables;
+}
+
 }  // namespace Dive::gfxr
\ No newline at end of file
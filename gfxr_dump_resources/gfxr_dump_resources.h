@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <optional>
 #include <vector>
 
@@ -34,4 +35,43 @@ std::optional<std::vector<DumpEntry>> FindDumpableResources(const char* filename
 // Returns false on error.
 bool SaveAsJsonFile(const std::vector<DumpEntry>& dumpables, const char* filename);
 
+// Compact binary alternative to the JSON file, which can be read without a JSON parser.
+//
+// Layout (little endian): a DumpEntryFileHeader, then for each entry a DumpEntryRecord followed by
+// render_pass_count pairs of uint64_t begin/end block indices and by draw_count uint64_t draw block
+// indices.
+inline constexpr char     kDumpEntryFileMagic[8] = { 'D', 'I', 'V', 'E', 'D', 'U', 'M', 'P' };
+inline constexpr uint32_t kDumpEntryFileVersion = 1;
+
+struct DumpEntryFileHeader
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t entry_count;
+};
+static_assert(sizeof(DumpEntryFileHeader) == 24, "DumpEntryFileHeader is part of the file format");
+
+struct DumpEntryRecord
+{
+    uint64_t begin_command_buffer_block_index;
+    uint64_t queue_submit_block_index;
+    uint64_t render_pass_count;
+    uint64_t draw_count;
+};
+static_assert(sizeof(DumpEntryRecord) == 32, "DumpEntryRecord is part of the file format");
+
+// Serialize a list of complete dumpable to a binary file.
+//
+// Returns false on error.
+bool SaveAsBinaryFile(const std::vector<DumpEntry>& dumpables, const char* filename);
+
+// Whether the file starts with kDumpEntryFileMagic.
+bool IsBinaryFile(const char* filename);
+
+// Read the dumpables of a file written by SaveAsBinaryFile.
+//
+// Returns std::nullopt on error.
+std::optional<std::vector<DumpEntry>> LoadBinaryFile(const char* filename);
+
 }  // namespace Dive::gfxr
\ No newline at end of file
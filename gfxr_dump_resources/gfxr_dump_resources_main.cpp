@@ -31,12 +31,20 @@ ABSL_FLAG(bool,
           false,
           "If specified, only dump the final draw call for a render pass. This should speed up "
           "dumping while still providing a useful result.");
+ABSL_FLAG(bool,
+          binary,
+          false,
+          "If specified, write OUTPUT in the compact binary format instead of JSON. A binary file "
+          "can be given back as input to convert it to JSON.");
 
 namespace
 {
 
 using Dive::gfxr::DumpEntry;
 using Dive::gfxr::FindDumpableResources;
+using Dive::gfxr::IsBinaryFile;
+using Dive::gfxr::LoadBinaryFile;
+using Dive::gfxr::SaveAsBinaryFile;
 using Dive::gfxr::SaveAsJsonFile;
 using gfxrecon::util::Log;
 
@@ -44,7 +52,7 @@ using gfxrecon::util::Log;
 
 int main(int argc, char** argv)
 {
-    absl::SetProgramUsageMessage("Usage: gfxr_dump_resources FILE.GFXR OUTPUT.JSON");
+    absl::SetProgramUsageMessage("Usage: gfxr_dump_resources FILE.GFXR|FILE.BIN OUTPUT.JSON");
     std::vector<char*> positional_args = absl::ParseCommandLine(argc, argv);
     if (positional_args.size() != 3)
     {
@@ -61,7 +69,9 @@ int main(int argc, char** argv)
     Log::Init(Log::kDebugSeverity);
 #endif
 
-    std::optional<std::vector<DumpEntry>> dumpables = FindDumpableResources(input_filename);
+    std::optional<std::vector<DumpEntry>> dumpables = IsBinaryFile(input_filename) ?
+                                                      LoadBinaryFile(input_filename) :
+                                                      FindDumpableResources(input_filename);
     if (!dumpables.has_value())
     {
         std::cerr << "Failed to find resources in " << input_filename << '\n';
@@ -84,7 +94,9 @@ int main(int argc, char** argv)
         }
     }
 
-    if (!SaveAsJsonFile(*dumpables, output_filename))
+    bool saved = absl::GetFlag(FLAGS_binary) ? SaveAsBinaryFile(*dumpables, output_filename) :
+                                               SaveAsJsonFile(*dumpables, output_filename);
+    if (!saved)
     {
         std::cerr << "Failed to serialize to " << output_filename << '\n';
         return 1;
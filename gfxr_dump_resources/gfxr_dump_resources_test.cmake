@@ -26,11 +26,27 @@
 # TEST_EXECUTABLE will be run with INPUT_GFXR. The test will pass if TEST_EXECUTABLE returns 0 exit code and the contents of the output json match the contents of GOLDEN_FILE.
 # TEST_NAME should match the NAME given to add_test(). This is mainly used to ensure that temp files are unique to the test (to support running tests in parallel).
 # ADDITIONAL_ARGUMENTS will be passed to TEST_EXECUTABLE in addition to the normal command-line. This is where you can specify options and parameters.
+# If ROUND_TRIP_BINARY is true, TEST_EXECUTABLE first writes the --binary output, which is then converted to the json compared to GOLDEN_FILE.
 
-execute_process(
-  COMMAND ${TEST_EXECUTABLE} ${ADDITIONAL_ARGUMENTS} ${INPUT_GFXR} ${TEST_NAME}.json
-  RESULT_VARIABLE exit_code
-)
+if (ROUND_TRIP_BINARY)
+  # Write the binary format, then convert it back to JSON so that it's checked against the same golden.
+  execute_process(
+    COMMAND ${TEST_EXECUTABLE} ${ADDITIONAL_ARGUMENTS} --binary ${INPUT_GFXR} ${TEST_NAME}.bin
+    RESULT_VARIABLE exit_code
+  )
+  if (NOT exit_code EQUAL 0)
+    message(FATAL_ERROR "${TEST_EXECUTABLE} failed: ${exit_code}")
+  endif()
+  execute_process(
+    COMMAND ${TEST_EXECUTABLE} ${TEST_NAME}.bin ${TEST_NAME}.json
+    RESULT_VARIABLE exit_code
+  )
+else()
+  execute_process(
+    COMMAND ${TEST_EXECUTABLE} ${ADDITIONAL_ARGUMENTS} ${INPUT_GFXR} ${TEST_NAME}.json
+    RESULT_VARIABLE exit_code
+  )
+endif()
 # In CMake 3.19+, prefer COMMAND_ERROR_IS_FATAL (more succinct)
 if (NOT exit_code EQUAL 0)
   message(FATAL_ERROR "${TEST_EXECUTABLE} failed: ${exit_code}")
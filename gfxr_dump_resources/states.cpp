@@ -112,27 +112,11 @@ uint32_t
 gfxrecon::decode::StructPointerDecoder<gfxrecon::decode::Decoded_VkSubmitInfo>* pSubmits,
 gfxrecon::format::HandleId                                                      fence)
 {
-    for (uint32_t submit_index = 0; submit_index < submitCount; submit_index++)
-    {
-        const gfxrecon::decode::Decoded_VkSubmitInfo&
-        submit = pSubmits->GetMetaStructPointer()[submit_index];
-        for (uint32_t command_buffer_index = 0;
-             command_buffer_index < pSubmits->GetPointer()->commandBufferCount;
-             command_buffer_index++)
-        {
-            gfxrecon::format::HandleId command_buffer_id = submit.pCommandBuffers
-                                                           .GetPointer()[command_buffer_index];
-            if (command_buffer_id != parent_.command_buffer())
-            {
-                continue;
-            }
-
-            parent_.dump_entry().queue_submit_block_index = call_info.index;
-            // Could be accept or reject depending on what's been accumulated so far...
-            parent_.Done();
-            return;
-        }
-    }
+    // DumpResourcesBuilderConsumer only forwards the submit to the state machines of the submitted
+    // command buffers, so `pSubmits` isn't inspected (and is null for replayed calls).
+    parent_.dump_entry().queue_submit_block_index = call_info.index;
+    // Could be accept or reject depending on what's been accumulated so far...
+    parent_.Done();
 }
 
 LookingForBeginCommandBuffer::LookingForBeginCommandBuffer(
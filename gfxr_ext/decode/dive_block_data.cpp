@@ -14,9 +14,17 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#include <filesystem>
 #include <fstream>
 #include <memory>
 
+#if defined(__linux__)
+#    include <fcntl.h>
+#    include <linux/fs.h>
+#    include <sys/ioctl.h>
+#    include <unistd.h>
+#endif
+
 #include "dive_block_data.h"
 
 #include "util/logging.h"
@@ -24,6 +32,73 @@ limitations under the License.
 GFXRECON_BEGIN_NAMESPACE(gfxrecon)
 GFXRECON_BEGIN_NAMESPACE(decode)
 
+namespace
+{
+
+// Returns false if the file can't be queried
+bool GetFileStamp(const std::string& path, uint64_t* size, int64_t* mtime)
+{
+    std::error_code ec;
+    uintmax_t       file_size = std::filesystem::file_size(path, ec);
+    if (ec)
+    {
+        return false;
+    }
+    std::filesystem::file_time_type file_mtime = std::filesystem::last_write_time(path, ec);
+    if (ec)
+    {
+        return false;
+    }
+    *size = static_cast<uint64_t>(file_size);
+    *mtime = static_cast<int64_t>(file_mtime.time_since_epoch().count());
+    return true;
+}
+
+// Copies a file, sharing the data blocks with the source (copy-on-write) if the filesystem
+// supports it
+bool CloneFile(const std::string& src_path, const std::string& dst_path)
+{
+#if defined(__linux__) && defined(FICLONE)
+    int src_fd = open(src_path.c_str(), O_RDONLY);
+    if (src_fd >= 0)
+    {
+        int dst_fd = open(dst_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (dst_fd >= 0)
+        {
+            bool cloned = (ioctl(dst_fd, FICLONE, src_fd) == 0);
+            close(dst_fd);
+            close(src_fd);
+            if (cloned)
+            {
+                return true;
+            }
+        }
+        else
+        {
+            close(src_fd);
+        }
+    }
+#endif
+
+    // The standard library uses an in-kernel copy where available
+    std::error_code error;
+    std::filesystem::copy_file(src_path,
+                               dst_path,
+                               std::filesystem::copy_options::overwrite_existing,
+                               error);
+    if (error)
+    {
+        GFXRECON_LOG_ERROR("Failed to copy %s to %s: %s",
+                           src_path.c_str(),
+                           dst_path.c_str(),
+                           error.message().c_str());
+        return false;
+    }
+    return true;
+}
+
+}  // namespace
+
 bool TestBlockVisitor::Visit(const DiveOriginalBlock& block)
 {
     std::string descrip = "original, offset:" + std::to_string(block.offset_) +
@@ -84,7 +159,7 @@ bool WriterBlockVisitor::Visit(const DiveModificationBlock& block)
         GFXRECON_LOG_ERROR("WriterBlockVisitor encountered empty modification block");
         return false;
     }
-    if (!util::platform::FileWrite(block.blob_ptr_.get(), block.blob_ptr_->size(), new_file_ptr_))
+    if (!util::platform::FileWrite(block.blob_ptr_->data(), block.blob_ptr_->size(), new_file_ptr_))
     {
         GFXRECON_LOG_ERROR("Writing modified block, could not write to new file");
         return false;
@@ -285,8 +360,48 @@ bool DiveBlockData::TraverseBlocks(BlockVisitor& visitor) const
     return true;
 }
 
+bool DiveBlockData::CanPatchOriginalFile() const
+{
+    for (const auto& [primary_id, modifications] : modifications_map_)
+    {
+        if (modifications.empty())
+        {
+            continue;
+        }
+        if (modifications.size() > 1 || modifications.count(0) == 0)
+        {
+            // Inserting blocks moves everything after them
+            return false;
+        }
+        auto modification_ptr =
+        std::dynamic_pointer_cast<DiveModificationBlock>(modifications.at(0));
+        if (modification_ptr == nullptr || modification_ptr->blob_ptr_ == nullptr)
+        {
+            // Deleting a block moves everything after it
+            return false;
+        }
+        const DiveOriginalBlock& original_block = *original_blocks_map_.at(primary_id);
+        if (original_block.size_ == 0 ||
+            modification_ptr->blob_ptr_->size() != original_block.size_)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint64_t DiveBlockData::GetOriginalFileSize() const
+{
+    if (original_blocks_map_.empty())
+    {
+        return original_header_block_.size_;
+    }
+    const DiveOriginalBlock& last_block = *original_blocks_map_.back();
+    return last_block.offset_ + last_block.size_;
+}
+
 bool DiveBlockData::WriteGFXRFile(const std::string& original_file_path,
-                                  const std::string& new_file_path) const
+                                  const std::string& new_file_path)
 {
     if (!original_blocks_map_locked_)
     {
@@ -294,6 +409,158 @@ bool DiveBlockData::WriteGFXRFile(const std::string& original_file_path,
         return false;
     }
 
+    std::error_code error;
+    if (std::filesystem::equivalent(original_file_path, new_file_path, error))
+    {
+        GFXRECON_LOG_ERROR("Cannot overwrite the original file %s", original_file_path.c_str());
+        return false;
+    }
+
+    if (CanPatchOriginalFile())
+    {
+        if (PatchGFXRFile(original_file_path, new_file_path))
+        {
+            return true;
+        }
+        GFXRECON_LOG_WARNING("Could not patch a copy of the original file, rewriting %s",
+                             new_file_path.c_str());
+    }
+
+    // The output no longer matches what was patched into it
+    patched_file_path_.clear();
+    patched_primary_ids_.clear();
+
+    return RewriteGFXRFile(original_file_path, new_file_path);
+}
+
+bool DiveBlockData::PatchGFXRFile(const std::string& original_file_path,
+                                  const std::string& new_file_path)
+{
+    // A previous patch save to the same path can be reused as long as neither it nor the original
+    // file it was cloned from changed since
+    uint64_t source_size = 0;
+    int64_t  source_mtime = 0;
+    uint64_t output_size = 0;
+    int64_t  output_mtime = 0;
+    bool     has_source_stamp = GetFileStamp(original_file_path, &source_size, &source_mtime);
+    bool     reuse_patched_file = has_source_stamp && (new_file_path == patched_file_path_) &&
+                              (original_file_path == patched_source_path_) &&
+                              (source_size == patched_source_size_) &&
+                              (source_mtime == patched_source_mtime_) &&
+                              GetFileStamp(new_file_path, &output_size, &output_mtime) &&
+                              (output_size == GetOriginalFileSize()) &&
+                              (output_mtime == patched_file_mtime_);
+    patched_file_path_.clear();
+
+    if (!reuse_patched_file)
+    {
+        patched_primary_ids_.clear();
+        if (!CloneFile(original_file_path, new_file_path))
+        {
+            return false;
+        }
+    }
+
+    FILE* original_fd;
+    int   result = util::platform::FileOpen(&original_fd, original_file_path.c_str(), "rb");
+    if (result || original_fd == nullptr)
+    {
+        GFXRECON_LOG_ERROR("Failed to open file %s", original_file_path.c_str());
+        return false;
+    }
+
+    FILE* new_fd;
+    result = util::platform::FileOpen(&new_fd, new_file_path.c_str(), "r+b");
+    if (result || new_fd == nullptr)
+    {
+        GFXRECON_LOG_ERROR("Failed to open file %s", new_file_path.c_str());
+        util::platform::FileClose(original_fd);
+        return false;
+    }
+
+    WriterBlockVisitor writer = { original_fd, new_fd };
+    bool               success = true;
+
+    // Restore the original content of blocks that are no longer modified
+    for (uint32_t primary_id : patched_primary_ids_)
+    {
+        if (!success)
+        {
+            break;
+        }
+        if (modifications_map_.count(primary_id) > 0 &&
+            modifications_map_.at(primary_id).count(0) > 0)
+        {
+            continue;
+        }
+        const DiveOriginalBlock& original_block = *original_blocks_map_.at(primary_id);
+        success = util::platform::FileSeek(new_fd,
+                                           original_block.offset_,
+                                           util::platform::FileSeekSet) &&
+                  original_block.Accept(writer);
+    }
+
+    std::set<uint32_t> patched_primary_ids = {};
+    for (const auto& [primary_id, modifications] : modifications_map_)
+    {
+        if (!success)
+        {
+            break;
+        }
+        if (modifications.count(0) == 0)
+        {
+            continue;
+        }
+        const DiveOriginalBlock& original_block = *original_blocks_map_.at(primary_id);
+        success = util::platform::FileSeek(new_fd,
+                                           original_block.offset_,
+                                           util::platform::FileSeekSet) &&
+                  modifications.at(0)->Accept(writer);
+        patched_primary_ids.insert(primary_id);
+    }
+
+    if (util::platform::FileClose(original_fd))
+    {
+        GFXRECON_LOG_ERROR("Failed to close file %s", original_file_path.c_str());
+        success = false;
+    }
+
+    if (util::platform::FileClose(new_fd))
+    {
+        GFXRECON_LOG_ERROR("Failed to close file %s", new_file_path.c_str());
+        success = false;
+    }
+
+    if (!success)
+    {
+        GFXRECON_LOG_ERROR("Could not patch modified blocks into %s", new_file_path.c_str());
+        patched_primary_ids_.clear();
+        return false;
+    }
+
+    GFXRECON_LOG_INFO("Patched %zu blocks into gfxr file: %s",
+                      patched_primary_ids.size(),
+                      new_file_path.c_str());
+
+    // Without a stamp the output can't safely be reused, the next save clones it again
+    if (has_source_stamp && GetFileStamp(new_file_path, &output_size, &patched_file_mtime_))
+    {
+        patched_file_path_ = new_file_path;
+        patched_source_path_ = original_file_path;
+        patched_source_size_ = source_size;
+        patched_source_mtime_ = source_mtime;
+        patched_primary_ids_ = std::move(patched_primary_ids);
+    }
+    else
+    {
+        patched_primary_ids_.clear();
+    }
+    return true;
+}
+
+bool DiveBlockData::RewriteGFXRFile(const std::string& original_file_path,
+                                    const std::string& new_file_path) const
+{
     FILE* original_fd;
     int   result = util::platform::FileOpen(&original_fd, original_file_path.c_str(), "rb");
     if (result || original_fd == nullptr)
@@ -17,6 +17,7 @@ limitations under the License.
 // Implementing a class to store GFXR file metadata is necessary to support these changes:
 // - Assemble a modified GFXR file quickly with data chunks from the original file and from stored
 // modifications
+// - Patch only the modified byte ranges when no block changes size
 
 #ifndef GFXRECON_DECODE_DIVE_BLOCK_DATA_H
 #define GFXRECON_DECODE_DIVE_BLOCK_DATA_H
@@ -25,6 +26,7 @@ limitations under the License.
 
 #include <map>
 #include <memory>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -135,12 +137,26 @@ public:
     bool RemoveModification(uint32_t primary_id, int32_t secondary_id);
     void ClearAllModifications() { modifications_map_.clear(); }
 
-    // Write modified GFXR file at the specified path
+    // True if every modification replaces an original block with a blob of the same size, in
+    // which case the modified file has the same layout as the original file
+    bool CanPatchOriginalFile() const;
+
+    // Write modified GFXR file at the specified path. When CanPatchOriginalFile(), the original
+    // file is cloned (reflink if supported) and only the modified blocks are written. Saving
+    // again to the same path only rewrites the blocks whose modifications changed since then, as
+    // long as neither the output nor the original file changed on disk.
+    // Otherwise the whole file is rewritten block by block.
     bool TraverseBlocks(BlockVisitor& visitor) const;
-    bool WriteGFXRFile(const std::string& original_file_path,
-                       const std::string& new_file_path) const;
+    bool WriteGFXRFile(const std::string& original_file_path, const std::string& new_file_path);
 
 private:
+    bool PatchGFXRFile(const std::string& original_file_path, const std::string& new_file_path);
+    bool RewriteGFXRFile(const std::string& original_file_path,
+                         const std::string& new_file_path) const;
+
+    // Size of the original file, header included
+    uint64_t GetOriginalFileSize() const;
+
     // Info for the blocks in the original GFXR file
     std::vector<std::shared_ptr<DiveOriginalBlock>>
                       original_blocks_map_ = {};  // Starting block index of 0
@@ -160,6 +176,16 @@ private:
     //
     // Each modification has an unique pair of primary_id and secondary_id.
     std::map<uint32_t, std::map<int32_t, std::shared_ptr<IDiveBlock>>> modifications_map_ = {};
+
+    // Output file of the last patch save, and the original blocks that were overwritten in it.
+    // The output is only reused while it and the original file it was cloned from keep the
+    // recorded size and modification time
+    std::string        patched_file_path_ = "";
+    int64_t            patched_file_mtime_ = 0;
+    std::string        patched_source_path_ = "";
+    uint64_t           patched_source_size_ = 0;
+    int64_t            patched_source_mtime_ = 0;
+    std::set<uint32_t> patched_primary_ids_ = {};
 };
 
 GFXRECON_END_NAMESPACE(decode)
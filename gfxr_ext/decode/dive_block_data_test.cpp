@@ -18,6 +18,12 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
 namespace gfxrecon::decode
 {
 namespace
@@ -291,5 +297,174 @@ TEST_F(DiveBlockDataTestFixture, TraverseBlocks_OrderSecondary)
     EXPECT_EQ(GetExampleString(o[2]), traversed_strings[6]);
 }
 
+class DiveBlockDataWriteTestFixture : public DiveBlockDataTestFixture
+{
+protected:
+    void SetUp() override
+    {
+        DiveBlockDataTestFixture::SetUp();
+        dir = std::filesystem::temp_directory_path() / "dive_block_data_test";
+        std::filesystem::create_directories(dir);
+        original_path = (dir / "original.gfxr").string();
+        new_path = (dir / "new.gfxr").string();
+
+        // Header and blocks filled with distinct bytes so that misplaced data is detected
+        original.resize(o.back().first + o.back().second);
+        for (size_t i = 0; i < original.size(); i++)
+        {
+            original[i] = static_cast<char>('a' + i % 26);
+        }
+        std::ofstream out(original_path, std::ios::binary);
+        out.write(original.data(), original.size());
+    }
+
+    void TearDown() override { std::filesystem::remove_all(dir); }
+
+    std::vector<char> ReadNewFile()
+    {
+        std::ifstream in(new_path, std::ios::binary);
+        return std::vector<char>(std::istreambuf_iterator<char>(in),
+                                 std::istreambuf_iterator<char>());
+    }
+
+    std::filesystem::path dir;
+    std::string           original_path;
+    std::string           new_path;
+    std::vector<char>     original = {};
+};
+
+TEST_F(DiveBlockDataWriteTestFixture, CanPatchOriginalFile_SameSize_Success)
+{
+    LockExampleOriginals();
+    EXPECT_TRUE(d.CanPatchOriginalFile());
+    EXPECT_TRUE(d.AddModification(0, 0, CreateModifiedBuffer("0123456789")));
+    EXPECT_TRUE(d.CanPatchOriginalFile());
+}
+
+TEST_F(DiveBlockDataWriteTestFixture, CanPatchOriginalFile_LayoutChange_Fail)
+{
+    LockExampleOriginals();
+    PopulateExampleModifications();
+    EXPECT_TRUE(d.AddModification(0, 0, m[1]));
+    EXPECT_FALSE(d.CanPatchOriginalFile());
+    EXPECT_TRUE(d.RemoveModification(0, 0));
+
+    EXPECT_TRUE(d.AddModification(1, 1, m[1]));
+    EXPECT_FALSE(d.CanPatchOriginalFile());
+    EXPECT_TRUE(d.RemoveModification(1, 1));
+
+    EXPECT_TRUE(d.AddModification(2, 0, nullptr));
+    EXPECT_FALSE(d.CanPatchOriginalFile());
+}
+
+TEST_F(DiveBlockDataWriteTestFixture, WriteGFXRFile_Rewrite_Success)
+{
+    LockExampleOriginals();
+    PopulateExampleModifications();
+    EXPECT_TRUE(d.AddModification(1, 0, m[3]));
+    EXPECT_TRUE(d.WriteGFXRFile(original_path, new_path));
+
+    std::vector<char> expected(original.begin(), original.begin() + o[1].first);
+    expected.insert(expected.end(), m[3]->begin(), m[3]->end());
+    expected.insert(expected.end(), original.begin() + o[2].first, original.end());
+    EXPECT_EQ(expected, ReadNewFile());
+}
+
+TEST_F(DiveBlockDataWriteTestFixture, WriteGFXRFile_Patch_Success)
+{
+    LockExampleOriginals();
+    std::shared_ptr<std::vector<char>> block = CreateModifiedBuffer("0123456789");
+    EXPECT_TRUE(d.AddModification(0, 0, block));
+    EXPECT_TRUE(d.WriteGFXRFile(original_path, new_path));
+
+    std::vector<char> expected = original;
+    std::copy(block->begin(), block->end(), expected.begin() + o[0].first);
+    EXPECT_EQ(expected, ReadNewFile());
+}
+
+TEST_F(DiveBlockDataWriteTestFixture, WriteGFXRFile_RepeatedPatch_RestoresRemoved)
+{
+    LockExampleOriginals();
+    std::shared_ptr<std::vector<char>> block_0 = CreateModifiedBuffer("0123456789");
+    std::shared_ptr<std::vector<char>> block_2 = CreateModifiedBuffer(std::string(50, '#'));
+    EXPECT_TRUE(d.AddModification(0, 0, block_0));
+    EXPECT_TRUE(d.WriteGFXRFile(original_path, new_path));
+
+    EXPECT_TRUE(d.RemoveModification(0, 0));
+    EXPECT_TRUE(d.AddModification(2, 0, block_2));
+    EXPECT_TRUE(d.WriteGFXRFile(original_path, new_path));
+
+    std::vector<char> expected = original;
+    std::copy(block_2->begin(), block_2->end(), expected.begin() + o[2].first);
+    EXPECT_EQ(expected, ReadNewFile());
+}
+
+TEST_F(DiveBlockDataWriteTestFixture, WriteGFXRFile_PatchThenRewrite_Success)
+{
+    LockExampleOriginals();
+    PopulateExampleModifications();
+    EXPECT_TRUE(d.AddModification(0, 0, CreateModifiedBuffer("0123456789")));
+    EXPECT_TRUE(d.WriteGFXRFile(original_path, new_path));
+
+    EXPECT_TRUE(d.RemoveModification(0, 0));
+    EXPECT_TRUE(d.AddModification(2, 1, m[2]));
+    EXPECT_TRUE(d.WriteGFXRFile(original_path, new_path));
+
+    std::vector<char> expected = original;
+    expected.insert(expected.end(), m[2]->begin(), m[2]->end());
+    EXPECT_EQ(expected, ReadNewFile());
+}
+
+TEST_F(DiveBlockDataWriteTestFixture, WriteGFXRFile_RepeatedPatch_OriginalChanged)
+{
+    LockExampleOriginals();
+    std::shared_ptr<std::vector<char>> block = CreateModifiedBuffer("0123456789");
+    EXPECT_TRUE(d.AddModification(0, 0, block));
+    EXPECT_TRUE(d.WriteGFXRFile(original_path, new_path));
+
+    // Same size original with different content, the previous output must not be reused
+    std::reverse(original.begin() + o[1].first, original.end());
+    {
+        std::ofstream out(original_path, std::ios::binary | std::ios::trunc);
+        out.write(original.data(), original.size());
+    }
+    std::filesystem::last_write_time(original_path,
+                                     std::filesystem::last_write_time(original_path) +
+                                     std::chrono::seconds(10));
+    EXPECT_TRUE(d.WriteGFXRFile(original_path, new_path));
+
+    std::vector<char> expected = original;
+    std::copy(block->begin(), block->end(), expected.begin() + o[0].first);
+    EXPECT_EQ(expected, ReadNewFile());
+}
+
+TEST_F(DiveBlockDataWriteTestFixture, WriteGFXRFile_RepeatedPatch_OutputReplaced)
+{
+    LockExampleOriginals();
+    std::shared_ptr<std::vector<char>> block = CreateModifiedBuffer("0123456789");
+    EXPECT_TRUE(d.AddModification(0, 0, block));
+    EXPECT_TRUE(d.WriteGFXRFile(original_path, new_path));
+
+    // Output replaced by a file of the same length
+    {
+        std::ofstream out(new_path, std::ios::binary | std::ios::trunc);
+        out.write(std::string(original.size(), '!').data(), original.size());
+    }
+    std::filesystem::last_write_time(new_path,
+                                     std::filesystem::last_write_time(new_path) +
+                                     std::chrono::seconds(10));
+    EXPECT_TRUE(d.WriteGFXRFile(original_path, new_path));
+
+    std::vector<char> expected = original;
+    std::copy(block->begin(), block->end(), expected.begin() + o[0].first);
+    EXPECT_EQ(expected, ReadNewFile());
+}
+
+TEST_F(DiveBlockDataWriteTestFixture, WriteGFXRFile_OverwriteOriginal_Fail)
+{
+    LockExampleOriginals();
+    EXPECT_FALSE(d.WriteGFXRFile(original_path, original_path));
+}
+
 }  // namespace
 }  // namespace gfxrecon::decode
\ No newline at end of file
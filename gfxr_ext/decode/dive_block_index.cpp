@@ -0,0 +1,571 @@
+/*
+Copyright 2025 Google Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "dive_block_index.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <filesystem>
+#include <system_error>
+
+#include "format/format.h"
+#include "format/format_util.h"
+#include "util/file_path.h"
+#include "util/logging.h"
+#include "util/platform.h"
+
+#include "dive_block_data.h"
+
+#include "common/trace.h"
+
+GFXRECON_BEGIN_NAMESPACE(gfxrecon)
+GFXRECON_BEGIN_NAMESPACE(decode)
+
+namespace
+{
+
+constexpr uint32_t kDiveBlockIndexFourCC = GFXRECON_MAKE_FOURCC('D', 'V', 'I', 'X');
+constexpr uint32_t kDiveBlockIndexVersion = 2;
+
+#pragma pack(push, 4)
+struct DiveBlockIndexFileHeader
+{
+    uint32_t fourcc;
+    uint32_t version;
+    uint64_t file_size;
+    int64_t  file_mtime;
+    uint64_t end_offset;
+    uint32_t uses_frame_markers;
+    uint32_t reserved;
+    uint64_t block_count;
+    uint64_t frame_count;
+    uint64_t state_marker_count;
+};
+#pragma pack(pop)
+
+// Frame-ending API calls used as frame delimiters when the capture has no frame markers. Mirrors
+// FileProcessor::IsFrameDelimiter(format::ApiCallId)
+bool IsFrameDelimiterCall(uint32_t call_id)
+{
+    return (call_id == format::ApiCallId::ApiCall_vkQueuePresentKHR) ||
+           (call_id == format::ApiCallId::ApiCall_vkFrameBoundaryANDROID) ||
+           (call_id == format::ApiCallId::ApiCall_xrEndFrame);
+}
+
+bool QueryFileSize(FILE* fd, uint64_t* file_size)
+{
+    if (!util::platform::FileSeek(fd, 0, util::platform::FileSeekEnd))
+    {
+        return false;
+    }
+    int64_t size = util::platform::FileTell(fd);
+    if (size < 0 || !util::platform::FileSeek(fd, 0, util::platform::FileSeekSet))
+    {
+        return false;
+    }
+    *file_size = static_cast<uint64_t>(size);
+    return true;
+}
+
+// Size and modification time of the capture, used to detect a stale index
+bool QueryFileStamp(const std::string& file_path, uint64_t* file_size, int64_t* file_mtime)
+{
+    std::error_code ec;
+    uintmax_t       size = std::filesystem::file_size(file_path, ec);
+    if (ec)
+    {
+        return false;
+    }
+    std::filesystem::file_time_type mtime = std::filesystem::last_write_time(file_path, ec);
+    if (ec)
+    {
+        return false;
+    }
+    *file_size = static_cast<uint64_t>(size);
+    *file_mtime = static_cast<int64_t>(mtime.time_since_epoch().count());
+    return true;
+}
+
+template<typename T> bool WriteVector(const std::vector<T>& data, FILE* fd)
+{
+    return data.empty() || util::platform::FileWrite(data.data(), data.size() * sizeof(T), fd);
+}
+
+// Counts come from the sidecar, so they are checked against the bytes left in it before allocating
+template<typename T>
+bool ReadVector(std::vector<T>& data, uint64_t count, uint64_t* remaining_bytes, FILE* fd)
+{
+    if (count > *remaining_bytes / sizeof(T))
+    {
+        return false;
+    }
+    *remaining_bytes -= count * sizeof(T);
+    data.resize(count);
+    return data.empty() || util::platform::FileRead(data.data(), data.size() * sizeof(T), fd);
+}
+
+}  // namespace
+
+std::string DiveBlockIndex::GetIndexFilePath(const std::string& gfxr_file_path)
+{
+    return gfxr_file_path + kDiveBlockIndexFileSuffix;
+}
+
+void DiveBlockIndex::Clear()
+{
+    valid_ = false;
+    file_size_ = 0;
+    file_mtime_ = 0;
+    end_offset_ = 0;
+    uses_frame_markers_ = false;
+    frame_first_block_index_ = 0;
+    blocks_.clear();
+    frames_.clear();
+    state_markers_.clear();
+}
+
+bool DiveBlockIndex::Build(const std::string& gfxr_file_path)
+{
+    DIVE_TRACE_SCOPE("BuildGfxrBlockIndex");
+    Clear();
+
+    FILE* fd;
+    int   result = util::platform::FileOpen(&fd, gfxr_file_path.c_str(), "rb");
+    if (result || fd == nullptr)
+    {
+        GFXRECON_LOG_ERROR("Failed to open file %s", gfxr_file_path.c_str());
+        return false;
+    }
+
+    valid_ = ScanBlocks(fd, gfxr_file_path) &&
+             QueryFileStamp(gfxr_file_path, &file_size_, &file_mtime_);
+
+    if (util::platform::FileClose(fd))
+    {
+        GFXRECON_LOG_ERROR("Failed to close file %s", gfxr_file_path.c_str());
+        valid_ = false;
+    }
+
+    if (!valid_)
+    {
+        Clear();
+        return false;
+    }
+
+    DIVE_TRACE_COUNTER("GFXR blocks", GetBlockCount());
+    GFXRECON_LOG_INFO("Indexed %" PRIu64 " blocks and %zu frames of %s",
+                      GetBlockCount(),
+                      frames_.size(),
+                      gfxr_file_path.c_str());
+    return true;
+}
+
+bool DiveBlockIndex::ScanBlocks(FILE* fd, const std::string& gfxr_file_path)
+{
+    uint64_t actual_file_size = 0;
+    if (!QueryFileSize(fd, &actual_file_size))
+    {
+        GFXRECON_LOG_ERROR("Could not determine size of file %s", gfxr_file_path.c_str());
+        return false;
+    }
+
+    format::FileHeader file_header = {};
+    if (!util::platform::FileRead(&file_header, sizeof(file_header), fd) ||
+        !format::ValidateFileHeader(file_header))
+    {
+        GFXRECON_LOG_ERROR("Failed to read file header of %s", gfxr_file_path.c_str());
+        return false;
+    }
+
+    uint64_t offset = sizeof(file_header) + file_header.num_options * sizeof(format::FileOptionPair);
+    if (offset > actual_file_size ||
+        !util::platform::FileSeek(fd, offset, util::platform::FileSeekSet))
+    {
+        GFXRECON_LOG_ERROR("Failed to read file options of %s", gfxr_file_path.c_str());
+        return false;
+    }
+
+    // Block index at which the first frame starts, moved past the state snapshot if there is one
+    uint64_t first_frame_block_index = 0;
+
+    while (offset < actual_file_size)
+    {
+        format::BlockHeader block_header = {};
+        if (!util::platform::FileRead(&block_header, sizeof(block_header), fd))
+        {
+            GFXRECON_LOG_WARNING("Incomplete block header at end of file (offset %" PRIu64 ")",
+                                 offset);
+            break;
+        }
+
+        DiveBlockIndexEntry entry = {};
+        entry.offset = offset;
+        entry.size = sizeof(block_header) + block_header.size;
+        entry.block_type = block_header.type;
+
+        if (offset + entry.size > actual_file_size)
+        {
+            GFXRECON_LOG_WARNING("Incomplete block at end of file (offset %" PRIu64 ")", offset);
+            break;
+        }
+
+        const uint64_t          block_index = blocks_.size();
+        const format::BlockType base_type = format::RemoveCompressedBlockBit(block_header.type);
+
+        // Every recognized block type starts its payload with a 32-bit id
+        if ((base_type != format::BlockType::kUnknownBlock) &&
+            (base_type <= format::BlockType::kMethodCallBlock) &&
+            (block_header.size >= sizeof(entry.id)))
+        {
+            if (!util::platform::FileRead(&entry.id, sizeof(entry.id), fd))
+            {
+                GFXRECON_LOG_ERROR("Failed to read block id at offset %" PRIu64, offset);
+                return false;
+            }
+        }
+
+        uint64_t asset_block_count = 0;
+
+        if ((block_header.type == format::BlockType::kFrameMarkerBlock) ||
+            (block_header.type == format::BlockType::kStateMarkerBlock))
+        {
+            uint64_t frame_number = 0;
+            if (!util::platform::FileRead(&frame_number, sizeof(frame_number), fd))
+            {
+                GFXRECON_LOG_ERROR("Failed to read marker data at offset %" PRIu64, offset);
+                return false;
+            }
+
+            if (block_header.type == format::BlockType::kStateMarkerBlock)
+            {
+                state_markers_.push_back({ block_index, frame_number, entry.id, 0 });
+                if (entry.id == format::MarkerType::kEndMarker)
+                {
+                    first_frame_block_index = block_index + 1;
+                    frame_first_block_index_ = first_frame_block_index;
+                    frames_.clear();
+                }
+            }
+            else if (entry.id == format::MarkerType::kEndMarker)
+            {
+                // The first frame marker resets the frame count, same as FileProcessor
+                if (!uses_frame_markers_)
+                {
+                    uses_frame_markers_ = true;
+                    frame_first_block_index_ = first_frame_block_index;
+                    frames_.clear();
+                }
+                AddFrameDelimiter(block_index, frame_number);
+            }
+        }
+        else if (base_type == format::BlockType::kFunctionCallBlock)
+        {
+            if (!uses_frame_markers_ && IsFrameDelimiterCall(entry.id))
+            {
+                AddFrameDelimiter(block_index, frames_.size());
+            }
+        }
+        else if ((block_header.type == format::BlockType::kMetaDataBlock) &&
+                 (format::GetMetaDataType(entry.id) ==
+                  format::MetaDataType::kExecuteBlocksFromFile))
+        {
+            format::ExecuteBlocksFromFile exec_from_file = {};
+            bool                          success =
+            util::platform::FileRead(&exec_from_file.thread_id,
+                                     sizeof(exec_from_file.thread_id),
+                                     fd) &&
+            util::platform::FileRead(&exec_from_file.n_blocks,
+                                     sizeof(exec_from_file.n_blocks),
+                                     fd) &&
+            util::platform::FileRead(&exec_from_file.offset, sizeof(exec_from_file.offset), fd) &&
+            util::platform::FileRead(&exec_from_file.filename_length,
+                                     sizeof(exec_from_file.filename_length),
+                                     fd);
+
+            std::string filename(success ? exec_from_file.filename_length : 0, '\0');
+            success = success && util::platform::FileRead(filename.data(), filename.size(), fd);
+
+            std::string asset_file_path =
+            util::filepath::Join(util::filepath::GetBasedir(gfxr_file_path), filename);
+            if (!success || !CountAssetFileBlocks(asset_file_path,
+                                                  exec_from_file.offset,
+                                                  exec_from_file.n_blocks,
+                                                  &asset_block_count))
+            {
+                GFXRECON_LOG_ERROR("Failed to index blocks executed from file at offset %" PRIu64,
+                                   offset);
+                return false;
+            }
+        }
+
+        blocks_.push_back(entry);
+        offset += entry.size;
+
+        // FileProcessor attributes blocks read from an asset file to the current .gfxr offset
+        DiveBlockIndexEntry asset_entry = {};
+        asset_entry.offset = offset;
+        blocks_.insert(blocks_.end(), asset_block_count, asset_entry);
+
+        if (!util::platform::FileSeek(fd, offset, util::platform::FileSeekSet))
+        {
+            GFXRECON_LOG_ERROR("Failed to seek to offset %" PRIu64, offset);
+            return false;
+        }
+    }
+
+    // A truncated trailing block is not indexed; file_size_ still records the whole file so the
+    // index matches the capture it was built from
+    end_offset_ = offset;
+    return true;
+}
+
+bool DiveBlockIndex::CountAssetFileBlocks(const std::string& asset_file_path,
+                                          int64_t            offset,
+                                          uint32_t           n_blocks,
+                                          uint64_t*          count) const
+{
+    FILE* fd;
+    int   result = util::platform::FileOpen(&fd, asset_file_path.c_str(), "rb");
+    if (result || fd == nullptr)
+    {
+        GFXRECON_LOG_ERROR("Failed to open file %s", asset_file_path.c_str());
+        return false;
+    }
+
+    uint64_t asset_file_size = 0;
+    bool     success = QueryFileSize(fd, &asset_file_size) &&
+                   util::platform::FileSeek(fd, offset, util::platform::FileSeekSet);
+
+    uint64_t block_count = 0;
+    uint64_t block_offset = static_cast<uint64_t>(offset);
+    while (success && (block_offset < asset_file_size) && (n_blocks == 0 || block_count < n_blocks))
+    {
+        format::BlockHeader block_header = {};
+        success = util::platform::FileRead(&block_header, sizeof(block_header), fd);
+        block_offset += sizeof(block_header) + block_header.size;
+        success = success && util::platform::FileSeek(fd, block_offset, util::platform::FileSeekSet);
+        ++block_count;
+    }
+
+    // When executing till EOF, the failed block header read at EOF also consumes a block index
+    if (n_blocks == 0)
+    {
+        ++block_count;
+    }
+
+    util::platform::FileClose(fd);
+
+    if (!success)
+    {
+        GFXRECON_LOG_ERROR("Failed to scan blocks of %s", asset_file_path.c_str());
+        return false;
+    }
+
+    *count = block_count;
+    return true;
+}
+
+void DiveBlockIndex::AddFrameDelimiter(uint64_t block_index, uint64_t frame_number)
+{
+    frames_.push_back({ frame_number, frame_first_block_index_, block_index });
+    frame_first_block_index_ = block_index + 1;
+}
+
+bool DiveBlockIndex::Save(const std::string& index_file_path) const
+{
+    if (!valid_)
+    {
+        GFXRECON_LOG_ERROR("Cannot save an index that was not built or loaded");
+        return false;
+    }
+
+    FILE* fd;
+    int   result = util::platform::FileOpen(&fd, index_file_path.c_str(), "wb");
+    if (result || fd == nullptr)
+    {
+        GFXRECON_LOG_ERROR("Failed to open file %s", index_file_path.c_str());
+        return false;
+    }
+
+    DiveBlockIndexFileHeader header = {};
+    header.fourcc = kDiveBlockIndexFourCC;
+    header.version = kDiveBlockIndexVersion;
+    header.file_size = file_size_;
+    header.file_mtime = file_mtime_;
+    header.end_offset = end_offset_;
+    header.uses_frame_markers = uses_frame_markers_ ? 1 : 0;
+    header.block_count = blocks_.size();
+    header.frame_count = frames_.size();
+    header.state_marker_count = state_markers_.size();
+
+    bool success = util::platform::FileWrite(&header, sizeof(header), fd) &&
+                   WriteVector(blocks_, fd) && WriteVector(frames_, fd) &&
+                   WriteVector(state_markers_, fd);
+    if (!success)
+    {
+        GFXRECON_LOG_ERROR("Could not write file: %s", index_file_path.c_str());
+    }
+
+    if (util::platform::FileClose(fd))
+    {
+        GFXRECON_LOG_ERROR("Failed to close file %s", index_file_path.c_str());
+        return false;
+    }
+
+    return success;
+}
+
+bool DiveBlockIndex::Load(const std::string& index_file_path, const std::string& gfxr_file_path)
+{
+    Clear();
+
+    uint64_t gfxr_file_size = 0;
+    int64_t  gfxr_file_mtime = 0;
+    if (!QueryFileStamp(gfxr_file_path, &gfxr_file_size, &gfxr_file_mtime))
+    {
+        GFXRECON_LOG_ERROR("Failed to query file %s", gfxr_file_path.c_str());
+        return false;
+    }
+
+    FILE* fd;
+    int   result = util::platform::FileOpen(&fd, index_file_path.c_str(), "rb");
+    if (result || fd == nullptr)
+    {
+        // Not an error, the index may not have been built yet
+        return false;
+    }
+
+    uint64_t                 remaining_bytes = 0;
+    DiveBlockIndexFileHeader header = {};
+    bool success = QueryFileSize(fd, &remaining_bytes) && (remaining_bytes >= sizeof(header)) &&
+                   util::platform::FileRead(&header, sizeof(header), fd);
+    if (success)
+    {
+        remaining_bytes -= sizeof(header);
+    }
+    if (success && ((header.fourcc != kDiveBlockIndexFourCC) ||
+                    (header.version != kDiveBlockIndexVersion)))
+    {
+        GFXRECON_LOG_WARNING("Ignoring index %s with unknown format", index_file_path.c_str());
+        success = false;
+    }
+    else if (success && ((header.file_size != gfxr_file_size) ||
+                         (header.file_mtime != gfxr_file_mtime) ||
+                         (header.end_offset > header.file_size)))
+    {
+        GFXRECON_LOG_WARNING("Ignoring stale index %s", index_file_path.c_str());
+        success = false;
+    }
+
+    success = success && ReadVector(blocks_, header.block_count, &remaining_bytes, fd) &&
+              ReadVector(frames_, header.frame_count, &remaining_bytes, fd) &&
+              ReadVector(state_markers_, header.state_marker_count, &remaining_bytes, fd);
+
+    util::platform::FileClose(fd);
+
+    if (!success)
+    {
+        Clear();
+        return false;
+    }
+
+    file_size_ = header.file_size;
+    file_mtime_ = header.file_mtime;
+    end_offset_ = header.end_offset;
+    uses_frame_markers_ = (header.uses_frame_markers != 0);
+    valid_ = true;
+    return true;
+}
+
+bool DiveBlockIndex::LoadOrBuild(const std::string& gfxr_file_path)
+{
+    std::string index_file_path = GetIndexFilePath(gfxr_file_path);
+    if (Load(index_file_path, gfxr_file_path))
+    {
+        GFXRECON_LOG_INFO("Loaded block index %s", index_file_path.c_str());
+        return true;
+    }
+
+    if (!Build(gfxr_file_path))
+    {
+        return false;
+    }
+
+    // The capture may live in a read-only location, the index is still usable without a sidecar
+    if (!Save(index_file_path))
+    {
+        GFXRECON_LOG_WARNING("Could not write block index %s", index_file_path.c_str());
+    }
+    return true;
+}
+
+bool DiveBlockIndex::PopulateDiveBlockData(DiveBlockData& block_data) const
+{
+    if (!valid_)
+    {
+        GFXRECON_LOG_ERROR("Cannot populate DiveBlockData from an invalid index");
+        return false;
+    }
+
+    for (size_t i = 0; i < blocks_.size(); i++)
+    {
+        if (!block_data.AddOriginalBlock(i, blocks_[i].offset))
+        {
+            return false;
+        }
+    }
+
+    // The file processor also stores the offset of the failed block header read at EOF
+    if (!block_data.AddOriginalBlock(blocks_.size(), end_offset_))
+    {
+        return false;
+    }
+
+    return block_data.FinalizeOriginalBlocksMapSizes();
+}
+
+const DiveBlockIndexEntry& DiveBlockIndex::GetBlock(uint64_t block_index) const
+{
+    GFXRECON_ASSERT(block_index < blocks_.size());
+    return blocks_[block_index];
+}
+
+bool DiveBlockIndex::GetStateEndMarker(DiveStateMarker* marker) const
+{
+    for (const DiveStateMarker& state_marker : state_markers_)
+    {
+        if (state_marker.marker_type == format::MarkerType::kEndMarker)
+        {
+            *marker = state_marker;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t DiveBlockIndex::GetFrameIndexForBlock(uint64_t block_index) const
+{
+    auto it = std::lower_bound(frames_.begin(),
+                               frames_.end(),
+                               block_index,
+                               [](const DiveFrameBoundary& frame, uint64_t index) {
+                                   return frame.last_block_index < index;
+                               });
+    return static_cast<uint64_t>(it - frames_.begin());
+}
+
+GFXRECON_END_NAMESPACE(decode)
+GFXRECON_END_NAMESPACE(gfxrecon)
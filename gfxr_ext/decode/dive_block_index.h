@@ -0,0 +1,137 @@
+/*
+Copyright 2025 Google Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+// Implementing a block offset index is necessary to support these changes:
+// - Random access into a GFXR file (seek to a frame or block) without decoding what comes before
+// - Populating DiveBlockData from block headers only, skipping all parameter payloads
+
+#ifndef GFXRECON_DECODE_DIVE_BLOCK_INDEX_H
+#define GFXRECON_DECODE_DIVE_BLOCK_INDEX_H
+
+#include "util/defines.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Suffix appended to the capture file path to get the path of the index sidecar file
+static constexpr const char* kDiveBlockIndexFileSuffix = ".diveidx";
+
+GFXRECON_BEGIN_NAMESPACE(gfxrecon)
+GFXRECON_BEGIN_NAMESPACE(decode)
+
+class DiveBlockData;
+
+// One entry per block index as counted by FileProcessor::block_index_
+struct DiveBlockIndexEntry
+{
+    // Offset of the block header in the .gfxr file. For blocks executed from an asset file this is
+    // the .gfxr offset at the time the block was processed, matching DiveFileProcessor
+    uint64_t offset = 0;
+    // Size of the block in the .gfxr file, header included. 0 for blocks stored in an asset file
+    uint64_t size = 0;
+    // format::BlockType, with the compressed bit preserved
+    uint32_t block_type = 0;
+    // ApiCallId, MetaDataId, MarkerType or AnnotationType depending on block_type
+    uint32_t id = 0;
+
+    bool IsInAssetFile() const { return size == 0; }
+};
+
+// Block range [first_block_index, last_block_index] of a frame, delimiter included
+struct DiveFrameBoundary
+{
+    uint64_t frame_number = 0;
+    uint64_t first_block_index = 0;
+    uint64_t last_block_index = 0;
+};
+
+struct DiveStateMarker
+{
+    uint64_t block_index = 0;
+    uint64_t frame_number = 0;
+    uint32_t marker_type = 0;
+    uint32_t reserved = 0;
+};
+
+class DiveBlockIndex
+{
+public:
+    // Returns the path of the index sidecar file for the given capture file
+    static std::string GetIndexFilePath(const std::string& gfxr_file_path);
+
+    // Scans the block headers of the capture file, seeking over block payloads
+    bool Build(const std::string& gfxr_file_path);
+
+    // Writes/reads the compact binary index. Load fails if the index doesn't match the capture
+    // file size and modification time, in which case the index should be rebuilt
+    bool Save(const std::string& index_file_path) const;
+    bool Load(const std::string& index_file_path, const std::string& gfxr_file_path);
+
+    // Loads the sidecar next to the capture file, or builds it and writes the sidecar
+    bool LoadOrBuild(const std::string& gfxr_file_path);
+
+    // Adds every block to block_data as DiveFileProcessor would during a full pass, and finalizes
+    // the block sizes
+    bool PopulateDiveBlockData(DiveBlockData& block_data) const;
+
+    bool                                  IsValid() const { return valid_; }
+    uint64_t                              GetFileSize() const { return file_size_; }
+    // End of the last complete block, less than GetFileSize() if the trailing block is truncated
+    uint64_t                              GetEndOffset() const { return end_offset_; }
+    uint64_t                              GetBlockCount() const { return blocks_.size(); }
+    const DiveBlockIndexEntry&            GetBlock(uint64_t block_index) const;
+    const std::vector<DiveFrameBoundary>& GetFrames() const { return frames_; }
+    const std::vector<DiveStateMarker>&   GetStateMarkers() const { return state_markers_; }
+    bool                                  UsesFrameMarkers() const { return uses_frame_markers_; }
+
+    // Returns false if the capture has no state end marker (not a trimmed capture)
+    bool GetStateEndMarker(DiveStateMarker* marker) const;
+
+    // Returns the position of the frame containing block_index in GetFrames(). Blocks after the
+    // last frame delimiter belong to GetFrames().size()
+    uint64_t GetFrameIndexForBlock(uint64_t block_index) const;
+
+private:
+    bool ScanBlocks(FILE* fd, const std::string& gfxr_file_path);
+
+    // Counts the blocks that FileProcessor processes from an asset file for a
+    // kExecuteBlocksFromFile meta data block, including the block index consumed by reaching EOF
+    bool CountAssetFileBlocks(const std::string& asset_file_path,
+                              int64_t            offset,
+                              uint32_t           n_blocks,
+                              uint64_t*          count) const;
+
+    void AddFrameDelimiter(uint64_t block_index, uint64_t frame_number);
+
+    void Clear();
+
+    bool                             valid_ = false;
+    uint64_t                         file_size_ = 0;
+    int64_t                          file_mtime_ = 0;
+    uint64_t                         end_offset_ = 0;
+    bool                             uses_frame_markers_ = false;
+    uint64_t                         frame_first_block_index_ = 0;
+    std::vector<DiveBlockIndexEntry> blocks_ = {};
+    std::vector<DiveFrameBoundary>   frames_ = {};
+    std::vector<DiveStateMarker>     state_markers_ = {};
+};
+
+GFXRECON_END_NAMESPACE(decode)
+GFXRECON_END_NAMESPACE(gfxrecon)
+
+#endif  // GFXRECON_DECODE_DIVE_BLOCK_INDEX_H
@@ -0,0 +1,244 @@
+/*
+ Copyright 2025 Google LLC
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#include "dive_block_index.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+
+#include "format/format.h"
+
+#include "dive_block_data.h"
+#include "dive_gfxr_test_capture.h"
+
+namespace gfxrecon::decode
+{
+namespace
+{
+
+class DiveBlockIndexTestFixture : public DiveGfxrCaptureTestFixture
+{
+protected:
+    DiveBlockIndexTestFixture() : DiveGfxrCaptureTestFixture("dive_block_index_test") {}
+
+    void SetUp() override
+    {
+        DiveGfxrCaptureTestFixture::SetUp();
+        std::filesystem::remove(DiveBlockIndex::GetIndexFilePath(gfxr_path));
+    }
+
+    // Trimmed capture: state snapshot followed by two frames ending with frame markers
+    void CreateTrimmedCapture()
+    {
+        AppendTrimmedCaptureStart(5);
+        offsets.push_back(AppendBlock(format::kFunctionCallBlock,
+                                      format::ApiCallId::ApiCall_vkCmdDraw,
+                                      100));
+        offsets.push_back(AppendBlock(format::kFunctionCallBlock,
+                                      format::ApiCallId::ApiCall_vkQueuePresentKHR,
+                                      10));
+        offsets.push_back(AppendMarker(format::kFrameMarkerBlock, format::kEndMarker, 5));
+        offsets.push_back(AppendBlock(format::kCompressedFunctionCallBlock,
+                                      format::ApiCallId::ApiCall_vkCmdDraw,
+                                      30));
+        offsets.push_back(AppendMarker(format::kFrameMarkerBlock, format::kEndMarker, 6));
+        WriteCapture();
+    }
+
+    DiveBlockIndex index = {};
+};
+
+TEST_F(DiveBlockIndexTestFixture, Build_MissingFile_Fail)
+{
+    EXPECT_FALSE(index.Build(gfxr_path));
+    EXPECT_FALSE(index.IsValid());
+}
+
+TEST_F(DiveBlockIndexTestFixture, Build_InvalidFourCC_Fail)
+{
+    file.resize(sizeof(format::FileHeader), 0);
+    WriteCapture();
+    EXPECT_FALSE(index.Build(gfxr_path));
+}
+
+TEST_F(DiveBlockIndexTestFixture, Build_BlockOffsets_Success)
+{
+    CreateTrimmedCapture();
+    ASSERT_TRUE(index.Build(gfxr_path));
+    ASSERT_EQ(index.GetBlockCount(), offsets.size());
+    for (size_t i = 0; i < offsets.size(); i++)
+    {
+        EXPECT_EQ(index.GetBlock(i).offset, offsets[i]);
+    }
+    EXPECT_EQ(index.GetBlock(3).id, format::ApiCallId::ApiCall_vkCmdDraw);
+    EXPECT_EQ(index.GetBlock(6).block_type, format::kCompressedFunctionCallBlock);
+    EXPECT_EQ(index.GetBlock(7).size, file.size() - offsets[7]);
+    EXPECT_EQ(index.GetFileSize(), file.size());
+}
+
+TEST_F(DiveBlockIndexTestFixture, Build_FramesAndStateMarkers_Success)
+{
+    CreateTrimmedCapture();
+    ASSERT_TRUE(index.Build(gfxr_path));
+    EXPECT_TRUE(index.UsesFrameMarkers());
+
+    // The present call is not a delimiter since the capture has frame markers
+    const std::vector<DiveFrameBoundary>& frames = index.GetFrames();
+    ASSERT_EQ(frames.size(), 2u);
+    EXPECT_EQ(frames[0].frame_number, 5u);
+    EXPECT_EQ(frames[0].first_block_index, 3u);
+    EXPECT_EQ(frames[0].last_block_index, 5u);
+    EXPECT_EQ(frames[1].frame_number, 6u);
+    EXPECT_EQ(frames[1].first_block_index, 6u);
+    EXPECT_EQ(frames[1].last_block_index, 7u);
+
+    DiveStateMarker state_end = {};
+    ASSERT_TRUE(index.GetStateEndMarker(&state_end));
+    EXPECT_EQ(state_end.block_index, 2u);
+    EXPECT_EQ(index.GetStateMarkers().size(), 2u);
+
+    EXPECT_EQ(index.GetFrameIndexForBlock(4), 0u);
+    EXPECT_EQ(index.GetFrameIndexForBlock(6), 1u);
+}
+
+TEST_F(DiveBlockIndexTestFixture, Build_PresentDelimiters_Success)
+{
+    AppendFileHeader();
+    AppendBlock(format::kFunctionCallBlock, format::ApiCallId::ApiCall_vkCmdDraw, 8);
+    AppendBlock(format::kFunctionCallBlock, format::ApiCallId::ApiCall_vkQueuePresentKHR, 8);
+    AppendBlock(format::kFunctionCallBlock, format::ApiCallId::ApiCall_vkQueuePresentKHR, 8);
+    WriteCapture();
+
+    ASSERT_TRUE(index.Build(gfxr_path));
+    EXPECT_FALSE(index.UsesFrameMarkers());
+    ASSERT_EQ(index.GetFrames().size(), 2u);
+    EXPECT_EQ(index.GetFrames()[0].first_block_index, 0u);
+    EXPECT_EQ(index.GetFrames()[0].last_block_index, 1u);
+    EXPECT_EQ(index.GetFrames()[1].first_block_index, 2u);
+}
+
+TEST_F(DiveBlockIndexTestFixture, SaveLoad_RoundTrip_Success)
+{
+    CreateTrimmedCapture();
+    ASSERT_TRUE(index.Build(gfxr_path));
+    std::string index_path = DiveBlockIndex::GetIndexFilePath(gfxr_path);
+    ASSERT_TRUE(index.Save(index_path));
+
+    DiveBlockIndex loaded = {};
+    ASSERT_TRUE(loaded.Load(index_path, gfxr_path));
+    ASSERT_EQ(loaded.GetBlockCount(), index.GetBlockCount());
+    for (uint64_t i = 0; i < index.GetBlockCount(); i++)
+    {
+        EXPECT_EQ(loaded.GetBlock(i).offset, index.GetBlock(i).offset);
+        EXPECT_EQ(loaded.GetBlock(i).size, index.GetBlock(i).size);
+        EXPECT_EQ(loaded.GetBlock(i).block_type, index.GetBlock(i).block_type);
+        EXPECT_EQ(loaded.GetBlock(i).id, index.GetBlock(i).id);
+    }
+    EXPECT_EQ(loaded.GetFrames().size(), index.GetFrames().size());
+    EXPECT_EQ(loaded.GetStateMarkers().size(), index.GetStateMarkers().size());
+    EXPECT_TRUE(loaded.UsesFrameMarkers());
+}
+
+TEST_F(DiveBlockIndexTestFixture, Load_StaleIndex_Fail)
+{
+    CreateTrimmedCapture();
+    ASSERT_TRUE(index.LoadOrBuild(gfxr_path));
+
+    AppendBlock(format::kFunctionCallBlock, format::ApiCallId::ApiCall_vkCmdDraw, 8);
+    WriteCapture();
+
+    DiveBlockIndex loaded = {};
+    EXPECT_FALSE(loaded.Load(DiveBlockIndex::GetIndexFilePath(gfxr_path), gfxr_path));
+    EXPECT_TRUE(loaded.LoadOrBuild(gfxr_path));
+    EXPECT_EQ(loaded.GetBlockCount(), offsets.size() + 1);
+}
+
+TEST_F(DiveBlockIndexTestFixture, Load_ModifiedSameSize_Fail)
+{
+    CreateTrimmedCapture();
+    ASSERT_TRUE(index.LoadOrBuild(gfxr_path));
+
+    // Same size, different content and modification time
+    file.back() = '\x01';
+    WriteCapture();
+    std::filesystem::last_write_time(gfxr_path,
+                                     std::filesystem::last_write_time(gfxr_path) +
+                                     std::chrono::seconds(10));
+
+    DiveBlockIndex loaded = {};
+    EXPECT_FALSE(loaded.Load(DiveBlockIndex::GetIndexFilePath(gfxr_path), gfxr_path));
+}
+
+TEST_F(DiveBlockIndexTestFixture, Load_TruncatedTrailingBlock_Success)
+{
+    CreateTrimmedCapture();
+    AppendBlock(format::kFunctionCallBlock, format::ApiCallId::ApiCall_vkCmdDraw, 32);
+    file.resize(file.size() - 16);
+    WriteCapture();
+
+    ASSERT_TRUE(index.LoadOrBuild(gfxr_path));
+    EXPECT_EQ(index.GetBlockCount(), offsets.size());
+    EXPECT_EQ(index.GetFileSize(), file.size());
+    EXPECT_LT(index.GetEndOffset(), index.GetFileSize());
+
+    // The index still matches the capture it was built from
+    DiveBlockIndex loaded = {};
+    ASSERT_TRUE(loaded.Load(DiveBlockIndex::GetIndexFilePath(gfxr_path), gfxr_path));
+    EXPECT_EQ(loaded.GetEndOffset(), index.GetEndOffset());
+}
+
+TEST_F(DiveBlockIndexTestFixture, Load_CorruptBlockCount_Fail)
+{
+    CreateTrimmedCapture();
+    ASSERT_TRUE(index.LoadOrBuild(gfxr_path));
+    std::string index_path = DiveBlockIndex::GetIndexFilePath(gfxr_path);
+
+    // Overwrite the block count of the header with a count larger than the sidecar
+    std::fstream sidecar(index_path, std::ios::binary | std::ios::in | std::ios::out);
+    const uint64_t block_count_offset = 4 * sizeof(uint32_t) + 3 * sizeof(uint64_t);
+    const uint64_t huge_count = UINT64_MAX / 2;
+    sidecar.seekp(block_count_offset);
+    sidecar.write(reinterpret_cast<const char*>(&huge_count), sizeof(huge_count));
+    sidecar.close();
+
+    DiveBlockIndex loaded = {};
+    EXPECT_FALSE(loaded.Load(index_path, gfxr_path));
+    EXPECT_FALSE(loaded.IsValid());
+}
+
+TEST_F(DiveBlockIndexTestFixture, PopulateDiveBlockData_Success)
+{
+    CreateTrimmedCapture();
+    ASSERT_TRUE(index.Build(gfxr_path));
+
+    DiveBlockData block_data = {};
+    ASSERT_TRUE(index.PopulateDiveBlockData(block_data));
+    EXPECT_TRUE(block_data.IsOriginalBlocksMapLocked());
+
+    TestBlockVisitor visitor = {};
+    ASSERT_TRUE(block_data.TraverseBlocks(visitor));
+    std::vector<std::string> traversed = visitor.GetTraversedPathString();
+    ASSERT_EQ(traversed.size(), offsets.size());
+    EXPECT_EQ(traversed[0],
+              "original, offset:" + std::to_string(offsets[0]) +
+              ", size:" + std::to_string(offsets[1] - offsets[0]));
+}
+
+}  // namespace
+}  // namespace gfxrecon::decode
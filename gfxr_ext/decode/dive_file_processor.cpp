@@ -18,6 +18,7 @@ limitations under the License.
 
 #include "dive_file_processor.h"
 
+#include <cinttypes>
 #include <fstream>
 
 #include "util/logging.h"
@@ -29,6 +30,7 @@ limitations under the License.
 
 #include "capture_service/constants.h"
 #include "capture_service/remote_files.h"
+#include "common/trace.h"
 
 GFXRECON_BEGIN_NAMESPACE(gfxrecon)
 GFXRECON_BEGIN_NAMESPACE(decode)
@@ -64,9 +66,107 @@ void DiveFileProcessor::SetDiveBlockData(std::shared_ptr<DiveBlockData> p_block_
     run_without_decoders_ = true;
 }
 
+void DiveFileProcessor::SetDiveBlockIndex(std::shared_ptr<const DiveBlockIndex> p_block_index)
+{
+    dive_block_index_ = p_block_index;
+}
+
+bool DiveFileProcessor::SeekToBlock(uint64_t block_index)
+{
+    if (!dive_block_index_ || !dive_block_index_->IsValid())
+    {
+        GFXRECON_LOG_ERROR("Seeking requires a valid DiveBlockIndex");
+        return false;
+    }
+
+    if (dive_block_data_)
+    {
+        GFXRECON_LOG_ERROR("Cannot seek while populating DiveBlockData");
+        return false;
+    }
+
+    if (block_index >= dive_block_index_->GetBlockCount())
+    {
+        GFXRECON_LOG_ERROR("Block index (%" PRIu64 ") is out of bounds, block count: %" PRIu64,
+                           block_index,
+                           dive_block_index_->GetBlockCount());
+        return false;
+    }
+
+    const DiveBlockIndexEntry& entry = dive_block_index_->GetBlock(block_index);
+    if (entry.IsInAssetFile())
+    {
+        GFXRECON_LOG_ERROR("Cannot seek to block (%" PRIu64 ") stored in an asset file",
+                           block_index);
+        return false;
+    }
+
+    if (gfxr_file_name_.empty())
+    {
+        gfxr_file_name_ = GetActiveFilename();
+    }
+
+    if (!SeekActiveFile(gfxr_file_name_,
+                        static_cast<int64_t>(entry.offset),
+                        util::platform::FileSeekSet))
+    {
+        GFXRECON_LOG_ERROR("Could not seek block at offset %" PRIu64, entry.offset);
+        return false;
+    }
+
+    block_index_ = block_index;
+    current_frame_number_ = kFirstFrame + dive_block_index_->GetFrameIndexForBlock(block_index);
+    if (dive_block_index_->UsesFrameMarkers())
+    {
+        SetUsesFrameMarkers(true);
+    }
+
+    // The state end marker may have been skipped, take the loop target from the index instead
+    DiveStateMarker state_end_marker = {};
+    if (dive_block_index_->GetStateEndMarker(&state_end_marker))
+    {
+        const DiveBlockIndexEntry& marker_entry =
+        dive_block_index_->GetBlock(state_end_marker.block_index);
+        state_end_marker_block_index_ = state_end_marker.block_index;
+        state_end_marker_file_offset_ = static_cast<int64_t>(marker_entry.offset + marker_entry.size);
+    }
+
+    return true;
+}
+
+bool DiveFileProcessor::SeekToFrame(uint64_t frame_index)
+{
+    if (!dive_block_index_ || !dive_block_index_->IsValid())
+    {
+        GFXRECON_LOG_ERROR("Seeking requires a valid DiveBlockIndex");
+        return false;
+    }
+
+    const std::vector<DiveFrameBoundary>& frames = dive_block_index_->GetFrames();
+    if (frame_index >= frames.size())
+    {
+        GFXRECON_LOG_ERROR("Frame (%" PRIu64 ") is out of bounds, frame count: %zu",
+                           frame_index,
+                           frames.size());
+        return false;
+    }
+
+    return SeekToBlock(frames[frame_index].first_block_index);
+}
+
+void DiveFileProcessor::SetLastBlockIndex(uint64_t last_block_index)
+{
+    SetBlockLimit(last_block_index);
+}
+
+std::string DiveFileProcessor::GetOutputFilePath(const std::string& name) const
+{
+    return absolute_path_ + "/" + name;
+}
+
 bool DiveFileProcessor::WriteFile(const std::string& name, const std::string& content)
 {
-    std::string new_file_path = absolute_path_ + "/" + name;
+    std::string new_file_path = GetOutputFilePath(name);
 
     FILE* fd;
     int   result = util::platform::FileOpen(&fd, new_file_path.c_str(), "wb");
@@ -110,6 +210,11 @@ bool DiveFileProcessor::ProcessFrameMarker(const format::BlockHeader& block_head
         GFXRECON_ASSERT((marker_type != format::kEndMarker) || (!UsesFrameMarkers()) ||
                         (frame_number == GetFirstFrame()));
 
+        if (marker_type == format::kEndMarker)
+        {
+            DIVE_TRACE_COUNTER("GFXR blocks", block_index_);
+        }
+
         for (auto decoder : decoders_)
         {
             if (marker_type == format::kEndMarker)
@@ -16,6 +16,7 @@ limitations under the License.
 
 // Implementing a custom file processor is necessary to support these changes:
 // - Loop a single frame for N times, or infinitely
+// - Seek to a frame or block range using a DiveBlockIndex
 
 #ifndef GFXRECON_DECODE_DIVE_FILE_PROCESSOR_H
 #define GFXRECON_DECODE_DIVE_FILE_PROCESSOR_H
@@ -25,6 +26,7 @@ limitations under the License.
 #include "decode/file_processor.h"
 
 #include "dive_block_data.h"
+#include "dive_block_index.h"
 
 GFXRECON_BEGIN_NAMESPACE(gfxrecon)
 GFXRECON_BEGIN_NAMESPACE(decode)
@@ -36,6 +38,22 @@ public:
 
     void SetDiveBlockData(std::shared_ptr<DiveBlockData> p_block_data);
 
+    // Index used for random access. Must describe the file passed to Initialize()
+    void SetDiveBlockIndex(std::shared_ptr<const DiveBlockIndex> p_block_index);
+
+    // Positions the processor at the given block or at the first block of the frame at position
+    // frame_index in DiveBlockIndex::GetFrames(). Must be called after Initialize() and before
+    // processing. Not compatible with SetDiveBlockData(), which needs every block.
+    bool SeekToBlock(uint64_t block_index);
+    bool SeekToFrame(uint64_t frame_index);
+
+    // Stops processing after last_block_index, inclusive
+    void SetLastBlockIndex(uint64_t last_block_index);
+
+    // Returns the path of a file named name in the same dir as the capture file. Must be called
+    // after Initialize()
+    std::string GetOutputFilePath(const std::string& name) const;
+
     // Writes content to a new file that is put in the same dir as the capture file,
     // overwriting existing file if present
     bool WriteFile(const std::string& name, const std::string& content);
@@ -64,6 +82,9 @@ private:
     // modifications
     std::shared_ptr<DiveBlockData> dive_block_data_ = nullptr;
 
+    // Block offsets, frame boundaries and state markers of the GFXR file for seeking
+    std::shared_ptr<const DiveBlockIndex> dive_block_index_ = nullptr;
+
     // Need to store this because the active file is sometimes the .gfxa one
     std::string gfxr_file_name_ = "";
 };
@@ -0,0 +1,295 @@
+/*
+Copyright 2025 Google Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "dive_gfxr_slice.h"
+
+#include <cinttypes>
+#include <filesystem>
+#include <memory>
+#include <system_error>
+#include <vector>
+
+#include "format/api_call_id.h"
+#include "format/format.h"
+#include "util/logging.h"
+#include "util/platform.h"
+
+#include "dive_block_index.h"
+
+GFXRECON_BEGIN_NAMESPACE(gfxrecon)
+GFXRECON_BEGIN_NAMESPACE(decode)
+
+namespace
+{
+
+constexpr uint64_t kDiveSliceBufferSize = 1024 * 1024;
+
+// Byte range [begin, end) of the original file
+struct ByteRange
+{
+    uint64_t begin = 0;
+    uint64_t end = 0;
+};
+
+bool CopyByteRange(FILE* original_fd, FILE* new_fd, const ByteRange& range, uint8_t* buffer)
+{
+    if (!util::platform::FileSeek(original_fd,
+                                  static_cast<int64_t>(range.begin),
+                                  util::platform::FileSeekSet))
+    {
+        GFXRECON_LOG_ERROR("Could not seek to offset %" PRIu64 " in original file", range.begin);
+        return false;
+    }
+
+    uint64_t bytes_left_to_copy = range.end - range.begin;
+    while (bytes_left_to_copy > 0)
+    {
+        uint64_t bytes_to_copy = bytes_left_to_copy;
+        if (bytes_left_to_copy > kDiveSliceBufferSize)
+        {
+            bytes_to_copy = kDiveSliceBufferSize;
+        }
+        bytes_left_to_copy -= bytes_to_copy;
+
+        if (!util::platform::FileRead(buffer, bytes_to_copy, original_fd))
+        {
+            GFXRECON_LOG_ERROR("Could not read %" PRIu64 " bytes from original file",
+                               bytes_to_copy);
+            return false;
+        }
+        if (!util::platform::FileWrite(buffer, bytes_to_copy, new_fd))
+        {
+            GFXRECON_LOG_ERROR("Could not write %" PRIu64 " bytes to new file", bytes_to_copy);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Calls that submit, present or wait for the work of a frame. In the skipped frames they are
+// dropped, while the calls creating objects, updating memory or recording command buffers are kept.
+// Fences are neither reset nor waited for, so they keep the state they had before the skipped
+// frames.
+bool IsFrameWorkCall(uint32_t call_id)
+{
+    switch (call_id)
+    {
+    case format::ApiCallId::ApiCall_vkQueueSubmit:
+    case format::ApiCallId::ApiCall_vkQueueSubmit2:
+    case format::ApiCallId::ApiCall_vkQueueSubmit2KHR:
+    case format::ApiCallId::ApiCall_vkQueuePresentKHR:
+    case format::ApiCallId::ApiCall_vkAcquireNextImageKHR:
+    case format::ApiCallId::ApiCall_vkAcquireNextImage2KHR:
+    case format::ApiCallId::ApiCall_vkFrameBoundaryANDROID:
+    case format::ApiCallId::ApiCall_vkQueueWaitIdle:
+    case format::ApiCallId::ApiCall_vkDeviceWaitIdle:
+    case format::ApiCallId::ApiCall_vkWaitForFences:
+    case format::ApiCallId::ApiCall_vkResetFences:
+    case format::ApiCallId::ApiCall_vkGetFenceStatus:
+    case format::ApiCallId::ApiCall_vkWaitSemaphores:
+    case format::ApiCallId::ApiCall_vkWaitSemaphoresKHR:
+    case format::ApiCallId::ApiCall_vkGetQueryPoolResults:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Appends [begin, end) to ranges, extending the last range if they are contiguous
+void AppendByteRange(std::vector<ByteRange>* ranges, uint64_t begin, uint64_t end)
+{
+    if (begin == end)
+    {
+        return;
+    }
+    if (!ranges->empty() && ranges->back().end == begin)
+    {
+        ranges->back().end = end;
+        return;
+    }
+    ranges->push_back({ begin, end });
+}
+
+// Whether a block skipped between the preamble and the range is copied
+bool IsSkippedBlockKept(const DiveBlockIndexEntry& block)
+{
+    const uint32_t block_type = block.block_type & ~format::kCompressedBlockTypeBit;
+    if (block_type == format::kFrameMarkerBlock)
+    {
+        return false;
+    }
+    if (block_type == format::kFunctionCallBlock || block_type == format::kMethodCallBlock)
+    {
+        return !IsFrameWorkCall(block.id);
+    }
+    return true;
+}
+
+}  // namespace
+
+uint64_t GetPreambleBlockCount(const DiveBlockIndex& block_index)
+{
+    const std::vector<DiveFrameBoundary>& frames = block_index.GetFrames();
+    if (frames.empty())
+    {
+        return block_index.GetBlockCount();
+    }
+    return frames.front().first_block_index;
+}
+
+bool GetFrameRangeBlocks(const DiveBlockIndex& block_index,
+                         uint64_t              first_frame,
+                         uint64_t              last_frame,
+                         uint64_t*             first_block_index,
+                         uint64_t*             last_block_index)
+{
+    GFXRECON_ASSERT(first_block_index != nullptr);
+    GFXRECON_ASSERT(last_block_index != nullptr);
+
+    const std::vector<DiveFrameBoundary>& frames = block_index.GetFrames();
+    if (first_frame > last_frame || last_frame >= frames.size())
+    {
+        GFXRECON_LOG_ERROR("Invalid frame range [%" PRIu64 ", %" PRIu64 "], capture has %zu frames",
+                           first_frame,
+                           last_frame,
+                           frames.size());
+        return false;
+    }
+
+    *first_block_index = frames[first_frame].first_block_index;
+    *last_block_index = frames[last_frame].last_block_index;
+    return true;
+}
+
+bool WriteGfxrBlockRange(const DiveBlockIndex& block_index,
+                         const std::string&    gfxr_file_path,
+                         const std::string&    new_file_path,
+                         uint64_t              first_block_index,
+                         uint64_t              last_block_index)
+{
+    const uint64_t block_count = block_index.GetBlockCount();
+    if (first_block_index > last_block_index || last_block_index >= block_count)
+    {
+        GFXRECON_LOG_ERROR("Invalid block range [%" PRIu64 ", %" PRIu64
+                           "], capture has %" PRIu64 " blocks",
+                           first_block_index,
+                           last_block_index,
+                           block_count);
+        return false;
+    }
+
+    std::error_code error;
+    if (std::filesystem::equivalent(gfxr_file_path, new_file_path, error))
+    {
+        GFXRECON_LOG_ERROR("Cannot overwrite the original file %s", gfxr_file_path.c_str());
+        return false;
+    }
+
+    // The blocks executed from an asset file are loaded by the ExecuteBlocksFromFile meta data
+    // block preceding them, which can't run part of them
+    const DiveBlockIndexEntry& first_block = block_index.GetBlock(first_block_index);
+    if (first_block.IsInAssetFile())
+    {
+        GFXRECON_LOG_ERROR("Block range [%" PRIu64 ", %" PRIu64
+                           "] starts in blocks executed from an asset file",
+                           first_block_index,
+                           last_block_index);
+        return false;
+    }
+
+    // The file header, the meta data and the state snapshot are always kept. The blocks skipped
+    // between the preamble and first_block_index are kept too, except for the frame markers and
+    // the calls of IsFrameWorkCall(). Blocks executed from an asset file have no bytes in the .gfxr
+    // file, their ExecuteBlocksFromFile block is copied instead.
+    std::vector<ByteRange> ranges;
+    AppendByteRange(&ranges, 0, block_index.GetBlock(0).offset);
+    const uint64_t preamble_block_count = GetPreambleBlockCount(block_index);
+    uint64_t       dropped_block_count = 0;
+    bool           uses_asset_file = false;
+    for (uint64_t i = 0; i <= last_block_index; ++i)
+    {
+        const DiveBlockIndexEntry& block = block_index.GetBlock(i);
+        if (block.IsInAssetFile())
+        {
+            uses_asset_file = true;
+            continue;
+        }
+        if (i >= preamble_block_count && i < first_block_index && !IsSkippedBlockKept(block))
+        {
+            dropped_block_count++;
+            continue;
+        }
+        AppendByteRange(&ranges, block.offset, block.offset + block.size);
+    }
+
+    if (dropped_block_count > 0)
+    {
+        GFXRECON_LOG_WARNING("Dropped %" PRIu64 " frame markers and submit, present or wait calls "
+                             "before block %" PRIu64 ": the work of the skipped frames isn't "
+                             "replayed",
+                             dropped_block_count,
+                             first_block_index);
+    }
+    if (uses_asset_file)
+    {
+        GFXRECON_LOG_WARNING("Blocks are executed from an asset file, which must be copied next "
+                             "to %s",
+                             new_file_path.c_str());
+    }
+
+    FILE* original_fd;
+    int   result = util::platform::FileOpen(&original_fd, gfxr_file_path.c_str(), "rb");
+    if (result || original_fd == nullptr)
+    {
+        GFXRECON_LOG_ERROR("Failed to open file %s", gfxr_file_path.c_str());
+        return false;
+    }
+
+    FILE* new_fd;
+    result = util::platform::FileOpen(&new_fd, new_file_path.c_str(), "wb");
+    if (result || new_fd == nullptr)
+    {
+        GFXRECON_LOG_ERROR("Failed to open file %s", new_file_path.c_str());
+        util::platform::FileClose(original_fd);
+        return false;
+    }
+
+    std::unique_ptr<uint8_t[]> buffer = std::make_unique<uint8_t[]>(kDiveSliceBufferSize);
+    bool                       success = true;
+    for (const ByteRange& range : ranges)
+    {
+        if (!CopyByteRange(original_fd, new_fd, range, buffer.get()))
+        {
+            success = false;
+            break;
+        }
+    }
+
+    if (util::platform::FileClose(original_fd))
+    {
+        GFXRECON_LOG_ERROR("Failed to close file %s", gfxr_file_path.c_str());
+        success = false;
+    }
+    if (util::platform::FileClose(new_fd))
+    {
+        GFXRECON_LOG_ERROR("Failed to close file %s", new_file_path.c_str());
+        success = false;
+    }
+    return success;
+}
+
+GFXRECON_END_NAMESPACE(decode)
+GFXRECON_END_NAMESPACE(gfxrecon)
@@ -0,0 +1,65 @@
+/*
+Copyright 2025 Google Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+// Implementing capture slicing from a DiveBlockIndex is necessary to support these changes:
+// - Extract a few frames of a large trimmed capture into a small capture that replays on its own
+// - Copy the kept blocks as byte ranges of the original file, without decoding or re-encoding them
+
+#ifndef GFXRECON_DECODE_DIVE_GFXR_SLICE_H
+#define GFXRECON_DECODE_DIVE_GFXR_SLICE_H
+
+#include "util/defines.h"
+
+#include <cstdint>
+#include <string>
+
+GFXRECON_BEGIN_NAMESPACE(gfxrecon)
+GFXRECON_BEGIN_NAMESPACE(decode)
+
+class DiveBlockIndex;
+
+// Returns the index of the first block of the first frame, i.e. the number of blocks before the
+// frames (the state snapshot of a trimmed capture, and the meta data preceding it)
+uint64_t GetPreambleBlockCount(const DiveBlockIndex& block_index);
+
+// Gets the block range [first_block_index, last_block_index] of the frames [first_frame,
+// last_frame], frame indices being positions in DiveBlockIndex::GetFrames(). Returns false if a
+// frame is out of range
+bool GetFrameRangeBlocks(const DiveBlockIndex& block_index,
+                         uint64_t              first_frame,
+                         uint64_t              last_frame,
+                         uint64_t*             first_block_index,
+                         uint64_t*             last_block_index);
+
+// Writes a capture made of the file header, the preamble blocks (see GetPreambleBlockCount()) and
+// the blocks [first_block_index, last_block_index] of the indexed capture. Blocks are copied as
+// contiguous byte ranges of the original file.
+//
+// Of the blocks skipped between the preamble and first_block_index, the frame markers and the
+// calls that submit, present or wait for work are dropped, and the others (object creation, memory
+// updates, command buffer recording, meta data) are kept. The GPU work of the skipped frames isn't
+// replayed, so the range should start at a steady-state frame. Fails if first_block_index is a
+// block executed from an asset file.
+bool WriteGfxrBlockRange(const DiveBlockIndex& block_index,
+                         const std::string&    gfxr_file_path,
+                         const std::string&    new_file_path,
+                         uint64_t              first_block_index,
+                         uint64_t              last_block_index);
+
+GFXRECON_END_NAMESPACE(decode)
+GFXRECON_END_NAMESPACE(gfxrecon)
+
+#endif  // GFXRECON_DECODE_DIVE_GFXR_SLICE_H
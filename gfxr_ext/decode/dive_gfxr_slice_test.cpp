@@ -0,0 +1,242 @@
+/*
+ Copyright 2025 Google LLC
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#include "dive_gfxr_slice.h"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+#include "format/format.h"
+
+#include "dive_block_index.h"
+#include "dive_gfxr_test_capture.h"
+
+namespace gfxrecon::decode
+{
+namespace
+{
+
+class DiveGfxrSliceTestFixture : public DiveGfxrCaptureTestFixture
+{
+protected:
+    DiveGfxrSliceTestFixture() : DiveGfxrCaptureTestFixture("dive_gfxr_slice_test") {}
+
+    void SetUp() override
+    {
+        DiveGfxrCaptureTestFixture::SetUp();
+        slice_path = (dir / "slice.gfxr").string();
+    }
+
+    // Trimmed capture: state snapshot followed by three frames ending with frame markers
+    void CreateTrimmedCapture()
+    {
+        AppendTrimmedCaptureStart(5);
+        for (uint64_t frame = 5; frame < 8; frame++)
+        {
+            offsets.push_back(AppendBlock(format::kFunctionCallBlock,
+                                          format::ApiCallId::ApiCall_vkCmdDraw,
+                                          static_cast<uint32_t>(10 * frame)));
+            offsets.push_back(AppendMarker(format::kFrameMarkerBlock, format::kEndMarker, frame));
+        }
+        offsets.push_back(file.size());
+        WriteCapture();
+    }
+
+    // Trimmed capture whose frame 5 creates objects and submits work before frame 6
+    void CreateCaptureWithSkippedWork()
+    {
+        AppendTrimmedCaptureStart(5);
+        offsets.push_back(AppendBlock(format::kFunctionCallBlock,
+                                      format::ApiCallId::ApiCall_vkAllocateMemory,
+                                      16));
+        offsets.push_back(AppendBlock(format::kFunctionCallBlock,
+                                      format::ApiCallId::ApiCall_vkCmdDraw,
+                                      16));
+        offsets.push_back(AppendBlock(format::kFunctionCallBlock,
+                                      format::ApiCallId::ApiCall_vkQueueSubmit,
+                                      16));
+        offsets.push_back(AppendBlock(format::kMetaDataBlock, 0, 32));
+        offsets.push_back(AppendBlock(format::kCompressedFunctionCallBlock,
+                                      format::ApiCallId::ApiCall_vkQueuePresentKHR,
+                                      16));
+        offsets.push_back(AppendMarker(format::kFrameMarkerBlock, format::kEndMarker, 5));
+        offsets.push_back(AppendBlock(format::kFunctionCallBlock,
+                                      format::ApiCallId::ApiCall_vkCmdDraw,
+                                      16));
+        offsets.push_back(AppendMarker(format::kFrameMarkerBlock, format::kEndMarker, 6));
+        offsets.push_back(file.size());
+        WriteCapture();
+    }
+
+    // Trimmed capture whose state snapshot executes two blocks from an asset file, followed by
+    // frame 5. Blocks 2 and 3 are executed from the asset file.
+    void CreateCaptureWithAssetFile()
+    {
+        const std::string asset_file_name = "capture.gfxa";
+        std::vector<char> capture = {};
+        std::swap(file, capture);
+        AppendBlock(format::kFunctionCallBlock, format::ApiCallId::ApiCall_vkCreateBuffer, 16);
+        AppendBlock(format::kFunctionCallBlock, format::ApiCallId::ApiCall_vkCreateImage, 16);
+        std::ofstream asset_out(dir / asset_file_name, std::ios::binary | std::ios::trunc);
+        asset_out.write(file.data(), file.size());
+        std::swap(file, capture);
+
+        AppendFileHeader();
+        AppendMarker(format::kStateMarkerBlock, format::kBeginMarker, 5);
+        const uint32_t exec_id =
+        format::MakeMetaDataId(format::ApiFamilyId::ApiFamily_Vulkan,
+                               format::MetaDataType::kExecuteBlocksFromFile);
+        uint64_t exec_offset = AppendBlock(format::kMetaDataBlock, exec_id, 0);
+        Append(format::ThreadId(1));
+        Append(uint32_t(2));
+        Append(int64_t(0));
+        Append(static_cast<uint32_t>(asset_file_name.size()));
+        file.insert(file.end(), asset_file_name.begin(), asset_file_name.end());
+        EndBlock(exec_offset);
+        AppendMarker(format::kStateMarkerBlock, format::kEndMarker, 5);
+        AppendBlock(format::kFunctionCallBlock, format::ApiCallId::ApiCall_vkCmdDraw, 16);
+        AppendMarker(format::kFrameMarkerBlock, format::kEndMarker, 5);
+        WriteCapture();
+    }
+
+    // Bytes [begin, end) of the original capture
+    std::vector<char> Bytes(uint64_t begin, uint64_t end) const
+    {
+        return std::vector<char>(file.begin() + begin, file.begin() + end);
+    }
+
+    std::vector<char> ReadSlice() const
+    {
+        std::ifstream in(slice_path, std::ios::binary);
+        return std::vector<char>(std::istreambuf_iterator<char>(in),
+                                 std::istreambuf_iterator<char>());
+    }
+
+    std::string    slice_path;
+    DiveBlockIndex index = {};
+};
+
+TEST_F(DiveGfxrSliceTestFixture, GetFrameRangeBlocks_Success)
+{
+    CreateTrimmedCapture();
+    ASSERT_TRUE(index.Build(gfxr_path));
+    EXPECT_EQ(GetPreambleBlockCount(index), 3u);
+
+    uint64_t first_block = 0;
+    uint64_t last_block = 0;
+    ASSERT_TRUE(GetFrameRangeBlocks(index, 1, 2, &first_block, &last_block));
+    EXPECT_EQ(first_block, 5u);
+    EXPECT_EQ(last_block, 8u);
+}
+
+TEST_F(DiveGfxrSliceTestFixture, GetFrameRangeBlocks_OutOfRange_Fail)
+{
+    CreateTrimmedCapture();
+    ASSERT_TRUE(index.Build(gfxr_path));
+
+    uint64_t first_block = 0;
+    uint64_t last_block = 0;
+    EXPECT_FALSE(GetFrameRangeBlocks(index, 1, 3, &first_block, &last_block));
+    EXPECT_FALSE(GetFrameRangeBlocks(index, 2, 1, &first_block, &last_block));
+}
+
+TEST_F(DiveGfxrSliceTestFixture, WriteGfxrBlockRange_KeepsStateSnapshot_Success)
+{
+    CreateTrimmedCapture();
+    ASSERT_TRUE(index.Build(gfxr_path));
+
+    // Frame 6 only: header and state snapshot, the draw recorded in frame 5, then blocks 5-6
+    ASSERT_TRUE(WriteGfxrBlockRange(index, gfxr_path, slice_path, 5, 6));
+    std::vector<char> expected = Bytes(0, offsets[4]);
+    std::vector<char> frame = Bytes(offsets[5], offsets[7]);
+    expected.insert(expected.end(), frame.begin(), frame.end());
+    EXPECT_EQ(ReadSlice(), expected);
+
+    DiveBlockIndex slice_index;
+    ASSERT_TRUE(slice_index.Build(slice_path));
+    ASSERT_EQ(slice_index.GetFrames().size(), 1u);
+    EXPECT_EQ(slice_index.GetFrames()[0].frame_number, 6u);
+    DiveStateMarker state_end = {};
+    EXPECT_TRUE(slice_index.GetStateEndMarker(&state_end));
+}
+
+TEST_F(DiveGfxrSliceTestFixture, WriteGfxrBlockRange_FirstFrame_SingleRange)
+{
+    CreateTrimmedCapture();
+    ASSERT_TRUE(index.Build(gfxr_path));
+
+    ASSERT_TRUE(WriteGfxrBlockRange(index, gfxr_path, slice_path, 3, 4));
+    EXPECT_EQ(ReadSlice(), Bytes(0, offsets[5]));
+}
+
+TEST_F(DiveGfxrSliceTestFixture, WriteGfxrBlockRange_SkippedFrameKeepsState_Success)
+{
+    CreateCaptureWithSkippedWork();
+    ASSERT_TRUE(index.Build(gfxr_path));
+
+    // Frame 6 only: the allocation, the recorded draw and the meta data of frame 5 are kept, its
+    // submit, present and frame marker are dropped
+    ASSERT_TRUE(WriteGfxrBlockRange(index, gfxr_path, slice_path, 9, 10));
+    std::vector<char> expected = Bytes(0, offsets[5]);
+    std::vector<char> meta_data = Bytes(offsets[6], offsets[7]);
+    std::vector<char> frame = Bytes(offsets[9], offsets[11]);
+    expected.insert(expected.end(), meta_data.begin(), meta_data.end());
+    expected.insert(expected.end(), frame.begin(), frame.end());
+    EXPECT_EQ(ReadSlice(), expected);
+
+    DiveBlockIndex slice_index;
+    ASSERT_TRUE(slice_index.Build(slice_path));
+    ASSERT_EQ(slice_index.GetFrames().size(), 1u);
+    EXPECT_EQ(slice_index.GetFrames()[0].frame_number, 6u);
+    EXPECT_EQ(slice_index.GetBlockCount(), 8u);
+}
+
+TEST_F(DiveGfxrSliceTestFixture, WriteGfxrBlockRange_AssetFile_Success)
+{
+    CreateCaptureWithAssetFile();
+    ASSERT_TRUE(index.Build(gfxr_path));
+    ASSERT_TRUE(index.GetBlock(2).IsInAssetFile());
+    ASSERT_TRUE(index.GetBlock(3).IsInAssetFile());
+
+    ASSERT_TRUE(WriteGfxrBlockRange(index, gfxr_path, slice_path, 5, 6));
+    EXPECT_EQ(ReadSlice(), file);
+}
+
+TEST_F(DiveGfxrSliceTestFixture, WriteGfxrBlockRange_StartsInAssetFile_Fail)
+{
+    CreateCaptureWithAssetFile();
+    ASSERT_TRUE(index.Build(gfxr_path));
+
+    // The ExecuteBlocksFromFile block 1 can't execute only block 3
+    EXPECT_FALSE(WriteGfxrBlockRange(index, gfxr_path, slice_path, 3, 6));
+    EXPECT_FALSE(std::filesystem::exists(slice_path));
+}
+
+TEST_F(DiveGfxrSliceTestFixture, WriteGfxrBlockRange_InvalidRange_Fail)
+{
+    CreateTrimmedCapture();
+    ASSERT_TRUE(index.Build(gfxr_path));
+
+    EXPECT_FALSE(WriteGfxrBlockRange(index, gfxr_path, slice_path, 4, 3));
+    EXPECT_FALSE(WriteGfxrBlockRange(index, gfxr_path, slice_path, 3, 9));
+    EXPECT_FALSE(WriteGfxrBlockRange(index, gfxr_path, gfxr_path, 3, 4));
+}
+
+}  // namespace
+}  // namespace gfxrecon::decode
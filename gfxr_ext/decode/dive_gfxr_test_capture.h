@@ -0,0 +1,124 @@
+/*
+ Copyright 2025 Google LLC
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+// Test fixture building small uncompressed GFXR captures block by block, shared by the unit tests
+// that read captures from disk
+
+#ifndef GFXRECON_DECODE_DIVE_GFXR_TEST_CAPTURE_H
+#define GFXRECON_DECODE_DIVE_GFXR_TEST_CAPTURE_H
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "format/format.h"
+#include "util/defines.h"
+
+GFXRECON_BEGIN_NAMESPACE(gfxrecon)
+GFXRECON_BEGIN_NAMESPACE(decode)
+
+class DiveGfxrCaptureTestFixture : public testing::Test
+{
+protected:
+    // The capture is written to capture.gfxr in a temporary directory named dir_name
+    explicit DiveGfxrCaptureTestFixture(const char* name) : dir_name(name) {}
+
+    void SetUp() override
+    {
+        dir = std::filesystem::temp_directory_path() / dir_name;
+        std::filesystem::create_directories(dir);
+        gfxr_path = (dir / "capture.gfxr").string();
+    }
+
+    void TearDown() override { std::filesystem::remove_all(dir); }
+
+    template<typename T> void Append(const T& value)
+    {
+        const char* bytes = reinterpret_cast<const char*>(&value);
+        file.insert(file.end(), bytes, bytes + sizeof(value));
+    }
+
+    void AppendFileHeader()
+    {
+        format::FileHeader header = {};
+        header.fourcc = GFXRECON_FOURCC;
+        header.num_options = 1;
+        Append(header);
+        format::FileOptionPair option = { format::FileOption::kCompressionType,
+                                          format::CompressionType::kNone };
+        Append(option);
+    }
+
+    // Appends a block with a 32-bit id followed by payload_size bytes, returns its offset. The
+    // payload bytes are the low byte of the offset, so that the blocks differ from each other.
+    uint64_t AppendBlock(format::BlockType type, uint32_t id, uint32_t payload_size)
+    {
+        uint64_t            offset = file.size();
+        format::BlockHeader header = { sizeof(id) + payload_size, type };
+        Append(header);
+        Append(id);
+        file.insert(file.end(), payload_size, static_cast<char>(offset));
+        return offset;
+    }
+
+    uint64_t AppendMarker(format::BlockType type, format::MarkerType marker, uint64_t frame)
+    {
+        uint64_t offset = AppendBlock(type, marker, 0);
+        Append(frame);
+        EndBlock(offset);
+        return offset;
+    }
+
+    // Sets the size of the block at offset to cover everything appended since
+    void EndBlock(uint64_t offset)
+    {
+        reinterpret_cast<format::BlockHeader*>(file.data() + offset)->size =
+        file.size() - offset - sizeof(format::BlockHeader);
+    }
+
+    // Appends the file header and the state snapshot of a capture trimmed at frame, the first
+    // three blocks
+    void AppendTrimmedCaptureStart(uint64_t frame)
+    {
+        AppendFileHeader();
+        offsets.push_back(AppendMarker(format::kStateMarkerBlock, format::kBeginMarker, frame));
+        offsets.push_back(AppendBlock(format::kMetaDataBlock, 0, 64));
+        offsets.push_back(AppendMarker(format::kStateMarkerBlock, format::kEndMarker, frame));
+    }
+
+    void WriteCapture()
+    {
+        std::ofstream out(gfxr_path, std::ios::binary | std::ios::trunc);
+        out.write(file.data(), file.size());
+    }
+
+    std::string           dir_name;
+    std::filesystem::path dir;
+    std::string           gfxr_path;
+    std::vector<char>     file = {};
+    // Offset of each block appended by the capture builders of the tests, which may be followed
+    // by the file size
+    std::vector<uint64_t> offsets = {};
+};
+
+GFXRECON_END_NAMESPACE(decode)
+GFXRECON_END_NAMESPACE(gfxrecon)
+
+#endif  // GFXRECON_DECODE_DIVE_GFXR_TEST_CAPTURE_H
@@ -61,7 +61,18 @@ HandlePointerDecoder<VkDevice>*                      pDevice)
         return;
     }
 
+    // The replay loops over the frame without double buffering the cmds, so the GPU time stays in
+    // the synchronous mode, whose vkDeviceWaitIdle at the frame boundary the loop relies on
     gpu_time_.SetEnable(enable_gpu_time_);
+    if (enable_gpu_time_)
+    {
+        Dive::GPUTime::GpuTimeStatus record_status = gpu_time_.SetRecordFile(
+        gpu_time_record_file_);
+        if (!record_status.success)
+        {
+            GFXRECON_LOG_ERROR(record_status.message.c_str());
+        }
+    }
 
     VkDevice device = MapHandle<VulkanDeviceInfo>(*(pDevice->GetPointer()),
                                                   &CommonObjectInfoTable::GetVkDeviceInfo);
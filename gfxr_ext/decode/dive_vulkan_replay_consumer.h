@@ -192,6 +192,10 @@ public:
 
     void SetEnableGPUTime(bool enable) { enable_gpu_time_ = enable; }
 
+    // Path of the binary records of every frame (gpu_time.bin), written alongside the CSV stats
+    // when GPU time is enabled. Needs to be set before the device is created.
+    void SetGPUTimeRecordFile(const std::string& file_path) { gpu_time_record_file_ = file_path; }
+
     std::string GetGPUTimeStatsCSVStr() const
     {
         return gpu_time_stats_csv_header_str_ + gpu_time_stats_csv_str_;
@@ -216,6 +220,7 @@ private:
     Dive::GPUTime                 gpu_time_ = {};
     std::string gpu_time_stats_csv_header_str_ = "Type,Id,Mean [ms],Median [ms]\n";
     std::string gpu_time_stats_csv_str_ = "";
+    std::string gpu_time_record_file_ = "";
     VkDevice    device_ = VK_NULL_HANDLE;
     bool        enable_gpu_time_ = false;
     // This is a flag that indicates if the Setup Phase is finised or not for gfx Replay
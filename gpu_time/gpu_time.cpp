@@ -108,69 +108,172 @@ void GPUTime::TimeStampSlotAllocator::FreeSlots(const std::vector<uint32_t>& slo
     }
 }
 
-void GPUTime::FrameMetrics::AddFrameData(double                     frame_time,
-                                         const std::vector<double>& cmd_time_vec,
-                                         const std::vector<double>& renderpass_time_vec,
-                                         const std::vector<size_t>& cmd_renderpass_count_vec)
+void GPUTime::StreamingStats::Add(double value)
 {
-    // TODO(wangra): reset when there is a difference in number of cmds per frame
-    // maybe we should expose the Reset and let the app decide when to reset
-    size_t new_frame_cmd_count = cmd_time_vec.size();
-    size_t new_frame_renderpass_count = renderpass_time_vec.size();
-    if ((m_cmd_time_vec.size() != new_frame_cmd_count) ||
-        (m_renderpass_time_vec.size() != new_frame_renderpass_count))
+    if (m_exact)
     {
-        Reset();
-        m_cmd_time_vec.resize(new_frame_cmd_count);
-        m_renderpass_time_vec.resize(new_frame_renderpass_count);
-        m_cmd_renderpass_count_vec = cmd_renderpass_count_vec;
+        if (m_samples.size() == TimeStampSlotAllocator::kFrameMetricsLimit)
+        {
+            m_samples.pop_front();
+        }
+        m_samples.push_back(value);
+        return;
     }
 
-    if (m_frame_time.size() == TimeStampSlotAllocator::kFrameMetricsLimit)
+    m_min = std::min(m_min, value);
+    m_max = std::max(m_max, value);
+
+    // Welford's online mean and variance
+    ++m_count;
+    const double delta = value - m_mean;
+    m_mean += delta / static_cast<double>(m_count);
+    m_m2 += delta * (value - m_mean);
+
+    UpdateMedianMarkers(value);
+}
+
+void GPUTime::StreamingStats::UpdateMedianMarkers(double value)
+{
+    constexpr double kQuantile = 0.5;
+    if (m_count <= kNumMarkers)
     {
-        m_frame_time.pop_front();
+        // Keep the first samples sorted, they are the initial marker heights
+        size_t i = m_count - 1;
+        for (; (i > 0) && (m_heights[i - 1] > value); --i)
+        {
+            m_heights[i] = m_heights[i - 1];
+        }
+        m_heights[i] = value;
 
-        for (auto& c : m_cmd_time_vec)
+        if (m_count == kNumMarkers)
         {
-            c.pop_front();
+            for (uint32_t m = 0; m < kNumMarkers; ++m)
+            {
+                m_positions[m] = static_cast<double>(m + 1);
+            }
+            m_desired_positions[0] = 1.0;
+            m_desired_positions[1] = 1.0 + 2.0 * kQuantile;
+            m_desired_positions[2] = 1.0 + 4.0 * kQuantile;
+            m_desired_positions[3] = 3.0 + 2.0 * kQuantile;
+            m_desired_positions[4] = 5.0;
         }
+        return;
+    }
 
-        for (auto& r : m_renderpass_time_vec)
+    // Find the cell containing the value, extending the extreme markers if needed
+    uint32_t cell = 0;
+    if (value < m_heights[0])
+    {
+        m_heights[0] = value;
+        cell = 0;
+    }
+    else if (value >= m_heights[kNumMarkers - 1])
+    {
+        m_heights[kNumMarkers - 1] = value;
+        cell = kNumMarkers - 2;
+    }
+    else
+    {
+        while (value >= m_heights[cell + 1])
         {
-            r.pop_front();
+            ++cell;
         }
     }
-    m_frame_time.push_back(frame_time);
-    for (size_t i = 0; i < new_frame_cmd_count; ++i)
+
+    for (uint32_t m = cell + 1; m < kNumMarkers; ++m)
     {
-        m_cmd_time_vec[i].push_back(cmd_time_vec[i]);
+        m_positions[m] += 1.0;
     }
-    for (size_t i = 0; i < new_frame_renderpass_count; ++i)
+    constexpr double kDesiredIncrements[kNumMarkers] = { 0.0,
+                                                         kQuantile / 2.0,
+                                                         kQuantile,
+                                                         (1.0 + kQuantile) / 2.0,
+                                                         1.0 };
+    for (uint32_t m = 0; m < kNumMarkers; ++m)
+    {
+        m_desired_positions[m] += kDesiredIncrements[m];
+    }
+
+    // Move the middle markers towards their desired positions
+    for (uint32_t m = 1; m < kNumMarkers - 1; ++m)
     {
-        m_renderpass_time_vec[i].push_back(renderpass_time_vec[i]);
+        const double offset = m_desired_positions[m] - m_positions[m];
+        if (((offset >= 1.0) && (m_positions[m + 1] - m_positions[m] > 1.0)) ||
+            ((offset <= -1.0) && (m_positions[m - 1] - m_positions[m] < -1.0)))
+        {
+            const double d = (offset > 0.0) ? 1.0 : -1.0;
+
+            // Piecewise-parabolic prediction, falling back to linear if it is not monotonic
+            const double n_prev = m_positions[m - 1];
+            const double n = m_positions[m];
+            const double n_next = m_positions[m + 1];
+            const double height = m_heights[m] +
+                                  d / (n_next - n_prev) *
+                                  ((n - n_prev + d) * (m_heights[m + 1] - m_heights[m]) /
+                                   (n_next - n) +
+                                   (n_next - n - d) * (m_heights[m] - m_heights[m - 1]) /
+                                   (n - n_prev));
+            if ((m_heights[m - 1] < height) && (height < m_heights[m + 1]))
+            {
+                m_heights[m] = height;
+            }
+            else
+            {
+                const uint32_t neighbor = (d > 0.0) ? m + 1 : m - 1;
+                m_heights[m] += d * (m_heights[neighbor] - m_heights[m]) /
+                                (m_positions[neighbor] - n);
+            }
+            m_positions[m] += d;
+        }
     }
 }
 
-GPUTime::Stats GPUTime::FrameMetrics::GetStatistics(const std::deque<double>& data) const
+double GPUTime::StreamingStats::GetMedian() const
 {
-    Stats stats;
-    stats.min = std::numeric_limits<double>::max();
-    stats.max = std::numeric_limits<double>::lowest();
-
-    for (const auto& d : data)
+    if (m_count == 0)
     {
-        stats.min = std::min(stats.min, d);
-        stats.max = std::max(stats.max, d);
+        return 0.0;
+    }
+    if (m_count < kNumMarkers)
+    {
+        // The first samples are sorted in m_heights
+        if (m_count % 2 == 0)
+        {
+            return (m_heights[(m_count / 2) - 1] + m_heights[m_count / 2]) / 2.0;
+        }
+        return m_heights[m_count / 2];
     }
+    return m_heights[kNumMarkers / 2];
+}
+
+GPUTime::Stats GPUTime::StreamingStats::GetStats() const
+{
+    Stats stats;
+    if (m_exact)
+    {
+        stats.min = std::numeric_limits<double>::max();
+        stats.max = std::numeric_limits<double>::lowest();
+        for (const auto& d : m_samples)
+        {
+            stats.min = std::min(stats.min, d);
+            stats.max = std::max(stats.max, d);
+        }
 
-    stats.average = CalculateAverage(data);
-    stats.median = CalculateMedian(data);
-    stats.stddev = CalculateStdDev(data, stats.average);
+        stats.average = CalculateAverage(m_samples);
+        stats.median = CalculateMedian(m_samples);
+        stats.stddev = CalculateStdDev(m_samples, stats.average);
+        return stats;
+    }
 
+    stats.min = m_min;
+    stats.max = m_max;
+    stats.average = m_mean;
+    stats.median = GetMedian();
+    stats.stddev = (m_count < 2) ? 0.0 : std::sqrt(m_m2 / static_cast<double>(m_count - 1));
     return stats;
 }
 
-double GPUTime::FrameMetrics::CalculateAverage(const std::deque<double>& data) const
+double GPUTime::StreamingStats::CalculateAverage(const std::deque<double>& data)
 {
     if (data.empty())
     {
@@ -185,7 +288,7 @@ double GPUTime::FrameMetrics::CalculateAverage(const std::deque<double>& data) c
     return sum / data.size();
 }
 
-double GPUTime::FrameMetrics::CalculateMedian(const std::deque<double>& data) const
+double GPUTime::StreamingStats::CalculateMedian(const std::deque<double>& data)
 {
     if (data.empty())
     {
@@ -193,7 +296,7 @@ double GPUTime::FrameMetrics::CalculateMedian(const std::deque<double>& data) co
     }
 
     // Create a mutable copy of the data to sort it,
-    // as the original m_frame_data is const in this const member function.
+    // as the original m_samples is const in this const member function.
     std::deque<double> sorted_data = data;
     std::sort(sorted_data.begin(), sorted_data.end());
 
@@ -212,7 +315,7 @@ double GPUTime::FrameMetrics::CalculateMedian(const std::deque<double>& data) co
     }
 }
 
-double GPUTime::FrameMetrics::CalculateStdDev(const std::deque<double>& data, double average) const
+double GPUTime::StreamingStats::CalculateStdDev(const std::deque<double>& data, double average)
 {
     if (data.size() < 2)
     {
@@ -227,16 +330,51 @@ double GPUTime::FrameMetrics::CalculateStdDev(const std::deque<double>& data, do
     return std::sqrt(variance);
 }
 
+void GPUTime::FrameMetrics::AddFrameData(double                     frame_time,
+                                         const std::vector<double>& cmd_time_vec,
+                                         const std::vector<double>& renderpass_time_vec,
+                                         const std::vector<size_t>& cmd_renderpass_count_vec)
+{
+    // TODO(wangra): reset when there is a difference in number of cmds per frame
+    // maybe we should expose the Reset and let the app decide when to reset
+    size_t new_frame_cmd_count = cmd_time_vec.size();
+    size_t new_frame_renderpass_count = renderpass_time_vec.size();
+    if ((m_cmd_time_vec.size() != new_frame_cmd_count) ||
+        (m_renderpass_time_vec.size() != new_frame_renderpass_count))
+    {
+        Reset();
+        m_cmd_time_vec.resize(new_frame_cmd_count, StreamingStats(m_exact));
+        m_renderpass_time_vec.resize(new_frame_renderpass_count, StreamingStats(m_exact));
+        m_cmd_renderpass_count_vec = cmd_renderpass_count_vec;
+    }
+
+    m_frame_time.Add(frame_time);
+    for (size_t i = 0; i < new_frame_cmd_count; ++i)
+    {
+        m_cmd_time_vec[i].Add(cmd_time_vec[i]);
+    }
+    for (size_t i = 0; i < new_frame_renderpass_count; ++i)
+    {
+        m_renderpass_time_vec[i].Add(renderpass_time_vec[i]);
+    }
+}
+
+void GPUTime::FrameMetrics::SetExactMode(bool exact)
+{
+    m_exact = exact;
+    Reset();
+}
+
 void GPUTime::FrameMetrics::Reset()
 {
-    m_frame_time.clear();
+    m_frame_time = StreamingStats(m_exact);
     m_cmd_time_vec.clear();
     m_renderpass_time_vec.clear();
 }
 
 GPUTime::Stats GPUTime::FrameMetrics::GetFrameTimeStats() const
 {
-    return GetStatistics(m_frame_time);
+    return m_frame_time.GetStats();
 }
 
 GPUTime::Stats GPUTime::FrameMetrics::GetFrameCmdTimeStats(size_t index) const
@@ -245,7 +383,7 @@ GPUTime::Stats GPUTime::FrameMetrics::GetFrameCmdTimeStats(size_t index) const
     {
         return GPUTime::Stats();
     }
-    return GetStatistics(m_cmd_time_vec[index]);
+    return m_cmd_time_vec[index].GetStats();
 }
 
 GPUTime::Stats GPUTime::FrameMetrics::GetFrameRenderPassTimeStats(size_t index) const
@@ -254,7 +392,7 @@ GPUTime::Stats GPUTime::FrameMetrics::GetFrameRenderPassTimeStats(size_t index)
     {
         return GPUTime::Stats();
     }
-    return GetStatistics(m_renderpass_time_vec[index]);
+    return m_renderpass_time_vec[index].GetStats();
 }
 
 size_t GPUTime::FrameMetrics::GetFrameCmdCount() const
@@ -341,6 +479,17 @@ std::string GPUTime::GetStatsCSVString() const
     return ss.str();
 }
 
+GPUTime::GpuTimeStatus GPUTime::SetRecordFile(const std::string& file_path)
+{
+    if (m_device != VK_NULL_HANDLE)
+    {
+        return GPUTime::GpuTimeStatus{ "Record file needs to be set before creating the device!",
+                                       false };
+    }
+    m_record_file_path = file_path;
+    return GPUTime::GpuTimeStatus();
+}
+
 GPUTime::GpuTimeStatus GPUTime::OnCreateDevice(VkDevice                     device,
                                                const VkAllocationCallbacks* allocator_ptr,
                                                float                        timestamp_period,
@@ -356,22 +505,52 @@ GPUTime::GpuTimeStatus GPUTime::OnCreateDevice(VkDevice                     devi
     m_device = device;
     m_timestamp_period = timestamp_period;
 
-    // Create a query pool for timestamps
+    // Create a query pool for timestamps per frame in flight
     VkQueryPoolCreateInfo queryPoolInfo{};
     queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
     queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
     queryPoolInfo.queryCount = TimeStampSlotAllocator::kTotalSlots;
 
-    VkResult result = pfn_create_query_pool(m_device, &queryPoolInfo, m_allocator, &m_query_pool);
-    if (result != VK_SUCCESS)
+    m_query_pools.assign(m_frames_in_flight, VK_NULL_HANDLE);
+    for (auto& query_pool : m_query_pools)
     {
-        m_valid_frame = false;
-        return GPUTime::GpuTimeStatus{ "vkCreateQueryPool failed with VkResult: " +
-                                       std::to_string(static_cast<int>(result)),
+        VkResult result = pfn_create_query_pool(m_device, &queryPoolInfo, m_allocator, &query_pool);
+        if (result != VK_SUCCESS)
+        {
+            m_valid_frame = false;
+            return GPUTime::GpuTimeStatus{ "vkCreateQueryPool failed with VkResult: " +
+                                           std::to_string(static_cast<int>(result)),
+                                           false };
+        }
+
+        pfn_reset_query_pool(m_device, query_pool, 0, TimeStampSlotAllocator::kTotalSlots);
+    }
+    m_query_pool_index = 0;
+    m_pending_frames.clear();
+
+    if (!m_record_file_path.empty() &&
+        !m_record_writer.Open(m_record_file_path, m_timestamp_period))
+    {
+        return GPUTime::GpuTimeStatus{ "Failed to create the record file: " + m_record_file_path,
                                        false };
     }
+    return GPUTime::GpuTimeStatus();
+}
 
-    pfn_reset_query_pool(m_device, m_query_pool, 0, TimeStampSlotAllocator::kTotalSlots);
+GPUTime::GpuTimeStatus GPUTime::SetFramesInFlight(uint32_t frames_in_flight)
+{
+    if (m_device != VK_NULL_HANDLE)
+    {
+        return GPUTime::GpuTimeStatus{ "Frames in flight needs to be set before creating the device!",
+                                       false };
+    }
+    if ((frames_in_flight == 0) || (frames_in_flight > kMaxFramesInFlight))
+    {
+        return GPUTime::GpuTimeStatus{ "Frames in flight needs to be in [1, " +
+                                       std::to_string(kMaxFramesInFlight) + "]",
+                                       false };
+    }
+    m_frames_in_flight = frames_in_flight;
     return GPUTime::GpuTimeStatus();
 }
 
@@ -384,7 +563,7 @@ GPUTime::GpuTimeStatus GPUTime::OnDestroyDevice(VkDevice               device,
         return GPUTime::GpuTimeStatus{ "Not destroying the cached device!" };
     }
 
-    if ((m_device != VK_NULL_HANDLE) && (m_query_pool != VK_NULL_HANDLE))
+    if ((m_device != VK_NULL_HANDLE) && !m_query_pools.empty())
     {
         if (m_queues.empty())
         {
@@ -397,10 +576,20 @@ GPUTime::GpuTimeStatus GPUTime::OnDestroyDevice(VkDevice               device,
         }
         m_queues.clear();
 
-        pfn_destroy_query_pool(m_device, m_query_pool, m_allocator);
-        m_query_pool = VK_NULL_HANDLE;
+        // Results of the frames still in flight are dropped
+        m_pending_frames.clear();
+        for (auto& query_pool : m_query_pools)
+        {
+            if (query_pool != VK_NULL_HANDLE)
+            {
+                pfn_destroy_query_pool(m_device, query_pool, m_allocator);
+            }
+        }
+        m_query_pools.clear();
+        m_query_pool_index = 0;
         m_allocator = nullptr;
     }
+    m_record_writer.Close();
     m_device = VK_NULL_HANDLE;
     return GPUTime::GpuTimeStatus();
 }
@@ -457,9 +646,15 @@ VkCommandBuffer*                   command_buffers_ptr)
             return GPUTime::GpuTimeStatus{ "Exceeded maximum number of query slots.", false };
         }
 
-        m_cmds.insert(
-        { command_buffers_ptr[i],
-          { {}, allocate_info_ptr->commandPool, begin_slot, end_slot, false, false, false } });
+        m_cmds.insert({ command_buffers_ptr[i],
+                        { {},
+                          allocate_info_ptr->commandPool,
+                          begin_slot,
+                          end_slot,
+                          m_query_pool_index,
+                          false,
+                          false,
+                          false } });
     }
     return GPUTime::GpuTimeStatus();
 }
@@ -533,9 +728,12 @@ PFN_vkCmdWriteTimestamp   pfn_cmd_write_timestamp)
 
     m_cmds[command_buffer].reusable = ((flags & VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT) != 0);
 
+    // All the timestamps of the cmd are written into the query pool of the frame being recorded
+    m_cmds[command_buffer].query_pool_index = m_query_pool_index;
+
     pfn_cmd_write_timestamp(command_buffer,
                             VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-                            m_query_pool,
+                            m_query_pools[m_query_pool_index],
                             m_cmds[command_buffer].begin_timestamp_offset);
     return GPUTime::GpuTimeStatus();
 }
@@ -556,7 +754,7 @@ GPUTime::GpuTimeStatus GPUTime::OnEndCommandBuffer(VkCommandBuffer         comma
 
     pfn_cmd_write_timestamp(command_buffer,
                             VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
-                            m_query_pool,
+                            GetCmdQueryPool(command_buffer),
                             m_cmds[command_buffer].end_timestamp_offset);
     return GPUTime::GpuTimeStatus();
 }
@@ -572,7 +770,7 @@ PFN_vkGetQueryPoolResults pfn_get_query_pool_results)
     constexpr VkDeviceSize stride = data_per_query + availability_per_query;
 
     VkResult result = pfn_get_query_pool_results(m_device,
-                                                 m_query_pool,
+                                                 m_query_pools[m_query_pool_index],
                                                  0,
                                                  TimeStampSlotAllocator::kTotalSlots,
                                                  data_size,
@@ -622,7 +820,7 @@ PFN_vkGetQueryPoolResults pfn_get_query_pool_results)
                             std::this_thread::sleep_for(std::chrono::milliseconds(14));
                             result =
                             pfn_get_query_pool_results(m_device,
-                                                       m_query_pool,
+                                                       m_query_pools[m_query_pool_index],
                                                        0,
                                                        TimeStampSlotAllocator::kTotalSlots,
                                                        data_size,
@@ -690,33 +888,13 @@ PFN_vkGetQueryPoolResults pfn_get_query_pool_results)
         }
     }
 
-    double              frame_time = 0.0;
-    std::vector<double> cmds_time;
-    std::vector<double> renderpasses_time;
-    std::vector<size_t> cmd_renderpass_count_vec;
-
-    auto GetTimeDuration = [&](uint32_t begin_offset,
-                               uint32_t end_offset,
-                               uint64_t timestamps_with_availability[]) -> std::optional<double> {
-        uint64_t availability_end = timestamps_with_availability[end_offset * 2 + 1];
-        uint64_t availability_begin = timestamps_with_availability[begin_offset * 2 + 1];
-
-        if ((availability_begin == 0) || (availability_end == 0))
-        {
-            // Return an empty optional to signal an invalid result
-            return std::nullopt;
-        }
-
-        // Calculate the elapsed time in nanoseconds
-        uint64_t elapsed_timestamp_increments = timestamps_with_availability[end_offset * 2] -
-                                                timestamps_with_availability[begin_offset * 2];
-        // m_timestamp_period is the number of nanoseconds per timestamp increment.
-        const double kNanoToMilli = 1.0 / 1000000.0;
-        double       elapsed_time_in_ms = static_cast<double>(elapsed_timestamp_increments) *
-                                    m_timestamp_period * kNanoToMilli;
-
-        return elapsed_time_in_ms;
-    };
+    double                frame_time = 0.0;
+    std::vector<double>   cmds_time;
+    std::vector<double>   renderpasses_time;
+    std::vector<size_t>   cmd_renderpass_count_vec;
+    std::vector<uint64_t> cmds_ticks;
+    std::vector<uint64_t> renderpasses_ticks;
+    const bool            write_record = m_record_writer.IsOpen();
 
     for (const auto& cmd : m_frame_cmds)
     {
@@ -744,6 +922,13 @@ PFN_vkGetQueryPoolResults pfn_get_query_pool_results)
 
             cmds_time.push_back(elapsed_time_in_ms.value());
             frame_time += elapsed_time_in_ms.value();
+            if (write_record)
+            {
+                cmds_ticks.push_back(GetElapsedTicks(begin_timestamp_offset,
+                                                     end_timestamp_offset,
+                                                     m_timestamps_with_availability)
+                                     .value());
+            }
 
             const size_t renderpass_count = m_cmds[cmd].renderpass_slots.size();
             cmd_renderpass_count_vec.push_back(renderpass_count / 2);
@@ -769,6 +954,14 @@ PFN_vkGetQueryPoolResults pfn_get_query_pool_results)
                     return GPUTime::GpuTimeStatus{ ss.str(), false };
                 }
                 renderpasses_time.push_back(renderpass_elapsed_time_in_ms.value());
+                if (write_record)
+                {
+                    renderpasses_ticks.push_back(
+                    GetElapsedTicks(renderpass_begin_timestamp_offset,
+                                    renderpass_end_timestamp_offset,
+                                    m_timestamps_with_availability)
+                    .value());
+                }
             }
         }
     }
@@ -776,11 +969,352 @@ PFN_vkGetQueryPoolResults pfn_get_query_pool_results)
     if (m_valid_frame)
     {
         m_metrics.AddFrameData(frame_time, cmds_time, renderpasses_time, cmd_renderpass_count_vec);
+        if (write_record)
+        {
+            return WriteFrameRecord(m_frame_index,
+                                    cmds_ticks,
+                                    renderpasses_ticks,
+                                    cmd_renderpass_count_vec);
+        }
+    }
+
+    return GPUTime::GpuTimeStatus();
+}
+
+std::optional<uint64_t> GPUTime::GetElapsedTicks(uint32_t        begin_offset,
+                                                 uint32_t        end_offset,
+                                                 const uint64_t* timestamps_with_availability) const
+{
+    uint64_t availability_end = timestamps_with_availability[end_offset * 2 + 1];
+    uint64_t availability_begin = timestamps_with_availability[begin_offset * 2 + 1];
+
+    if ((availability_begin == 0) || (availability_end == 0))
+    {
+        // Return an empty optional to signal an invalid result
+        return std::nullopt;
+    }
+
+    return timestamps_with_availability[end_offset * 2] -
+           timestamps_with_availability[begin_offset * 2];
+}
+
+std::optional<double> GPUTime::GetTimeDuration(uint32_t        begin_offset,
+                                               uint32_t        end_offset,
+                                               const uint64_t* timestamps_with_availability) const
+{
+    std::optional<uint64_t> elapsed_ticks = GetElapsedTicks(begin_offset,
+                                                            end_offset,
+                                                            timestamps_with_availability);
+    if (!elapsed_ticks)
+    {
+        return std::nullopt;
+    }
+
+    uint64_t elapsed_timestamp_increments = *elapsed_ticks;
+    // m_timestamp_period is the number of nanoseconds per timestamp increment.
+    const double kNanoToMilli = 1.0 / 1000000.0;
+    double       elapsed_time_in_ms = static_cast<double>(elapsed_timestamp_increments) *
+                                m_timestamp_period * kNanoToMilli;
+
+    return elapsed_time_in_ms;
+}
+
+GPUTime::GpuTimeStatus GPUTime::WriteFrameRecord(
+uint64_t                     frame_index,
+const std::vector<uint64_t>& cmds_ticks,
+const std::vector<uint64_t>& renderpasses_ticks,
+const std::vector<size_t>&   cmd_renderpass_count_vec)
+{
+    auto AddSample = [&](GpuTimeObjectType object_type, size_t object_id, uint64_t ticks) {
+        GpuTimeSample sample = {};
+        sample.ticks = ticks;
+        sample.frame_index = static_cast<uint32_t>(frame_index);
+        sample.object_id = static_cast<uint32_t>(object_id);
+        sample.object_type = static_cast<uint8_t>(object_type);
+        m_record_samples.push_back(sample);
+    };
+
+    // Same order as GetStatsCSVString()
+    m_record_samples.clear();
+    uint64_t frame_ticks = 0;
+    for (uint64_t ticks : cmds_ticks)
+    {
+        frame_ticks += ticks;
     }
+    AddSample(GpuTimeObjectType::kFrame, 0, frame_ticks);
 
+    size_t rp_index = 0;
+    for (size_t cmd_index = 0; cmd_index < cmds_ticks.size(); ++cmd_index)
+    {
+        AddSample(GpuTimeObjectType::kCommandBuffer, cmd_index, cmds_ticks[cmd_index]);
+        for (size_t j = 0; (j < cmd_renderpass_count_vec[cmd_index]) &&
+                           (rp_index < renderpasses_ticks.size());
+             ++j)
+        {
+            AddSample(GpuTimeObjectType::kRenderPass, rp_index, renderpasses_ticks[rp_index]);
+            rp_index++;
+        }
+    }
+
+    if (!m_record_writer.WriteFrame(m_record_samples))
+    {
+        m_record_writer.Close();
+        return GPUTime::GpuTimeStatus{ "Failed to write to the record file: " + m_record_file_path,
+                                       false };
+    }
     return GPUTime::GpuTimeStatus();
 }
 
+VkQueryPool GPUTime::GetCmdQueryPool(VkCommandBuffer command_buffer) const
+{
+    auto it = m_cmds.find(command_buffer);
+    if (it == m_cmds.end())
+    {
+        return m_query_pools[m_query_pool_index];
+    }
+    return m_query_pools[it->second.query_pool_index];
+}
+
+bool GPUTime::IsQueryPoolPending(uint32_t query_pool_index) const
+{
+    for (const auto& frame : m_pending_frames)
+    {
+        if (frame.query_pool_index == query_pool_index)
+        {
+            return true;
+        }
+        for (const auto& cmd : frame.cmds)
+        {
+            if (cmd.query_pool_index == query_pool_index)
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+GPUTime::GpuTimeStatus GPUTime::ResolveOldestPendingFrame(
+bool                      wait,
+PFN_vkGetQueryPoolResults pfn_get_query_pool_results,
+bool*                     resolved)
+{
+    *resolved = false;
+    if (m_pending_frames.empty())
+    {
+        return GPUTime::GpuTimeStatus();
+    }
+
+    const PendingFrame& frame = m_pending_frames.front();
+    if (!frame.valid)
+    {
+        m_pending_frames.pop_front();
+        *resolved = true;
+        return GPUTime::GpuTimeStatus();
+    }
+
+    constexpr VkDeviceSize stride = sizeof(uint64_t) * 2;
+    const VkQueryPool      query_pool = m_query_pools[frame.query_pool_index];
+    const uint64_t*        results = m_timestamps_with_availability;
+
+    // Returns false if the slot is not available yet (or on error, in which case status is set)
+    GPUTime::GpuTimeStatus status;
+    auto IsSlotAvailable = [&](uint32_t slot, uint32_t slot_query_pool_index) -> bool {
+        if (slot == CommandBufferInfo::kInvalidTimeStampOffset)
+        {
+            return false;
+        }
+        if (!wait && (slot_query_pool_index == frame.query_pool_index))
+        {
+            return results[slot * 2 + 1] != 0;
+        }
+        // Only wait on the slots used by the frame, the other slots might never be written. Slots
+        // of a resubmitted cmd live in another query pool, which is not polled as a whole
+        VkQueryResultFlags flags = VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT;
+        if (wait)
+        {
+            flags |= VK_QUERY_RESULT_WAIT_BIT;
+        }
+        VkResult result = pfn_get_query_pool_results(m_device,
+                                                     m_query_pools[slot_query_pool_index],
+                                                     slot,
+                                                     1,
+                                                     stride,
+                                                     &m_timestamps_with_availability[slot * 2],
+                                                     stride,
+                                                     flags);
+        if ((result != VK_SUCCESS) && (wait || (result != VK_NOT_READY)))
+        {
+            status = GPUTime::GpuTimeStatus{ "vkGetQueryPoolResults failed with VkResult: " +
+                                             std::to_string(static_cast<int>(result)),
+                                             false };
+            return false;
+        }
+        return results[slot * 2 + 1] != 0;
+    };
+
+    if (!wait)
+    {
+        // Poll the whole pool at once, VK_NOT_READY only means some slots are not available
+        VkResult result = pfn_get_query_pool_results(m_device,
+                                                     query_pool,
+                                                     0,
+                                                     TimeStampSlotAllocator::kTotalSlots,
+                                                     sizeof(m_timestamps_with_availability),
+                                                     m_timestamps_with_availability,
+                                                     stride,
+                                                     VK_QUERY_RESULT_64_BIT |
+                                                     VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+        if ((result != VK_SUCCESS) && (result != VK_NOT_READY))
+        {
+            m_pending_frames.pop_front();
+            *resolved = true;
+            return GPUTime::GpuTimeStatus{ "vkGetQueryPoolResults failed with VkResult: " +
+                                           std::to_string(static_cast<int>(result)),
+                                           false };
+        }
+    }
+
+    for (const auto& cmd : frame.cmds)
+    {
+        bool available = IsSlotAvailable(cmd.begin_timestamp_offset, cmd.query_pool_index) &&
+                         IsSlotAvailable(cmd.end_timestamp_offset, cmd.query_pool_index);
+        for (size_t r = 0; available && (r < cmd.renderpass_slots.size()); ++r)
+        {
+            available = IsSlotAvailable(cmd.renderpass_slots[r], cmd.query_pool_index);
+        }
+
+        if (!available)
+        {
+            if (!wait && status.success)
+            {
+                // Try again at the next frame boundary
+                return GPUTime::GpuTimeStatus();
+            }
+
+            std::stringstream ss;
+            ss << "Query result is not available for cmd " << static_cast<void*>(cmd.cmd)
+               << " in frame " << frame.frame_index;
+            if (!status.success)
+            {
+                ss << ": " << status.message;
+            }
+            m_pending_frames.pop_front();
+            *resolved = true;
+            return GPUTime::GpuTimeStatus{ ss.str(), false };
+        }
+    }
+
+    double                frame_time = 0.0;
+    std::vector<double>   cmds_time;
+    std::vector<double>   renderpasses_time;
+    std::vector<size_t>   cmd_renderpass_count_vec;
+    std::vector<uint64_t> cmds_ticks;
+    std::vector<uint64_t> renderpasses_ticks;
+    for (const auto& cmd : frame.cmds)
+    {
+        const uint64_t cmd_ticks = GetElapsedTicks(cmd.begin_timestamp_offset,
+                                                   cmd.end_timestamp_offset,
+                                                   results)
+                                   .value();
+        const double   cmd_time = GetTimeDuration(cmd.begin_timestamp_offset,
+                                                cmd.end_timestamp_offset,
+                                                results)
+                                .value();
+        cmds_ticks.push_back(cmd_ticks);
+        cmds_time.push_back(cmd_time);
+        frame_time += cmd_time;
+
+        cmd_renderpass_count_vec.push_back(cmd.renderpass_slots.size() / 2);
+        for (size_t r = 0; r + 1 < cmd.renderpass_slots.size(); r = r + 2)
+        {
+            renderpasses_ticks.push_back(
+            GetElapsedTicks(cmd.renderpass_slots[r], cmd.renderpass_slots[r + 1], results)
+            .value());
+            renderpasses_time.push_back(
+            GetTimeDuration(cmd.renderpass_slots[r], cmd.renderpass_slots[r + 1], results)
+            .value());
+        }
+    }
+    m_metrics.AddFrameData(frame_time, cmds_time, renderpasses_time, cmd_renderpass_count_vec);
+
+    GPUTime::GpuTimeStatus record_status;
+    if (m_record_writer.IsOpen())
+    {
+        record_status = WriteFrameRecord(frame.frame_index,
+                                         cmds_ticks,
+                                         renderpasses_ticks,
+                                         cmd_renderpass_count_vec);
+    }
+
+    m_pending_frames.pop_front();
+    *resolved = true;
+    return record_status;
+}
+
+GPUTime::SubmitStatus GPUTime::OnFrameBoundaryPipelined(
+PFN_vkResetQueryPool      pfn_reset_query_pool,
+PFN_vkGetQueryPoolResults pfn_get_query_pool_results)
+{
+    // Snapshot the slots of the frame, the cmds can be re-recorded before the results are read
+    PendingFrame frame;
+    frame.frame_index = m_frame_index;
+    frame.query_pool_index = m_query_pool_index;
+    frame.valid = m_valid_frame;
+    for (const auto& cmd : m_frame_cmds)
+    {
+        // cmd may not be in the m_cmds when some cmds got deleted before submitting the frame
+        // boundary cmd
+        auto it = m_cmds.find(cmd);
+        if (it != m_cmds.end())
+        {
+            frame.cmds.push_back({ cmd,
+                                   it->second.begin_timestamp_offset,
+                                   it->second.end_timestamp_offset,
+                                   it->second.query_pool_index,
+                                   it->second.renderpass_slots });
+        }
+    }
+    m_pending_frames.push_back(std::move(frame));
+
+    m_frame_index++;
+    m_frame_cmds.clear();
+    m_valid_frame = true;
+
+    // Attribute all the frames that are already done, oldest first
+    GPUTime::GpuTimeStatus status;
+    bool                   resolved = true;
+    while (!m_pending_frames.empty() && resolved)
+    {
+        GPUTime::GpuTimeStatus
+        resolve_status = ResolveOldestPendingFrame(false, pfn_get_query_pool_results, &resolved);
+        if (!resolve_status.success && status.success)
+        {
+            status = resolve_status;
+        }
+    }
+
+    // The query pool of the next frame can only be reset once its results have been read
+    const uint32_t next_query_pool_index = static_cast<uint32_t>(m_frame_index %
+                                                                 m_query_pools.size());
+    while (IsQueryPoolPending(next_query_pool_index))
+    {
+        GPUTime::GpuTimeStatus
+        resolve_status = ResolveOldestPendingFrame(true, pfn_get_query_pool_results, &resolved);
+        if (!resolve_status.success && status.success)
+        {
+            status = resolve_status;
+        }
+    }
+
+    pfn_reset_query_pool(m_device,
+                         m_query_pools[next_query_pool_index],
+                         0,
+                         TimeStampSlotAllocator::kTotalSlots);
+    m_query_pool_index = next_query_pool_index;
+    return { status, true };
+}
+
 void GPUTime::RemoveCmdFromFrameCache(VkCommandBuffer cmd)
 {
     // Free any slots that were used for render pass timings within this command buffer
@@ -791,6 +1325,56 @@ void GPUTime::RemoveCmdFromFrameCache(VkCommandBuffer cmd)
     vec.erase(std::remove(vec.begin(), vec.end(), cmd), vec.end());
 }
 
+GPUTime::GpuTimeStatus GPUTime::OnBeforeQueueSubmit(
+uint32_t                  submit_count,
+const VkSubmitInfo*       submits_ptr,
+PFN_vkResetQueryPool      pfn_reset_query_pool,
+PFN_vkGetQueryPoolResults pfn_get_query_pool_results)
+{
+    // In the synchronous mode, the single query pool is reset at every frame boundary
+    if (!m_enable || !IsPipelined() || (submits_ptr == nullptr))
+    {
+        return GPUTime::GpuTimeStatus();
+    }
+
+    GPUTime::GpuTimeStatus status;
+    for (uint32_t i = 0; i < submit_count; i++)
+    {
+        for (uint32_t c = 0; c < submits_ptr[i].commandBufferCount; ++c)
+        {
+            const VkCommandBuffer cmd = submits_ptr[i].pCommandBuffers[c];
+            auto                  it = m_cmds.find(cmd);
+            // A cmd submitted twice within the frame keeps its slots, see OnQueueSubmit
+            if ((it == m_cmds.end()) || (it->second.query_pool_index == m_query_pool_index) ||
+                (std::find(m_frame_cmds.begin(), m_frame_cmds.end(), cmd) != m_frame_cmds.end()))
+            {
+                continue;
+            }
+
+            const uint32_t query_pool_index = it->second.query_pool_index;
+            bool           resolved = true;
+            while (IsQueryPoolPending(query_pool_index))
+            {
+                GPUTime::GpuTimeStatus resolve_status =
+                ResolveOldestPendingFrame(true, pfn_get_query_pool_results, &resolved);
+                if (!resolve_status.success && status.success)
+                {
+                    status = resolve_status;
+                }
+            }
+
+            const VkQueryPool query_pool = m_query_pools[query_pool_index];
+            pfn_reset_query_pool(m_device, query_pool, it->second.begin_timestamp_offset, 1);
+            pfn_reset_query_pool(m_device, query_pool, it->second.end_timestamp_offset, 1);
+            for (uint32_t slot : it->second.renderpass_slots)
+            {
+                pfn_reset_query_pool(m_device, query_pool, slot, 1);
+            }
+        }
+    }
+    return status;
+}
+
 GPUTime::SubmitStatus GPUTime::OnQueueSubmit(uint32_t                  submit_count,
                                              const VkSubmitInfo*       submits_ptr,
                                              PFN_vkDeviceWaitIdle      pfn_device_wait_idle,
@@ -855,6 +1439,11 @@ GPUTime::SubmitStatus GPUTime::OnQueueSubmit(uint32_t                  submit_co
         }
     }
 
+    if (is_frame_boundary && IsPipelined())
+    {
+        return OnFrameBoundaryPipelined(pfn_reset_query_pool, pfn_get_query_pool_results);
+    }
+
     if (is_frame_boundary)
     {
         //  force sync to make sure the gpu is done with this frame
@@ -869,7 +1458,10 @@ GPUTime::SubmitStatus GPUTime::OnQueueSubmit(uint32_t                  submit_co
         m_frame_index++;
         m_frame_cmds.clear();
 
-        pfn_reset_query_pool(m_device, m_query_pool, 0, TimeStampSlotAllocator::kTotalSlots);
+        pfn_reset_query_pool(m_device,
+                             m_query_pools[m_query_pool_index],
+                             0,
+                             TimeStampSlotAllocator::kTotalSlots);
         m_valid_frame = true;
         if (!update_status.success)
         {
@@ -925,7 +1517,10 @@ PFN_vkCmdWriteTimestamp pfn_cmd_write_timestamp)
     }
     uint32_t slot = m_timestamp_allocator.AllocateSlot();
     m_cmds[command_buffer].renderpass_slots.push_back(slot);
-    pfn_cmd_write_timestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_query_pool, slot);
+    pfn_cmd_write_timestamp(command_buffer,
+                            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                            GetCmdQueryPool(command_buffer),
+                            slot);
     return GPUTime::GpuTimeStatus();
 }
 
@@ -940,7 +1535,7 @@ GPUTime::GpuTimeStatus GPUTime::OnCmdEndRenderPass(VkCommandBuffer         comma
     m_cmds[command_buffer].renderpass_slots.push_back(slot);
     pfn_cmd_write_timestamp(command_buffer,
                             VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
-                            m_query_pool,
+                            GetCmdQueryPool(command_buffer),
                             slot);
     return GPUTime::GpuTimeStatus();
 }
@@ -955,7 +1550,10 @@ PFN_vkCmdWriteTimestamp pfn_cmd_write_timestamp)
     }
     uint32_t slot = m_timestamp_allocator.AllocateSlot();
     m_cmds[command_buffer].renderpass_slots.push_back(slot);
-    pfn_cmd_write_timestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_query_pool, slot);
+    pfn_cmd_write_timestamp(command_buffer,
+                            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                            GetCmdQueryPool(command_buffer),
+                            slot);
     return GPUTime::GpuTimeStatus();
 }
 
@@ -970,7 +1568,7 @@ GPUTime::GpuTimeStatus GPUTime::OnCmdEndRenderPass2(VkCommandBuffer         comm
     m_cmds[command_buffer].renderpass_slots.push_back(slot);
     pfn_cmd_write_timestamp(command_buffer,
                             VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
-                            m_query_pool,
+                            GetCmdQueryPool(command_buffer),
                             slot);
     return GPUTime::GpuTimeStatus();
 }
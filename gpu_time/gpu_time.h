@@ -17,6 +17,7 @@ limitations under the License.
 #pragma once
 
 #include "vulkan/vulkan_core.h"
+#include "gpu_time_record.h"
 #include <set>
 #include <string>
 #include <vector>
@@ -24,6 +25,7 @@ limitations under the License.
 #include <unordered_map>
 #include <limits>
 #include <atomic>
+#include <optional>
 
 namespace Dive
 {
@@ -31,7 +33,8 @@ namespace Dive
 // To use GPUTime, make sure to
 //     - Disable system gpu preemption
 //     - Insert "vr-marker,frame_end,type,application" as frame boundary
-// Note that the performance will drop due to vkDeviceWaitIdle
+// Note that the performance will drop due to vkDeviceWaitIdle, unless more than one frame is
+// allowed in flight (see SetFramesInFlight)
 class GPUTime
 {
 public:
@@ -63,6 +66,25 @@ public:
     void SetEnable(bool enable) { m_enable = enable; }
     bool IsEnabled() const { return m_enable; }
 
+    // Number of frames whose timestamps can be in flight at once, each frame recording into its
+    // own query pool. With 1 (default), every frame boundary waits for the device to be idle and
+    // reads the results synchronously. With more, results are polled with
+    // VK_QUERY_RESULT_WITH_AVAILABILITY_BIT and attributed to their frame once available, so the
+    // stats lag behind by up to frames_in_flight - 1 frames. A frame only blocks when its query
+    // pool is needed again for recording.
+    // Needs to be set before OnCreateDevice, and the app must not rely on the vkDeviceWaitIdle
+    // done at the frame boundary in the synchronous mode. OnBeforeQueueSubmit needs to be called
+    // before every submit so that cmds recorded in an earlier frame can be resubmitted.
+    static constexpr uint32_t kMaxFramesInFlight = 4;
+    GpuTimeStatus             SetFramesInFlight(uint32_t frames_in_flight);
+    uint32_t                  GetFramesInFlight() const { return m_frames_in_flight; }
+    bool                      IsPipelined() const { return m_frames_in_flight > 1; }
+
+    // Writes the raw timestamp ticks of every frame to a binary record file (see
+    // gpu_time_record.h), in addition to the online stats. Needs to be set before OnCreateDevice,
+    // where the file is created. An empty path disables the records.
+    GpuTimeStatus SetRecordFile(const std::string& file_path);
+
     GpuTimeStatus OnCreateDevice(VkDevice                     device,
                                  const VkAllocationCallbacks* allocator_ptr,
                                  float                        timestamp_period,
@@ -92,6 +114,14 @@ public:
     GpuTimeStatus OnEndCommandBuffer(VkCommandBuffer         command_buffer,
                                      PFN_vkCmdWriteTimestamp pfn_cmd_write_timestamp);
 
+    // Pipelined mode only, called before the submit is forwarded. A cmd recorded in an earlier
+    // frame writes its timestamps into the query pool of that frame again, so the frames still
+    // reading that pool are resolved first (blocking), then the slots of the cmd are reset.
+    GpuTimeStatus OnBeforeQueueSubmit(uint32_t                  submit_count,
+                                      const VkSubmitInfo*       submits_ptr,
+                                      PFN_vkResetQueryPool      pfn_reset_query_pool,
+                                      PFN_vkGetQueryPoolResults pfn_get_query_pool_results);
+
     SubmitStatus OnQueueSubmit(uint32_t                  submit_count,
                                const VkSubmitInfo*       submits_ptr,
                                PFN_vkDeviceWaitIdle      pfn_device_wait_idle,
@@ -140,7 +170,51 @@ public:
     std::string GetStatsCSVString() const;
     void        ClearFrameCache();
 
+    // By default, the stats are computed online over all the frames since the metrics were last
+    // reset: Welford's algorithm for the average/stddev and the P-square estimator for the
+    // median, so adding a frame and querying the stats cost O(1) per metric.
+    // In exact mode, the last kFrameMetricsLimit samples of each metric are kept and the stats are
+    // computed from them (mainly for tests). Switching the mode resets the metrics.
+    void SetExactStats(bool exact) { m_metrics.SetExactMode(exact); }
+    bool IsExactStats() const { return m_metrics.IsExactMode(); }
+
 private:
+    // Online statistics of a single metric
+    class StreamingStats
+    {
+    public:
+        explicit StreamingStats(bool exact = false) :
+            m_exact(exact)
+        {
+        }
+        void  Add(double value);
+        Stats GetStats() const;
+
+    private:
+        // P-square estimation of the median (Jain & Chlamtac), exact for the first kNumMarkers
+        static constexpr uint32_t kNumMarkers = 5;
+        void                      UpdateMedianMarkers(double value);
+        double                    GetMedian() const;
+
+        static double CalculateAverage(const std::deque<double>& data);
+        static double CalculateMedian(const std::deque<double>& data);
+        static double CalculateStdDev(const std::deque<double>& data, double average);
+
+        bool   m_exact = false;
+        size_t m_count = 0;
+        double m_mean = 0.0;
+        // Sum of squares of differences from the current mean
+        double m_m2 = 0.0;
+        double m_min = std::numeric_limits<double>::max();
+        double m_max = std::numeric_limits<double>::lowest();
+        // Marker heights and positions
+        double m_heights[kNumMarkers] = {};
+        double m_positions[kNumMarkers] = {};
+        double m_desired_positions[kNumMarkers] = {};
+        // Exact mode only
+        std::deque<double> m_samples;
+    };
+
     class FrameMetrics
     {
     public:
@@ -156,18 +230,17 @@ private:
         size_t GetFrameCmdCount() const;
         size_t GetFrameRenderPassCount() const;
         size_t GetCmdRenderPassCount(size_t index) const;
+        void   SetExactMode(bool exact);
+        bool   IsExactMode() const { return m_exact; }
 
     private:
-        Stats  GetStatistics(const std::deque<double>& data) const;
-        double CalculateAverage(const std::deque<double>& data) const;
-        double CalculateMedian(const std::deque<double>& data) const;
-        double CalculateStdDev(const std::deque<double>& data, double average) const;
-        void   Reset();
-
-        std::deque<double>              m_frame_time;
-        std::vector<size_t>             m_cmd_renderpass_count_vec;
-        std::vector<std::deque<double>> m_cmd_time_vec;
-        std::vector<std::deque<double>> m_renderpass_time_vec;
+        void Reset();
+
+        bool                        m_exact = false;
+        StreamingStats              m_frame_time;
+        std::vector<size_t>         m_cmd_renderpass_count_vec;
+        std::vector<StreamingStats> m_cmd_time_vec;
+        std::vector<StreamingStats> m_renderpass_time_vec;
     };
 
     class TimeStampSlotAllocator
@@ -206,13 +279,54 @@ private:
         VkCommandPool         pool = VK_NULL_HANDLE;
         uint32_t              begin_timestamp_offset = kInvalidTimeStampOffset;
         uint32_t              end_timestamp_offset = kInvalidTimeStampOffset;
+        uint32_t              query_pool_index = 0;
         bool                  is_frameboundary = false;
         bool                  usage_one_submit = false;
         bool                  reusable = false;
     };
 
+    // Snapshot of the timestamp slots of a submitted frame whose results are not read back yet
+    struct PendingFrame
+    {
+        struct Cmd
+        {
+            VkCommandBuffer       cmd = VK_NULL_HANDLE;
+            uint32_t              begin_timestamp_offset = CommandBufferInfo::kInvalidTimeStampOffset;
+            uint32_t              end_timestamp_offset = CommandBufferInfo::kInvalidTimeStampOffset;
+            // Differs from the frame's query pool for a cmd recorded in an earlier frame
+            uint32_t              query_pool_index = 0;
+            std::vector<uint32_t> renderpass_slots;
+        };
+        std::vector<Cmd> cmds;
+        uint64_t         frame_index = 0;
+        uint32_t         query_pool_index = 0;
+        bool             valid = true;
+    };
+
     GpuTimeStatus UpdateFrameMetrics(PFN_vkGetQueryPoolResults pfn_get_query_pool_results);
     void          RemoveCmdFromFrameCache(VkCommandBuffer cmd);
+    std::optional<double> GetTimeDuration(uint32_t        begin_offset,
+                                          uint32_t        end_offset,
+                                          const uint64_t* timestamps_with_availability) const;
+    std::optional<uint64_t> GetElapsedTicks(uint32_t        begin_offset,
+                                            uint32_t        end_offset,
+                                            const uint64_t* timestamps_with_availability) const;
+    GpuTimeStatus           WriteFrameRecord(uint64_t                     frame_index,
+                                             const std::vector<uint64_t>& cmds_ticks,
+                                             const std::vector<uint64_t>& renderpasses_ticks,
+                                             const std::vector<size_t>&   cmd_renderpass_count_vec);
+
+    // Pipelined mode
+    SubmitStatus  OnFrameBoundaryPipelined(PFN_vkResetQueryPool      pfn_reset_query_pool,
+                                           PFN_vkGetQueryPoolResults pfn_get_query_pool_results);
+    // Reads the results of m_pending_frames.front() and adds them to the metrics. Without wait,
+    // returns false in *resolved if some results are not available yet
+    GpuTimeStatus ResolveOldestPendingFrame(bool                      wait,
+                                            PFN_vkGetQueryPoolResults pfn_get_query_pool_results,
+                                            bool*                     resolved);
+    // True if a pending frame still has results to read from the query pool
+    bool          IsQueryPoolPending(uint32_t query_pool_index) const;
+    VkQueryPool   GetCmdQueryPool(VkCommandBuffer command_buffer) const;
 
     // Keep the timestamp results *2 for VK_QUERY_RESULT_WITH_AVAILABILITY_BIT
     uint64_t     m_timestamps_with_availability[TimeStampSlotAllocator::kTotalSlots * 2];
@@ -222,10 +336,18 @@ private:
     std::unordered_map<VkCommandBuffer, CommandBufferInfo> m_cmds;
     std::vector<VkCommandBuffer>                           m_frame_cmds;
     TimeStampSlotAllocator                                 m_timestamp_allocator;
+    std::deque<PendingFrame>                               m_pending_frames;
+
+    std::string                m_record_file_path;
+    GpuTimeRecordWriter        m_record_writer;
+    std::vector<GpuTimeSample> m_record_samples;  // Samples of the frame being written
 
     VkDevice                     m_device = VK_NULL_HANDLE;
     const VkAllocationCallbacks* m_allocator = nullptr;
-    VkQueryPool                  m_query_pool = VK_NULL_HANDLE;
+    // One query pool per frame in flight, m_query_pools[m_query_pool_index] is recorded into
+    std::vector<VkQueryPool>     m_query_pools;
+    uint32_t                     m_query_pool_index = 0;
+    uint32_t                     m_frames_in_flight = 1;
     uint64_t                     m_frame_index = 0;
     uint32_t                     m_timestamp_counter = 0;
     float                        m_timestamp_period = 0.0f;
@@ -0,0 +1,78 @@
+/*
+Copyright 2025 Google Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "gpu_time_record.h"
+
+#include <cstring>
+
+namespace Dive
+{
+
+GpuTimeRecordWriter::~GpuTimeRecordWriter()
+{
+    Close();
+}
+
+bool GpuTimeRecordWriter::Open(const std::string& file_path, double timestamp_period_ns)
+{
+    Close();
+    m_file = std::fopen(file_path.c_str(), "wb");
+    if (m_file == nullptr)
+    {
+        return false;
+    }
+
+    GpuTimeRecordHeader header = {};
+    std::memcpy(header.magic, kGpuTimeRecordMagic, sizeof(header.magic));
+    header.version = kGpuTimeRecordVersion;
+    header.sample_size = sizeof(GpuTimeSample);
+    header.timestamp_period_ns = timestamp_period_ns;
+    if ((std::fwrite(&header, sizeof(header), 1, m_file) != 1) || (std::fflush(m_file) != 0))
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+bool GpuTimeRecordWriter::WriteFrame(const std::vector<GpuTimeSample>& samples)
+{
+    if (m_file == nullptr)
+    {
+        return false;
+    }
+    if (samples.empty())
+    {
+        return true;
+    }
+    if (std::fwrite(samples.data(), sizeof(GpuTimeSample), samples.size(), m_file) !=
+        samples.size())
+    {
+        return false;
+    }
+    return std::fflush(m_file) == 0;
+}
+
+void GpuTimeRecordWriter::Close()
+{
+    if (m_file != nullptr)
+    {
+        std::fclose(m_file);
+        m_file = nullptr;
+    }
+}
+
+}  // namespace Dive
@@ -0,0 +1,90 @@
+/*
+Copyright 2025 Google Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Binary GPU timing records (gpu_time.bin), written by GPUTime during a looping GFXR replay and
+// loaded by AvailableGpuTiming. Unlike gpu_time.csv, which only holds the statistics of the last
+// frame, the file keeps the raw timestamp ticks of every object of every frame.
+//
+// Layout (little endian): a GpuTimeRecordHeader, followed by GpuTimeSample records up to the end
+// of the file. The samples of a frame are contiguous and in the same order as the rows of
+// gpu_time.csv: the frame, then each command buffer followed by its render passes.
+//
+// This header doesn't depend on Vulkan so that the host tools can read the records.
+
+namespace Dive
+{
+
+enum class GpuTimeObjectType : uint8_t
+{
+    kFrame = 0,
+    kCommandBuffer = 1,
+    kRenderPass = 2,
+    nObjectTypes = 3,  // Also used for invalid ObjectTypes
+};
+
+inline constexpr char     kGpuTimeRecordMagic[8] = { 'D', 'I', 'V', 'E', 'G', 'P', 'U', 'T' };
+inline constexpr uint32_t kGpuTimeRecordVersion = 1;
+
+struct GpuTimeRecordHeader
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t sample_size;          // sizeof(GpuTimeSample) of the writer
+    double   timestamp_period_ns;  // VkPhysicalDeviceLimits::timestampPeriod
+};
+static_assert(sizeof(GpuTimeRecordHeader) == 24, "GpuTimeRecordHeader is part of the file format");
+
+struct GpuTimeSample
+{
+    uint64_t ticks;        // Elapsed timestamp increments
+    uint32_t frame_index;  // Index of the frame since the replay started
+    uint32_t object_id;    // Index of the object of its type within the frame, 0 for kFrame
+    uint8_t  object_type;  // GpuTimeObjectType
+    uint8_t  reserved[7];
+};
+static_assert(sizeof(GpuTimeSample) == 24, "GpuTimeSample is part of the file format");
+
+// Appends the samples of each frame to a record file. Every frame is flushed as soon as it is
+// written, so the file stays readable if the replay is killed.
+class GpuTimeRecordWriter
+{
+public:
+    GpuTimeRecordWriter() = default;
+    ~GpuTimeRecordWriter();
+    GpuTimeRecordWriter(const GpuTimeRecordWriter&) = delete;
+    GpuTimeRecordWriter& operator=(const GpuTimeRecordWriter&) = delete;
+
+    // Creates the file and writes its header. Returns false if the file can't be written.
+    bool Open(const std::string& file_path, double timestamp_period_ns);
+    bool IsOpen() const { return m_file != nullptr; }
+
+    bool WriteFrame(const std::vector<GpuTimeSample>& samples);
+
+    void Close();
+
+private:
+    std::FILE* m_file = nullptr;
+};
+
+}  // namespace Dive
@@ -18,6 +18,12 @@ limitations under the License.
 #include <gmock/gmock.h>
 #include "gpu_time.h"
 
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+
 namespace Dive
 {
 namespace
@@ -366,6 +372,76 @@ TEST(GPUTimeTest, MultiCommandBufferSingleFrameAggregatesTimeCorrectly)
     ASSERT_NO_FATAL_FAILURE(DestroyGPUTime(gpu_time));
 }
 
+// Test that the raw ticks of every frame are written to the record file.
+TEST(GPUTimeTest, RecordFileKeepsRawTicksOfEveryFrame)
+{
+    const std::filesystem::path record_path = std::filesystem::temp_directory_path() /
+                                              "gpu_time_test_records.bin";
+    GPUTime gpu_time;
+    gpu_time.SetEnable(true);
+    ASSERT_TRUE(gpu_time.SetRecordFile(record_path.string()).success);
+    ASSERT_NO_FATAL_FAILURE(CreateGPUTime(gpu_time, kMockTimestampPeriod));
+    EXPECT_FALSE(gpu_time.SetRecordFile(record_path.string()).success);
+
+    VkCommandBufferAllocateInfo alloc_info = {};
+    alloc_info.commandPool = MOCK_COMMAND_POOL;
+    alloc_info.commandBufferCount = 2;
+    VkCommandBuffer cmdBufs[] = { MOCK_COMMAND_BUFFER_1, MOCK_COMMAND_BUFFER_2 };
+    gpu_time.OnAllocateCommandBuffers(&alloc_info, cmdBufs);
+
+    VkDebugUtilsLabelEXT label = {};
+    label.pLabelName = GPUTime::kVulkanVrFrameDelimiterString;
+    gpu_time.OnCmdInsertDebugUtilsLabelEXT(MOCK_COMMAND_BUFFER_2, &label);
+
+    VkSubmitInfo submit_info = {};
+    submit_info.commandBufferCount = 2;
+    submit_info.pCommandBuffers = cmdBufs;
+
+    constexpr uint32_t kNumFrames = 2;
+    for (uint32_t i = 0; i < kNumFrames; ++i)
+    {
+        ASSERT_TRUE(gpu_time
+                    .OnQueueSubmit(1,
+                                   &submit_info,
+                                   MockDeviceWaitIdle,
+                                   MockResetQueryPool,
+                                   MockGetQueryPoolResults)
+                    .gpu_time_status.success);
+    }
+    ASSERT_NO_FATAL_FAILURE(DestroyGPUTime(gpu_time));
+
+    std::ifstream file(record_path, std::ios::binary);
+    ASSERT_TRUE(file.is_open());
+    GpuTimeRecordHeader header = {};
+    ASSERT_TRUE(file.read(reinterpret_cast<char*>(&header), sizeof(header)));
+    EXPECT_EQ(std::memcmp(header.magic, kGpuTimeRecordMagic, sizeof(header.magic)), 0);
+    EXPECT_EQ(header.version, kGpuTimeRecordVersion);
+    EXPECT_EQ(header.sample_size, sizeof(GpuTimeSample));
+    EXPECT_DOUBLE_EQ(header.timestamp_period_ns, kMockTimestampPeriod);
+
+    std::vector<GpuTimeSample> samples(3 * kNumFrames + 1);
+    file.read(reinterpret_cast<char*>(samples.data()), samples.size() * sizeof(GpuTimeSample));
+    ASSERT_EQ(file.gcount(), static_cast<std::streamsize>(3 * kNumFrames * sizeof(GpuTimeSample)));
+    for (uint32_t i = 0; i < kNumFrames; ++i)
+    {
+        const GpuTimeSample* frame = &samples[i * 3];
+        EXPECT_EQ(frame[0].object_type, static_cast<uint8_t>(GpuTimeObjectType::kFrame));
+        EXPECT_EQ(frame[0].ticks, 30000000u);
+        EXPECT_EQ(frame[1].object_type, static_cast<uint8_t>(GpuTimeObjectType::kCommandBuffer));
+        EXPECT_EQ(frame[1].object_id, 0u);
+        EXPECT_EQ(frame[1].ticks, 10000000u);
+        EXPECT_EQ(frame[2].object_type, static_cast<uint8_t>(GpuTimeObjectType::kCommandBuffer));
+        EXPECT_EQ(frame[2].object_id, 1u);
+        EXPECT_EQ(frame[2].ticks, 20000000u);
+        for (size_t j = 0; j < 3; ++j)
+        {
+            EXPECT_EQ(frame[j].frame_index, i);
+        }
+    }
+    file.close();
+    std::filesystem::remove(record_path);
+}
+
 // Test submitting multiple, separate frames to see how statistics accumulate.
 TEST(GPUTimeTest, MultipleFramesUpdateMetricsCorrectly)
 {
@@ -429,5 +505,377 @@ TEST(GPUTimeTest, MultipleFramesUpdateMetricsCorrectly)
     ASSERT_NO_FATAL_FAILURE(DestroyGPUTime(gpu_time));
 }
 
+// --- Fake device for multiple frames in flight ---
+// Keeps the results of each query pool, and lets the tests decide when the gpu has finished a cmd
+
+struct FakeQuery
+{
+    uint64_t timestamp = 0;
+    bool     written = false;
+    bool     available = false;
+};
+
+struct FakeDevice
+{
+    std::map<VkQueryPool, std::vector<FakeQuery>>                         query_pools;
+    std::map<VkCommandBuffer, std::vector<std::pair<VkQueryPool, uint32_t>>> cmd_writes;
+    uint32_t                                                              device_wait_idle_count = 0;
+    uint32_t                                                              wait_count = 0;
+};
+
+FakeDevice g_fake_device;
+
+VkResult FakeCreateQueryPool(VkDevice                     device,
+                             const VkQueryPoolCreateInfo* pCreateInfo,
+                             const VkAllocationCallbacks* pAllocator,
+                             VkQueryPool*                 pQueryPool)
+{
+    *pQueryPool = reinterpret_cast<VkQueryPool>(
+    static_cast<uintptr_t>(0x100 + g_fake_device.query_pools.size()));
+    g_fake_device.query_pools[*pQueryPool].resize(pCreateInfo->queryCount);
+    return VK_SUCCESS;
+}
+
+void FakeResetQueryPool(VkDevice    device,
+                        VkQueryPool queryPool,
+                        uint32_t    firstQuery,
+                        uint32_t    queryCount)
+{
+    auto& queries = g_fake_device.query_pools[queryPool];
+    for (uint32_t i = firstQuery; i < firstQuery + queryCount; ++i)
+    {
+        queries[i] = {};
+    }
+}
+
+void FakeCmdWriteTimestamp(VkCommandBuffer         commandBuffer,
+                           VkPipelineStageFlagBits pipelineStage,
+                           VkQueryPool             queryPool,
+                           uint32_t                query)
+{
+    g_fake_device.cmd_writes[commandBuffer].push_back({ queryPool, query });
+}
+
+VkResult FakeGetQueryPoolResults(VkDevice           device,
+                                 VkQueryPool        queryPool,
+                                 uint32_t           firstQuery,
+                                 uint32_t           queryCount,
+                                 size_t             dataSize,
+                                 void*              pData,
+                                 VkDeviceSize       stride,
+                                 VkQueryResultFlags flags)
+{
+    auto&    queries = g_fake_device.query_pools[queryPool];
+    VkResult result = VK_SUCCESS;
+    for (uint32_t i = 0; i < queryCount; ++i)
+    {
+        FakeQuery& query = queries[firstQuery + i];
+        if ((flags & VK_QUERY_RESULT_WAIT_BIT) != 0)
+        {
+            // Waiting on a query that is never written would hang
+            EXPECT_TRUE(query.written);
+            ++g_fake_device.wait_count;
+            query.available = query.written;
+        }
+        uint64_t* result_ptr = reinterpret_cast<uint64_t*>(static_cast<char*>(pData) + i * stride);
+        if (query.available)
+        {
+            result_ptr[0] = query.timestamp;
+        }
+        result_ptr[1] = query.available ? 1 : 0;
+        if (!query.available)
+        {
+            result = VK_NOT_READY;
+        }
+    }
+    return result;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL FakeDeviceWaitIdle(VkDevice device)
+{
+    ++g_fake_device.device_wait_idle_count;
+    return VK_SUCCESS;
+}
+
+// Simulates the gpu executing the recorded cmd from start_ns for duration_ns, the results only
+// become available without waiting when available is true
+void ExecuteCmd(VkCommandBuffer cmd, uint64_t start_ns, uint64_t duration_ns, bool available)
+{
+    auto& writes = g_fake_device.cmd_writes[cmd];
+    ASSERT_GE(writes.size(), 2u);
+    for (size_t i = 0; i < writes.size(); ++i)
+    {
+        FakeQuery& query = g_fake_device.query_pools[writes[i].first][writes[i].second];
+        query.timestamp = (i + 1 == writes.size()) ? start_ns + duration_ns : start_ns;
+        query.written = true;
+        query.available = available;
+    }
+    writes.clear();
+}
+
+void RecordFrameBoundaryCmd(GPUTime& gpu_time, VkCommandBuffer cmd)
+{
+    VkDebugUtilsLabelEXT label = {};
+    label.pLabelName = GPUTime::kVulkanVrFrameDelimiterString;
+    ASSERT_TRUE(gpu_time
+                .OnBeginCommandBuffer(cmd,
+                                      VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+                                      FakeCmdWriteTimestamp)
+                .success);
+    ASSERT_TRUE(gpu_time.OnCmdInsertDebugUtilsLabelEXT(cmd, &label).success);
+    ASSERT_TRUE(gpu_time.OnEndCommandBuffer(cmd, FakeCmdWriteTimestamp).success);
+}
+
+GPUTime::SubmitStatus SubmitCmd(GPUTime& gpu_time, const VkCommandBuffer& cmd)
+{
+    VkSubmitInfo submit_info = {};
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &cmd;
+    return gpu_time
+    .OnQueueSubmit(1, &submit_info, FakeDeviceWaitIdle, FakeResetQueryPool, FakeGetQueryPoolResults);
+}
+
+class GPUTimePipelinedTest : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        g_fake_device = {};
+        gpu_time.SetEnable(true);
+        ASSERT_TRUE(gpu_time.SetFramesInFlight(2).success);
+        ASSERT_TRUE(gpu_time
+                    .OnCreateDevice(MOCK_DEVICE,
+                                    /*allocator=*/nullptr,
+                                    kMockTimestampPeriod,
+                                    FakeCreateQueryPool,
+                                    FakeResetQueryPool)
+                    .success);
+        ASSERT_EQ(g_fake_device.query_pools.size(), 2u);
+
+        VkCommandBufferAllocateInfo alloc_info = {};
+        alloc_info.commandPool = MOCK_COMMAND_POOL;
+        alloc_info.commandBufferCount = 3;
+        VkCommandBuffer cmds[] = { MOCK_COMMAND_BUFFER_1,
+                                   MOCK_COMMAND_BUFFER_2,
+                                   MOCK_COMMAND_BUFFER_3 };
+        ASSERT_TRUE(gpu_time.OnAllocateCommandBuffers(&alloc_info, cmds).success);
+    }
+
+    void TearDown() override { DestroyGPUTime(gpu_time); }
+
+    GPUTime gpu_time;
+};
+
+TEST(GPUTimeTest, SetFramesInFlightValidatesInput)
+{
+    GPUTime gpu_time;
+    EXPECT_EQ(gpu_time.GetFramesInFlight(), 1u);
+    EXPECT_FALSE(gpu_time.SetFramesInFlight(0).success);
+    EXPECT_FALSE(gpu_time.SetFramesInFlight(GPUTime::kMaxFramesInFlight + 1).success);
+    EXPECT_TRUE(gpu_time.SetFramesInFlight(GPUTime::kMaxFramesInFlight).success);
+    EXPECT_TRUE(gpu_time.IsPipelined());
+
+    ASSERT_NO_FATAL_FAILURE(CreateGPUTime(gpu_time, kMockTimestampPeriod));
+    EXPECT_FALSE(gpu_time.SetFramesInFlight(1).success);
+    ASSERT_NO_FATAL_FAILURE(DestroyGPUTime(gpu_time));
+}
+
+// Test that the results are attributed to their frame once available, without waiting for idle
+TEST_F(GPUTimePipelinedTest, ResultsAreReadWhenAvailable)
+{
+    // --- Frame 0 (10ms), not finished by the gpu at its frame boundary ---
+    ASSERT_NO_FATAL_FAILURE(RecordFrameBoundaryCmd(gpu_time, MOCK_COMMAND_BUFFER_1));
+    GPUTime::SubmitStatus status = SubmitCmd(gpu_time, MOCK_COMMAND_BUFFER_1);
+    ASSERT_TRUE(status.gpu_time_status.success);
+    EXPECT_TRUE(status.contains_frame_boundary);
+    EXPECT_EQ(gpu_time.GetFrameTimeStats().max, std::numeric_limits<double>::lowest());
+
+    // --- Frame 1 (20ms), recorded while frame 0 is still in flight ---
+    ASSERT_NO_FATAL_FAILURE(RecordFrameBoundaryCmd(gpu_time, MOCK_COMMAND_BUFFER_2));
+    ASSERT_NO_FATAL_FAILURE(ExecuteCmd(MOCK_COMMAND_BUFFER_1, 1000000000, 10000000, true));
+    ASSERT_TRUE(SubmitCmd(gpu_time, MOCK_COMMAND_BUFFER_2).gpu_time_status.success);
+    GPUTime::Stats expected_stats;
+    expected_stats.average = 10.0;
+    expected_stats.median = 10.0;
+    expected_stats.min = 10.0;
+    expected_stats.max = 10.0;
+    expected_stats.stddev = 0.0;
+    EXPECT_THAT(gpu_time.GetFrameTimeStats(), StatsEq(expected_stats));
+
+    // --- Frame 2 (30ms), reusing the query pool of frame 0 ---
+    ASSERT_NO_FATAL_FAILURE(RecordFrameBoundaryCmd(gpu_time, MOCK_COMMAND_BUFFER_3));
+    ASSERT_NO_FATAL_FAILURE(ExecuteCmd(MOCK_COMMAND_BUFFER_2, 2000000000, 20000000, true));
+    ASSERT_NO_FATAL_FAILURE(ExecuteCmd(MOCK_COMMAND_BUFFER_3, 3000000000, 30000000, true));
+    ASSERT_TRUE(SubmitCmd(gpu_time, MOCK_COMMAND_BUFFER_3).gpu_time_status.success);
+    expected_stats.average = 20.0;
+    expected_stats.median = 20.0;
+    expected_stats.max = 30.0;
+    expected_stats.stddev = 10.0;
+    EXPECT_THAT(gpu_time.GetFrameTimeStats(), StatsEq(expected_stats));
+
+    EXPECT_EQ(g_fake_device.device_wait_idle_count, 0u);
+    EXPECT_EQ(g_fake_device.wait_count, 0u);
+}
+
+// Test that a frame boundary only waits for the results when their query pool is needed again
+TEST_F(GPUTimePipelinedTest, WaitsOnlyWhenQueryPoolIsReused)
+{
+    ASSERT_NO_FATAL_FAILURE(RecordFrameBoundaryCmd(gpu_time, MOCK_COMMAND_BUFFER_1));
+    ASSERT_NO_FATAL_FAILURE(ExecuteCmd(MOCK_COMMAND_BUFFER_1, 1000000000, 10000000, false));
+    ASSERT_TRUE(SubmitCmd(gpu_time, MOCK_COMMAND_BUFFER_1).gpu_time_status.success);
+    EXPECT_EQ(g_fake_device.wait_count, 0u);
+
+    // The next frame records into the second query pool, no need to wait for frame 0 yet
+    ASSERT_NO_FATAL_FAILURE(RecordFrameBoundaryCmd(gpu_time, MOCK_COMMAND_BUFFER_2));
+    ASSERT_NO_FATAL_FAILURE(ExecuteCmd(MOCK_COMMAND_BUFFER_2, 2000000000, 20000000, false));
+    ASSERT_TRUE(SubmitCmd(gpu_time, MOCK_COMMAND_BUFFER_2).gpu_time_status.success);
+
+    // Frame 2 records into the query pool of frame 0, which has to be read first
+    EXPECT_EQ(g_fake_device.wait_count, 2u);
+    EXPECT_DOUBLE_EQ(gpu_time.GetFrameTimeStats().average, 10.0);
+    EXPECT_EQ(g_fake_device.device_wait_idle_count, 0u);
+}
+
+// Test that a cmd recorded once and resubmitted in later frames is timed in every frame
+TEST_F(GPUTimePipelinedTest, ResubmittingCmdFromEarlierFrame)
+{
+    // Recorded once into the query pool of frame 0
+    VkDebugUtilsLabelEXT label = {};
+    label.pLabelName = GPUTime::kVulkanVrFrameDelimiterString;
+    ASSERT_TRUE(
+    gpu_time.OnBeginCommandBuffer(MOCK_COMMAND_BUFFER_1, 0, FakeCmdWriteTimestamp).success);
+    ASSERT_TRUE(gpu_time.OnCmdInsertDebugUtilsLabelEXT(MOCK_COMMAND_BUFFER_1, &label).success);
+    ASSERT_TRUE(gpu_time.OnEndCommandBuffer(MOCK_COMMAND_BUFFER_1, FakeCmdWriteTimestamp).success);
+    const auto recorded_writes = g_fake_device.cmd_writes[MOCK_COMMAND_BUFFER_1];
+
+    auto SubmitFrame = [&](uint64_t start_ns, uint64_t duration_ns, bool available) {
+        VkSubmitInfo submit_info = {};
+        submit_info.commandBufferCount = 1;
+        submit_info.pCommandBuffers = &MOCK_COMMAND_BUFFER_1;
+        ASSERT_TRUE(gpu_time
+                    .OnBeforeQueueSubmit(1,
+                                         &submit_info,
+                                         FakeResetQueryPool,
+                                         FakeGetQueryPoolResults)
+                    .success);
+        g_fake_device.cmd_writes[MOCK_COMMAND_BUFFER_1] = recorded_writes;
+        ASSERT_NO_FATAL_FAILURE(
+        ExecuteCmd(MOCK_COMMAND_BUFFER_1, start_ns, duration_ns, available));
+        GPUTime::SubmitStatus status = SubmitCmd(gpu_time, MOCK_COMMAND_BUFFER_1);
+        ASSERT_TRUE(status.gpu_time_status.success);
+        EXPECT_TRUE(status.contains_frame_boundary);
+    };
+
+    // Frame 0 is still in flight at its frame boundary
+    ASSERT_NO_FATAL_FAILURE(SubmitFrame(1000000000, 10000000, false));
+    EXPECT_EQ(g_fake_device.wait_count, 0u);
+
+    // Frame 1 writes into the query pool of frame 0 again, which has to be read first
+    ASSERT_NO_FATAL_FAILURE(SubmitFrame(2000000000, 20000000, true));
+    EXPECT_EQ(g_fake_device.wait_count, 2u);
+    EXPECT_EQ(gpu_time.GetFrameTimeStats().max, 20.0);
+
+    // Frame 2 records into the query pool of frame 0, which was fully reset
+    ASSERT_NO_FATAL_FAILURE(SubmitFrame(3000000000, 30000000, true));
+    GPUTime::Stats expected_stats;
+    expected_stats.average = 20.0;
+    expected_stats.median = 20.0;
+    expected_stats.min = 10.0;
+    expected_stats.max = 30.0;
+    expected_stats.stddev = 10.0;
+    EXPECT_THAT(gpu_time.GetFrameTimeStats(), StatsEq(expected_stats));
+    EXPECT_EQ(g_fake_device.wait_count, 2u);
+    EXPECT_EQ(g_fake_device.device_wait_idle_count, 0u);
+}
+
+// Submits one frame per duration in sync mode, with the fake device
+void SubmitFrames(GPUTime& gpu_time, const std::vector<uint64_t>& durations_ns)
+{
+    for (size_t i = 0; i < durations_ns.size(); ++i)
+    {
+        ASSERT_NO_FATAL_FAILURE(RecordFrameBoundaryCmd(gpu_time, MOCK_COMMAND_BUFFER_1));
+        ASSERT_NO_FATAL_FAILURE(
+        ExecuteCmd(MOCK_COMMAND_BUFFER_1, 1000000000 * i, durations_ns[i], true));
+        ASSERT_TRUE(SubmitCmd(gpu_time, MOCK_COMMAND_BUFFER_1).gpu_time_status.success);
+    }
+}
+
+class GPUTimeStatsTest : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        g_fake_device = {};
+        gpu_time.SetEnable(true);
+        ASSERT_TRUE(gpu_time
+                    .OnCreateDevice(MOCK_DEVICE,
+                                    /*allocator=*/nullptr,
+                                    kMockTimestampPeriod,
+                                    FakeCreateQueryPool,
+                                    FakeResetQueryPool)
+                    .success);
+
+        VkCommandBufferAllocateInfo alloc_info = {};
+        alloc_info.commandPool = MOCK_COMMAND_POOL;
+        alloc_info.commandBufferCount = 1;
+        VkCommandBuffer cmd = MOCK_COMMAND_BUFFER_1;
+        ASSERT_TRUE(gpu_time.OnAllocateCommandBuffers(&alloc_info, &cmd).success);
+
+        // Durations 1..kFrameCount ms in a scrambled order
+        for (uint64_t i = 0; i < kFrameCount; ++i)
+        {
+            durations_ns.push_back(((i * 37) % kFrameCount + 1) * 1000000);
+        }
+    }
+
+    void TearDown() override { DestroyGPUTime(gpu_time); }
+
+    static constexpr uint64_t kFrameCount = 501;
+    GPUTime                   gpu_time;
+    std::vector<uint64_t>     durations_ns;
+};
+
+// Test that the exact mode computes the stats from the samples
+TEST_F(GPUTimeStatsTest, ExactStatsMatchSamples)
+{
+    gpu_time.SetExactStats(true);
+    ASSERT_NO_FATAL_FAILURE(SubmitFrames(gpu_time, durations_ns));
+    EXPECT_EQ(g_fake_device.device_wait_idle_count, kFrameCount);
+
+    // Average and median of 1..501 are 251, the variance is n(n+1)/12
+    GPUTime::Stats expected_stats;
+    expected_stats.average = 251.0;
+    expected_stats.median = 251.0;
+    expected_stats.min = 1.0;
+    expected_stats.max = 501.0;
+    expected_stats.stddev = std::sqrt(501.0 * 502.0 / 12.0);
+    EXPECT_THAT(gpu_time.GetFrameTimeStats(), StatsEq(expected_stats));
+}
+
+// Test that the streaming estimators stay close to the exact stats
+TEST_F(GPUTimeStatsTest, StreamingStatsApproximateExactStats)
+{
+    EXPECT_FALSE(gpu_time.IsExactStats());
+    ASSERT_NO_FATAL_FAILURE(SubmitFrames(gpu_time, durations_ns));
+
+    GPUTime::Stats stats = gpu_time.GetFrameTimeStats();
+    EXPECT_NEAR(stats.average, 251.0, 1e-9);
+    EXPECT_NEAR(stats.stddev, std::sqrt(501.0 * 502.0 / 12.0), 1e-9);
+    EXPECT_DOUBLE_EQ(stats.min, 1.0);
+    EXPECT_DOUBLE_EQ(stats.max, 501.0);
+    // P-square is an estimation, allow 2% of the range
+    EXPECT_NEAR(stats.median, 251.0, 10.0);
+}
+
+// Test that the streaming median is exact while there are few samples
+TEST_F(GPUTimeStatsTest, StreamingMedianExactForFewSamples)
+{
+    ASSERT_NO_FATAL_FAILURE(SubmitFrames(gpu_time, { 40000000, 10000000, 30000000, 20000000 }));
+    EXPECT_DOUBLE_EQ(gpu_time.GetFrameTimeStats().median, 25.0);
+
+    ASSERT_NO_FATAL_FAILURE(SubmitFrames(gpu_time, { 50000000 }));
+    EXPECT_DOUBLE_EQ(gpu_time.GetFrameTimeStats().median, 30.0);
+}
+
 }  // namespace
-}  // namespace Dive
\ No newline at end of file
+}  // namespace Dive
@@ -18,17 +18,25 @@
 // and the old cli will be deprecated
 
 #include <filesystem>
+#include <cstdint>
 #include <string>
+#include <vector>
 
 #include "absl/flags/flag.h"
 #include "absl/flags/parse.h"
 #include "absl/flags/usage.h"
 #include "absl/status/status.h"
+#include "absl/strings/numbers.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
 
+#include "common/defer.h"
 #include "common/dive_version.h"
+#include "common/trace.h"
 #include "data_core_wrapper.h"
+#include "gfxr_ext/decode/dive_block_index.h"
+#include "gfxr_ext/decode/dive_gfxr_slice.h"
 
 namespace
 {
@@ -47,6 +55,51 @@ ABSL_FLAG(std::string,
           "",
           "If specified, a new .gfxr file will be generated from the original file "
           "(--input_file_path) and any specified modifications");
+ABSL_FLAG(std::string,
+          frame_range,
+          "",
+          "If specified as FIRST:LAST or FRAME, --output_gfxr_path is a copy of --input_file_path "
+          "reduced to the state snapshot and the given frames. Frames are 0-based and counted "
+          "from the end of the state snapshot. The skipped frames keep their object creation "
+          "and memory updates, but their submits, presents and waits are dropped, so FIRST "
+          "should be a steady-state frame");
+ABSL_FLAG(std::string,
+          block_range,
+          "",
+          "Same as --frame_range, with FIRST:LAST or BLOCK being block indices of "
+          "--input_file_path");
+ABSL_FLAG(std::string,
+          trace_file_path,
+          "",
+          "If specified, a Chrome JSON trace of the loading phases is written to this file, to be "
+          "opened in ui.perfetto.dev");
+
+// Parses "FIRST:LAST" or "INDEX" into an inclusive range
+absl::Status ParseRange(const std::string &flag_name,
+                        const std::string &range,
+                        uint64_t          *first,
+                        uint64_t          *last)
+{
+    std::vector<std::string> parts = absl::StrSplit(range, ':');
+    bool                     valid = false;
+    if (parts.size() == 1)
+    {
+        valid = absl::SimpleAtoi(parts[0], first);
+        *last = *first;
+    }
+    else if (parts.size() == 2)
+    {
+        valid = absl::SimpleAtoi(parts[0], first) && absl::SimpleAtoi(parts[1], last);
+    }
+    if (!valid || *first > *last)
+    {
+        return absl::InvalidArgumentError(
+        absl::StrFormat("invalid --%s: %s, expected FIRST:LAST or a single index",
+                        flag_name,
+                        range));
+    }
+    return absl::OkStatus();
+}
 
 absl::Status ValidateFlags()
 {
@@ -78,6 +131,32 @@ absl::Status ValidateFlags()
         }
     }
 
+    std::string frame_range = absl::GetFlag(FLAGS_frame_range);
+    std::string block_range = absl::GetFlag(FLAGS_block_range);
+    if (!frame_range.empty() || !block_range.empty())
+    {
+        if (!frame_range.empty() && !block_range.empty())
+        {
+            return absl::InvalidArgumentError(
+            "--frame_range and --block_range cannot be specified together");
+        }
+        if (output_gfxr_path.empty())
+        {
+            return absl::InvalidArgumentError(
+            "if --frame_range or --block_range is specified, then --output_gfxr_path must also be "
+            "specified");
+        }
+        uint64_t     first = 0;
+        uint64_t     last = 0;
+        absl::Status res = frame_range.empty() ?
+                           ParseRange("block_range", block_range, &first, &last) :
+                           ParseRange("frame_range", frame_range, &first, &last);
+        if (!res.ok())
+        {
+            return res;
+        }
+    }
+
     return absl::OkStatus();
 }
 
@@ -93,6 +172,105 @@ std::string GetDiveRepositoryVersion()
     }
 }
 
+// Writes the state snapshot and the frame or block range given by --frame_range or --block_range
+// of the .gfxr file to output_gfxr_path. The capture isn't loaded, blocks are located from their
+// headers and copied as is
+absl::Status SliceGfxrFile(const std::string &input_gfxr_path, const std::string &output_gfxr_path)
+{
+    gfxrecon::decode::DiveBlockIndex block_index;
+    if (!block_index.Build(input_gfxr_path))
+    {
+        return absl::InternalError(
+        absl::StrFormat("could not index the blocks of %s", input_gfxr_path));
+    }
+
+    uint64_t    first_block = 0;
+    uint64_t    last_block = 0;
+    std::string frame_range = absl::GetFlag(FLAGS_frame_range);
+    if (frame_range.empty())
+    {
+        absl::Status res = ParseRange("block_range",
+                                      absl::GetFlag(FLAGS_block_range),
+                                      &first_block,
+                                      &last_block);
+        if (!res.ok())
+        {
+            return res;
+        }
+    }
+    else
+    {
+        uint64_t     first_frame = 0;
+        uint64_t     last_frame = 0;
+        absl::Status res = ParseRange("frame_range", frame_range, &first_frame, &last_frame);
+        if (!res.ok())
+        {
+            return res;
+        }
+
+        // Without a state snapshot, the frames skipped before first_frame are the only place
+        // resources are created
+        gfxrecon::decode::DiveStateMarker state_end = {};
+        if (first_frame > 0 && !block_index.GetStateEndMarker(&state_end))
+        {
+            return absl::InvalidArgumentError(
+            absl::StrFormat("%s is not a trimmed capture, --frame_range must start at frame 0",
+                            input_gfxr_path));
+        }
+
+        if (!gfxrecon::decode::GetFrameRangeBlocks(block_index,
+                                                   first_frame,
+                                                   last_frame,
+                                                   &first_block,
+                                                   &last_block))
+        {
+            return absl::InvalidArgumentError(
+            absl::StrFormat("invalid --frame_range %s, %s has %d frames",
+                            frame_range,
+                            input_gfxr_path,
+                            block_index.GetFrames().size()));
+        }
+    }
+
+    if (first_block > last_block || last_block >= block_index.GetBlockCount())
+    {
+        return absl::InvalidArgumentError(
+        absl::StrFormat("invalid block range %d:%d, %s has %d blocks",
+                        first_block,
+                        last_block,
+                        input_gfxr_path,
+                        block_index.GetBlockCount()));
+    }
+    if (block_index.GetBlock(first_block).IsInAssetFile())
+    {
+        return absl::InvalidArgumentError(
+        absl::StrFormat("block %d of %s is executed from an asset file, start the range at the "
+                        "block executing the asset file instead",
+                        first_block,
+                        input_gfxr_path));
+    }
+
+    uint64_t preamble_block_count = gfxrecon::decode::GetPreambleBlockCount(block_index);
+    if (first_block > preamble_block_count)
+    {
+        std::cout << "WARNING: blocks " << preamble_block_count << " to " << first_block - 1
+                  << " are skipped. Their submits, presents and waits are dropped, so the GPU "
+                     "work of those frames is not replayed. The range should start at a "
+                     "steady-state frame."
+                  << std::endl;
+    }
+
+    if (!gfxrecon::decode::WriteGfxrBlockRange(block_index,
+                                               input_gfxr_path,
+                                               output_gfxr_path,
+                                               first_block,
+                                               last_block))
+    {
+        return absl::InternalError(absl::StrFormat("could not write %s", output_gfxr_path));
+    }
+    return absl::OkStatus();
+}
+
 int main(int argc, char **argv)
 {
     absl::SetProgramUsageMessage(
@@ -118,9 +296,42 @@ int main(int argc, char **argv)
         return 1;
     }
 
+    std::string trace_file_path = absl::GetFlag(FLAGS_trace_file_path);
+    if (!trace_file_path.empty())
+    {
+        if (!Dive::Tracer::IsCompiledIn())
+        {
+            std::cout << "Built without DIVE_ENABLE_TRACING, the trace will be empty" << std::endl;
+        }
+        Dive::Tracer::Get().Start();
+    }
+    Dive::Defer write_trace([&trace_file_path]() {
+        if (trace_file_path.empty())
+        {
+            return;
+        }
+        Dive::Tracer::Get().Stop();
+        if (!Dive::Tracer::Get().WriteChromeJson(trace_file_path))
+        {
+            std::cout << "Failed to write trace " << trace_file_path << std::endl;
+        }
+    });
+
     Dive::HostCli::DataCoreWrapper data_core;
 
     std::filesystem::path input_file_path = absl::GetFlag(FLAGS_input_file_path);
+    if (!absl::GetFlag(FLAGS_frame_range).empty() || !absl::GetFlag(FLAGS_block_range).empty())
+    {
+        absl::Status res = SliceGfxrFile(input_file_path.string(),
+                                         absl::GetFlag(FLAGS_output_gfxr_path));
+        if (!res.ok())
+        {
+            std::cout << res << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
     if (input_file_path.extension().string() == ".gfxr")
     {
         absl::Status res = data_core.LoadGfxrFile(input_file_path.string());
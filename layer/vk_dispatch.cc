@@ -33,6 +33,7 @@ void InitInstanceDispatchTable(VkInstance                instance,
 
     dt->EnumerateDeviceExtensionProperties = (PFN_vkEnumerateDeviceExtensionProperties)
     pa(instance, "vkEnumerateDeviceExtensionProperties");
+    dt->DestroyInstance = (PFN_vkDestroyInstance)pa(instance, "vkDestroyInstance");
 }
 
 void InitDeviceDispatchTable(VkDevice device, PFN_vkGetDeviceProcAddr pa, DeviceDispatchTable *dt)
@@ -40,6 +41,7 @@ void InitDeviceDispatchTable(VkDevice device, PFN_vkGetDeviceProcAddr pa, Device
     LOGI("InitDeviceDispatchTable");
     dt->pfn_get_device_proc_addr = pa;
     dt->QueuePresentKHR = (PFN_vkQueuePresentKHR)pa(device, "vkQueuePresentKHR");
+    dt->DestroyDevice = (PFN_vkDestroyDevice)pa(device, "vkDestroyDevice");
 }
 
 }  // namespace DiveLayer
\ No newline at end of file
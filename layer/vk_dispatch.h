@@ -28,12 +28,14 @@ struct InstanceDispatchTable
     PFN_vkCreateDevice                       CreateDevice = nullptr;
     PFN_vkEnumerateDeviceLayerProperties     EnumerateDeviceLayerProperties = nullptr;
     PFN_vkEnumerateDeviceExtensionProperties EnumerateDeviceExtensionProperties = nullptr;
+    PFN_vkDestroyInstance                    DestroyInstance = nullptr;
 };
 
 struct DeviceDispatchTable
 {
     PFN_vkGetDeviceProcAddr pfn_get_device_proc_addr = nullptr;
     PFN_vkQueuePresentKHR   QueuePresentKHR = nullptr;
+    PFN_vkDestroyDevice     DestroyDevice = nullptr;
 };
 
 void InitInstanceDispatchTable(VkInstance                instance,
@@ -23,11 +23,10 @@ limitations under the License.
 #include <cstdio>
 #include <cstring>
 #include <memory>
-#include <mutex>
 #include <thread>
-#include <unordered_map>
 #include <vector>
 
+#include "common/dispatch_map.h"
 #include "common/log.h"
 #include "capture_service/server.h"
 #include "layer_common.h"
@@ -53,16 +52,9 @@ struct DeviceData
 
 namespace
 {
-// Generally we expect to get the same device and instance, so we keep them
-// handy
-static thread_local InstanceData *last_used_instance_data = nullptr;
-static thread_local DeviceData   *last_used_device_data = nullptr;
-
-std::mutex                                                   g_instance_mutex;
-std::unordered_map<uintptr_t, std::unique_ptr<InstanceData>> g_instance_data;
-
-std::mutex                                                 g_device_mutex;
-std::unordered_map<uintptr_t, std::unique_ptr<DeviceData>> g_device_data;
+// Looked up on every intercepted call, possibly from multiple recording threads
+Dive::DispatchMap<InstanceData> g_instance_data;
+Dive::DispatchMap<DeviceData>   g_device_data;
 
 constexpr VkLayerProperties layer_properties = { "VK_LAYER_Dive",
                                                  VK_MAKE_VERSION(1, 0, VK_HEADER_VERSION),
@@ -82,26 +74,12 @@ static constexpr std::array<VkExtensionProperties, 1> device_extensions{ {
 
 InstanceData *GetInstanceLayerData(uintptr_t key)
 {
-    if (last_used_instance_data && DataKey(last_used_instance_data->instance) == key)
-    {
-        return last_used_instance_data;
-    }
-
-    std::lock_guard<std::mutex> lock(g_instance_mutex);
-    last_used_instance_data = g_instance_data[key].get();
-    return last_used_instance_data;
+    return g_instance_data.Get(key);
 }
 
 DeviceData *GetDeviceLayerData(uintptr_t key)
 {
-    if (last_used_device_data && DataKey(last_used_device_data->device) == key)
-    {
-        return last_used_device_data;
-    }
-
-    std::lock_guard<std::mutex> lock(g_device_mutex);
-    last_used_device_data = g_device_data[key].get();
-    return last_used_device_data;
+    return g_device_data.Get(key);
 }
 
 struct VkStruct
@@ -195,10 +173,13 @@ VkResult DiveInterceptCreateInstance(const VkInstanceCreateInfo  *pCreateInfo,
     id->instance = *pInstance;
     InitInstanceDispatchTable(*pInstance, pfn_get_instance_proc_addr, &id->dispatch_table);
 
+    PFN_vkDestroyInstance pfn_destroy_instance = id->dispatch_table.DestroyInstance;
+    if (!g_instance_data.Insert(DataKey(*pInstance), std::move(id)))
     {
-        std::lock_guard<std::mutex> lock(g_instance_mutex);
-        auto                        key = (uintptr_t)(*(void **)(*pInstance));
-        g_instance_data[key] = std::move(id);
+        LOGE("Failed to track instance %p!\n", *pInstance);
+        pfn_destroy_instance(*pInstance, pAllocator);
+        *pInstance = VK_NULL_HANDLE;
+        return VK_ERROR_INITIALIZATION_FAILED;
     }
     SetLayerStatusLoaded();
 
@@ -238,15 +219,42 @@ VkResult DiveInterceptCreateDevice(VkPhysicalDevice             gpu,
     dd->device = *pDevice;
     InitDeviceDispatchTable(*pDevice, pfn_next_device_proc_addr, &dd->dispatch_table);
 
+    PFN_vkDestroyDevice pfn_destroy_device = dd->dispatch_table.DestroyDevice;
+    if (!g_device_data.Insert(DataKey(*pDevice), std::move(dd)))
     {
-        std::lock_guard<std::mutex> lock(g_device_mutex);
-        auto                        key = (uintptr_t)(*(void **)(*pDevice));
-        g_device_data[key] = std::move(dd);
+        LOGE("Failed to track device %p!\n", *pDevice);
+        pfn_destroy_device(*pDevice, pAllocator);
+        *pDevice = VK_NULL_HANDLE;
+        return VK_ERROR_INITIALIZATION_FAILED;
     }
 
     return result;
 }
 
+void DiveInterceptDestroyDevice(VkDevice device, const VkAllocationCallbacks *pAllocator)
+{
+    if (device == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    auto layer_data = GetDeviceLayerData(DataKey(device));
+    layer_data->dispatch_table.DestroyDevice(device, pAllocator);
+    g_device_data.Remove(DataKey(device));
+}
+
+void DiveInterceptDestroyInstance(VkInstance instance, const VkAllocationCallbacks *pAllocator)
+{
+    if (instance == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    auto instance_data = GetInstanceLayerData(DataKey(instance));
+    instance_data->dispatch_table.DestroyInstance(instance, pAllocator);
+    g_instance_data.Remove(DataKey(instance));
+}
+
 extern "C"
 {
 
@@ -495,6 +503,8 @@ extern "C"
             return (PFN_vkVoidFunction)&DiveInterceptCreateDevice;
         if (0 == strcmp(func, "vkQueuePresentKHR"))
             return (PFN_vkVoidFunction)DiveInterceptQueuePresentKHR;
+        if (0 == strcmp(func, "vkDestroyDevice"))
+            return (PFN_vkVoidFunction)&DiveInterceptDestroyDevice;
         auto layer_data = GetDeviceLayerData(DataKey(dev));
         return layer_data->dispatch_table.pfn_get_device_proc_addr(dev, func);
     }
@@ -524,6 +534,10 @@ extern "C"
             return (PFN_vkVoidFunction)&DiveInterceptEnumerateInstanceLayerProperties;
         if (0 == strcmp(func, "vkCreateDevice"))
             return (PFN_vkVoidFunction)&DiveInterceptCreateDevice;
+        if (0 == strcmp(func, "vkDestroyInstance"))
+            return (PFN_vkVoidFunction)&DiveInterceptDestroyInstance;
+        if (0 == strcmp(func, "vkDestroyDevice"))
+            return (PFN_vkVoidFunction)&DiveInterceptDestroyDevice;
         auto instance_data = GetInstanceLayerData(DataKey(inst));
         return instance_data->dispatch_table.pfn_get_instance_proc_addr(inst, func);
     }
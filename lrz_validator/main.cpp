@@ -13,182 +13,453 @@
  See the License for the specific language governing permissions and
  limitations under the License.
 */
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
 #include <iostream>
-#include <optional>
+#include <thread>
 #include <vector>
 
 #include "dive_core/data_core.h"
 #include "pm4_info.h"
 
-bool ValidateLRZ(const Dive::CaptureMetadata &meta_data, const std::string &output_file_name)
+namespace
 {
-    size_t                       event_count = meta_data.m_event_info.size();
-    const Dive::EventStateInfo  &event_state = meta_data.m_event_state;
-    bool                         lrz_test_passed = true;
-    std::optional<std::ofstream> output_file = std::nullopt;
-    if (!output_file_name.empty())
+
+// A draw checked by the validator
+struct LrzDrawRecord
+{
+    uint32_t    m_event_id;
+    std::string m_draw;
+    bool        m_depth_test_enabled;
+    bool        m_depth_write_enabled;
+    VkCompareOp m_depth_func;
+    bool        m_lrz_enabled;
+    // LRZ is disabled while the depth test can reject fragments, the performance penalty the
+    // validator looks for
+    bool m_lrz_penalty;
+};
+
+struct LrzCaptureReport
+{
+    enum class Status
     {
-        std::cout << "Output detailed validation result to \"" << output_file_name << "\""
-                  << std::endl;
-        output_file.emplace(std::ofstream(output_file_name));
+        kSuccess,
+        kLoadFailed,
+        kMetadataFailed,
+    };
+
+    std::string                m_file_name;
+    Status                     m_status = Status::kSuccess;
+    std::vector<LrzDrawRecord> m_draws;
+
+    bool Passed() const
+    {
+        return std::none_of(m_draws.begin(), m_draws.end(), [](const LrzDrawRecord &draw) {
+            return draw.m_lrz_penalty;
+        });
     }
+};
 
-    std::function<void(const std::string &)> OutputDetails;
+// Number of events per validation task
+constexpr size_t kEventRangeSize = 4096;
 
-    if (output_file.has_value())
+//--------------------------------------------------------------------------------------------------
+// Runs task(0) .. task(num_tasks - 1) on up to num_workers threads, including the calling one
+void RunParallel(size_t num_tasks, uint32_t num_workers, const std::function<void(size_t)> &task)
+{
+    std::atomic<size_t> next_task{ 0 };
+    auto                worker = [&]() {
+        for (size_t i = next_task++; i < num_tasks; i = next_task++)
+        {
+            task(i);
+        }
+    };
+    num_workers = static_cast<uint32_t>(std::min<size_t>(std::max(num_workers, 1u), num_tasks));
+    std::vector<std::thread> threads;
+    for (uint32_t i = 1; i < num_workers; ++i)
     {
-        OutputDetails = [&output_file](const std::string &str) { *output_file << str; };
+        threads.emplace_back(worker);
     }
-    else
+    worker();
+    for (std::thread &thread : threads)
     {
-        OutputDetails = [](const std::string &) {};
+        thread.join();
     }
+}
 
-    for (size_t i = 0; i < event_count; ++i)
+//--------------------------------------------------------------------------------------------------
+// Checks the draws of the events in [begin, end)
+void ValidateEventRange(const Dive::CaptureMetadata  &meta_data,
+                        size_t                        begin,
+                        size_t                        end,
+                        std::vector<LrzDrawRecord> &draws)
+{
+    const Dive::EventStateInfo &event_state = meta_data.m_event_state;
+    for (size_t i = begin; i < end; ++i)
     {
         const Dive::EventInfo &info = meta_data.m_event_info[i];
         // We only output the drawcalls in direct/binning mode
-        if ((info.m_type == Dive::EventInfo::EventType::kDraw) &&
-            ((info.m_render_mode == Dive::RenderModeType::kDirect) ||
-             (info.m_render_mode == Dive::RenderModeType::kBinning)))
-        {
-            // This is just to align the strings so that they are easier to read
-            auto AppendSpace = [](std::string &str, uint32_t desired_len) {
-                if (str.length() < desired_len)
-                {
-                    str.append(desired_len - str.length(), ' ');
-                }
-            };
-
-            const uint32_t event_id = static_cast<uint32_t>(i);
-            auto event_state_it = event_state.find(static_cast<Dive::EventStateId>(event_id));
-
-            const uint32_t desired_draw_string_len = 64;
-            std::string    draw_string = info.m_str;
-            AppendSpace(draw_string, desired_draw_string_len);
-            OutputDetails(draw_string + "\t");
-
-            const bool  is_depth_test_enabled = event_state_it->DepthTestEnabled();
-            const bool  is_depth_write_enabled = event_state_it->DepthWriteEnabled();
-            VkCompareOp zfunc = event_state_it->DepthCompareOp();
-
-            OutputDetails("DepthTest:" +
-                          std::string(is_depth_test_enabled ? "Enabled\t" : "Disabled\t"));
-            OutputDetails("DepthWrite:" +
-                          std::string(is_depth_write_enabled ? "Enabled\t" : "Disabled\t"));
-
-            std::string zfunc_str = "Invalid";
-            switch (zfunc)
+        if ((info.m_type != Dive::EventInfo::EventType::kDraw) ||
+            ((info.m_render_mode != Dive::RenderModeType::kDirect) &&
+             (info.m_render_mode != Dive::RenderModeType::kBinning)))
+        {
+            continue;
+        }
+
+        const uint32_t event_id = static_cast<uint32_t>(i);
+        auto           event_state_it = event_state.find(static_cast<Dive::EventStateId>(event_id));
+
+        LrzDrawRecord draw;
+        draw.m_event_id = event_id;
+        draw.m_draw = info.m_str;
+        draw.m_depth_test_enabled = event_state_it->DepthTestEnabled();
+        draw.m_depth_write_enabled = event_state_it->DepthWriteEnabled();
+        draw.m_depth_func = event_state_it->DepthCompareOp();
+        draw.m_lrz_enabled = draw.m_depth_test_enabled && event_state_it->LRZEnabled();
+        // if depth func is Always or Never, we don't really care about LRZ
+        draw.m_lrz_penalty = draw.m_depth_test_enabled && !draw.m_lrz_enabled &&
+                             (draw.m_depth_func != VK_COMPARE_OP_NEVER) &&
+                             (draw.m_depth_func != VK_COMPARE_OP_ALWAYS);
+        draws.push_back(std::move(draw));
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Validates ranges of events in parallel. The draws are returned in event order.
+std::vector<LrzDrawRecord> ValidateLRZ(const Dive::CaptureMetadata &meta_data,
+                                       uint32_t                     num_workers)
+{
+    size_t event_count = meta_data.m_event_info.size();
+    size_t num_ranges = (event_count + kEventRangeSize - 1) / kEventRangeSize;
+
+    // The event workers decode with the GPU of the capture, which the loading thread set
+    const uint32_t                          gpu_id = GetGPUID();
+    std::vector<std::vector<LrzDrawRecord>> range_draws(num_ranges);
+    RunParallel(num_ranges, num_workers, [&](size_t range) {
+        SetGPUID(gpu_id);
+        size_t begin = range * kEventRangeSize;
+        size_t end = std::min(begin + kEventRangeSize, event_count);
+        ValidateEventRange(meta_data, begin, end, range_draws[range]);
+    });
+
+    std::vector<LrzDrawRecord> draws;
+    for (std::vector<LrzDrawRecord> &range : range_draws)
+    {
+        draws.insert(draws.end(),
+                     std::make_move_iterator(range.begin()),
+                     std::make_move_iterator(range.end()));
+    }
+    return draws;
+}
+
+//--------------------------------------------------------------------------------------------------
+LrzCaptureReport ValidateCapture(const std::string &file_name, uint32_t num_workers)
+{
+    LrzCaptureReport report;
+    report.m_file_name = file_name;
+
+    // Load capture
+    std::unique_ptr<Dive::DataCore> data_core = std::make_unique<Dive::DataCore>();
+    if (data_core->LoadPm4CaptureData(file_name) != Dive::CaptureData::LoadResult::kSuccess)
+    {
+        report.m_status = LrzCaptureReport::Status::kLoadFailed;
+        return report;
+    }
+
+    // Create meta data
+    if (!data_core->CreatePm4MetaData())
+    {
+        report.m_status = LrzCaptureReport::Status::kMetadataFailed;
+        return report;
+    }
+
+    report.m_draws = ValidateLRZ(data_core->GetCaptureMetadata(), num_workers);
+    return report;
+}
+
+//--------------------------------------------------------------------------------------------------
+const char *DepthFuncString(VkCompareOp zfunc)
+{
+    switch (zfunc)
+    {
+    case VK_COMPARE_OP_NEVER:
+        return "Never";
+    case VK_COMPARE_OP_LESS:
+        return "Less";
+    case VK_COMPARE_OP_EQUAL:
+        return "Equal";
+    case VK_COMPARE_OP_LESS_OR_EQUAL:
+        return "Less or Equal";
+    case VK_COMPARE_OP_GREATER:
+        return "Greater";
+    case VK_COMPARE_OP_NOT_EQUAL:
+        return "Not Equal";
+    case VK_COMPARE_OP_GREATER_OR_EQUAL:
+        return "Greater or Equal";
+    case VK_COMPARE_OP_ALWAYS:
+        return "Always";
+    default:
+        DIVE_ASSERT(false);
+        break;
+    }
+    return "Invalid";
+}
+
+//--------------------------------------------------------------------------------------------------
+const char *StatusString(LrzCaptureReport::Status status)
+{
+    switch (status)
+    {
+    case LrzCaptureReport::Status::kSuccess:
+        return "success";
+    case LrzCaptureReport::Status::kLoadFailed:
+        return "load_failed";
+    case LrzCaptureReport::Status::kMetadataFailed:
+        return "metadata_failed";
+    }
+    return "unknown";
+}
+
+//--------------------------------------------------------------------------------------------------
+// One line per draw, the strings are padded so that the columns are easier to read
+void WriteTextReport(std::ostream &out, const std::vector<LrzCaptureReport> &reports)
+{
+    for (const LrzCaptureReport &report : reports)
+    {
+        if (reports.size() > 1)
+        {
+            out << "Capture: " << report.m_file_name << " (" << StatusString(report.m_status)
+                << ")\n";
+        }
+        for (const LrzDrawRecord &draw : report.m_draws)
+        {
+            out << std::left << std::setw(64) << draw.m_draw << "\t";
+            out << "DepthTest:" << (draw.m_depth_test_enabled ? "Enabled\t" : "Disabled\t");
+            out << "DepthWrite:" << (draw.m_depth_write_enabled ? "Enabled\t" : "Disabled\t");
+            out << "DepthFunc:" << std::setw(16) << DepthFuncString(draw.m_depth_func) << "\t";
+            out << "LRZ:" << (draw.m_lrz_enabled ? "Enabled\t" : "Disabled\t");
+            if (draw.m_lrz_penalty)
             {
-            case VK_COMPARE_OP_NEVER:
-                zfunc_str = "Never";
-                break;
-            case VK_COMPARE_OP_LESS:
-                zfunc_str = "Less";
-                break;
-            case VK_COMPARE_OP_EQUAL:
-                zfunc_str = "Equal";
-                break;
-            case VK_COMPARE_OP_LESS_OR_EQUAL:
-                zfunc_str = "Less or Equal";
-                break;
-            case VK_COMPARE_OP_GREATER:
-                zfunc_str = "Greater";
-                break;
-            case VK_COMPARE_OP_NOT_EQUAL:
-                zfunc_str = "Not Equal";
-                break;
-            case VK_COMPARE_OP_GREATER_OR_EQUAL:
-                zfunc_str = "Greater or Equal";
-                break;
-            case VK_COMPARE_OP_ALWAYS:
-                zfunc_str = "Always";
-                break;
-            default:
-                DIVE_ASSERT(false);
-                break;
+                out << "[WARNING!] LRZ is disabled with performance penalties!";
             }
-            const uint32_t desired_zfunc_str_len = 16;
-            AppendSpace(zfunc_str, desired_zfunc_str_len);
-            OutputDetails("DepthFunc:" + zfunc_str + "\t");
-            if (is_depth_test_enabled)
+            out << "\n";
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void WriteJsonString(std::ostream &out, const std::string &str)
+{
+    out << '"';
+    for (char c : str)
+    {
+        switch (c)
+        {
+        case '"':
+            out << "\\\"";
+            break;
+        case '\\':
+            out << "\\\\";
+            break;
+        case '\n':
+            out << "\\n";
+            break;
+        case '\t':
+            out << "\\t";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
             {
-                const bool lrz_enabled = event_state_it->LRZEnabled();
-                if (!lrz_enabled)
-                {
-                    OutputDetails("LRZ:Disabled\t");
-                    // if depth func is Always or Never, we don't really care about LRZ
-                    if (is_depth_test_enabled &&
-                        ((zfunc != VK_COMPARE_OP_NEVER) && (zfunc != VK_COMPARE_OP_ALWAYS)))
-                    {
-                        lrz_test_passed = false;
-                        OutputDetails("[WARNING!] LRZ is disabled with performance penalties!");
-                    }
-                }
-                else
-                {
-                    OutputDetails("LRZ:Enabled\t");
-                }
+                out << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+                    << static_cast<uint32_t>(c) << std::dec << std::setfill(' ');
             }
             else
             {
-                OutputDetails("LRZ:Disabled\t");
+                out << c;
             }
-            OutputDetails("\n");
+            break;
         }
     }
-    return lrz_test_passed;
+    out << '"';
+}
+
+//--------------------------------------------------------------------------------------------------
+void WriteJsonReport(std::ostream &out, const std::vector<LrzCaptureReport> &reports)
+{
+    auto json_bool = [](bool value) { return value ? "true" : "false"; };
+    out << "{\n  \"captures\": [";
+    for (size_t r = 0; r < reports.size(); ++r)
+    {
+        const LrzCaptureReport &report = reports[r];
+        out << (r ? ",\n" : "\n") << "    {\n      \"file\": ";
+        WriteJsonString(out, report.m_file_name);
+        out << ",\n      \"status\": \"" << StatusString(report.m_status) << "\",\n";
+        out << "      \"passed\": "
+            << json_bool(report.m_status == LrzCaptureReport::Status::kSuccess &&
+                         report.Passed())
+            << ",\n";
+        out << "      \"draws\": [";
+        for (size_t d = 0; d < report.m_draws.size(); ++d)
+        {
+            const LrzDrawRecord &draw = report.m_draws[d];
+            out << (d ? ",\n" : "\n") << "        { \"event\": " << draw.m_event_id
+                << ", \"draw\": ";
+            WriteJsonString(out, draw.m_draw);
+            out << ", \"depth_test\": " << json_bool(draw.m_depth_test_enabled)
+                << ", \"depth_write\": " << json_bool(draw.m_depth_write_enabled)
+                << ", \"depth_func\": \"" << DepthFuncString(draw.m_depth_func)
+                << "\", \"lrz\": " << json_bool(draw.m_lrz_enabled)
+                << ", \"lrz_penalty\": " << json_bool(draw.m_lrz_penalty) << " }";
+        }
+        out << (report.m_draws.empty() ? "]\n" : "\n      ]\n") << "    }";
+    }
+    out << (reports.empty() ? "]\n" : "\n  ]\n") << "}\n";
+}
+
+//--------------------------------------------------------------------------------------------------
+bool EndsWith(const std::string &str, const char *suffix)
+{
+    size_t suffix_len = strlen(suffix);
+    return (str.size() >= suffix_len) &&
+           (str.compare(str.size() - suffix_len, suffix_len, suffix) == 0);
+}
+
+//--------------------------------------------------------------------------------------------------
+bool IsExistingCapture(const std::string &file_name)
+{
+    std::error_code ec;
+    return (EndsWith(file_name, ".rd") || EndsWith(file_name, ".dive")) &&
+           std::filesystem::is_regular_file(file_name, ec);
 }
 
+//--------------------------------------------------------------------------------------------------
+void PrintUsage()
+{
+    std::cout << "You need to call: lrz_validator <input_file_name.rd>... "
+                 "[-o <output_details_file_name.txt|.json>] [--json] [-j <jobs>]\n"
+                 "  -o: write the details of each drawcall, as json if the name ends with .json\n"
+                 "      With exactly two file names and no -o, the second one is the output unless\n"
+                 "      it is an existing .rd or .dive capture:\n"
+                 "      lrz_validator <input_file_name.rd> <output_details_file_name.txt>\n"
+                 "  --json: write the details as json\n"
+                 "  -j: number of threads, default one per core\n";
+}
+
+}  // namespace
+
 int main(int argc, char **argv)
 {
     Pm4InfoInit();
 
     // Handle args
-    if ((argc != 2) && (argc != 3))
+    std::vector<std::string> input_file_names;
+    std::string              output_file_name;
+    bool                     json = false;
+    uint32_t                 num_workers = std::max(std::thread::hardware_concurrency(), 1u);
+    for (int i = 1; i < argc; ++i)
     {
-        std::cout << "You need to call: lrz_validator <input_file_name.rd> "
-                     "<output_details_file_name.txt>(optional)";
-        return 0;
+        bool has_value = (i + 1 < argc);
+        if (strcmp(argv[i], "-o") == 0 && has_value)
+        {
+            output_file_name = argv[++i];
+        }
+        else if (strcmp(argv[i], "-j") == 0 && has_value)
+        {
+            num_workers = std::max(static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10)), 1u);
+        }
+        else if (strcmp(argv[i], "--json") == 0)
+        {
+            json = true;
+        }
+        else if (argv[i][0] != '-')
+        {
+            input_file_names.push_back(argv[i]);
+        }
+        else
+        {
+            input_file_names.clear();
+            break;
+        }
     }
-    char *input_file_name = argv[1];
-
-    std::string output_file_name = "";
-    if (argc == 3)
+    // Keep the original "lrz_validator <input> <output_details_file_name>" form working, whatever
+    // the extension of the output. Two captures are both validated, and need -o for the details.
+    if (output_file_name.empty() && (input_file_names.size() == 2) &&
+        !IsExistingCapture(input_file_names[1]))
     {
-        output_file_name = argv[2];
+        output_file_name = input_file_names[1];
+        input_file_names.pop_back();
     }
-
-    // Load capture
-    std::unique_ptr<Dive::DataCore> data_core = std::make_unique<Dive::DataCore>();
-    Dive::CaptureData::LoadResult   load_res = data_core->LoadPm4CaptureData(input_file_name);
-    if (load_res != Dive::CaptureData::LoadResult::kSuccess)
+    if (input_file_names.empty())
     {
-        std::cout << "Loading capture \"" << input_file_name << "\" failed!";
+        PrintUsage();
         return 0;
     }
-    std::cout << "Capture file \"" << input_file_name << "\" is loaded!\n";
+    json = json || EndsWith(output_file_name, ".json");
 
-    // Create meta data
-    if (!data_core->CreatePm4MetaData())
+    // Validate the captures in parallel, and the events of each capture with the remaining threads.
+    // Each capture is loaded by the worker validating it, which keeps the GPU of that capture.
+    std::cout << "Validating LRZ...\n";
+    uint32_t capture_workers = std::min<uint32_t>(num_workers,
+                                                  static_cast<uint32_t>(input_file_names.size()));
+    uint32_t event_workers = std::max(num_workers / capture_workers, 1u);
+    std::vector<LrzCaptureReport> reports(input_file_names.size());
+    RunParallel(input_file_names.size(), capture_workers, [&](size_t i) {
+        reports[i] = ValidateCapture(input_file_names[i], event_workers);
+    });
+
+    bool all_loaded = true;
+    for (const LrzCaptureReport &report : reports)
     {
-        std::cout << "Failed to create meta data!";
-        return 0;
+        const char *input_file_name = report.m_file_name.c_str();
+        if (report.m_status == LrzCaptureReport::Status::kLoadFailed)
+        {
+            std::cout << "Loading capture \"" << input_file_name << "\" failed!\n";
+            all_loaded = false;
+            continue;
+        }
+        if (report.m_status == LrzCaptureReport::Status::kMetadataFailed)
+        {
+            std::cout << "Failed to create meta data for \"" << input_file_name << "\"!\n";
+            all_loaded = false;
+            continue;
+        }
+        std::cout << "Capture file \"" << input_file_name << "\" is loaded!\n";
+        if (report.Passed())
+        {
+            std::cout << "[LRZ Pass] \"" << input_file_name
+                      << "\": LRZ is correctly set for all drawcalls!\n";
+        }
+        else
+        {
+            std::cout << "[LRZ Fail] \"" << input_file_name
+                      << "\": Some drawcalls have LRZ disabled but depth test is enabled and "
+                         "depth func is not set to NEVER or ALWAYS!\n";
+        }
     }
-    std::cout << "Validating LRZ...\n";
 
-    // LRZ Validation
-    const Dive::CaptureMetadata &meta_data = data_core->GetCaptureMetadata();
-    const bool                   lrz_test_passed = ValidateLRZ(meta_data, output_file_name);
-    if (lrz_test_passed)
+    if (!output_file_name.empty())
     {
-        std::cout << "[LRZ Pass] LRZ is correctly set for all drawcalls!\n";
+        std::cout << "Output detailed validation result to \"" << output_file_name << "\""
+                  << std::endl;
+        std::ofstream output_file(output_file_name);
+        if (json)
+        {
+            WriteJsonReport(output_file, reports);
+        }
+        else
+        {
+            WriteTextReport(output_file, reports);
+        }
     }
-    else
+    else if (input_file_names.size() > 1)
     {
-        std::cout << "[LRZ Fail] Some drawcalls have LRZ disabled but depth test is enabled and "
-                     "depth func is not set to NEVER or ALWAYS!\n";
+        std::cout << "Use -o to write the details of the drawcalls of the captures" << std::endl;
     }
 
-    return 1;
+    return all_loaded ? 1 : 0;
 }
@@ -0,0 +1,469 @@
+/*
+Copyright 2025 Google Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "file_transfer.h"
+
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <fstream>
+
+#include "absl/strings/str_cat.h"
+
+#ifdef DIVE_NETWORK_HAS_ZLIB
+#    include <zlib.h>
+#endif
+
+namespace Network
+{
+
+namespace
+{
+constexpr uint32_t kMinFileChunkSize = 4 * 1024;
+// Leaves room for the chunk header and for data that doesn't compress in a kMaxPayloadSize message.
+constexpr uint32_t kMaxFileChunkSize = 8 * 1024 * 1024;
+
+using Crc32cTables = std::array<std::array<uint32_t, 256>, 8>;
+
+// Tables for the slicing-by-8 CRC32C, which processes 8 bytes per step.
+constexpr Crc32cTables MakeCrc32cTables()
+{
+    // Reversed Castagnoli polynomial.
+    constexpr uint32_t kPolynomial = 0x82F63B78;
+    Crc32cTables       tables = {};
+    for (uint32_t i = 0; i < 256; ++i)
+    {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit)
+        {
+            crc = (crc >> 1) ^ ((crc & 1) ? kPolynomial : 0);
+        }
+        tables[0][i] = crc;
+    }
+    for (uint32_t i = 0; i < 256; ++i)
+    {
+        for (size_t t = 1; t < tables.size(); ++t)
+        {
+            const uint32_t prev = tables[t - 1][i];
+            tables[t][i] = (prev >> 8) ^ tables[0][prev & 0xFF];
+        }
+    }
+    return tables;
+}
+
+constexpr Crc32cTables kCrc32cTables = MakeCrc32cTables();
+
+uint32_t ClampChunkSize(uint32_t chunk_size)
+{
+    if (chunk_size == 0)
+    {
+        return kDefaultFileChunkSize;
+    }
+    return std::clamp(chunk_size, kMinFileChunkSize, kMaxFileChunkSize);
+}
+
+// Compresses raw into compressed. Returns false if the chunk should be sent uncompressed instead.
+bool CompressChunk(CompressionType type, const Buffer& raw, Buffer& compressed)
+{
+    switch (type)
+    {
+#ifdef DIVE_NETWORK_HAS_ZLIB
+    case CompressionType::kDeflate:
+    {
+        uLongf compressed_size = compressBound(static_cast<uLong>(raw.size()));
+        compressed.resize(compressed_size);
+        int result = compress2(compressed.data(),
+                               &compressed_size,
+                               raw.data(),
+                               static_cast<uLong>(raw.size()),
+                               Z_BEST_SPEED);
+        if (result != Z_OK || compressed_size >= raw.size())
+        {
+            return false;
+        }
+        compressed.resize(compressed_size);
+        return true;
+    }
+#endif
+    default: return false;
+    }
+}
+
+absl::Status DecompressChunk(const FileChunkMessage& chunk, Buffer& raw)
+{
+    raw.resize(chunk.GetRawSize());
+    switch (chunk.GetCompressionType())
+    {
+#ifdef DIVE_NETWORK_HAS_ZLIB
+    case CompressionType::kDeflate:
+    {
+        uLongf raw_size = static_cast<uLongf>(raw.size());
+        int    result = uncompress(raw.data(),
+                               &raw_size,
+                               chunk.GetData().data(),
+                               static_cast<uLong>(chunk.GetData().size()));
+        if (result != Z_OK || raw_size != raw.size())
+        {
+            return absl::DataLossError(
+            absl::StrCat("DecompressChunk: Failed to inflate chunk at offset ",
+                         chunk.GetOffset(),
+                         " (zlib error ",
+                         result,
+                         ")."));
+        }
+        return absl::OkStatus();
+    }
+#endif
+    default:
+        return absl::InvalidArgumentError(
+        absl::StrCat("DecompressChunk: Unsupported compression type ",
+                     static_cast<uint32_t>(chunk.GetCompressionType()),
+                     "."));
+    }
+}
+
+absl::Status SendRangeError(SocketConnection* conn, std::string error_reason)
+{
+    DownloadFileRangeResponse response;
+    response.SetFound(false);
+    response.SetErrorReason(std::move(error_reason));
+    return SendMessage(conn, response);
+}
+
+}  // namespace
+
+uint32_t Crc32c(const uint8_t* data, size_t size, uint32_t crc)
+{
+    const Crc32cTables& t = kCrc32cTables;
+    crc = ~crc;
+    while (size >= 8)
+    {
+        const uint32_t low = crc ^ (static_cast<uint32_t>(data[0]) |
+                                    (static_cast<uint32_t>(data[1]) << 8) |
+                                    (static_cast<uint32_t>(data[2]) << 16) |
+                                    (static_cast<uint32_t>(data[3]) << 24));
+        crc = t[7][low & 0xFF] ^ t[6][(low >> 8) & 0xFF] ^ t[5][(low >> 16) & 0xFF] ^
+              t[4][low >> 24] ^ t[3][data[4]] ^ t[2][data[5]] ^ t[1][data[6]] ^ t[0][data[7]];
+        data += 8;
+        size -= 8;
+    }
+    while (size-- > 0)
+    {
+        crc = t[0][(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+uint32_t GetSupportedCompressionTypes()
+{
+    uint32_t types = 1u << static_cast<uint32_t>(CompressionType::kNone);
+#ifdef DIVE_NETWORK_HAS_ZLIB
+    types |= 1u << static_cast<uint32_t>(CompressionType::kDeflate);
+#endif
+    return types;
+}
+
+CompressionType ChooseCompressionType(uint32_t accepted_types)
+{
+    const uint32_t types = accepted_types & GetSupportedCompressionTypes();
+    if (types & (1u << static_cast<uint32_t>(CompressionType::kDeflate)))
+    {
+        return CompressionType::kDeflate;
+    }
+    return CompressionType::kNone;
+}
+
+int64_t GetFileMtime(const std::string& file_path)
+{
+    std::error_code ec;
+    auto            mtime = std::filesystem::last_write_time(file_path, ec);
+    if (ec)
+    {
+        return 0;
+    }
+    return static_cast<int64_t>(mtime.time_since_epoch().count());
+}
+
+absl::Status SendFileRange(SocketConnection* conn, const DownloadFileRangeRequest& request)
+{
+    const std::string& file_path = request.GetFilePath();
+    std::error_code    ec;
+    uint64_t           file_size = std::filesystem::file_size(file_path, ec);
+    if (ec)
+    {
+        auto status = SendRangeError(conn, ec.message());
+        if (!status.ok())
+        {
+            return status;
+        }
+        return absl::NotFoundError(absl::StrCat("SendFileRange: ", ec.message()));
+    }
+    if (request.GetOffset() > file_size)
+    {
+        std::string reason = absl::StrCat("Offset ",
+                                          request.GetOffset(),
+                                          " is beyond the end of the file (",
+                                          file_size,
+                                          " bytes).");
+        auto        status = SendRangeError(conn, reason);
+        if (!status.ok())
+        {
+            return status;
+        }
+        return absl::OutOfRangeError(absl::StrCat("SendFileRange: ", reason));
+    }
+    const int64_t file_mtime = GetFileMtime(file_path);
+    if ((request.GetOffset() > 0) &&
+        ((request.GetFileSize() != file_size) || (request.GetFileMtime() != file_mtime)))
+    {
+        std::string reason = "File changed since the partial download.";
+        auto        status = SendRangeError(conn, reason);
+        if (!status.ok())
+        {
+            return status;
+        }
+        return absl::FailedPreconditionError(absl::StrCat("SendFileRange: ", reason));
+    }
+
+    std::ifstream file(file_path, std::ios::binary);
+    if (!file.is_open() || !file.seekg(static_cast<std::streamoff>(request.GetOffset())))
+    {
+        std::string reason = absl::StrCat("Failed to open file: ", file_path);
+        auto        status = SendRangeError(conn, reason);
+        if (!status.ok())
+        {
+            return status;
+        }
+        return absl::InternalError(absl::StrCat("SendFileRange: ", reason));
+    }
+
+    DownloadFileRangeResponse response;
+    response.SetFound(true);
+    response.SetFileSize(file_size);
+    response.SetFileMtime(file_mtime);
+    response.SetOffset(request.GetOffset());
+    response.SetCompressionType(ChooseCompressionType(request.GetCompressionTypes()));
+    response.SetChunkSize(ClampChunkSize(request.GetChunkSize()));
+    auto status = SendMessage(conn, response);
+    if (!status.ok())
+    {
+        return status;
+    }
+
+    // The chunk buffers are reused, so sending a chunk doesn't allocate once they have grown.
+    MessageArena     arena;
+    FileChunkMessage chunk;
+    Buffer           raw;
+    uint64_t         position = response.GetOffset();
+    while (position < file_size)
+    {
+        const size_t chunk_size = static_cast<size_t>(
+        std::min<uint64_t>(response.GetChunkSize(), file_size - position));
+        raw.resize(chunk_size);
+        if (!file.read(reinterpret_cast<char*>(raw.data()), chunk_size))
+        {
+            std::string reason = absl::StrCat("Failed to read file at offset ", position, ".");
+            status = SendRangeError(conn, reason);
+            if (!status.ok())
+            {
+                return status;
+            }
+            return absl::DataLossError(absl::StrCat("SendFileRange: ", reason));
+        }
+
+        chunk.SetOffset(position);
+        chunk.SetRawSize(static_cast<uint32_t>(chunk_size));
+        chunk.SetChecksum(Crc32c(raw.data(), raw.size()));
+        if (CompressChunk(response.GetCompressionType(), raw, chunk.GetData()))
+        {
+            chunk.SetCompressionType(response.GetCompressionType());
+        }
+        else
+        {
+            chunk.SetCompressionType(CompressionType::kNone);
+            chunk.GetData().swap(raw);
+        }
+
+        status = SendMessage(conn, chunk, arena);
+        if (!status.ok())
+        {
+            return status;
+        }
+        position += chunk_size;
+    }
+    return absl::OkStatus();
+}
+
+absl::Status ReceiveFileRange(SocketConnection*                conn,
+                              const std::string&               file_path,
+                              const DownloadFileRangeResponse& response,
+                              std::function<void(size_t)>      progress_callback)
+{
+    const uint64_t file_size = response.GetFileSize();
+    uint64_t       position = response.GetOffset();
+    if (position > file_size)
+    {
+        return absl::InvalidArgumentError(
+        absl::StrCat("ReceiveFileRange: Offset ", position, " is beyond the file size."));
+    }
+
+    // Drop anything after the offset, the file must only contain verified data.
+    std::error_code ec;
+    if (position == 0)
+    {
+        std::ofstream create(file_path, std::ios::binary | std::ios::trunc);
+        if (!create.is_open())
+        {
+            return absl::InternalError(
+            absl::StrCat("ReceiveFileRange: Failed to create file: ", file_path));
+        }
+    }
+    else if (std::filesystem::file_size(file_path, ec) < position || ec)
+    {
+        return absl::FailedPreconditionError(
+        absl::StrCat("ReceiveFileRange: File doesn't hold the first ",
+                     position,
+                     " bytes to resume from: ",
+                     file_path));
+    }
+    std::filesystem::resize_file(file_path, position, ec);
+    if (ec)
+    {
+        return absl::InternalError(
+        absl::StrCat("ReceiveFileRange: Failed to truncate file: ", ec.message()));
+    }
+
+    std::fstream file(file_path, std::ios::binary | std::ios::in | std::ios::out);
+    if (!file.is_open() || !file.seekp(static_cast<std::streamoff>(position)))
+    {
+        return absl::InternalError(
+        absl::StrCat("ReceiveFileRange: Failed to open file: ", file_path));
+    }
+
+    // Closes the file and trims it to the data written, so it can be resumed from its size.
+    auto Fail = [&](absl::Status status) {
+        file.close();
+        std::error_code resize_ec;
+        std::filesystem::resize_file(file_path, position, resize_ec);
+        return status;
+    };
+
+    absl::Status mismatch_status;
+    uint64_t     received = position;
+    Buffer       raw;
+    MessageArena arena;
+    while (received < file_size)
+    {
+        auto message = ReceiveMessage(conn, arena);
+        if (!message.ok())
+        {
+            return Fail(message.status());
+        }
+        if ((*message)->GetMessageType() == MessageType::DOWNLOAD_FILE_RANGE_RESPONSE)
+        {
+            auto* error = dynamic_cast<DownloadFileRangeResponse*>(*message);
+            return Fail(absl::AbortedError(
+            absl::StrCat("ReceiveFileRange: Server aborted the transfer: ",
+                         error ? error->GetErrorReason() : "")));
+        }
+        auto* chunk = dynamic_cast<FileChunkMessage*>(*message);
+        if (!chunk)
+        {
+            return Fail(absl::FailedPreconditionError(
+            absl::StrCat("ReceiveFileRange: Unexpected message type (Expected: ",
+                         MessageType::FILE_CHUNK,
+                         ", Got: ",
+                         (*message)->GetMessageType(),
+                         ").")));
+        }
+        if (chunk->GetOffset() != received || chunk->GetRawSize() > file_size - received)
+        {
+            return Fail(absl::FailedPreconditionError(
+            absl::StrCat("ReceiveFileRange: Unexpected chunk at offset ",
+                         chunk->GetOffset(),
+                         " with size ",
+                         chunk->GetRawSize(),
+                         ", expected offset ",
+                         received,
+                         ".")));
+        }
+        received += chunk->GetRawSize();
+
+        // After a bad chunk, the rest of the range is only drained.
+        if (!mismatch_status.ok())
+        {
+            continue;
+        }
+
+        const Buffer* data = &chunk->GetData();
+        if (chunk->GetCompressionType() != CompressionType::kNone)
+        {
+            auto status = DecompressChunk(*chunk, raw);
+            if (!status.ok())
+            {
+                mismatch_status = status;
+                continue;
+            }
+            data = &raw;
+        }
+        else if (data->size() != chunk->GetRawSize())
+        {
+            mismatch_status = absl::DataLossError(
+            absl::StrCat("ReceiveFileRange: Chunk at offset ",
+                         chunk->GetOffset(),
+                         " has ",
+                         data->size(),
+                         " bytes, expected ",
+                         chunk->GetRawSize(),
+                         "."));
+            continue;
+        }
+
+        const uint32_t checksum = Crc32c(data->data(), data->size());
+        if (checksum != chunk->GetChecksum())
+        {
+            mismatch_status = absl::DataLossError(
+            absl::StrCat("ReceiveFileRange: Checksum mismatch for chunk at offset ",
+                         chunk->GetOffset(),
+                         "."));
+            continue;
+        }
+
+        if (!file.write(reinterpret_cast<const char*>(data->data()), data->size()))
+        {
+            return Fail(absl::InternalError(
+            absl::StrCat("ReceiveFileRange: Failed to write file: ", file_path)));
+        }
+        position += data->size();
+        if (progress_callback)
+        {
+            progress_callback(static_cast<size_t>(position));
+        }
+    }
+
+    if (!mismatch_status.ok())
+    {
+        return Fail(mismatch_status);
+    }
+    if (!file.flush())
+    {
+        return Fail(absl::InternalError(
+        absl::StrCat("ReceiveFileRange: Failed to write file: ", file_path)));
+    }
+    return absl::OkStatus();
+}
+
+}  // namespace Network
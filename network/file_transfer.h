@@ -0,0 +1,61 @@
+/*
+Copyright 2025 Google Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "messages.h"
+
+namespace Network
+{
+
+// Size of the uncompressed chunks when the client doesn't ask for a specific one.
+constexpr uint32_t kDefaultFileChunkSize = 1024 * 1024;
+
+// Computes the CRC32C (Castagnoli) of the data, continuing from a previous CRC if any.
+uint32_t Crc32c(const uint8_t* data, size_t size, uint32_t crc = 0);
+
+// Returns a bit mask of (1 << CompressionType) for the compression types built into this binary.
+uint32_t GetSupportedCompressionTypes();
+
+// Chooses the compression to use for a peer accepting the given bit mask of compression types.
+CompressionType ChooseCompressionType(uint32_t accepted_types);
+
+// Returns the modification time of the file as an opaque value, only meant to be compared with
+// another value from the same machine. 0 if it can't be determined.
+int64_t GetFileMtime(const std::string& file_path);
+
+// Server side of DOWNLOAD_FILE_RANGE: sends a DownloadFileRangeResponse, then the requested range
+// of the file as FILE_CHUNK messages. A request resuming from a non-zero offset is refused if the
+// file size or modification time differ from the ones in the request.
+absl::Status SendFileRange(SocketConnection* conn, const DownloadFileRangeRequest& request);
+
+// Client side of DOWNLOAD_FILE_RANGE: receives the FILE_CHUNK messages following the response
+// into file_path, which must hold at least the first response.GetOffset() bytes of the file.
+// The file always ends with verified data, so an interrupted download can be resumed from its
+// size. On a checksum mismatch the rest of the range is drained to keep the connection usable and
+// absl::DataLossError is returned.
+// The progress callback receives the number of bytes of the file received so far.
+absl::Status ReceiveFileRange(SocketConnection*                conn,
+                              const std::string&               file_path,
+                              const DownloadFileRangeResponse& response,
+                              std::function<void(size_t)>      progress_callback = nullptr);
+
+}  // namespace Network
@@ -23,6 +23,8 @@ limitations under the License.
 namespace Network
 {
 
+// The server calls the handler from several threads, one per connection being served, so
+// implementations must be thread-safe. The messages of a single connection are handled in order.
 class IMessageHandler
 {
 public:
@@ -15,6 +15,10 @@ limitations under the License.
 */
 
 #include "messages.h"
+
+#include <algorithm>
+#include <cstring>
+
 #include "common/macros.h"
 #include "absl/strings/str_cat.h"
 
@@ -30,6 +34,12 @@ void WriteUint32ToBuffer(uint32_t value, Buffer& dest)
     dest.insert(dest.end(), p_val, p_val + sizeof(uint32_t));
 }
 
+void WriteUint64ToBuffer(uint64_t value, Buffer& dest)
+{
+    WriteUint32ToBuffer(static_cast<uint32_t>(value >> 32), dest);
+    WriteUint32ToBuffer(static_cast<uint32_t>(value), dest);
+}
+
 void WriteStringToBuffer(const std::string& str, Buffer& dest)
 {
     WriteUint32ToBuffer(static_cast<uint32_t>(str.length()), dest);
@@ -48,7 +58,22 @@ absl::StatusOr<uint32_t> ReadUint32FromBuffer(const Buffer& src, size_t& offset)
     return ntohl(net_val);
 }
 
+absl::StatusOr<uint64_t> ReadUint64FromBuffer(const Buffer& src, size_t& offset)
+{
+    uint32_t high, low;
+    ASSIGN_OR_RETURN(high, ReadUint32FromBuffer(src, offset));
+    ASSIGN_OR_RETURN(low, ReadUint32FromBuffer(src, offset));
+    return (static_cast<uint64_t>(high) << 32) | low;
+}
+
 absl::StatusOr<std::string> ReadStringFromBuffer(const Buffer& src, size_t& offset)
+{
+    std::string_view str;
+    ASSIGN_OR_RETURN(str, ReadStringViewFromBuffer(src, offset));
+    return std::string(str);
+}
+
+absl::StatusOr<std::string_view> ReadStringViewFromBuffer(const Buffer& src, size_t& offset)
 {
     uint32_t len;
     ASSIGN_OR_RETURN(len, ReadUint32FromBuffer(src, offset));
@@ -56,11 +81,91 @@ absl::StatusOr<std::string> ReadStringFromBuffer(const Buffer& src, size_t& offs
     {
         return absl::InvalidArgumentError("Buffer too small for declared string length.");
     }
-    std::string result(reinterpret_cast<const char*>(src.data() + offset), len);
+    std::string_view result(reinterpret_cast<const char*>(src.data() + offset), len);
     offset += len;
     return result;
 }
 
+namespace
+{
+
+// Reads a string into dest, reusing its storage.
+absl::Status ReadStringIntoBuffer(const Buffer& src, size_t& offset, std::string& dest)
+{
+    std::string_view str;
+    ASSIGN_OR_RETURN(str, ReadStringViewFromBuffer(src, offset));
+    dest.assign(str.data(), str.size());
+    return absl::OkStatus();
+}
+
+constexpr size_t kMessageHeaderSize = sizeof(uint32_t) * 2;
+
+// Receives the header and the payload of the next message into payload, which is resized to the
+// payload length.
+absl::StatusOr<uint32_t> ReceiveMessagePayload(SocketConnection* conn,
+                                               Buffer&           payload,
+                                               int               timeout_ms)
+{
+    if (!conn)
+    {
+        return absl::InvalidArgumentError("Provided SocketConnection is null.");
+    }
+
+    uint8_t header_buffer[kMessageHeaderSize];
+
+    // Receive the message header.
+    absl::Status status = ReceiveBuffer(conn, header_buffer, kMessageHeaderSize, timeout_ms);
+    if (!status.ok())
+    {
+        return status;
+    }
+
+    // Parse header.
+    uint32_t net_type, net_length;
+    std::memcpy(&net_type, header_buffer, sizeof(uint32_t));
+    std::memcpy(&net_length, header_buffer + sizeof(uint32_t), sizeof(uint32_t));
+    uint32_t type = ntohl(net_type);
+    uint32_t payload_length = ntohl(net_length);
+
+    if (payload_length > kMaxPayloadSize)
+    {
+        conn->Close();
+        return absl::InvalidArgumentError(
+        absl::StrCat("Payload size ", payload_length, " exceeds limit."));
+    }
+
+    // Receive the message payload.
+    payload.resize(payload_length);
+    status = ReceiveBuffer(conn, payload.data(), payload_length, timeout_ms);
+    if (!status.ok())
+    {
+        return status;
+    }
+    return type;
+}
+
+// Sends the header and the serialized payload of a message in one gathered write.
+absl::Status SendMessagePayload(SocketConnection* conn, MessageType type, const Buffer& payload)
+{
+    if (payload.size() > kMaxPayloadSize)
+    {
+        return absl::InvalidArgumentError("Serialized payload size exceeds limit.");
+    }
+
+    // Construct the header.
+    uint32_t net_type = htonl(static_cast<uint32_t>(type));
+    uint32_t net_payload_length = htonl(static_cast<uint32_t>(payload.size()));
+    uint8_t  header_buffer[kMessageHeaderSize];
+    std::memcpy(header_buffer, &net_type, sizeof(uint32_t));
+    std::memcpy(header_buffer + sizeof(uint32_t), &net_payload_length, sizeof(uint32_t));
+
+    const ConstSlice slices[] = { { header_buffer, kMessageHeaderSize },
+                                  { payload.data(), payload.size() } };
+    return conn->SendV(slices, 2);
+}
+
+}  // namespace
+
 absl::Status HandshakeMessage::Serialize(Buffer& dest) const
 {
     dest.clear();
@@ -81,6 +186,39 @@ absl::Status HandshakeMessage::Deserialize(const Buffer& src)
     return absl::OkStatus();
 }
 
+absl::Status HandshakeResponse::Serialize(Buffer& dest) const
+{
+    RETURN_IF_ERROR(HandshakeMessage::Serialize(dest));
+    // Clients predating v1.1 reject trailing data
+    if (GetMinorVersion() >= kDownloadFileRangeMinorVersion)
+    {
+        WriteUint32ToBuffer(m_capabilities, dest);
+    }
+    return absl::OkStatus();
+}
+
+absl::Status HandshakeResponse::Deserialize(const Buffer& src)
+{
+    size_t   offset = 0;
+    uint32_t major_version;
+    uint32_t minor_version;
+    ASSIGN_OR_RETURN(major_version, ReadUint32FromBuffer(src, offset));
+    ASSIGN_OR_RETURN(minor_version, ReadUint32FromBuffer(src, offset));
+    SetMajorVersion(major_version);
+    SetMinorVersion(minor_version);
+    // Servers predating v1.1 echo the client version without a capability mask
+    m_capabilities = 0;
+    if (offset != src.size())
+    {
+        ASSIGN_OR_RETURN(m_capabilities, ReadUint32FromBuffer(src, offset));
+    }
+    if (offset != src.size())
+    {
+        return absl::InvalidArgumentError("Handshake message has unexpected trailing data.");
+    }
+    return absl::OkStatus();
+}
+
 absl::Status StringMessage::Serialize(Buffer& dest) const
 {
     dest.clear();
@@ -91,7 +229,7 @@ absl::Status StringMessage::Serialize(Buffer& dest) const
 absl::Status StringMessage::Deserialize(const Buffer& src)
 {
     size_t offset = 0;
-    ASSIGN_OR_RETURN(m_str, ReadStringFromBuffer(src, offset));
+    RETURN_IF_ERROR(ReadStringIntoBuffer(src, offset, m_str));
     if (offset != src.size())
     {
         return absl::InvalidArgumentError("String message has unexpected trailing data.");
@@ -101,6 +239,7 @@ absl::Status StringMessage::Deserialize(const Buffer& src)
 
 absl::Status DownloadFileResponse::Serialize(Buffer& dest) const
 {
+    dest.clear();
     dest.push_back(static_cast<uint8_t>(m_found));
     WriteStringToBuffer(m_error_reason, dest);
     WriteStringToBuffer(m_file_path, dest);
@@ -120,9 +259,9 @@ absl::Status DownloadFileResponse::Deserialize(const Buffer& src)
     m_found = (src[offset] != 0);
     offset += sizeof(uint8_t);
 
-    ASSIGN_OR_RETURN(m_error_reason, ReadStringFromBuffer(src, offset));
-    ASSIGN_OR_RETURN(m_file_path, ReadStringFromBuffer(src, offset));
-    ASSIGN_OR_RETURN(m_file_size_str, ReadStringFromBuffer(src, offset));
+    RETURN_IF_ERROR(ReadStringIntoBuffer(src, offset, m_error_reason));
+    RETURN_IF_ERROR(ReadStringIntoBuffer(src, offset, m_file_path));
+    RETURN_IF_ERROR(ReadStringIntoBuffer(src, offset, m_file_size_str));
     if (offset != src.size())
     {
         return absl::InvalidArgumentError("Message has unexpected trailing data.");
@@ -132,6 +271,7 @@ absl::Status DownloadFileResponse::Deserialize(const Buffer& src)
 
 absl::Status FileSizeResponse::Serialize(Buffer& dest) const
 {
+    dest.clear();
     dest.push_back(static_cast<uint8_t>(m_found));
     WriteStringToBuffer(m_error_reason, dest);
     WriteStringToBuffer(m_file_size_str, dest);
@@ -150,8 +290,79 @@ absl::Status FileSizeResponse::Deserialize(const Buffer& src)
     m_found = (src[offset] != 0);
     offset += sizeof(uint8_t);
 
-    ASSIGN_OR_RETURN(m_error_reason, ReadStringFromBuffer(src, offset));
-    ASSIGN_OR_RETURN(m_file_size_str, ReadStringFromBuffer(src, offset));
+    RETURN_IF_ERROR(ReadStringIntoBuffer(src, offset, m_error_reason));
+    RETURN_IF_ERROR(ReadStringIntoBuffer(src, offset, m_file_size_str));
+    if (offset != src.size())
+    {
+        return absl::InvalidArgumentError("Message has unexpected trailing data.");
+    }
+    return absl::OkStatus();
+}
+
+absl::Status DownloadFileRangeRequest::Serialize(Buffer& dest) const
+{
+    dest.clear();
+    WriteStringToBuffer(m_file_path, dest);
+    WriteUint64ToBuffer(m_offset, dest);
+    WriteUint32ToBuffer(m_compression_types, dest);
+    WriteUint32ToBuffer(m_chunk_size, dest);
+    WriteUint64ToBuffer(m_file_size, dest);
+    WriteUint64ToBuffer(static_cast<uint64_t>(m_file_mtime), dest);
+    return absl::OkStatus();
+}
+
+absl::Status DownloadFileRangeRequest::Deserialize(const Buffer& src)
+{
+    size_t offset = 0;
+    RETURN_IF_ERROR(ReadStringIntoBuffer(src, offset, m_file_path));
+    ASSIGN_OR_RETURN(m_offset, ReadUint64FromBuffer(src, offset));
+    ASSIGN_OR_RETURN(m_compression_types, ReadUint32FromBuffer(src, offset));
+    ASSIGN_OR_RETURN(m_chunk_size, ReadUint32FromBuffer(src, offset));
+    ASSIGN_OR_RETURN(m_file_size, ReadUint64FromBuffer(src, offset));
+    uint64_t file_mtime;
+    ASSIGN_OR_RETURN(file_mtime, ReadUint64FromBuffer(src, offset));
+    m_file_mtime = static_cast<int64_t>(file_mtime);
+    if (offset != src.size())
+    {
+        return absl::InvalidArgumentError("Message has unexpected trailing data.");
+    }
+    return absl::OkStatus();
+}
+
+absl::Status DownloadFileRangeResponse::Serialize(Buffer& dest) const
+{
+    dest.clear();
+    dest.push_back(static_cast<uint8_t>(m_found));
+    WriteStringToBuffer(m_error_reason, dest);
+    WriteUint64ToBuffer(m_file_size, dest);
+    WriteUint64ToBuffer(static_cast<uint64_t>(m_file_mtime), dest);
+    WriteUint64ToBuffer(m_offset, dest);
+    WriteUint32ToBuffer(static_cast<uint32_t>(m_compression_type), dest);
+    WriteUint32ToBuffer(m_chunk_size, dest);
+    return absl::OkStatus();
+}
+
+absl::Status DownloadFileRangeResponse::Deserialize(const Buffer& src)
+{
+    size_t offset = 0;
+    // Deserialize the 'found' boolean.
+    if (src.size() < offset + sizeof(uint8_t))
+    {
+        return absl::InvalidArgumentError("Buffer too small for 'found' field.");
+    }
+    m_found = (src[offset] != 0);
+    offset += sizeof(uint8_t);
+
+    uint32_t compression_type;
+    uint64_t file_mtime;
+    RETURN_IF_ERROR(ReadStringIntoBuffer(src, offset, m_error_reason));
+    ASSIGN_OR_RETURN(m_file_size, ReadUint64FromBuffer(src, offset));
+    ASSIGN_OR_RETURN(file_mtime, ReadUint64FromBuffer(src, offset));
+    m_file_mtime = static_cast<int64_t>(file_mtime);
+    ASSIGN_OR_RETURN(m_offset, ReadUint64FromBuffer(src, offset));
+    ASSIGN_OR_RETURN(compression_type, ReadUint32FromBuffer(src, offset));
+    ASSIGN_OR_RETURN(m_chunk_size, ReadUint32FromBuffer(src, offset));
+    m_compression_type = static_cast<CompressionType>(compression_type);
     if (offset != src.size())
     {
         return absl::InvalidArgumentError("Message has unexpected trailing data.");
@@ -159,6 +370,37 @@ absl::Status FileSizeResponse::Deserialize(const Buffer& src)
     return absl::OkStatus();
 }
 
+absl::Status FileChunkMessage::Serialize(Buffer& dest) const
+{
+    dest.clear();
+    dest.reserve(sizeof(uint64_t) + sizeof(uint32_t) * 4 + m_data.size());
+    WriteUint64ToBuffer(m_offset, dest);
+    WriteUint32ToBuffer(m_raw_size, dest);
+    WriteUint32ToBuffer(static_cast<uint32_t>(m_compression_type), dest);
+    WriteUint32ToBuffer(m_checksum, dest);
+    WriteUint32ToBuffer(static_cast<uint32_t>(m_data.size()), dest);
+    dest.insert(dest.end(), m_data.begin(), m_data.end());
+    return absl::OkStatus();
+}
+
+absl::Status FileChunkMessage::Deserialize(const Buffer& src)
+{
+    size_t   offset = 0;
+    uint32_t compression_type, data_size;
+    ASSIGN_OR_RETURN(m_offset, ReadUint64FromBuffer(src, offset));
+    ASSIGN_OR_RETURN(m_raw_size, ReadUint32FromBuffer(src, offset));
+    ASSIGN_OR_RETURN(compression_type, ReadUint32FromBuffer(src, offset));
+    ASSIGN_OR_RETURN(m_checksum, ReadUint32FromBuffer(src, offset));
+    ASSIGN_OR_RETURN(data_size, ReadUint32FromBuffer(src, offset));
+    m_compression_type = static_cast<CompressionType>(compression_type);
+    if (src.size() != offset + data_size)
+    {
+        return absl::InvalidArgumentError("File chunk size doesn't match the declared size.");
+    }
+    m_data.assign(src.begin() + offset, src.end());
+    return absl::OkStatus();
+}
+
 absl::Status ReceiveBuffer(SocketConnection* conn, uint8_t* buffer, size_t size, int timeout_ms)
 {
     if (!conn)
@@ -189,86 +431,94 @@ absl::Status SendBuffer(SocketConnection* conn, const uint8_t* buffer, size_t si
     return conn->Send(buffer, size);
 }
 
-absl::StatusOr<std::unique_ptr<ISerializable>> ReceiveMessage(SocketConnection* conn,
-                                                              int               timeout_ms)
+std::unique_ptr<ISerializable> CreateMessage(MessageType type)
 {
-    if (!conn)
+    switch (type)
     {
-        return absl::InvalidArgumentError("Provided SocketConnection is null.");
+    case MessageType::HANDSHAKE_REQUEST:
+        return std::make_unique<HandshakeRequest>();
+    case MessageType::HANDSHAKE_RESPONSE:
+        return std::make_unique<HandshakeResponse>();
+    case MessageType::PING_MESSAGE:
+        return std::make_unique<PingMessage>();
+    case MessageType::PONG_MESSAGE:
+        return std::make_unique<PongMessage>();
+    case MessageType::PM4_CAPTURE_REQUEST:
+        return std::make_unique<Pm4CaptureRequest>();
+    case MessageType::PM4_CAPTURE_RESPONSE:
+        return std::make_unique<Pm4CaptureResponse>();
+    case MessageType::DOWNLOAD_FILE_REQUEST:
+        return std::make_unique<DownloadFileRequest>();
+    case MessageType::DOWNLOAD_FILE_RESPONSE:
+        return std::make_unique<DownloadFileResponse>();
+    case MessageType::FILE_SIZE_REQUEST:
+        return std::make_unique<FileSizeRequest>();
+    case MessageType::FILE_SIZE_RESPONSE:
+        return std::make_unique<FileSizeResponse>();
+    case MessageType::DOWNLOAD_FILE_RANGE_REQUEST:
+        return std::make_unique<DownloadFileRangeRequest>();
+    case MessageType::DOWNLOAD_FILE_RANGE_RESPONSE:
+        return std::make_unique<DownloadFileRangeResponse>();
+    case MessageType::FILE_CHUNK:
+        return std::make_unique<FileChunkMessage>();
     }
+    return nullptr;
+}
 
-    const size_t header_size = sizeof(uint32_t) * 2;
-    uint8_t      header_buffer[header_size];
-
-    // Receive the message header.
-    absl::Status status = ReceiveBuffer(conn, header_buffer, header_size, timeout_ms);
-    if (!status.ok())
+ISerializable* MessageArena::GetMessage(MessageType type)
+{
+    const uint32_t index = static_cast<uint32_t>(type);
+    if (index >= kMessageTypeCount)
     {
-        return status;
+        return nullptr;
+    }
+    if (!m_messages[index])
+    {
+        m_messages[index] = CreateMessage(type);
     }
+    return m_messages[index].get();
+}
 
-    // Parse header.
-    uint32_t net_type, net_length;
-    std::memcpy(&net_type, header_buffer, sizeof(uint32_t));
-    std::memcpy(&net_length, header_buffer + sizeof(uint32_t), sizeof(uint32_t));
-    uint32_t type = ntohl(net_type);
-    uint32_t payload_length = ntohl(net_length);
+absl::StatusOr<std::unique_ptr<ISerializable>> ReceiveMessage(SocketConnection* conn,
+                                                              int               timeout_ms)
+{
+    Buffer   payload_buffer;
+    uint32_t type;
+    ASSIGN_OR_RETURN(type, ReceiveMessagePayload(conn, payload_buffer, timeout_ms));
 
-    if (payload_length > kMaxPayloadSize)
+    // Create and deserialize the message object.
+    std::unique_ptr<ISerializable> message = CreateMessage(static_cast<MessageType>(type));
+    if (!message)
     {
         conn->Close();
-        return absl::InvalidArgumentError(
-        absl::StrCat("Payload size ", payload_length, " exceeds limit."));
+        return absl::InvalidArgumentError(absl::StrCat("Unknown message type: ", type));
     }
 
-    // Receive the message payload.
-    Buffer payload_buffer(payload_length);
-    status = ReceiveBuffer(conn, payload_buffer.data(), payload_length, timeout_ms);
+    absl::Status status = message->Deserialize(payload_buffer);
     if (!status.ok())
     {
+        conn->Close();
         return status;
     }
 
-    // Create and deserialize the message object.
-    std::unique_ptr<ISerializable> message;
-    switch (static_cast<MessageType>(type))
+    return message;
+}
+
+absl::StatusOr<ISerializable*> ReceiveMessage(SocketConnection* conn,
+                                              MessageArena&     arena,
+                                              int               timeout_ms)
+{
+    uint32_t type;
+    ASSIGN_OR_RETURN(type, ReceiveMessagePayload(conn, arena.GetReceiveBuffer(), timeout_ms));
+
+    ISerializable* message = arena.GetMessage(static_cast<MessageType>(type));
+    if (!message)
     {
-    case MessageType::HANDSHAKE_REQUEST:
-        message = std::make_unique<HandshakeRequest>();
-        break;
-    case MessageType::HANDSHAKE_RESPONSE:
-        message = std::make_unique<HandshakeResponse>();
-        break;
-    case MessageType::PING_MESSAGE:
-        message = std::make_unique<PingMessage>();
-        break;
-    case MessageType::PONG_MESSAGE:
-        message = std::make_unique<PongMessage>();
-        break;
-    case MessageType::PM4_CAPTURE_REQUEST:
-        message = std::make_unique<Pm4CaptureRequest>();
-        break;
-    case MessageType::PM4_CAPTURE_RESPONSE:
-        message = std::make_unique<Pm4CaptureResponse>();
-        break;
-    case MessageType::DOWNLOAD_FILE_REQUEST:
-        message = std::make_unique<DownloadFileRequest>();
-        break;
-    case MessageType::DOWNLOAD_FILE_RESPONSE:
-        message = std::make_unique<DownloadFileResponse>();
-        break;
-    case MessageType::FILE_SIZE_REQUEST:
-        message = std::make_unique<FileSizeRequest>();
-        break;
-    case MessageType::FILE_SIZE_RESPONSE:
-        message = std::make_unique<FileSizeResponse>();
-        break;
-    default:
         conn->Close();
         return absl::InvalidArgumentError(absl::StrCat("Unknown message type: ", type));
     }
 
-    status = message->Deserialize(payload_buffer);
+    absl::Status status = message->Deserialize(arena.GetReceiveBuffer());
     if (!status.ok())
     {
         conn->Close();
@@ -286,39 +536,37 @@ absl::Status SendMessage(SocketConnection* conn, const ISerializable& message)
     }
 
     // Serialize the message payload.
-    Buffer       payload_buffer;
-    absl::Status status = message.Serialize(payload_buffer);
-    if (!status.ok())
-    {
-        return status;
-    }
-    if (payload_buffer.size() > kMaxPayloadSize)
+    Buffer payload_buffer;
+    RETURN_IF_ERROR(message.Serialize(payload_buffer));
+    return SendMessagePayload(conn, message.GetMessageType(), payload_buffer);
+}
+
+absl::Status SendMessage(SocketConnection* conn, const ISerializable& message, MessageArena& arena)
+{
+    if (!conn)
     {
-        return absl::InvalidArgumentError("Serialized payload size exceeds limit.");
+        return absl::InvalidArgumentError("Provided SocketConnection is null.");
     }
 
-    // Construct and send the header.
-    uint32_t     net_type = htonl(static_cast<uint32_t>(message.GetMessageType()));
-    uint32_t     net_payload_length = htonl(static_cast<uint32_t>(payload_buffer.size()));
-    const size_t header_size = sizeof(net_type) + sizeof(net_payload_length);
-    uint8_t      header_buffer[header_size];
-    std::memcpy(header_buffer, &net_type, sizeof(uint32_t));
-    std::memcpy(header_buffer + sizeof(uint32_t), &net_payload_length, sizeof(uint32_t));
+    Buffer& payload_buffer = arena.GetSendBuffer();
+    RETURN_IF_ERROR(message.Serialize(payload_buffer));
+    return SendMessagePayload(conn, message.GetMessageType(), payload_buffer);
+}
 
-    status = SendBuffer(conn, header_buffer, header_size);
-    if (!status.ok())
+HandshakeResponse NegotiateHandshake(const HandshakeRequest& request)
+{
+    HandshakeResponse response;
+    response.SetMajorVersion(kProtocolMajorVersion);
+    response.SetMinorVersion(kProtocolMinorVersion);
+    if (request.GetMajorVersion() == kProtocolMajorVersion)
     {
-        return status;
+        response.SetMinorVersion(std::min(request.GetMinorVersion(), kProtocolMinorVersion));
     }
-
-    // Send the payload.
-    status = SendBuffer(conn, payload_buffer.data(), payload_buffer.size());
-    if (!status.ok())
+    if (response.GetMinorVersion() >= kDownloadFileRangeMinorVersion)
     {
-        return status;
+        response.SetCapabilities(kCapabilityDownloadFileRange);
     }
-
-    return absl::OkStatus();
+    return response;
 }
 
 }  // namespace Network
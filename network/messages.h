@@ -16,6 +16,9 @@ limitations under the License.
 
 #pragma once
 
+#include <array>
+#include <string_view>
+
 #include "serializable.h"
 #include "socket_connection.h"
 
@@ -25,15 +28,25 @@ namespace Network
 // Helper to write a uint32_t to a buffer.
 void WriteUint32ToBuffer(uint32_t value, Buffer& dest);
 
+// Helper to write a uint64_t to a buffer, most significant byte first.
+void WriteUint64ToBuffer(uint64_t value, Buffer& dest);
+
 // Helper to write a string (length + data) to the buffer.
 void WriteStringToBuffer(const std::string& str, Buffer& dest);
 
 // Helper to read a uint32_t from a buffer.
 absl::StatusOr<uint32_t> ReadUint32FromBuffer(const Buffer& src, size_t& offset);
 
+// Helper to read a uint64_t from a buffer.
+absl::StatusOr<uint64_t> ReadUint64FromBuffer(const Buffer& src, size_t& offset);
+
 // Helper to read a string (length + data) from the buffer.
 absl::StatusOr<std::string> ReadStringFromBuffer(const Buffer& src, size_t& offset);
 
+// Helper to read a string (length + data) from the buffer without copying it. The view points
+// into src.
+absl::StatusOr<std::string_view> ReadStringViewFromBuffer(const Buffer& src, size_t& offset);
+
 enum class MessageType : uint32_t
 {
     HANDSHAKE_REQUEST = 1,
@@ -45,7 +58,34 @@ enum class MessageType : uint32_t
     DOWNLOAD_FILE_REQUEST = 7,
     DOWNLOAD_FILE_RESPONSE = 8,
     FILE_SIZE_REQUEST = 9,
-    FILE_SIZE_RESPONSE = 10
+    FILE_SIZE_RESPONSE = 10,
+    DOWNLOAD_FILE_RANGE_REQUEST = 11,
+    DOWNLOAD_FILE_RANGE_RESPONSE = 12,
+    FILE_CHUNK = 13
+};
+
+// One past the highest MessageType.
+constexpr uint32_t kMessageTypeCount = 14;
+
+// Protocol version negotiated by the handshake. The client sends the highest version it supports
+// and the server answers with the version both sides will use.
+// v1.0: Initial protocol.
+// v1.1: Adds DOWNLOAD_FILE_RANGE_REQUEST/RESPONSE and FILE_CHUNK (resumable, checksummed and
+// optionally compressed downloads), and a capability mask at the end of the handshake response.
+// Servers predating v1.1 echo the client version back, so the client relies on the capability
+// mask rather than on the negotiated version to use new messages.
+constexpr uint32_t kProtocolMajorVersion = 1;
+constexpr uint32_t kProtocolMinorVersion = 1;
+constexpr uint32_t kDownloadFileRangeMinorVersion = 1;
+
+// Bits of the capability mask of the handshake response.
+constexpr uint32_t kCapabilityDownloadFileRange = 1u << 0;
+
+// Compression applied to the data of a FILE_CHUNK.
+enum class CompressionType : uint32_t
+{
+    kNone = 0,
+    kDeflate = 1,
 };
 
 class HandshakeMessage : public ISerializable
@@ -93,7 +133,16 @@ public:
 class HandshakeResponse : public HandshakeMessage
 {
 public:
-    MessageType GetMessageType() const override { return MessageType::HANDSHAKE_RESPONSE; }
+    MessageType  GetMessageType() const override { return MessageType::HANDSHAKE_RESPONSE; }
+    absl::Status Serialize(Buffer& dest) const override;
+    absl::Status Deserialize(const Buffer& src) override;
+
+    uint32_t GetCapabilities() const { return m_capabilities; }
+    void     SetCapabilities(uint32_t capabilities) { m_capabilities = capabilities; }
+
+private:
+    // Bit mask of kCapability* values. Only sent from v1.1 on, 0 for older servers.
+    uint32_t m_capabilities = 0;
 };
 
 class Pm4CaptureRequest : public EmptyMessage
@@ -197,6 +246,160 @@ private:
     std::string m_file_size_str;
 };
 
+// Requests the part of a file starting at a byte offset, to resume an interrupted download.
+// The server answers with a DownloadFileRangeResponse followed by FILE_CHUNK messages covering
+// [offset, file size).
+class DownloadFileRangeRequest : public ISerializable
+{
+public:
+    MessageType GetMessageType() const override
+    {
+        return MessageType::DOWNLOAD_FILE_RANGE_REQUEST;
+    }
+    absl::Status Serialize(Buffer& dest) const override;
+    absl::Status Deserialize(const Buffer& src) override;
+
+    const std::string& GetFilePath() const { return m_file_path; }
+    void               SetFilePath(std::string file_path) { m_file_path = std::move(file_path); }
+
+    uint64_t GetOffset() const { return m_offset; }
+    void     SetOffset(uint64_t offset) { m_offset = offset; }
+
+    uint32_t GetCompressionTypes() const { return m_compression_types; }
+    void     SetCompressionTypes(uint32_t types) { m_compression_types = types; }
+
+    uint32_t GetChunkSize() const { return m_chunk_size; }
+    void     SetChunkSize(uint32_t chunk_size) { m_chunk_size = chunk_size; }
+
+    uint64_t GetFileSize() const { return m_file_size; }
+    void     SetFileSize(uint64_t file_size) { m_file_size = file_size; }
+
+    int64_t GetFileMtime() const { return m_file_mtime; }
+    void    SetFileMtime(int64_t file_mtime) { m_file_mtime = file_mtime; }
+
+private:
+    std::string m_file_path;
+    // Offset of the first byte to send.
+    uint64_t m_offset = 0;
+    // Size and modification time of the file the first m_offset bytes were received from, as
+    // reported by the server. The server refuses to resume if the file has changed since.
+    uint64_t m_file_size = 0;
+    int64_t  m_file_mtime = 0;
+    // Bit mask of (1 << CompressionType) accepted by the client.
+    uint32_t m_compression_types = 0;
+    // Preferred size of the uncompressed chunks. 0 lets the server decide.
+    uint32_t m_chunk_size = 0;
+};
+
+class DownloadFileRangeResponse : public ISerializable
+{
+public:
+    MessageType GetMessageType() const override
+    {
+        return MessageType::DOWNLOAD_FILE_RANGE_RESPONSE;
+    }
+    absl::Status Serialize(Buffer& dest) const override;
+    absl::Status Deserialize(const Buffer& src) override;
+
+    bool GetFound() const { return m_found; }
+    void SetFound(bool found) { m_found = found; }
+
+    const std::string& GetErrorReason() const { return m_error_reason; }
+    void SetErrorReason(std::string error_reason) { m_error_reason = std::move(error_reason); }
+
+    uint64_t GetFileSize() const { return m_file_size; }
+    void     SetFileSize(uint64_t file_size) { m_file_size = file_size; }
+
+    int64_t GetFileMtime() const { return m_file_mtime; }
+    void    SetFileMtime(int64_t file_mtime) { m_file_mtime = file_mtime; }
+
+    uint64_t GetOffset() const { return m_offset; }
+    void     SetOffset(uint64_t offset) { m_offset = offset; }
+
+    CompressionType GetCompressionType() const { return m_compression_type; }
+    void            SetCompressionType(CompressionType type) { m_compression_type = type; }
+
+    uint32_t GetChunkSize() const { return m_chunk_size; }
+    void     SetChunkSize(uint32_t chunk_size) { m_chunk_size = chunk_size; }
+
+private:
+    // Flag indicating whether the range can be sent. It is also sent with found set to false in
+    // place of a FILE_CHUNK if the server fails in the middle of the transfer.
+    bool m_found = false;
+    // A description of the error. Empty if successful.
+    std::string m_error_reason;
+    uint64_t    m_file_size = 0;
+    // Opaque modification time of the file on the server, to detect a change between resumes.
+    int64_t     m_file_mtime = 0;
+    uint64_t    m_offset = 0;
+    // Compression the server chose among the ones the client accepts. A chunk that doesn't
+    // compress well is sent with CompressionType::kNone regardless.
+    CompressionType m_compression_type = CompressionType::kNone;
+    uint32_t        m_chunk_size = 0;
+};
+
+// A piece of a file sent after a DownloadFileRangeResponse.
+class FileChunkMessage : public ISerializable
+{
+public:
+    MessageType  GetMessageType() const override { return MessageType::FILE_CHUNK; }
+    absl::Status Serialize(Buffer& dest) const override;
+    absl::Status Deserialize(const Buffer& src) override;
+
+    uint64_t GetOffset() const { return m_offset; }
+    void     SetOffset(uint64_t offset) { m_offset = offset; }
+
+    uint32_t GetRawSize() const { return m_raw_size; }
+    void     SetRawSize(uint32_t raw_size) { m_raw_size = raw_size; }
+
+    CompressionType GetCompressionType() const { return m_compression_type; }
+    void            SetCompressionType(CompressionType type) { m_compression_type = type; }
+
+    uint32_t GetChecksum() const { return m_checksum; }
+    void     SetChecksum(uint32_t checksum) { m_checksum = checksum; }
+
+    const Buffer& GetData() const { return m_data; }
+    Buffer&       GetData() { return m_data; }
+
+private:
+    // Offset of the chunk in the file.
+    uint64_t m_offset = 0;
+    // Size of the chunk once decompressed.
+    uint32_t        m_raw_size = 0;
+    CompressionType m_compression_type = CompressionType::kNone;
+    // CRC32C of the decompressed chunk.
+    uint32_t m_checksum = 0;
+    Buffer   m_data;
+};
+
+// Reusable storage for the messages of one connection: the serialization buffers and one
+// message object per type. Once they have grown to the size of the messages exchanged, sending
+// and receiving through an arena doesn't allocate.
+// The send side and the receive side may be used by two different threads, but each by only one
+// thread at a time.
+class MessageArena
+{
+public:
+    MessageArena() = default;
+    MessageArena(const MessageArena&) = delete;
+    MessageArena& operator=(const MessageArena&) = delete;
+
+    Buffer& GetSendBuffer() { return m_send_buffer; }
+    Buffer& GetReceiveBuffer() { return m_receive_buffer; }
+
+    // Returns the message object of the given type, created on first use, or nullptr if the type
+    // is unknown.
+    ISerializable* GetMessage(MessageType type);
+
+private:
+    Buffer                                                        m_send_buffer;
+    Buffer                                                        m_receive_buffer;
+    std::array<std::unique_ptr<ISerializable>, kMessageTypeCount> m_messages;
+};
+
+// Creates an empty message of the given type, or returns nullptr if the type is unknown.
+std::unique_ptr<ISerializable> CreateMessage(MessageType type);
+
 // Message Helper Functions (TLV Framing).
 
 // Helper to receive an exact number of bytes.
@@ -212,7 +415,20 @@ absl::Status SendBuffer(SocketConnection* conn, const uint8_t* buffer, size_t si
 absl::StatusOr<std::unique_ptr<ISerializable>> ReceiveMessage(SocketConnection* conn,
                                                               int timeout_ms = kNoTimeout);
 
+// Receives a message into the object of its type in the arena. The message stays valid until the
+// next message of the same type is received through the arena.
+absl::StatusOr<ISerializable*> ReceiveMessage(SocketConnection* conn,
+                                              MessageArena&     arena,
+                                              int               timeout_ms = kNoTimeout);
+
 // Sends a full message (header + payload).
 absl::Status SendMessage(SocketConnection* conn, const ISerializable& message);
 
+// Sends a full message, serialized into the send buffer of the arena.
+absl::Status SendMessage(SocketConnection* conn, const ISerializable& message, MessageArena& arena);
+
+// Builds the server answer to a handshake: the server's major version, and the lower of the two
+// minor versions if the major versions match.
+HandshakeResponse NegotiateHandshake(const HandshakeRequest& request);
+
 }  // namespace Network
\ No newline at end of file
@@ -16,9 +16,21 @@ limitations under the License.
 
 #include "absl/status/status_matchers.h"
 #include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <algorithm>
+#include <chrono>
 #include <limits>
 #include <iostream>
+#include <thread>
+#include "file_transfer.h"
 #include "messages.h"
+#include "unix_domain_server.h"
+
+#ifndef WIN32
+#    include <sys/socket.h>
+#    include <sys/un.h>
+#endif
 
 namespace
 {
@@ -50,6 +62,24 @@ TEST(MessagesTest, WriteAndReadUint32)
     ASSERT_EQ(write_value, *read_value);
 }
 
+TEST(MessagesTest, WriteAndReadUint64)
+{
+    Network::Buffer buf;
+    const uint64_t  values[] = { 0, 0x0123456789ABCDEF, std::numeric_limits<uint64_t>::max() };
+    for (uint64_t value : values)
+    {
+        Network::WriteUint64ToBuffer(value, buf);
+    }
+    ASSERT_EQ(buf.size(), sizeof(values));
+    ASSERT_EQ(buf[8], 0x01);
+    size_t offset = 0;
+    for (uint64_t value : values)
+    {
+        ASSERT_THAT(Network::ReadUint64FromBuffer(buf, offset), IsOkAndHolds(value));
+    }
+    ASSERT_FALSE(Network::ReadUint64FromBuffer(buf, offset).ok());
+}
+
 TEST(MessagesTest, WriteAndReadString)
 {
     Network::Buffer buf;
@@ -69,6 +99,36 @@ TEST(MessagesTest, WriteAndReadString)
     ASSERT_EQ(write_str, *read_str);
 }
 
+TEST(MessagesTest, ReadStringView)
+{
+    Network::Buffer buf;
+    Network::WriteStringToBuffer("dive", buf);
+    Network::WriteStringToBuffer("", buf);
+    size_t offset = 0;
+    auto   view = Network::ReadStringViewFromBuffer(buf, offset);
+    ASSERT_TRUE(view.ok());
+    EXPECT_EQ(*view, "dive");
+    // The view points into the buffer
+    EXPECT_EQ(reinterpret_cast<const uint8_t*>(view->data()), buf.data() + sizeof(uint32_t));
+    EXPECT_THAT(Network::ReadStringViewFromBuffer(buf, offset), IsOkAndHolds(""));
+    EXPECT_EQ(offset, buf.size());
+    EXPECT_FALSE(Network::ReadStringViewFromBuffer(buf, offset).ok());
+}
+
+TEST(MessagesTest, SerializeIntoUsedBuffer)
+{
+    Network::FileSizeResponse response;
+    response.SetFound(true);
+    response.SetFileSizeStr("42");
+
+    // A reused buffer still holds the previous message
+    Network::Buffer buf = { 1, 2, 3 };
+    ASSERT_TRUE(response.Serialize(buf).ok());
+    Network::FileSizeResponse deserialized;
+    ASSERT_TRUE(deserialized.Deserialize(buf).ok());
+    EXPECT_EQ(deserialized.GetFileSizeStr(), "42");
+}
+
 TEST(MessagesTest, HandShakeMessage)
 {
     Network::HandshakeRequest request;
@@ -189,4 +249,740 @@ TEST(MessagesTest, FileSizeMessage)
     ASSERT_EQ(res_serialize.GetFileSizeStr(), res_deserialize.GetFileSizeStr());
 }
 
-}  // namespace
\ No newline at end of file
+TEST(MessagesTest, NegotiateHandshake)
+{
+    Network::HandshakeRequest request;
+    request.SetMajorVersion(Network::kProtocolMajorVersion);
+    request.SetMinorVersion(0);
+    Network::HandshakeResponse response = Network::NegotiateHandshake(request);
+    EXPECT_EQ(response.GetMajorVersion(), Network::kProtocolMajorVersion);
+    EXPECT_EQ(response.GetMinorVersion(), 0u);
+
+    request.SetMinorVersion(Network::kProtocolMinorVersion + 5);
+    response = Network::NegotiateHandshake(request);
+    EXPECT_EQ(response.GetMinorVersion(), Network::kProtocolMinorVersion);
+
+    request.SetMajorVersion(Network::kProtocolMajorVersion + 1);
+    response = Network::NegotiateHandshake(request);
+    EXPECT_EQ(response.GetMajorVersion(), Network::kProtocolMajorVersion);
+}
+
+TEST(MessagesTest, HandshakeCapabilities)
+{
+    Network::HandshakeRequest request;
+    request.SetMajorVersion(Network::kProtocolMajorVersion);
+    request.SetMinorVersion(Network::kDownloadFileRangeMinorVersion);
+    Network::HandshakeResponse response = Network::NegotiateHandshake(request);
+    EXPECT_EQ(response.GetCapabilities(), Network::kCapabilityDownloadFileRange);
+
+    Network::Buffer buf;
+    ASSERT_TRUE(response.Serialize(buf).ok());
+    Network::HandshakeResponse deserialized;
+    ASSERT_TRUE(deserialized.Deserialize(buf).ok());
+    EXPECT_EQ(deserialized.GetCapabilities(), Network::kCapabilityDownloadFileRange);
+
+    // Clients predating v1.1 reject trailing data, so no capability mask is sent to them
+    request.SetMinorVersion(0);
+    response = Network::NegotiateHandshake(request);
+    EXPECT_EQ(response.GetCapabilities(), 0u);
+    ASSERT_TRUE(response.Serialize(buf).ok());
+    Network::HandshakeRequest legacy_client_view;
+    EXPECT_TRUE(legacy_client_view.Deserialize(buf).ok());
+
+    // Servers predating v1.1 echo the client version back without a capability mask
+    request.SetMinorVersion(Network::kProtocolMinorVersion);
+    ASSERT_TRUE(request.Serialize(buf).ok());
+    ASSERT_TRUE(deserialized.Deserialize(buf).ok());
+    EXPECT_EQ(deserialized.GetMinorVersion(), Network::kProtocolMinorVersion);
+    EXPECT_EQ(deserialized.GetCapabilities(), 0u);
+}
+
+TEST(MessagesTest, DownloadFileRangeMessage)
+{
+    Network::DownloadFileRangeRequest req_serialize;
+    req_serialize.SetFilePath("/sdcard/captures/dive_capture_0456.rd");
+    req_serialize.SetOffset(0x100000000ull + 17);
+    req_serialize.SetCompressionTypes(3);
+    req_serialize.SetChunkSize(65536);
+    req_serialize.SetFileSize(0x200000000ull);
+    req_serialize.SetFileMtime(-1234567890123ll);
+    Network::Buffer buf;
+    ASSERT_TRUE(req_serialize.Serialize(buf).ok());
+    Network::DownloadFileRangeRequest req_deserialize;
+    ASSERT_TRUE(req_deserialize.Deserialize(buf).ok());
+    ASSERT_EQ(req_deserialize.GetMessageType(), Network::MessageType::DOWNLOAD_FILE_RANGE_REQUEST);
+    ASSERT_EQ(req_serialize.GetFilePath(), req_deserialize.GetFilePath());
+    ASSERT_EQ(req_serialize.GetOffset(), req_deserialize.GetOffset());
+    ASSERT_EQ(req_serialize.GetCompressionTypes(), req_deserialize.GetCompressionTypes());
+    ASSERT_EQ(req_serialize.GetChunkSize(), req_deserialize.GetChunkSize());
+    ASSERT_EQ(req_serialize.GetFileSize(), req_deserialize.GetFileSize());
+    ASSERT_EQ(req_serialize.GetFileMtime(), req_deserialize.GetFileMtime());
+
+    Network::DownloadFileRangeResponse res_serialize;
+    res_serialize.SetFound(true);
+    res_serialize.SetFileSize(0x200000000ull);
+    res_serialize.SetFileMtime(1234567890123ll);
+    res_serialize.SetOffset(4096);
+    res_serialize.SetCompressionType(Network::CompressionType::kDeflate);
+    res_serialize.SetChunkSize(1024 * 1024);
+    ASSERT_TRUE(res_serialize.Serialize(buf).ok());
+    Network::DownloadFileRangeResponse res_deserialize;
+    ASSERT_TRUE(res_deserialize.Deserialize(buf).ok());
+    ASSERT_EQ(res_deserialize.GetMessageType(),
+              Network::MessageType::DOWNLOAD_FILE_RANGE_RESPONSE);
+    ASSERT_EQ(res_serialize.GetFound(), res_deserialize.GetFound());
+    ASSERT_EQ(res_serialize.GetErrorReason(), res_deserialize.GetErrorReason());
+    ASSERT_EQ(res_serialize.GetFileSize(), res_deserialize.GetFileSize());
+    ASSERT_EQ(res_serialize.GetFileMtime(), res_deserialize.GetFileMtime());
+    ASSERT_EQ(res_serialize.GetOffset(), res_deserialize.GetOffset());
+    ASSERT_EQ(res_serialize.GetCompressionType(), res_deserialize.GetCompressionType());
+    ASSERT_EQ(res_serialize.GetChunkSize(), res_deserialize.GetChunkSize());
+
+    Network::FileChunkMessage chunk_serialize;
+    chunk_serialize.SetOffset(0x300000000ull);
+    chunk_serialize.SetRawSize(5);
+    chunk_serialize.SetChecksum(0xDEADBEEF);
+    chunk_serialize.GetData() = { 1, 2, 3, 4, 5 };
+    ASSERT_TRUE(chunk_serialize.Serialize(buf).ok());
+    Network::FileChunkMessage chunk_deserialize;
+    ASSERT_TRUE(chunk_deserialize.Deserialize(buf).ok());
+    ASSERT_EQ(chunk_deserialize.GetMessageType(), Network::MessageType::FILE_CHUNK);
+    ASSERT_EQ(chunk_serialize.GetOffset(), chunk_deserialize.GetOffset());
+    ASSERT_EQ(chunk_serialize.GetRawSize(), chunk_deserialize.GetRawSize());
+    ASSERT_EQ(chunk_serialize.GetCompressionType(), chunk_deserialize.GetCompressionType());
+    ASSERT_EQ(chunk_serialize.GetChecksum(), chunk_deserialize.GetChecksum());
+    ASSERT_EQ(chunk_serialize.GetData(), chunk_deserialize.GetData());
+
+    buf.pop_back();
+    ASSERT_FALSE(chunk_deserialize.Deserialize(buf).ok());
+}
+
+TEST(MessagesTest, Crc32c)
+{
+    const std::string check = "123456789";
+    const uint8_t*    data = reinterpret_cast<const uint8_t*>(check.data());
+    EXPECT_EQ(Network::Crc32c(data, check.size()), 0xE3069283u);
+    EXPECT_EQ(Network::Crc32c(data + 4, check.size() - 4, Network::Crc32c(data, 4)), 0xE3069283u);
+    EXPECT_EQ(Network::Crc32c(nullptr, 0), 0u);
+}
+
+#ifndef WIN32
+class FileTransferTest : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        // A connected pair of local sockets stands in for the adb-forwarded connection
+        int fds[2];
+        ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+        auto sender = Network::SocketConnection::Create(fds[0]);
+        auto receiver = Network::SocketConnection::Create(fds[1]);
+        ASSERT_TRUE(sender.ok());
+        ASSERT_TRUE(receiver.ok());
+        m_sender = *std::move(sender);
+        m_receiver = *std::move(receiver);
+
+        m_dir = std::filesystem::temp_directory_path() / "dive_file_transfer_test";
+        std::filesystem::create_directories(m_dir);
+        m_src_path = (m_dir / "src.bin").string();
+        m_dst_path = (m_dir / "dst.bin").string();
+    }
+
+    void TearDown() override { std::filesystem::remove_all(m_dir); }
+
+    void WriteFile(const std::string& path, const std::string& content)
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(content.data(), content.size());
+    }
+
+    std::string ReadFile(const std::string& path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    // Not a multiple of the page size or of the transfer chunks
+    std::string MakeContent(size_t size)
+    {
+        std::string content(size, '\0');
+        for (size_t i = 0; i < size; ++i)
+        {
+            content[i] = static_cast<char>((i * 31 + i / 4093) & 0xFF);
+        }
+        return content;
+    }
+
+    std::unique_ptr<Network::SocketConnection> m_sender;
+    std::unique_ptr<Network::SocketConnection> m_receiver;
+    std::filesystem::path                      m_dir;
+    std::string                                m_src_path;
+    std::string                                m_dst_path;
+};
+
+TEST_F(FileTransferTest, SendAndReceiveFile)
+{
+    const std::string content = MakeContent(5 * 1024 * 1024 + 123);
+    WriteFile(m_src_path, content);
+
+    absl::Status send_status;
+    std::thread  sender([&]() { send_status = m_sender->SendFile(m_src_path); });
+    size_t       last_progress = 0;
+    absl::Status recv_status = m_receiver->ReceiveFile(m_dst_path,
+                                                       content.size(),
+                                                       [&](size_t progress) {
+                                                           EXPECT_GE(progress, last_progress);
+                                                           last_progress = progress;
+                                                       });
+    sender.join();
+    ASSERT_TRUE(send_status.ok()) << send_status;
+    ASSERT_TRUE(recv_status.ok()) << recv_status;
+    EXPECT_EQ(last_progress, content.size());
+    EXPECT_EQ(ReadFile(m_dst_path), content);
+}
+
+TEST_F(FileTransferTest, SendAndReceiveEmptyFile)
+{
+    WriteFile(m_src_path, "");
+    WriteFile(m_dst_path, "stale content");
+
+    ASSERT_TRUE(m_sender->SendFile(m_src_path).ok());
+    ASSERT_TRUE(m_receiver->ReceiveFile(m_dst_path, 0).ok());
+    EXPECT_TRUE(std::filesystem::exists(m_dst_path));
+    EXPECT_EQ(std::filesystem::file_size(m_dst_path), 0u);
+}
+
+TEST_F(FileTransferTest, ResumeFromOffset)
+{
+    const std::string content = MakeContent(3 * 1024 * 1024 + 7);
+    const size_t      offset = 1024 * 1024 + 3;
+    WriteFile(m_src_path, content);
+    WriteFile(m_dst_path, content.substr(0, offset));
+
+    absl::Status send_status;
+    std::thread  sender([&]() { send_status = m_sender->SendFile(m_src_path, offset); });
+    absl::Status recv_status = m_receiver->ReceiveFile(m_dst_path, content.size(), nullptr, offset);
+    sender.join();
+    ASSERT_TRUE(send_status.ok()) << send_status;
+    ASSERT_TRUE(recv_status.ok()) << recv_status;
+    EXPECT_EQ(ReadFile(m_dst_path), content);
+}
+
+TEST_F(FileTransferTest, ReceiveFileOffsetPastEndFails)
+{
+    absl::Status status = m_receiver->ReceiveFile(m_dst_path, 100, nullptr, 200);
+    EXPECT_EQ(status.code(), absl::StatusCode::kInvalidArgument);
+}
+
+TEST_F(FileTransferTest, SendFileHasNoHeader)
+{
+    // Peers that predate the mmap'd transfer expect the raw file data only
+    const std::string content = MakeContent(100);
+    WriteFile(m_src_path, content);
+
+    ASSERT_TRUE(m_sender->SendFile(m_src_path).ok());
+    std::string received(content.size(), '\0');
+    auto ret = m_receiver->Recv(reinterpret_cast<uint8_t*>(received.data()), received.size());
+    ASSERT_TRUE(ret.ok()) << ret.status();
+    EXPECT_EQ(*ret, content.size());
+    EXPECT_EQ(received, content);
+}
+
+TEST_F(FileTransferTest, ReceiveFileConnectionClosedKeepsReceivedData)
+{
+    const std::string content = MakeContent(2 * 1024 * 1024);
+
+    // Only send part of the data
+    std::thread sender([&]() {
+        ASSERT_TRUE(m_sender
+                    ->Send(reinterpret_cast<const uint8_t*>(content.data()), content.size() / 2)
+                    .ok());
+        m_sender->Close();
+    });
+    absl::Status status = m_receiver->ReceiveFile(m_dst_path, content.size());
+    sender.join();
+    EXPECT_FALSE(status.ok());
+    EXPECT_EQ(ReadFile(m_dst_path), content.substr(0, content.size() / 2));
+}
+
+TEST_F(FileTransferTest, SendAndReceiveFileRange)
+{
+    // Half compressible, half not
+    std::string content(3 * 1024 * 1024, 'a');
+    content += MakeContent(2 * 1024 * 1024 + 11);
+    WriteFile(m_src_path, content);
+
+    Network::DownloadFileRangeRequest request;
+    request.SetFilePath(m_src_path);
+    request.SetCompressionTypes(Network::GetSupportedCompressionTypes());
+    absl::Status send_status;
+    std::thread  sender([&]() { send_status = Network::SendFileRange(m_sender.get(), request); });
+
+    auto response = Network::ReceiveMessage(m_receiver.get());
+    ASSERT_TRUE(response.ok()) << response.status();
+    auto* range_response = dynamic_cast<Network::DownloadFileRangeResponse*>(response->get());
+    ASSERT_NE(range_response, nullptr);
+    ASSERT_TRUE(range_response->GetFound());
+    EXPECT_EQ(range_response->GetFileSize(), content.size());
+    EXPECT_EQ(range_response->GetCompressionType(),
+              Network::ChooseCompressionType(Network::GetSupportedCompressionTypes()));
+
+    size_t       last_progress = 0;
+    absl::Status recv_status = Network::ReceiveFileRange(m_receiver.get(),
+                                                         m_dst_path,
+                                                         *range_response,
+                                                         [&](size_t progress) {
+                                                             EXPECT_GT(progress, last_progress);
+                                                             last_progress = progress;
+                                                         });
+    sender.join();
+    ASSERT_TRUE(send_status.ok()) << send_status;
+    ASSERT_TRUE(recv_status.ok()) << recv_status;
+    EXPECT_EQ(last_progress, content.size());
+    EXPECT_EQ(ReadFile(m_dst_path), content);
+}
+
+TEST_F(FileTransferTest, ResumeFileRange)
+{
+    const std::string content = MakeContent(3 * 1024 * 1024 + 7);
+    const size_t      offset = 1024 * 1024 + 3;
+    WriteFile(m_src_path, content);
+    // Data past the offset is discarded
+    WriteFile(m_dst_path, content.substr(0, offset) + "garbage");
+
+    Network::DownloadFileRangeRequest request;
+    request.SetFilePath(m_src_path);
+    request.SetOffset(offset);
+    request.SetFileSize(content.size());
+    request.SetFileMtime(Network::GetFileMtime(m_src_path));
+    request.SetChunkSize(64 * 1024);
+    absl::Status send_status;
+    std::thread  sender([&]() { send_status = Network::SendFileRange(m_sender.get(), request); });
+
+    auto response = Network::ReceiveMessage(m_receiver.get());
+    ASSERT_TRUE(response.ok()) << response.status();
+    auto* range_response = dynamic_cast<Network::DownloadFileRangeResponse*>(response->get());
+    ASSERT_NE(range_response, nullptr);
+    EXPECT_EQ(range_response->GetOffset(), offset);
+    EXPECT_EQ(range_response->GetChunkSize(), 64u * 1024);
+    EXPECT_EQ(range_response->GetCompressionType(), Network::CompressionType::kNone);
+
+    absl::Status recv_status = Network::ReceiveFileRange(m_receiver.get(),
+                                                         m_dst_path,
+                                                         *range_response);
+    sender.join();
+    ASSERT_TRUE(send_status.ok()) << send_status;
+    ASSERT_TRUE(recv_status.ok()) << recv_status;
+    EXPECT_EQ(ReadFile(m_dst_path), content);
+}
+
+TEST_F(FileTransferTest, SendFileRangeChangedFileFails)
+{
+    const std::string content = MakeContent(100);
+    WriteFile(m_src_path, content);
+
+    // Same size, older modification time: the partial data came from another version of the file
+    Network::DownloadFileRangeRequest request;
+    request.SetFilePath(m_src_path);
+    request.SetOffset(50);
+    request.SetFileSize(content.size());
+    request.SetFileMtime(Network::GetFileMtime(m_src_path) - 1);
+    EXPECT_EQ(Network::SendFileRange(m_sender.get(), request).code(),
+              absl::StatusCode::kFailedPrecondition);
+
+    auto response = Network::ReceiveMessage(m_receiver.get());
+    ASSERT_TRUE(response.ok()) << response.status();
+    auto* range_response = dynamic_cast<Network::DownloadFileRangeResponse*>(response->get());
+    ASSERT_NE(range_response, nullptr);
+    EXPECT_FALSE(range_response->GetFound());
+}
+
+TEST_F(FileTransferTest, SendFileRangeOffsetBeyondEndFails)
+{
+    WriteFile(m_src_path, MakeContent(100));
+
+    Network::DownloadFileRangeRequest request;
+    request.SetFilePath(m_src_path);
+    request.SetOffset(101);
+    EXPECT_EQ(Network::SendFileRange(m_sender.get(), request).code(),
+              absl::StatusCode::kOutOfRange);
+
+    auto response = Network::ReceiveMessage(m_receiver.get());
+    ASSERT_TRUE(response.ok()) << response.status();
+    auto* range_response = dynamic_cast<Network::DownloadFileRangeResponse*>(response->get());
+    ASSERT_NE(range_response, nullptr);
+    EXPECT_FALSE(range_response->GetFound());
+}
+
+TEST_F(FileTransferTest, ReceiveFileRangeChecksumMismatchKeepsVerifiedData)
+{
+    const std::string content = MakeContent(3 * 1000);
+    Network::DownloadFileRangeResponse response;
+    response.SetFound(true);
+    response.SetFileSize(content.size());
+    response.SetChunkSize(1000);
+
+    // The second chunk is corrupted
+    std::thread sender([&]() {
+        for (uint64_t offset = 0; offset < content.size(); offset += 1000)
+        {
+            Network::FileChunkMessage chunk;
+            chunk.SetOffset(offset);
+            chunk.SetRawSize(1000);
+            chunk.GetData().assign(content.begin() + offset, content.begin() + offset + 1000);
+            chunk.SetChecksum(Network::Crc32c(chunk.GetData().data(), chunk.GetData().size()));
+            if (offset == 1000)
+            {
+                chunk.GetData()[10] ^= 1;
+            }
+            ASSERT_TRUE(Network::SendMessage(m_sender.get(), chunk).ok());
+        }
+        ASSERT_TRUE(Network::SendMessage(m_sender.get(), Network::PingMessage()).ok());
+    });
+    absl::Status status = Network::ReceiveFileRange(m_receiver.get(), m_dst_path, response);
+    EXPECT_EQ(status.code(), absl::StatusCode::kDataLoss);
+    EXPECT_EQ(ReadFile(m_dst_path), content.substr(0, 1000));
+
+    // The rest of the range was drained
+    auto next = Network::ReceiveMessage(m_receiver.get());
+    sender.join();
+    ASSERT_TRUE(next.ok()) << next.status();
+    EXPECT_EQ((*next)->GetMessageType(), Network::MessageType::PING_MESSAGE);
+}
+#endif
+
+#ifndef WIN32
+class MessageArenaTest : public testing::Test
+{
+protected:
+    void SetUp() override { Connect(); }
+
+    void Connect()
+    {
+        int fds[2];
+        ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+        auto client = Network::SocketConnection::Create(fds[0]);
+        auto server = Network::SocketConnection::Create(fds[1]);
+        ASSERT_TRUE(client.ok());
+        ASSERT_TRUE(server.ok());
+        m_client = *std::move(client);
+        m_server = *std::move(server);
+    }
+
+    // Answers each ping with a pong until the client closes the connection.
+    std::thread StartPongServer(bool use_arena)
+    {
+        return std::thread([this, use_arena]() {
+            Network::MessageArena arena;
+            Network::PongMessage  pong;
+            while (true)
+            {
+                absl::Status status;
+                if (use_arena)
+                {
+                    status = Network::ReceiveMessage(m_server.get(), arena).status();
+                }
+                else
+                {
+                    status = Network::ReceiveMessage(m_server.get()).status();
+                }
+                if (!status.ok())
+                {
+                    return;
+                }
+                if (use_arena)
+                {
+                    status = Network::SendMessage(m_server.get(), pong, arena);
+                }
+                else
+                {
+                    status = Network::SendMessage(m_server.get(), pong);
+                }
+                if (!status.ok())
+                {
+                    return;
+                }
+            }
+        });
+    }
+
+    std::unique_ptr<Network::SocketConnection> m_client;
+    std::unique_ptr<Network::SocketConnection> m_server;
+};
+
+TEST_F(MessageArenaTest, SendAndReceive)
+{
+    Network::MessageArena         send_arena;
+    Network::MessageArena         receive_arena;
+    Network::DownloadFileResponse response;
+    response.SetFound(true);
+    response.SetFilePath("/sdcard/capture.rd");
+    response.SetFileSizeStr("1234");
+    ASSERT_TRUE(Network::SendMessage(m_client.get(), response, send_arena).ok());
+    response.SetFilePath("/sdcard/other.rd");
+    ASSERT_TRUE(Network::SendMessage(m_client.get(), response, send_arena).ok());
+
+    auto first = Network::ReceiveMessage(m_server.get(), receive_arena);
+    ASSERT_TRUE(first.ok()) << first.status();
+    auto* first_response = dynamic_cast<Network::DownloadFileResponse*>(*first);
+    ASSERT_NE(first_response, nullptr);
+    EXPECT_TRUE(first_response->GetFound());
+    EXPECT_EQ(first_response->GetFilePath(), "/sdcard/capture.rd");
+    EXPECT_EQ(first_response->GetFileSizeStr(), "1234");
+
+    // The message object of a type is reused
+    auto second = Network::ReceiveMessage(m_server.get(), receive_arena);
+    ASSERT_TRUE(second.ok()) << second.status();
+    EXPECT_EQ(*second, *first);
+    EXPECT_EQ(first_response->GetFilePath(), "/sdcard/other.rd");
+}
+
+TEST_F(MessageArenaTest, SendVKeepsSliceOrder)
+{
+    // Larger than the socket buffers, so sendmsg sends the slices in several parts
+    std::vector<uint8_t> large(4 * 1024 * 1024);
+    for (size_t i = 0; i < large.size(); ++i)
+    {
+        large[i] = static_cast<uint8_t>(i * 7);
+    }
+    const uint8_t             head[] = { 1, 2, 3 };
+    const uint8_t             tail[] = { 4, 5 };
+    const Network::ConstSlice slices[] = { { head, sizeof(head) },
+                                           { nullptr, 0 },
+                                           { large.data(), large.size() },
+                                           { tail, sizeof(tail) } };
+
+    std::thread sender([&]() { EXPECT_TRUE(m_client->SendV(slices, 4).ok()); });
+    std::vector<uint8_t> received(sizeof(head) + large.size() + sizeof(tail));
+    ASSERT_TRUE(Network::ReceiveBuffer(m_server.get(), received.data(), received.size()).ok());
+    sender.join();
+
+    EXPECT_TRUE(std::equal(head, head + sizeof(head), received.begin()));
+    EXPECT_TRUE(std::equal(large.begin(), large.end(), received.begin() + sizeof(head)));
+    EXPECT_TRUE(std::equal(tail, tail + sizeof(tail), received.end() - sizeof(tail)));
+}
+
+// Exchanges keep-alive pings over a local socket, with and without arenas.
+TEST_F(MessageArenaTest, LoopbackPingPong)
+{
+    constexpr int kRoundTrips = 100;
+
+    for (bool use_arena : { false, true })
+    {
+        std::thread server = StartPongServer(use_arena);
+
+        Network::MessageArena arena;
+        Network::PingMessage  ping;
+        auto                  RoundTrip = [&]() {
+            if (use_arena)
+            {
+                ASSERT_TRUE(Network::SendMessage(m_client.get(), ping, arena).ok());
+                auto pong = Network::ReceiveMessage(m_client.get(), arena);
+                ASSERT_TRUE(pong.ok()) << pong.status();
+                ASSERT_EQ((*pong)->GetMessageType(), Network::MessageType::PONG_MESSAGE);
+            }
+            else
+            {
+                ASSERT_TRUE(Network::SendMessage(m_client.get(), ping).ok());
+                auto pong = Network::ReceiveMessage(m_client.get());
+                ASSERT_TRUE(pong.ok()) << pong.status();
+                ASSERT_EQ((*pong)->GetMessageType(), Network::MessageType::PONG_MESSAGE);
+            }
+        };
+
+        RoundTrip();
+        Network::ISerializable* pong_message = arena.GetMessage(
+        Network::MessageType::PONG_MESSAGE);
+        for (int i = 0; i < kRoundTrips; ++i)
+        {
+            RoundTrip();
+        }
+        // The arena didn't create another message
+        EXPECT_EQ(arena.GetMessage(Network::MessageType::PONG_MESSAGE), pong_message);
+
+        // Stop the server and reconnect for the next run
+        m_client->Close();
+        server.join();
+        Connect();
+    }
+}
+#endif
+
+#if defined(__linux__)
+// Answers pings right away, and holds capture requests until released.
+class BlockingCaptureHandler : public Network::DefaultMessageHandler
+{
+public:
+    void HandleMessage(std::unique_ptr<Network::ISerializable> message,
+                       Network::SocketConnection*              client_conn) override
+    {
+        if (message->GetMessageType() != Network::MessageType::PM4_CAPTURE_REQUEST)
+        {
+            Network::DefaultMessageHandler::HandleMessage(std::move(message), client_conn);
+            return;
+        }
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_capture_started = true;
+            m_cv.notify_all();
+            m_cv.wait(lock, [this] { return m_capture_released; });
+        }
+        Network::Pm4CaptureResponse response;
+        response.SetString("capture.rd");
+        ASSERT_TRUE(Network::SendMessage(client_conn, response).ok());
+    }
+
+    void WaitForCaptureStarted()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock, [this] { return m_capture_started; });
+    }
+
+    void ReleaseCapture()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_capture_released = true;
+        m_cv.notify_all();
+    }
+
+private:
+    std::mutex              m_mutex;
+    std::condition_variable m_cv;
+    bool                    m_capture_started = false;
+    bool                    m_capture_released = false;
+};
+
+class UnixDomainServerTest : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        m_address = "dive_unix_domain_server_test_" + std::to_string(getpid());
+        auto handler = std::make_unique<BlockingCaptureHandler>();
+        m_handler = handler.get();
+        m_server = std::make_unique<Network::UnixDomainServer>(std::move(handler), 2);
+        ASSERT_TRUE(m_server->Start(m_address).ok());
+    }
+
+    void TearDown() override
+    {
+        m_handler->ReleaseCapture();
+        m_server->Stop();
+    }
+
+    std::unique_ptr<Network::SocketConnection> ConnectClient() { return ConnectClient(m_address); }
+
+    std::unique_ptr<Network::SocketConnection> ConnectClient(const std::string& address)
+    {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        EXPECT_GE(fd, 0);
+        sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        memcpy(addr.sun_path + 1, address.data(), address.size());
+        socklen_t len = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + 1 +
+                                               address.size());
+        EXPECT_EQ(connect(fd, reinterpret_cast<sockaddr*>(&addr), len), 0);
+        auto connection = Network::SocketConnection::Create(fd);
+        EXPECT_TRUE(connection.ok());
+        return *std::move(connection);
+    }
+
+    std::string                                m_address;
+    BlockingCaptureHandler*                    m_handler = nullptr;
+    std::unique_ptr<Network::UnixDomainServer> m_server;
+};
+
+TEST_F(UnixDomainServerTest, PingWhileAnotherClientCaptures)
+{
+    auto capture_client = ConnectClient();
+    auto ping_client = ConnectClient();
+
+    ASSERT_TRUE(Network::SendMessage(capture_client.get(), Network::Pm4CaptureRequest()).ok());
+    m_handler->WaitForCaptureStarted();
+
+    ASSERT_TRUE(Network::SendMessage(ping_client.get(), Network::PingMessage()).ok());
+    auto pong = Network::ReceiveMessage(ping_client.get(), 5000);
+    ASSERT_TRUE(pong.ok()) << pong.status();
+    EXPECT_EQ((*pong)->GetMessageType(), Network::MessageType::PONG_MESSAGE);
+
+    m_handler->ReleaseCapture();
+    auto capture = Network::ReceiveMessage(capture_client.get(), 5000);
+    ASSERT_TRUE(capture.ok()) << capture.status();
+    EXPECT_EQ((*capture)->GetMessageType(), Network::MessageType::PM4_CAPTURE_RESPONSE);
+}
+
+TEST_F(UnixDomainServerTest, MessagesOfAClientAreHandledInOrder)
+{
+    auto client = ConnectClient();
+
+    // Pipelined requests are answered in the order they were sent
+    Network::HandshakeRequest handshake;
+    handshake.SetMajorVersion(Network::kProtocolMajorVersion);
+    handshake.SetMinorVersion(Network::kProtocolMinorVersion);
+    for (int i = 0; i < 8; ++i)
+    {
+        ASSERT_TRUE(Network::SendMessage(client.get(), Network::PingMessage()).ok());
+        ASSERT_TRUE(Network::SendMessage(client.get(), handshake).ok());
+    }
+    for (int i = 0; i < 8; ++i)
+    {
+        auto pong = Network::ReceiveMessage(client.get(), 5000);
+        ASSERT_TRUE(pong.ok()) << pong.status();
+        EXPECT_EQ((*pong)->GetMessageType(), Network::MessageType::PONG_MESSAGE);
+        auto response = Network::ReceiveMessage(client.get(), 5000);
+        ASSERT_TRUE(response.ok()) << response.status();
+        EXPECT_EQ((*response)->GetMessageType(), Network::MessageType::HANDSHAKE_RESPONSE);
+    }
+}
+
+TEST_F(UnixDomainServerTest, DisconnectedClientsAreRemoved)
+{
+    auto client = ConnectClient();
+    ASSERT_TRUE(Network::SendMessage(client.get(), Network::PingMessage()).ok());
+    ASSERT_TRUE(Network::ReceiveMessage(client.get(), 5000).ok());
+    EXPECT_EQ(m_server->GetClientCount(), 1u);
+
+    client->Close();
+    for (int i = 0; i < 100 && m_server->GetClientCount() != 0; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(m_server->GetClientCount(), 0u);
+}
+
+// Stops the server from the handler when it receives a ping.
+class StoppingHandler : public Network::DefaultMessageHandler
+{
+public:
+    void HandleMessage(std::unique_ptr<Network::ISerializable> message,
+                       Network::SocketConnection*              client_conn) override
+    {
+        if (message->GetMessageType() == Network::MessageType::PING_MESSAGE)
+        {
+            m_server->Stop();
+            return;
+        }
+        Network::DefaultMessageHandler::HandleMessage(std::move(message), client_conn);
+    }
+
+    Network::UnixDomainServer* m_server = nullptr;
+};
+
+TEST_F(UnixDomainServerTest, StopFromHandler)
+{
+    const std::string address = m_address + "_stop";
+    auto              handler = std::make_unique<StoppingHandler>();
+    StoppingHandler*  stopping_handler = handler.get();
+    Network::UnixDomainServer server(std::move(handler), 2);
+    stopping_handler->m_server = &server;
+    ASSERT_TRUE(server.Start(address).ok());
+
+    auto client = ConnectClient(address);
+    ASSERT_TRUE(Network::SendMessage(client.get(), Network::PingMessage()).ok());
+    server.Wait();
+    server.Stop();
+    EXPECT_EQ(server.GetClientCount(), 0u);
+}
+#endif
+
+}  // namespace
@@ -15,14 +15,39 @@ limitations under the License.
 */
 
 #include "socket_connection.h"
+#include <algorithm>
+#include <filesystem>
 #include <fstream>
 #include <string>
 #include <vector>
 #include "absl/strings/str_cat.h"
+#include "common/defer.h"
+
+#ifndef WIN32
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/socket.h>
+#    include <sys/stat.h>
+#    if defined(__linux__)
+#        include <sys/sendfile.h>
+#    endif
+#endif
 
 namespace Network
 {
 
+namespace
+{
+
+// Granularity of the buffered reads/writes and of the progress callback
+constexpr size_t kFileChunkSize = 1024 * 1024;
+// Size of the mmap'd windows, and the largest single sendfile() call
+constexpr size_t kFileMapWindowSize = 64 * 1024 * 1024;
+// Number of slices SendV hands to a single sendmsg() call
+constexpr size_t kMaxSendSlices = 16;
+
+}  // namespace
+
 NetworkInitializer::NetworkInitializer() :
     m_initialized(false)
 {
@@ -401,6 +426,93 @@ absl::StatusOr<size_t> SocketConnection::Recv(uint8_t* data, size_t size, int ti
     return total_received;
 }
 
+absl::Status SocketConnection::SendV(const ConstSlice* slices, size_t count)
+{
+#ifdef WIN32
+    for (size_t i = 0; i < count; ++i)
+    {
+        absl::Status status = Send(slices[i].data, slices[i].size);
+        if (!status.ok())
+        {
+            return status;
+        }
+    }
+    return absl::OkStatus();
+#else
+    if (!IsOpen() || m_is_listening)
+    {
+        return absl::FailedPreconditionError(
+        "SendV: Socket is invalid or operation not supported on a listening socket.");
+    }
+
+    // sendmsg may send part of the data, so keep a window of the slices left to send.
+    iovec  iov[kMaxSendSlices];
+    size_t next_slice = 0;
+    size_t iov_count = 0;
+    while (true)
+    {
+        // Refill the window from the slices not yet handed to sendmsg.
+        while (iov_count < kMaxSendSlices && next_slice < count)
+        {
+            if (slices[next_slice].size != 0)
+            {
+                iov[iov_count].iov_base = const_cast<uint8_t*>(slices[next_slice].data);
+                iov[iov_count].iov_len = slices[next_slice].size;
+                ++iov_count;
+            }
+            ++next_slice;
+        }
+        if (iov_count == 0)
+        {
+            return absl::OkStatus();
+        }
+
+        msghdr msg = {};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = iov_count;
+        ssize_t sent = ::sendmsg(m_socket, &msg, MSG_NOSIGNAL);
+        if (sent == -1)
+        {
+            int e = errno;
+            if (e == EINTR)
+            {
+                continue;
+            }
+            if (e == EAGAIN || e == EWOULDBLOCK)
+            {
+                return absl::UnavailableError("SendV: Operation would block.");
+            }
+            else if (e == EPIPE || e == ECONNRESET)
+            {
+                Close();
+                return absl::AbortedError("SendV: Connection reset by peer (EPIPE/ECONNRESET).");
+            }
+            return absl::InternalError(absl::StrCat("SendV: sendmsg() failed: ", strerror(e)));
+        }
+        if (sent == 0)
+        {
+            return absl::AbortedError("SendV: Peer has closed the connection.");
+        }
+
+        // Drop the slices fully sent and advance into the partially sent one.
+        size_t remaining = static_cast<size_t>(sent);
+        size_t first = 0;
+        while (first < iov_count && remaining >= iov[first].iov_len)
+        {
+            remaining -= iov[first].iov_len;
+            ++first;
+        }
+        if (first < iov_count)
+        {
+            iov[first].iov_base = static_cast<uint8_t*>(iov[first].iov_base) + remaining;
+            iov[first].iov_len -= remaining;
+        }
+        std::copy(iov + first, iov + iov_count, iov);
+        iov_count -= first;
+    }
+#endif
+}
+
 absl::Status SocketConnection::SendString(const std::string& s)
 {
     // Include null terminator.
@@ -432,45 +544,145 @@ absl::StatusOr<std::string> SocketConnection::ReceiveString()
     }
 }
 
-absl::Status SocketConnection::SendFile(const std::string& file_path)
+absl::Status SocketConnection::SendFile(const std::string& file_path, uint64_t offset)
 {
-    std::ifstream file_stream(file_path, std::ios::binary | std::ios::ate);
-    if (!file_stream)
+    std::error_code ec;
+    uint64_t        file_size = std::filesystem::file_size(file_path, ec);
+    if (ec)
     {
-        return absl::NotFoundError(absl::StrCat("SendFile: Failed to open file '", file_path, "'"));
+        return absl::NotFoundError(
+        absl::StrCat("SendFile: Failed to determine size of file '", file_path, "': ", ec.message()));
     }
-    std::streamsize file_size = file_stream.tellg();
-    if (file_size < 0)
+    if (offset > file_size)
     {
-        file_stream.close();
-        return absl::InternalError(
-        absl::StrCat("SendFile: Failed to determine size of file '", file_path, "'"));
+        return absl::OutOfRangeError(absl::StrCat("SendFile: Offset ",
+                                                  offset,
+                                                  " is past the end of file '",
+                                                  file_path,
+                                                  "' (size ",
+                                                  file_size,
+                                                  ")."));
     }
 
-    file_stream.seekg(0);
-    const size_t      CHUNK_SIZE = 4096;
-    std::vector<char> buffer(CHUNK_SIZE);
-    std::streamsize   total_sent = 0;
-    while (total_sent < file_size)
+    return SendFileData(file_path, offset, file_size - offset);
+}
+
+absl::Status SocketConnection::SendFileData(const std::string& file_path,
+                                            uint64_t           offset,
+                                            uint64_t           size)
+{
+#ifdef WIN32
+    std::ifstream file_stream(file_path, std::ios::binary);
+    if (!file_stream || !file_stream.seekg(static_cast<std::streamoff>(offset)))
+    {
+        return absl::NotFoundError(absl::StrCat("SendFile: Failed to open file '", file_path, "'"));
+    }
+    std::vector<char> buffer(kFileChunkSize);
+    uint64_t          total_sent = 0;
+    while (total_sent < size)
     {
-        std::streamsize to_read = std::min(static_cast<std::streamsize>(CHUNK_SIZE),
-                                           file_size - total_sent);
-        if (!file_stream.read(buffer.data(), to_read))
+        size_t to_read = static_cast<size_t>(std::min<uint64_t>(kFileChunkSize, size - total_sent));
+        if (!file_stream.read(buffer.data(), to_read) ||
+            (static_cast<size_t>(file_stream.gcount()) != to_read))
         {
-            file_stream.close();
-            return absl::InternalError(
+            return absl::DataLossError(
             absl::StrCat("SendFile: Failed to read chunk from file '", file_path, "'"));
         }
-        size_t current_read = static_cast<size_t>(file_stream.gcount());
-        if (current_read == 0)
+        absl::Status ret = Send(reinterpret_cast<uint8_t*>(buffer.data()), to_read);
+        if (!ret.ok())
+        {
+            return absl::Status(ret.code(),
+                                absl::StrCat("SendFile: Failed to send chunk for file '",
+                                             file_path,
+                                             "': ",
+                                             ret.message()));
+        }
+        total_sent += to_read;
+    }
+    return absl::OkStatus();
+#else
+    int fd = ::open(file_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return absl::NotFoundError(
+        absl::StrCat("SendFile: Failed to open file '", file_path, "': ", strerror(errno)));
+    }
+    Dive::Defer close_file([fd]() { ::close(fd); });
+
+    uint64_t position = offset;
+    uint64_t end = offset + size;
+
+#    if defined(__linux__)
+    // Let the kernel copy from the page cache to the socket. Falls back to the mmap'd path if
+    // sendfile() is not supported for this file/socket.
+    while (position < end)
+    {
+        off_t   file_offset = static_cast<off_t>(position);
+        size_t  to_send = static_cast<size_t>(std::min<uint64_t>(kFileMapWindowSize, end - position));
+        ssize_t sent = ::sendfile(m_socket, fd, &file_offset, to_send);
+        if (sent < 0)
+        {
+            int e = errno;
+            if (e == EINTR)
+            {
+                continue;
+            }
+            if (e == EAGAIN || e == EWOULDBLOCK)
+            {
+                pollfd pfd = { m_socket, POLLOUT, 0 };
+                ::poll(&pfd, 1, kNoTimeout);
+                continue;
+            }
+            if ((e == EINVAL || e == ENOSYS) && (position == offset))
+            {
+                break;
+            }
+            if (e == EPIPE || e == ECONNRESET)
+            {
+                Close();
+                return absl::AbortedError("SendFile: Connection reset by peer (EPIPE/ECONNRESET).");
+            }
+            return absl::InternalError(absl::StrCat("SendFile: sendfile() failed for file '",
+                                                    file_path,
+                                                    "': ",
+                                                    strerror(e)));
+        }
+        if (sent == 0)
+        {
+            return absl::DataLossError(
+            absl::StrCat("SendFile: File '", file_path, "' was truncated while being sent."));
+        }
+        position += static_cast<uint64_t>(sent);
+    }
+    if (position == end)
+    {
+        return absl::OkStatus();
+    }
+#    endif
+
+    // Send large mmap'd windows of the file
+    const uint64_t page_size = static_cast<uint64_t>(::sysconf(_SC_PAGESIZE));
+    while (position < end)
+    {
+        uint64_t map_offset = position - (position % page_size);
+        size_t   delta = static_cast<size_t>(position - map_offset);
+        size_t   length = static_cast<size_t>(std::min<uint64_t>(kFileMapWindowSize, end - position));
+        void*    addr = ::mmap(nullptr,
+                            length + delta,
+                            PROT_READ,
+                            MAP_PRIVATE,
+                            fd,
+                            static_cast<off_t>(map_offset));
+        if (addr == MAP_FAILED)
         {
-            file_stream.close();
-            return absl::DataLossError(absl::StrCat("SendFile: File size mismatch. Read 0 bytes "
-                                                    "before reaching expected end of file '",
+            return absl::InternalError(absl::StrCat("SendFile: mmap() failed for file '",
                                                     file_path,
-                                                    "'"));
+                                                    "': ",
+                                                    strerror(errno)));
         }
-        absl::Status ret = this->Send(reinterpret_cast<uint8_t*>(buffer.data()), current_read);
+        ::madvise(addr, length + delta, MADV_SEQUENTIAL);
+        absl::Status ret = Send(static_cast<const uint8_t*>(addr) + delta, length);
+        ::munmap(addr, length + delta);
         if (!ret.ok())
         {
             return absl::Status(ret.code(),
@@ -479,53 +691,213 @@ absl::Status SocketConnection::SendFile(const std::string& file_path)
                                              "': ",
                                              ret.message()));
         }
-        total_sent += static_cast<std::streamsize>(current_read);
+        position += length;
     }
-    file_stream.close();
     return absl::OkStatus();
+#endif
 }
 
 absl::Status SocketConnection::ReceiveFile(const std::string&          file_path,
                                            size_t                      file_size,
-                                           std::function<void(size_t)> progress_callback)
+                                           std::function<void(size_t)> progress_callback,
+                                           uint64_t                    offset)
 {
-    std::ofstream file_stream(file_path, std::ios::binary | std::ios::trunc);
+    if (offset > file_size)
+    {
+        return absl::InvalidArgumentError(absl::StrCat("ReceiveFile: Offset ",
+                                                       offset,
+                                                       " is past the end of '",
+                                                       file_path,
+                                                       "' (size ",
+                                                       file_size,
+                                                       ")."));
+    }
+    return ReceiveFileData(file_path, offset, file_size - offset, progress_callback);
+}
+
+absl::Status SocketConnection::ReceiveFileData(
+const std::string&                 file_path,
+uint64_t                           offset,
+uint64_t                           size,
+const std::function<void(size_t)>& progress_callback)
+{
+#ifdef WIN32
+    std::fstream file_stream;
+    if (offset == 0)
+    {
+        file_stream.open(file_path, std::ios::out | std::ios::binary | std::ios::trunc);
+    }
+    else
+    {
+        file_stream.open(file_path, std::ios::in | std::ios::out | std::ios::binary);
+        file_stream.seekp(static_cast<std::streamoff>(offset));
+    }
     if (!file_stream)
     {
         return absl::PermissionDeniedError(
         absl::StrCat("ReceiveFile: Failed to open file '", file_path, "' for writing."));
     }
-    const size_t         CHUNK_SIZE = 4096;
-    std::vector<uint8_t> buffer(CHUNK_SIZE);
-    size_t               total_received = 0;
-    while (total_received < file_size)
+    std::vector<uint8_t> buffer(kFileChunkSize);
+    uint64_t             position = offset;
+    const uint64_t       end = offset + size;
+    while (position < end)
     {
-        size_t to_receive = std::min(CHUNK_SIZE, file_size - total_received);
-        auto   ret = this->Recv(buffer.data(), to_receive);
+        size_t to_receive = static_cast<size_t>(std::min<uint64_t>(kFileChunkSize, end - position));
+        auto   ret = Recv(buffer.data(), to_receive);
         if (!ret.ok())
         {
-            file_stream.close();
             return absl::Status(ret.status().code(),
                                 absl::StrCat("ReceiveFile: Failed to receive chunk for '",
                                              file_path,
                                              "': ",
                                              ret.status().message()));
         }
-        size_t current_received = ret.value();
-        if (!file_stream.write(reinterpret_cast<char*>(buffer.data()), current_received))
+        if (!file_stream.write(reinterpret_cast<char*>(buffer.data()), *ret))
         {
-            file_stream.close();
             return absl::InternalError(
             absl::StrCat("ReceiveFile: Failed to write to file '", file_path, "'"));
         }
-        total_received += current_received;
+        position += *ret;
         if (progress_callback)
         {
-            progress_callback(total_received);
+            progress_callback(static_cast<size_t>(position));
         }
     }
-    file_stream.close();
     return absl::OkStatus();
+#else
+    int flags = O_RDWR | O_CREAT | O_CLOEXEC | ((offset == 0) ? O_TRUNC : 0);
+    int fd = ::open(file_path.c_str(), flags, 0644);
+    if (fd < 0)
+    {
+        return absl::PermissionDeniedError(absl::StrCat("ReceiveFile: Failed to open file '",
+                                                        file_path,
+                                                        "' for writing: ",
+                                                        strerror(errno)));
+    }
+    Dive::Defer close_file([fd]() { ::close(fd); });
+
+    struct stat file_stat;
+    if ((offset > 0) && ((::fstat(fd, &file_stat) != 0) ||
+                         (static_cast<uint64_t>(file_stat.st_size) < offset)))
+    {
+        return absl::FailedPreconditionError(
+        absl::StrCat("ReceiveFile: '", file_path, "' is smaller than the resume offset ", offset));
+    }
+
+    // Preallocate the whole file, so that the data can be received in place. Writing to a mapped
+    // page that can't be backed by the file system raises SIGBUS, so the file is only mapped once
+    // its blocks are reserved, and is written with pwrite() otherwise.
+    const uint64_t end = offset + size;
+    bool           map_file = false;
+#    if defined(__linux__)
+    map_file = (size > 0) &&
+               (::fallocate(fd, 0, static_cast<off_t>(offset), static_cast<off_t>(size)) == 0);
+#    endif
+    if (::ftruncate(fd, static_cast<off_t>(end)) != 0)
+    {
+        return absl::ResourceExhaustedError(absl::StrCat("ReceiveFile: Failed to allocate ",
+                                                         end,
+                                                         " bytes for '",
+                                                         file_path,
+                                                         "': ",
+                                                         strerror(errno)));
+    }
+
+    // End of the data received so far
+    uint64_t position = offset;
+    // Only keep what was received on failure, so that the transfer can be resumed
+    auto Fail = [&](absl::Status status) {
+        if (::ftruncate(fd, static_cast<off_t>(position)) != 0)
+        {
+            return absl::Status(status.code(),
+                                absl::StrCat(status.message(),
+                                             " (failed to truncate the partial file)"));
+        }
+        return status;
+    };
+    auto ReceiveInto = [&](uint8_t* dest, size_t length) -> absl::Status {
+        size_t received = 0;
+        while (received < length)
+        {
+            size_t to_receive = std::min(kFileChunkSize, length - received);
+            auto   ret = Recv(dest + received, to_receive);
+            if (!ret.ok())
+            {
+                return absl::Status(ret.status().code(),
+                                    absl::StrCat("ReceiveFile: Failed to receive chunk for '",
+                                                 file_path,
+                                                 "': ",
+                                                 ret.status().message()));
+            }
+            received += *ret;
+            position += *ret;
+            if (progress_callback)
+            {
+                progress_callback(static_cast<size_t>(position));
+            }
+        }
+        return absl::OkStatus();
+    };
+
+    const uint64_t       page_size = static_cast<uint64_t>(::sysconf(_SC_PAGESIZE));
+    std::vector<uint8_t> buffer;
+    while (position < end)
+    {
+        uint64_t map_offset = position - (position % page_size);
+        size_t   delta = static_cast<size_t>(position - map_offset);
+        size_t   length = static_cast<size_t>(std::min<uint64_t>(kFileMapWindowSize, end - position));
+        void*    addr = (map_file && buffer.empty()) ? ::mmap(nullptr,
+                                             length + delta,
+                                             PROT_READ | PROT_WRITE,
+                                             MAP_SHARED,
+                                             fd,
+                                             static_cast<off_t>(map_offset)) :
+                                         MAP_FAILED;
+        if (addr != MAP_FAILED)
+        {
+            absl::Status status = ReceiveInto(static_cast<uint8_t*>(addr) + delta, length);
+            ::munmap(addr, length + delta);
+            if (!status.ok())
+            {
+                return Fail(status);
+            }
+            continue;
+        }
+
+        // The file couldn't be preallocated or mapped, fall back to a buffered write
+        const uint64_t write_offset = position;
+        length = static_cast<size_t>(std::min<uint64_t>(kFileChunkSize, end - position));
+        buffer.resize(kFileChunkSize);
+        absl::Status status = ReceiveInto(buffer.data(), length);
+        if (!status.ok())
+        {
+            position = write_offset;
+            return Fail(status);
+        }
+        size_t written = 0;
+        while (written < length)
+        {
+            ssize_t ret = ::pwrite(fd,
+                                   buffer.data() + written,
+                                   length - written,
+                                   static_cast<off_t>(write_offset + written));
+            if (ret < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                position = write_offset + written;
+                return Fail(absl::InternalError(absl::StrCat("ReceiveFile: Failed to write to file '",
+                                                             file_path,
+                                                             "': ",
+                                                             strerror(errno))));
+            }
+            written += static_cast<size_t>(ret);
+        }
+    }
+    return absl::OkStatus();
+#endif
 }
 
 void SocketConnection::Close()
@@ -549,4 +921,16 @@ bool SocketConnection::IsOpen() const
     return m_socket != kInvalidSocketValue;
 }
 
+void SocketConnection::Shutdown()
+{
+    if (m_socket != kInvalidSocketValue)
+    {
+#ifdef WIN32
+        ::shutdown(static_cast<SOCKET>(m_socket), SD_BOTH);
+#else
+        ::shutdown(m_socket, SHUT_RDWR);
+#endif
+    }
+}
+
 }  // namespace Network
\ No newline at end of file
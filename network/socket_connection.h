@@ -16,7 +16,10 @@ limitations under the License.
 
 #pragma once
 
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <string>
 #include <system_error>
 
 #include "platform_net.h"
@@ -28,6 +31,13 @@ constexpr int kAcceptTimeout = 2000;
 namespace Network
 {
 
+// A contiguous piece of the data passed to SocketConnection::SendV.
+struct ConstSlice
+{
+    const uint8_t* data;
+    size_t         size;
+};
+
 class NetworkInitializer
 {
 public:
@@ -62,20 +72,45 @@ public:
 
     // Data transfer methods.
     absl::Status                Send(const uint8_t* data, size_t size);
+    // Sends the slices back to back, gathered into as few system calls as possible (sendmsg on
+    // POSIX), so a header and its payload don't need to be copied into one buffer first.
+    absl::Status                SendV(const ConstSlice* slices, size_t count);
     absl::StatusOr<size_t>      Recv(uint8_t* data, size_t size, int timeout_ms = kNoTimeout);
     absl::Status                SendString(const std::string& s);
     absl::StatusOr<std::string> ReceiveString();
-    absl::Status                SendFile(const std::string& file_path);
-    absl::Status                ReceiveFile(const std::string&          file_path,
-                                            size_t                      file_size,
-                                            std::function<void(size_t)> progress_callback = nullptr);
+
+    // File transfer: the raw file data from offset to the end of the file, as expected by
+    // DOWNLOAD_FILE peers of every protocol version.
+    // On POSIX the sender uses sendfile() (Linux) or large mmap'd windows, and the receiver
+    // preallocates the file and receives directly into mmap'd windows of it.
+    // ReceiveFile keeps the first `offset` bytes of an existing file, so that a transfer can be
+    // resumed; both sides must agree on the offset. file_size is the expected full size of the
+    // file.
+    absl::Status SendFile(const std::string& file_path, uint64_t offset = 0);
+    absl::Status ReceiveFile(const std::string&          file_path,
+                             size_t                      file_size,
+                             std::function<void(size_t)> progress_callback = nullptr,
+                             uint64_t                    offset = 0);
 
     void Close();
     bool IsOpen() const;
 
+    // Shuts down both directions of the socket without closing it. A thread blocked in Send or
+    // Recv on this connection returns an error, and the socket stays valid until it calls Close.
+    void Shutdown();
+
+    // Returns the underlying socket, to register it with an event loop.
+    SocketType GetSocket() const { return m_socket; }
+
 private:
     explicit SocketConnection(SocketType initial_socket_value);
 
+    absl::Status SendFileData(const std::string& file_path, uint64_t offset, uint64_t size);
+    absl::Status ReceiveFileData(const std::string&                 file_path,
+                                 uint64_t                           offset,
+                                 uint64_t                           size,
+                                 const std::function<void(size_t)>& progress_callback);
+
     SocketType m_socket;
     bool       m_is_listening;
     int        m_accept_timout_ms;
@@ -16,22 +16,42 @@ limitations under the License.
 #include "tcp_client.h"
 
 #include <chrono>
+#include <filesystem>
+#include <fstream>
 
 #include "absl/strings/str_cat.h"
+#include "file_transfer.h"
 
 namespace
 {
 constexpr uint32_t kKeepAliveIntervalSec = 2;
 constexpr uint32_t kPingTimeoutMs = 5000;
-constexpr uint32_t kHandshakeMajorVersion = 1;
-constexpr uint32_t kHandshakeMinorVersion = 0;
+// Number of times a range is requested again after a corrupted chunk.
+constexpr uint32_t kMaxDownloadAttempts = 3;
+constexpr char     kPartialDownloadSuffix[] = ".part";
+// Size and modification time of the remote file the partial download was received from.
+constexpr char     kPartialDownloadInfoSuffix[] = ".part.info";
+
+bool ReadPartialDownloadInfo(const std::string& info_path, uint64_t* file_size, int64_t* mtime)
+{
+    std::ifstream info(info_path);
+    return static_cast<bool>(info >> *file_size >> *mtime);
+}
+
+bool WritePartialDownloadInfo(const std::string& info_path, uint64_t file_size, int64_t mtime)
+{
+    std::ofstream info(info_path, std::ios::trunc);
+    return static_cast<bool>(info << file_size << " " << mtime << "\n");
+}
 }  // namespace
 
 namespace Network
 {
 
 TcpClient::TcpClient() :
-    m_status(ClientStatus::DISCONNECTED)
+    m_status(ClientStatus::DISCONNECTED),
+    m_protocol_minor_version(0),
+    m_server_capabilities(0)
 {
     m_keep_alive.running = false;
     m_keep_alive.interval_sec = kKeepAliveIntervalSec;
@@ -130,7 +150,7 @@ absl::StatusOr<std::string> TcpClient::StartPm4Capture()
 
     Pm4CaptureRequest pm4_request;
     std::cout << "Client: StartPm4Capture request." << std::endl;
-    auto send_status = SendMessage(m_connection.get(), pm4_request);
+    auto send_status = SendMessage(m_connection.get(), pm4_request, m_message_arena);
     if (!send_status.ok())
     {
         return SetStatusAndReturnError(ClientStatus::CONNECTION_FAILED,
@@ -140,7 +160,7 @@ absl::StatusOr<std::string> TcpClient::StartPm4Capture()
                                                            send_status.message())));
     }
 
-    auto receive = ReceiveMessage(m_connection.get());
+    auto receive = ReceiveMessage(m_connection.get(), m_message_arena);
     if (!receive.ok())
     {
         return SetStatusAndReturnError(ClientStatus::CONNECTION_FAILED,
@@ -150,7 +170,7 @@ absl::StatusOr<std::string> TcpClient::StartPm4Capture()
                                                            receive.status().message())));
     }
 
-    auto response = *std::move(receive);
+    ISerializable* response = *receive;
     if (response->GetMessageType() != MessageType::PM4_CAPTURE_RESPONSE)
     {
         return absl::FailedPreconditionError(
@@ -162,7 +182,7 @@ absl::StatusOr<std::string> TcpClient::StartPm4Capture()
                      ")."));
     }
 
-    auto* pm4_response = dynamic_cast<Pm4CaptureResponse*>(response.get());
+    auto* pm4_response = dynamic_cast<Pm4CaptureResponse*>(response);
     if (!pm4_response)
     {
         return absl::InternalError(
@@ -183,13 +203,18 @@ absl::Status TcpClient::DownloadFileFromServer(const std::string&          remot
     {
         return absl::FailedPreconditionError("DownloadFileFromServer: Client is not connected.");
     }
+    if ((m_protocol_minor_version >= kDownloadFileRangeMinorVersion) &&
+        (m_server_capabilities & kCapabilityDownloadFileRange))
+    {
+        return DownloadFileRangeFromServer(remote_file_path, local_save_path, progress_callback);
+    }
 
     DownloadFileRequest download_request;
     download_request.SetString(remote_file_path);
 
     std::cout << "Client: Requesting to download file from server '" << remote_file_path << "' to '"
               << local_save_path << "'." << std::endl;
-    auto send_status = SendMessage(m_connection.get(), download_request);
+    auto send_status = SendMessage(m_connection.get(), download_request, m_message_arena);
     if (!send_status.ok())
     {
         return SetStatusAndReturnError(ClientStatus::CONNECTION_FAILED,
@@ -199,7 +224,7 @@ absl::Status TcpClient::DownloadFileFromServer(const std::string&          remot
                                                                  send_status.message())));
     }
 
-    auto receive = ReceiveMessage(m_connection.get());
+    auto receive = ReceiveMessage(m_connection.get(), m_message_arena);
     if (!receive.ok())
     {
         return SetStatusAndReturnError(ClientStatus::CONNECTION_FAILED,
@@ -209,7 +234,7 @@ absl::Status TcpClient::DownloadFileFromServer(const std::string&          remot
                                                                  receive.status().message())));
     }
 
-    auto response = *std::move(receive);
+    ISerializable* response = *receive;
     if (response->GetMessageType() != MessageType::DOWNLOAD_FILE_RESPONSE)
     {
         return absl::FailedPreconditionError(
@@ -221,7 +246,7 @@ absl::Status TcpClient::DownloadFileFromServer(const std::string&          remot
                      ")."));
     }
 
-    auto* download_response = dynamic_cast<DownloadFileResponse*>(response.get());
+    auto* download_response = dynamic_cast<DownloadFileResponse*>(response);
     if (!download_response)
     {
         return absl::InternalError(
@@ -266,6 +291,161 @@ absl::Status TcpClient::DownloadFileFromServer(const std::string&          remot
     return absl::OkStatus();
 }
 
+absl::Status TcpClient::DownloadFileRangeFromServer(const std::string& remote_file_path,
+                                                    const std::string& local_save_path,
+                                                    std::function<void(size_t)> progress_callback)
+{
+    const std::string partial_path = local_save_path + kPartialDownloadSuffix;
+    const std::string info_path = local_save_path + kPartialDownloadInfoSuffix;
+    std::error_code   ec;
+    uint64_t          offset = 0;
+    uint64_t          remote_size = 0;
+    int64_t           remote_mtime = 0;
+    if (std::filesystem::exists(partial_path, ec))
+    {
+        offset = std::filesystem::file_size(partial_path, ec);
+        // Without the remote file it came from, the partial file can't be trusted.
+        if (ec || !ReadPartialDownloadInfo(info_path, &remote_size, &remote_mtime))
+        {
+            offset = 0;
+        }
+    }
+
+    for (uint32_t attempt = 0; attempt < kMaxDownloadAttempts; ++attempt)
+    {
+        DownloadFileRangeRequest request;
+        request.SetFilePath(remote_file_path);
+        request.SetOffset(offset);
+        request.SetFileSize(remote_size);
+        request.SetFileMtime(remote_mtime);
+        request.SetCompressionTypes(GetSupportedCompressionTypes());
+
+        std::cout << "Client: Requesting to download file from server '" << remote_file_path
+                  << "' to '" << local_save_path << "' from offset " << offset << "."
+                  << std::endl;
+        auto send_status = SendMessage(m_connection.get(), request, m_message_arena);
+        if (!send_status.ok())
+        {
+            return SetStatusAndReturnError(ClientStatus::CONNECTION_FAILED,
+                                           absl::Status(send_status.code(),
+                                                        absl::StrCat("DownloadFileRangeFromServer: "
+                                                                     "SendMessage fail: ",
+                                                                     send_status.message())));
+        }
+
+        auto receive = ReceiveMessage(m_connection.get(), m_message_arena);
+        if (!receive.ok())
+        {
+            return SetStatusAndReturnError(ClientStatus::CONNECTION_FAILED,
+                                           absl::Status(receive.status().code(),
+                                                        absl::StrCat("DownloadFileRangeFromServer: "
+                                                                     "ReceiveMessage fail: ",
+                                                                     receive.status().message())));
+        }
+
+        ISerializable* response = *receive;
+        if (response->GetMessageType() != MessageType::DOWNLOAD_FILE_RANGE_RESPONSE)
+        {
+            return absl::FailedPreconditionError(
+            absl::StrCat("DownloadFileRangeFromServer: Unexpected message type in Download "
+                         "response (Expected: ",
+                         MessageType::DOWNLOAD_FILE_RANGE_RESPONSE,
+                         ", Got: ",
+                         response->GetMessageType(),
+                         ")."));
+        }
+
+        auto* range_response = dynamic_cast<DownloadFileRangeResponse*>(response);
+        if (!range_response)
+        {
+            return absl::InternalError("DownloadFileRangeFromServer: Failed to cast received "
+                                       "message to DownloadFileRangeResponse.");
+        }
+
+        if (!range_response->GetFound())
+        {
+            // The partial file may be left over from another file, start over.
+            if (offset > 0)
+            {
+                std::cout << "Client: Server can't resume download ("
+                          << range_response->GetErrorReason() << "). Restarting." << std::endl;
+                std::filesystem::remove(partial_path, ec);
+                std::filesystem::remove(info_path, ec);
+                offset = 0;
+                remote_size = 0;
+                remote_mtime = 0;
+                continue;
+            }
+            return absl::NotFoundError(
+            absl::StrCat("DownloadFileRangeFromServer: Server could not provide file. Reason: ",
+                         range_response->GetErrorReason()));
+        }
+
+        std::cout << "Client: Server offering file (size = " << range_response->GetFileSize()
+                  << " bytes, compression = "
+                  << static_cast<uint32_t>(range_response->GetCompressionType())
+                  << "). Starting download." << std::endl;
+        remote_size = range_response->GetFileSize();
+        remote_mtime = range_response->GetFileMtime();
+        if (!WritePartialDownloadInfo(info_path, remote_size, remote_mtime))
+        {
+            std::cout << "Client: Failed to write '" << info_path
+                      << "', the download can't be resumed." << std::endl;
+        }
+        auto recv_status = ReceiveFileRange(m_connection.get(),
+                                            partial_path,
+                                            *range_response,
+                                            progress_callback);
+        if (recv_status.ok())
+        {
+            std::filesystem::remove(info_path, ec);
+            std::filesystem::rename(partial_path, local_save_path, ec);
+            if (ec)
+            {
+                return absl::InternalError(
+                absl::StrCat("DownloadFileRangeFromServer: Failed to rename '",
+                             partial_path,
+                             "' to '",
+                             local_save_path,
+                             "': ",
+                             ec.message()));
+            }
+            std::cout << "Client: File from server '" << remote_file_path
+                      << "' downloaded successfully to '" << local_save_path << "'."
+                      << std::endl;
+            return absl::OkStatus();
+        }
+
+        // The rest of the range was drained, so the connection is still usable to request the
+        // remaining data again.
+        if (absl::IsDataLoss(recv_status) && m_connection->IsOpen())
+        {
+            std::cout << "Client: " << recv_status.message() << " Retrying." << std::endl;
+            offset = std::filesystem::file_size(partial_path, ec);
+            if (ec)
+            {
+                offset = 0;
+            }
+            continue;
+        }
+        if (absl::IsAborted(recv_status))
+        {
+            return recv_status;
+        }
+        return SetStatusAndReturnError(ClientStatus::CONNECTION_FAILED,
+                                       absl::Status(recv_status.code(),
+                                                    absl::StrCat("DownloadFileRangeFromServer: "
+                                                                 "ReceiveFileRange fail: ",
+                                                                 recv_status.message())));
+    }
+    return absl::DataLossError(
+    absl::StrCat("DownloadFileRangeFromServer: Giving up on '",
+                 remote_file_path,
+                 "' after ",
+                 kMaxDownloadAttempts,
+                 " attempts."));
+}
+
 absl::StatusOr<size_t> TcpClient::GetCaptureFileSize(const std::string& remote_file_path)
 {
     std::lock_guard<std::mutex> lock(m_connection_mutex);
@@ -277,7 +457,7 @@ absl::StatusOr<size_t> TcpClient::GetCaptureFileSize(const std::string& remote_f
     FileSizeRequest file_size_request;
     file_size_request.SetString(remote_file_path);
     std::cout << "Client: Requesting file size of " << remote_file_path << std::endl;
-    auto send_status = SendMessage(m_connection.get(), file_size_request);
+    auto send_status = SendMessage(m_connection.get(), file_size_request, m_message_arena);
     if (!send_status.ok())
     {
         return SetStatusAndReturnError(ClientStatus::CONNECTION_FAILED,
@@ -287,7 +467,7 @@ absl::StatusOr<size_t> TcpClient::GetCaptureFileSize(const std::string& remote_f
                                                                  send_status.message())));
     }
 
-    auto receive = ReceiveMessage(m_connection.get());
+    auto receive = ReceiveMessage(m_connection.get(), m_message_arena);
     if (!receive.ok())
     {
         return SetStatusAndReturnError(ClientStatus::CONNECTION_FAILED,
@@ -297,7 +477,7 @@ absl::StatusOr<size_t> TcpClient::GetCaptureFileSize(const std::string& remote_f
                                                                  receive.status().message())));
     }
 
-    auto response = *std::move(receive);
+    ISerializable* response = *receive;
     if (response->GetMessageType() != MessageType::FILE_SIZE_RESPONSE)
     {
         return absl::FailedPreconditionError(
@@ -309,7 +489,7 @@ absl::StatusOr<size_t> TcpClient::GetCaptureFileSize(const std::string& remote_f
                      ")."));
     }
 
-    auto* file_size_response = dynamic_cast<FileSizeResponse*>(response.get());
+    auto* file_size_response = dynamic_cast<FileSizeResponse*>(response);
     if (!file_size_response)
     {
         return absl::InternalError(
@@ -348,7 +528,7 @@ absl::Status TcpClient::PingServer()
 
     PingMessage ping_request;
     std::cout << "Client: Send PING." << std::endl;
-    auto send_status = SendMessage(m_connection.get(), ping_request);
+    auto send_status = SendMessage(m_connection.get(), ping_request, m_message_arena);
     if (!send_status.ok())
     {
         return SetStatusAndReturnError(ClientStatus::CONNECTION_FAILED,
@@ -357,7 +537,7 @@ absl::Status TcpClient::PingServer()
                                                                  send_status.message())));
     }
 
-    auto receive = ReceiveMessage(m_connection.get(), kPingTimeoutMs);
+    auto receive = ReceiveMessage(m_connection.get(), m_message_arena, kPingTimeoutMs);
     if (!receive.ok())
     {
         return SetStatusAndReturnError(ClientStatus::CONNECTION_FAILED,
@@ -367,7 +547,7 @@ absl::Status TcpClient::PingServer()
                                                            receive.status().message())));
     }
 
-    auto response = *std::move(receive);
+    ISerializable* response = *receive;
     if (response->GetMessageType() != MessageType::PONG_MESSAGE)
     {
         return absl::FailedPreconditionError(
@@ -379,7 +559,7 @@ absl::Status TcpClient::PingServer()
                      ")."));
     }
 
-    auto* pong_response = dynamic_cast<PongMessage*>(response.get());
+    auto* pong_response = dynamic_cast<PongMessage*>(response);
     if (!pong_response)
     {
         return absl::InternalError("PingServer: Failed to cast received message to PongMessage.");
@@ -398,12 +578,12 @@ absl::Status TcpClient::PerformHandshake()
     }
 
     HandshakeRequest hs_request;
-    hs_request.SetMajorVersion(kHandshakeMajorVersion);
-    hs_request.SetMinorVersion(kHandshakeMinorVersion);
+    hs_request.SetMajorVersion(kProtocolMajorVersion);
+    hs_request.SetMinorVersion(kProtocolMinorVersion);
     std::cout << "Client: Sending Handshake (Client v" << hs_request.GetMajorVersion() << "."
               << hs_request.GetMinorVersion() << ")" << std::endl;
 
-    auto send_status = SendMessage(m_connection.get(), hs_request);
+    auto send_status = SendMessage(m_connection.get(), hs_request, m_message_arena);
     if (!send_status.ok())
     {
         return SetStatusAndReturnError(ClientStatus::CONNECTION_FAILED,
@@ -413,7 +593,7 @@ absl::Status TcpClient::PerformHandshake()
                                                            send_status.message())));
     }
 
-    auto receive = ReceiveMessage(m_connection.get());
+    auto receive = ReceiveMessage(m_connection.get(), m_message_arena);
     if (!receive.ok())
     {
         return SetStatusAndReturnError(ClientStatus::CONNECTION_FAILED,
@@ -423,7 +603,7 @@ absl::Status TcpClient::PerformHandshake()
                                                                  receive.status().message())));
     }
 
-    auto response = *std::move(receive);
+    ISerializable* response = *receive;
     if (response->GetMessageType() != MessageType::HANDSHAKE_RESPONSE)
     {
         return absl::FailedPreconditionError(
@@ -435,7 +615,7 @@ absl::Status TcpClient::PerformHandshake()
                      ")."));
     }
 
-    auto* hs_response = dynamic_cast<HandshakeResponse*>(response.get());
+    auto* hs_response = dynamic_cast<HandshakeResponse*>(response);
     if (!hs_response)
     {
         return absl::InternalError(
@@ -445,8 +625,9 @@ absl::Status TcpClient::PerformHandshake()
     std::cout << "Client: Server Handshake (Server v" << hs_response->GetMajorVersion() << "."
               << hs_response->GetMinorVersion() << ")" << std::endl;
 
+    // The server answers with the minor version both sides support.
     if (hs_response->GetMajorVersion() != hs_request.GetMajorVersion() ||
-        hs_response->GetMinorVersion() != hs_request.GetMinorVersion())
+        hs_response->GetMinorVersion() > hs_request.GetMinorVersion())
     {
         return absl::FailedPreconditionError(
         absl::StrCat("PerformHandshake: Handshake version mismatch. Server is v",
@@ -458,7 +639,11 @@ absl::Status TcpClient::PerformHandshake()
                      ".",
                      hs_request.GetMinorVersion()));
     }
-    std::cout << "Client: Handshake versions compatible." << std::endl;
+    m_protocol_minor_version = hs_response->GetMinorVersion();
+    m_server_capabilities = hs_response->GetCapabilities();
+    std::cout << "Client: Handshake versions compatible (v" << hs_response->GetMajorVersion()
+              << "." << m_protocol_minor_version << ", capabilities 0x" << std::hex
+              << m_server_capabilities << std::dec << ")." << std::endl;
     return absl::OkStatus();
 }
 
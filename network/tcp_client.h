@@ -58,6 +58,11 @@ public:
     absl::StatusOr<std::string> StartPm4Capture();
 
     // Downloads a file from the server to a local path.
+    // With a server advertising DOWNLOAD_FILE_RANGE, the data is verified chunk by chunk and
+    // written to local_save_path + ".part" first. A download interrupted by a connection failure is
+    // resumed from that file by the next call, and a corrupted chunk is fetched again. The size and
+    // modification time of the remote file are kept in local_save_path + ".part.info", and the
+    // download restarts from scratch if the remote file has changed since.
     absl::Status DownloadFileFromServer(const std::string&          remote_file_path,
                                         const std::string&          local_save_path,
                                         std::function<void(size_t)> progress_callback = nullptr);
@@ -72,6 +77,11 @@ private:
     // Performs a handshake with the server.
     absl::Status PerformHandshake();
 
+    // Downloads a file using DOWNLOAD_FILE_RANGE, resuming from a partial download if any.
+    absl::Status DownloadFileRangeFromServer(const std::string&          remote_file_path,
+                                             const std::string&          local_save_path,
+                                             std::function<void(size_t)> progress_callback);
+
     // Starts the keep-alive checking.
     absl::Status StartKeepAlive();
 
@@ -87,8 +97,14 @@ private:
 
     std::unique_ptr<SocketConnection> m_connection;
     std::mutex                        m_connection_mutex;
+    // Reused by the messages sent and received on m_connection, guarded by m_connection_mutex.
+    MessageArena                      m_message_arena;
     ClientStatus                      m_status;
     mutable std::mutex                m_status_mutex;
+    // Protocol minor version negotiated by the handshake.
+    uint32_t m_protocol_minor_version;
+    // Capability mask advertised by the server in the handshake.
+    uint32_t m_server_capabilities;
 
     // KeepAlive is used to check the connection with the server periodically via a ping-pong
     // mechanism.
@@ -16,9 +16,32 @@ limitations under the License.
 
 #include "unix_domain_server.h"
 
+#include <algorithm>
+#include <cstring>
+
 #include "common/log.h"
 #include "absl/strings/str_cat.h"
 
+#if defined(__linux__)
+#    include <sys/epoll.h>
+#    include <sys/eventfd.h>
+#endif
+
+namespace
+{
+// Event loop ids of the listen socket and of the wake up event. Clients use the following ids.
+constexpr uint64_t kListenId = 0;
+constexpr uint64_t kWakeId = 1;
+constexpr uint64_t kFirstClientId = 2;
+constexpr int      kMaxEvents = 64;
+// Time to wait for the rest of a message once its first bytes arrived.
+constexpr int kMessageTimeoutMs = 5000;
+#if defined(__linux__)
+// A client is handed to one worker at a time, and watched again once its message is handled.
+constexpr uint32_t kClientEvents = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+#endif
+}  // namespace
+
 namespace Network
 {
 
@@ -50,10 +73,8 @@ void DefaultMessageHandler::HandleMessage(std::unique_ptr<ISerializable> message
         auto* request = dynamic_cast<HandshakeRequest*>(message.get());
         if (request)
         {
-            HandshakeResponse response;
-            response.SetMajorVersion(request->GetMajorVersion());
-            response.SetMinorVersion(request->GetMinorVersion());
-            auto status = SendMessage(client_conn, response);
+            HandshakeResponse response = NegotiateHandshake(*request);
+            auto              status = SendMessage(client_conn, response);
             if (!status.ok())
             {
                 LOGW("DefaultMessageHandler::HandleMessage: SendMessage fail: %.*s",
@@ -100,7 +121,12 @@ void DefaultMessageHandler::OnDisconnect()
     LOGI("DefaultMessageHandler::OnDisconnect()");
 }
 
-UnixDomainServer::UnixDomainServer(std::unique_ptr<IMessageHandler> handler) :
+UnixDomainServer::UnixDomainServer(std::unique_ptr<IMessageHandler> handler,
+                                   uint32_t                         num_workers) :
+    m_num_workers(std::max(num_workers, 1u)),
+    m_epoll_fd(-1),
+    m_wake_fd(-1),
+    m_next_client_id(kFirstClientId),
     m_handler(std::move(handler)),
     m_is_running(false)
 {
@@ -117,7 +143,9 @@ absl::Status UnixDomainServer::Start(const std::string& server_address)
     {
         return absl::AlreadyExistsError("Start: Server is already running.");
     }
-
+#if !defined(__linux__)
+    return absl::UnimplementedError("Start: The server requires epoll (Linux or Android).");
+#else
     auto connection = SocketConnection::Create();
     if (!connection.ok())
     {
@@ -133,10 +161,37 @@ absl::Status UnixDomainServer::Start(const std::string& server_address)
                                          conn_status.message()));
     }
 
+    m_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    m_wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (m_epoll_fd < 0 || m_wake_fd < 0)
+    {
+        CloseEventLoop();
+        return absl::InternalError(
+        absl::StrCat("Start: Failed to create the event loop: ", strerror(errno)));
+    }
+    epoll_event listen_event = {};
+    listen_event.events = EPOLLIN;
+    listen_event.data.u64 = kListenId;
+    epoll_event wake_event = {};
+    wake_event.events = EPOLLIN;
+    wake_event.data.u64 = kWakeId;
+    if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, (*connection)->GetSocket(), &listen_event) < 0 ||
+        epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, m_wake_fd, &wake_event) < 0)
+    {
+        CloseEventLoop();
+        return absl::InternalError(
+        absl::StrCat("Start: Failed to watch the listen socket: ", strerror(errno)));
+    }
+
     m_listen_connection = *std::move(connection);
     m_is_running.store(true);
-    m_server_thread = std::thread(&UnixDomainServer::AcceptAndHandleClientLoop, this);
+    for (uint32_t i = 0; i < m_num_workers; ++i)
+    {
+        m_workers.emplace_back(&UnixDomainServer::WorkerLoop, this);
+    }
+    m_server_thread = std::thread(&UnixDomainServer::EventLoop, this);
     return absl::OkStatus();
+#endif
 }
 
 void UnixDomainServer::Wait()
@@ -145,101 +200,313 @@ void UnixDomainServer::Wait()
     m_wait_cv.wait(lock, [this] { return !m_is_running.load(); });
 }
 
-void UnixDomainServer::Stop()
+bool UnixDomainServer::IsServerThread() const
+{
+    const std::thread::id id = std::this_thread::get_id();
+    if (m_server_thread.get_id() == id)
+    {
+        return true;
+    }
+    return std::any_of(m_workers.begin(), m_workers.end(), [id](const std::thread& worker) {
+        return worker.get_id() == id;
+    });
+}
+
+void UnixDomainServer::RequestStop()
 {
     m_is_running.store(false);
-    m_listen_connection.reset();
-    ResetClientConnection();
+#if defined(__linux__)
+    if (m_wake_fd >= 0)
+    {
+        uint64_t one = 1;
+        (void)!write(m_wake_fd, &one, sizeof(one));
+    }
+#endif
+}
+
+void UnixDomainServer::Stop()
+{
+    // A thread can't join itself. From a handler, only stop serving and let Wait() return; the
+    // threads are joined by the next Stop() from another thread, at the latest by the destructor.
+    if (IsServerThread())
+    {
+        LOGI("UnixDomainServer: Stop requested from a server thread, deferring the join.");
+        RequestStop();
+        {
+            std::lock_guard<std::mutex> lk(m_clients_mutex);
+            for (auto& [id, client] : m_clients)
+            {
+                client->connection->Shutdown();
+            }
+        }
+        m_ready_cv.notify_all();
+        std::lock_guard<std::mutex> lk(m_wait_mutex);
+        m_wait_cv.notify_all();
+        return;
+    }
+
+    RequestStop();
     if (m_server_thread.joinable())
     {
         m_server_thread.join();
     }
 
+    // Unblock the workers waiting for a message or sending a response.
+    {
+        std::lock_guard<std::mutex> lk(m_clients_mutex);
+        for (auto& [id, client] : m_clients)
+        {
+            client->connection->Shutdown();
+        }
+    }
+    m_ready_cv.notify_all();
+    for (auto& worker : m_workers)
+    {
+        if (worker.joinable())
+        {
+            worker.join();
+        }
+    }
+    m_workers.clear();
+
+    std::unordered_map<uint64_t, std::shared_ptr<Client>> clients;
+    {
+        std::lock_guard<std::mutex> lk(m_clients_mutex);
+        clients.swap(m_clients);
+    }
+    for (size_t i = 0; i < clients.size(); ++i)
+    {
+        m_handler->OnDisconnect();
+    }
+    clients.clear();
+    {
+        std::lock_guard<std::mutex> lk(m_ready_mutex);
+        m_ready_clients.clear();
+    }
+    m_listen_connection.reset();
+    CloseEventLoop();
+
     m_wait_cv.notify_one();
     LOGI("UnixDomainServer: Stopped completely.");
 }
 
-void UnixDomainServer::AcceptAndHandleClientLoop()
+size_t UnixDomainServer::GetClientCount() const
+{
+    std::lock_guard<std::mutex> lk(m_clients_mutex);
+    return m_clients.size();
+}
+
+void UnixDomainServer::EventLoop()
 {
+#if defined(__linux__)
+    epoll_event events[kMaxEvents];
     while (m_is_running.load())
     {
-        // We only accept one client connection at a time.
-        if (!m_client_connection)
+        int num_events = epoll_wait(m_epoll_fd, events, kMaxEvents, -1);
+        if (num_events < 0)
         {
-            if (!m_listen_connection || !m_listen_connection->IsOpen())
+            if (errno == EINTR)
             {
-                LOGI(m_is_running.load() ?
-                     "AcceptAndHandleClientLoop: Listen socket closed unexpectedly. Stopping." :
-                     "AcceptAndHandleClientLoop: Listen socket closed for shutdown.");
-                break;
-            }
-
-            auto acc_connection = m_listen_connection->Accept();
-            if (!acc_connection.ok())
-            {
-                if (!m_is_running.load())
-                {
-                    LOGI("AcceptAndHandleClientLoop: Accept: Exiting loop due to shutdown.");
-                    break;
-                }
-                LOGI("AcceptAndHandleClientLoop: Error accepting new client: %.*s",
-                     static_cast<int>(acc_connection.status().message().length()),
-                     acc_connection.status().message().data());
                 continue;
             }
-
-            {
-                std::lock_guard<std::mutex> lk(m_client_mutex);
-                m_client_connection = *std::move(acc_connection);
-            }
-            LOGI("AcceptAndHandleClientLoop: New client accepted.");
-            m_handler->OnConnect();
+            LOGI("EventLoop: epoll_wait failed: %s", strerror(errno));
+            break;
         }
 
-        // Having accepted the only client connection, we're now ready to receive messages from it.
-        if (m_client_connection)
+        bool listen_closed = false;
+        for (int i = 0; i < num_events; ++i)
         {
-            if (!m_client_connection->IsOpen())
+            const uint64_t id = events[i].data.u64;
+            if (id == kWakeId)
             {
-                LOGI("AcceptAndHandleClientLoop: Client connection is closed.");
-                m_handler->OnDisconnect();
-                ResetClientConnection();
-                continue;
+                uint64_t count;
+                (void)!read(m_wake_fd, &count, sizeof(count));
             }
-
-            auto recv_message = ReceiveMessage(m_client_connection.get());
-            if (!recv_message.ok())
+            else if (id == kListenId)
             {
-                if (!m_is_running.load())
+                if (events[i].events & (EPOLLERR | EPOLLHUP))
                 {
-                    LOGI(
-                    "AcceptAndHandleClientLoop: ReceiveMessage: Exiting loop due to shutdown.");
-                    m_handler->OnDisconnect();
-                    break;
+                    listen_closed = true;
+                }
+                else
+                {
+                    AcceptClient();
                 }
-
-                LOGI("AcceptAndHandleClientLoop: ReceiveMessage failed: %.*s",
-                     static_cast<int>(recv_message.status().message().length()),
-                     recv_message.status().message().data());
-                m_handler->OnDisconnect();
-                ResetClientConnection();
             }
             else
             {
-                m_handler->HandleMessage(*std::move(recv_message), m_client_connection.get());
+                // The client isn't watched anymore (EPOLLONESHOT) until its message is handled.
+                std::shared_ptr<Client> client;
+                {
+                    std::lock_guard<std::mutex> lk(m_clients_mutex);
+                    auto                        it = m_clients.find(id);
+                    if (it != m_clients.end())
+                    {
+                        client = it->second;
+                    }
+                }
+                if (client)
+                {
+                    {
+                        std::lock_guard<std::mutex> lk(m_ready_mutex);
+                        m_ready_clients.push_back(std::move(client));
+                    }
+                    m_ready_cv.notify_one();
+                }
             }
         }
+        if (listen_closed)
+        {
+            LOGI(m_is_running.load() ?
+                 "EventLoop: Listen socket closed unexpectedly. Stopping." :
+                 "EventLoop: Listen socket closed for shutdown.");
+            break;
+        }
     }
+#endif
 
-    LOGI("AcceptAndHandleClientLoop: Exiting loop.");
+    LOGI("EventLoop: Exiting loop.");
     m_is_running.store(false);
+    m_ready_cv.notify_all();
     m_wait_cv.notify_one();
 }
 
-void UnixDomainServer::ResetClientConnection()
+void UnixDomainServer::WorkerLoop()
+{
+    while (true)
+    {
+        std::shared_ptr<Client> client;
+        {
+            std::unique_lock<std::mutex> lk(m_ready_mutex);
+            m_ready_cv.wait(lk, [this] {
+                return !m_is_running.load() || !m_ready_clients.empty();
+            });
+            if (!m_is_running.load())
+            {
+                break;
+            }
+            client = std::move(m_ready_clients.front());
+            m_ready_clients.pop_front();
+        }
+
+        if (!ServeClient(*client) || !m_is_running.load() || !RearmClient(*client))
+        {
+            DisconnectClient(client);
+        }
+    }
+}
+
+void UnixDomainServer::AcceptClient()
 {
-    std::lock_guard<std::mutex> lk(m_client_mutex);
-    m_client_connection.reset();
+#if defined(__linux__)
+    auto acc_connection = m_listen_connection->Accept();
+    if (!acc_connection.ok())
+    {
+        LOGI("AcceptClient: Error accepting new client: %.*s",
+             static_cast<int>(acc_connection.status().message().length()),
+             acc_connection.status().message().data());
+        return;
+    }
+
+    auto client = std::make_shared<Client>();
+    client->connection = *std::move(acc_connection);
+    {
+        std::lock_guard<std::mutex> lk(m_clients_mutex);
+        client->id = m_next_client_id++;
+        m_clients[client->id] = client;
+    }
+    LOGI("AcceptClient: New client accepted.");
+    m_handler->OnConnect();
+
+    epoll_event event = {};
+    event.events = kClientEvents;
+    event.data.u64 = client->id;
+    if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, client->connection->GetSocket(), &event) < 0)
+    {
+        LOGI("AcceptClient: Failed to watch the client socket: %s", strerror(errno));
+        DisconnectClient(client);
+    }
+#endif
+}
+
+bool UnixDomainServer::ServeClient(Client& client)
+{
+    if (!client.connection->IsOpen())
+    {
+        LOGI("ServeClient: Client connection is closed.");
+        return false;
+    }
+
+    // The client has data to read, so the whole message is expected to follow shortly.
+    auto recv_message = ReceiveMessage(client.connection.get(), kMessageTimeoutMs);
+    if (!recv_message.ok())
+    {
+        if (m_is_running.load())
+        {
+            LOGI("ServeClient: ReceiveMessage failed: %.*s",
+                 static_cast<int>(recv_message.status().message().length()),
+                 recv_message.status().message().data());
+        }
+        return false;
+    }
+    m_handler->HandleMessage(*std::move(recv_message), client.connection.get());
+    return client.connection->IsOpen();
+}
+
+bool UnixDomainServer::RearmClient(const Client& client)
+{
+#if defined(__linux__)
+    epoll_event event = {};
+    event.events = kClientEvents;
+    event.data.u64 = client.id;
+    // The event loop takes the lock to find the client, which orders the work done on the client
+    // by this worker before the work of the next one.
+    std::lock_guard<std::mutex> lk(m_clients_mutex);
+    if (epoll_ctl(m_epoll_fd, EPOLL_CTL_MOD, client.connection->GetSocket(), &event) < 0)
+    {
+        LOGI("RearmClient: Failed to watch the client socket: %s", strerror(errno));
+        return false;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+void UnixDomainServer::DisconnectClient(const std::shared_ptr<Client>& client)
+{
+    {
+        std::lock_guard<std::mutex> lk(m_clients_mutex);
+        if (m_clients.erase(client->id) == 0)
+        {
+            // Already disconnected by Stop.
+            return;
+        }
+#if defined(__linux__)
+        if (client->connection->IsOpen())
+        {
+            epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, client->connection->GetSocket(), nullptr);
+        }
+#endif
+        client->connection->Close();
+    }
+    m_handler->OnDisconnect();
+}
+
+void UnixDomainServer::CloseEventLoop()
+{
+#if defined(__linux__)
+    if (m_epoll_fd >= 0)
+    {
+        close(m_epoll_fd);
+        m_epoll_fd = -1;
+    }
+    if (m_wake_fd >= 0)
+    {
+        close(m_wake_fd);
+        m_wake_fd = -1;
+    }
+#endif
 }
 
-}  // namespace Network
\ No newline at end of file
+}  // namespace Network
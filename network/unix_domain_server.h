@@ -18,10 +18,13 @@ limitations under the License.
 
 #include <atomic>
 #include <condition_variable>
+#include <deque>
 #include <memory>
 #include <mutex>
 #include <string>
 #include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include "messages.h"
 #include "message_handler.h"
@@ -40,16 +43,20 @@ public:
     void OnDisconnect() override;
 };
 
-// The UnixDomainServer is designed to run two threads. One thread accepts and handles a single
-// client connection, while the main thread starts the server and waits for the first thread to
-// finish or for an unexpected error to occur that necessitates stopping the server.
-// The server is designed to accept only one client connection at a time.
+// The UnixDomainServer serves many concurrent clients. One thread runs an event loop (epoll) that
+// accepts new connections and waits for incoming data, and a small pool of worker threads receives
+// and handles the messages. A connection is handed to a single worker at a time and only watched
+// again once its message is handled, so the messages of a client are handled in order, while a
+// long request (e.g. a capture or a download) from one client doesn't block the others.
+// The handler is called from several threads and must be thread-safe.
+// The event loop requires epoll, so Start fails on other platforms than Linux and Android.
 class UnixDomainServer
 {
 public:
     // Constructs the server, taking ownership of the provided IMessageHandler.
     explicit UnixDomainServer(
-    std::unique_ptr<IMessageHandler> handler = std::make_unique<DefaultMessageHandler>());
+    std::unique_ptr<IMessageHandler> handler = std::make_unique<DefaultMessageHandler>(),
+    uint32_t                         num_workers = kDefaultServerWorkers);
 
     // Stops the server and cleans up all resources.
     ~UnixDomainServer();
@@ -60,26 +67,72 @@ public:
     // Blocks the calling thread until the server stops.
     void Wait();
 
-    // Gracefully stops the server thread and closes connections.
+    // Gracefully stops the server threads and closes connections.
+    // When called from a handler, only stops serving and wakes up Wait(): a thread of the server
+    // can't join itself, so the threads are joined by a later Stop() from another thread, or by
+    // the destructor.
     void Stop();
 
+    // Returns the number of connected clients.
+    size_t GetClientCount() const;
+
+    static constexpr uint32_t kDefaultServerWorkers = 4;
+
 private:
-    // The primary run loop for the server's worker thread.
-    void AcceptAndHandleClientLoop();
+    struct Client
+    {
+        uint64_t                          id;
+        std::unique_ptr<SocketConnection> connection;
+    };
+
+    // The run loop of the event thread: accepts clients and queues the ones with incoming data.
+    void EventLoop();
+
+    // The run loop of the worker threads: handles one message of a queued client at a time.
+    void WorkerLoop();
+
+    void AcceptClient();
+
+    // Receives and handles one message. Returns false if the client should be disconnected.
+    bool ServeClient(Client& client);
+
+    // Watches the client again for incoming data.
+    bool RearmClient(const Client& client);
+
+    void DisconnectClient(const std::shared_ptr<Client>& client);
+
+    // Closes the event loop file descriptors.
+    void CloseEventLoop();
+
+    // Returns true if called from the event loop or from a worker.
+    bool IsServerThread() const;
 
-    // Resets the client connection to prepare for a new client.
-    void ResetClientConnection();
+    // Clears the running flag and wakes up the event loop.
+    void RequestStop();
 
     // Server connection.
     std::unique_ptr<SocketConnection> m_listen_connection;
-    // The only one client connection at a time.
-    std::unique_ptr<SocketConnection> m_client_connection;
-    // The thread that accepts and handles the only one client connection at a time.
+    // The thread running the event loop.
     std::thread m_server_thread;
+    // The threads handling the messages.
+    std::vector<std::thread> m_workers;
+    uint32_t                 m_num_workers;
+    int                      m_epoll_fd;
+    // Written to wake up the event loop on Stop.
+    int m_wake_fd;
+
+    // Connected clients, by id.
+    std::unordered_map<uint64_t, std::shared_ptr<Client>> m_clients;
+    uint64_t                                              m_next_client_id;
+    mutable std::mutex                                    m_clients_mutex;
+
+    // Clients with incoming data, waiting for a worker.
+    std::deque<std::shared_ptr<Client>> m_ready_clients;
+    std::mutex                          m_ready_mutex;
+    std::condition_variable             m_ready_cv;
 
     std::unique_ptr<IMessageHandler> m_handler;
     std::atomic<bool>                m_is_running;
-    std::mutex                       m_client_mutex;
     std::mutex                       m_wait_mutex;
     std::condition_variable          m_wait_cv;
 };
@@ -33,6 +33,7 @@ void InitInstanceDispatchTable(VkInstance                instance,
 
     dt->EnumerateDeviceExtensionProperties = (PFN_vkEnumerateDeviceExtensionProperties)
     pa(instance, "vkEnumerateDeviceExtensionProperties");
+    dt->DestroyInstance = (PFN_vkDestroyInstance)pa(instance, "vkDestroyInstance");
 }
 
 void InitDeviceDispatchTable(VkDevice device, PFN_vkGetDeviceProcAddr pa, DeviceDispatchTable *dt)
@@ -28,6 +28,7 @@ struct InstanceDispatchTable
     PFN_vkCreateDevice                       CreateDevice = nullptr;
     PFN_vkEnumerateDeviceLayerProperties     EnumerateDeviceLayerProperties = nullptr;
     PFN_vkEnumerateDeviceExtensionProperties EnumerateDeviceExtensionProperties = nullptr;
+    PFN_vkDestroyInstance                    DestroyInstance = nullptr;
 };
 
 struct DeviceDispatchTable
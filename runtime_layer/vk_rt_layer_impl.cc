@@ -42,6 +42,10 @@ static bool sRemoveImageFlagFDMOffset = false;
 static bool sRemoveImageFlagSubSampled = false;
 static bool sDisableTimestamp = false;
 
+// The app synchronizes its own frames, so the GPU timing does not need to wait for the device to
+// be idle at every frame boundary
+static uint32_t sOpenXRGPUTimingFramesInFlight = 3;
+
 static uint32_t sDrawcallCounter = 0;
 static size_t   sTotalIndexCounter = 0;
 
@@ -301,6 +305,12 @@ VkResult DiveRuntimeLayer::CreateDevice(PFN_vkGetDeviceProcAddr      pa,
     }
 
     m_gpu_time.SetEnable(sEnableOpenXRGPUTiming);
+    Dive::GPUTime::GpuTimeStatus frames_status = m_gpu_time.SetFramesInFlight(
+    sOpenXRGPUTimingFramesInFlight);
+    if (!frames_status.success)
+    {
+        LOGE("%s", frames_status.message.c_str());
+    }
 
     PFN_vkCreateQueryPool CreateQueryPool = reinterpret_cast<PFN_vkCreateQueryPool>(
     m_device_proc_addr(*pDevice, "vkCreateQueryPool"));
@@ -364,13 +374,6 @@ VkResult DiveRuntimeLayer::QueueSubmit(PFN_vkQueueSubmit   pfn,
                                        const VkSubmitInfo* pSubmits,
                                        VkFence             fence)
 {
-    VkResult result = pfn(queue, submitCount, pSubmits, fence);
-
-    if (result != VK_SUCCESS)
-    {
-        return result;
-    }
-
     PFN_vkDeviceWaitIdle DeviceWaitIdle = reinterpret_cast<PFN_vkDeviceWaitIdle>(
     m_device_proc_addr(m_gpu_time.GetDevice(), "vkDeviceWaitIdle"));
 
@@ -380,6 +383,22 @@ VkResult DiveRuntimeLayer::QueueSubmit(PFN_vkQueueSubmit   pfn,
     PFN_vkGetQueryPoolResults GetQueryPoolResults = reinterpret_cast<PFN_vkGetQueryPoolResults>(
     m_device_proc_addr(m_gpu_time.GetDevice(), "vkGetQueryPoolResults"));
 
+    Dive::GPUTime::GpuTimeStatus before_status = m_gpu_time.OnBeforeQueueSubmit(submitCount,
+                                                                                pSubmits,
+                                                                                ResetQueryPool,
+                                                                                GetQueryPoolResults);
+    if (!before_status.success)
+    {
+        LOGE("%s", before_status.message.c_str());
+    }
+
+    VkResult result = pfn(queue, submitCount, pSubmits, fence);
+
+    if (result != VK_SUCCESS)
+    {
+        return result;
+    }
+
     auto submit_status = m_gpu_time.OnQueueSubmit(submitCount,
                                                   pSubmits,
                                                   DeviceWaitIdle,
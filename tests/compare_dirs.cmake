@@ -0,0 +1,44 @@
+#
+# Copyright 2025 Google LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+# Usage: cmake -DEXPECTED_DIR=<abs dir> -DACTUAL_DIR=<abs dir> [-DREQUIRED_SUBDIRS=a;b] -P compare_dirs.cmake
+# Fails unless both directories hold the same files with the same content, and each of
+# REQUIRED_SUBDIRS holds at least one file.
+
+file(GLOB_RECURSE expected_files RELATIVE "${EXPECTED_DIR}" "${EXPECTED_DIR}/*")
+file(GLOB_RECURSE actual_files RELATIVE "${ACTUAL_DIR}" "${ACTUAL_DIR}/*")
+list(SORT expected_files)
+list(SORT actual_files)
+if(NOT expected_files STREQUAL actual_files)
+    message(FATAL_ERROR "${EXPECTED_DIR} and ${ACTUAL_DIR} don't hold the same files")
+endif()
+
+foreach(subdir IN LISTS REQUIRED_SUBDIRS)
+    set(subdir_files ${expected_files})
+    list(FILTER subdir_files INCLUDE REGEX "^${subdir}/")
+    if(NOT subdir_files)
+        message(FATAL_ERROR "No file in ${EXPECTED_DIR}/${subdir}")
+    endif()
+endforeach()
+
+foreach(file IN LISTS expected_files)
+    execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files "${EXPECTED_DIR}/${file}"
+                            "${ACTUAL_DIR}/${file}"
+                    RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "${file} differs between ${EXPECTED_DIR} and ${ACTUAL_DIR}")
+    endif()
+endforeach()
@@ -285,6 +285,7 @@ class FileProcessor
     ProcessFrameMarker(const format::BlockHeader& block_header, format::MarkerType marker_type, bool& should_break);
     virtual bool ProcessStateMarker(const format::BlockHeader& block_header, format::MarkerType marker_type);
     virtual void StoreBlockInfo() {}
+    void         SetBlockLimit(uint64_t block_limit) { block_limit_ = block_limit; }
 
     bool        run_without_decoders_ = false;
     std::string absolute_path_;
@@ -178,6 +178,16 @@ void android_main(struct android_app* app)
                 if (arg_parser.IsOptionSet(kEnableGPUTime))
                 {
                     vulkan_replay_consumer.SetEnableGPUTime(replay_options.enable_gpu_time);
+
+                    // GOOGLE: Record the GPU time of every frame to gpu_time.bin, next to gpu_time.csv
+                    auto* dive_file_processor =
+                        dynamic_cast<gfxrecon::decode::DiveFileProcessor*>(file_processor.get());
+                    GFXRECON_ASSERT(dive_file_processor)
+                    if (replay_options.enable_gpu_time && (dive_file_processor != nullptr))
+                    {
+                        vulkan_replay_consumer.SetGPUTimeRecordFile(
+                            dive_file_processor->GetOutputFilePath("gpu_time.bin"));
+                    }
                 }
 
                 ApiReplayOptions  api_replay_options;
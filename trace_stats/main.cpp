@@ -20,15 +20,113 @@
 #include <numeric>
 #include <set>
 #include <array>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <thread>
 
 #include "dive_core/data_core.h"
 #include "trace_stats.h"
 #include "pm4_info.h"
 
+// Collect the captures to process in batch mode: all the .rd files under a directory, or the
+// files listed one per line in a text file. Empty lines and lines starting with # are skipped.
+std::vector<std::string> CollectCaptureFiles(const std::string &input)
+{
+    std::vector<std::string> file_names;
+    std::error_code          ec;
+    if (std::filesystem::is_directory(input, ec))
+    {
+        for (const auto &entry : std::filesystem::recursive_directory_iterator(input, ec))
+        {
+            if (entry.is_regular_file(ec) && entry.path().extension() == ".rd")
+            {
+                file_names.push_back(entry.path().string());
+            }
+        }
+        std::sort(file_names.begin(), file_names.end());
+        return file_names;
+    }
+
+    std::ifstream list_file(input);
+    std::string   line;
+    while (std::getline(list_file, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
+        if (!line.empty() && line[0] != '#')
+        {
+            file_names.push_back(line);
+        }
+    }
+    return file_names;
+}
+
+int RunBatch(int argc, char **argv)
+{
+    std::string input;
+    std::string output_file_name;
+    uint32_t    num_workers = std::max(1u, std::thread::hardware_concurrency());
+    for (int i = 2; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--jobs" && i + 1 < argc)
+        {
+            num_workers = static_cast<uint32_t>(std::max(1, std::atoi(argv[++i])));
+        }
+        else if (input.empty())
+        {
+            input = arg;
+        }
+        else
+        {
+            output_file_name = arg;
+        }
+    }
+    if (input.empty())
+    {
+        std::cout << "You need to call: trace_stats --batch <capture_directory or list_file.txt> "
+                     "<output_report.csv>(optional) --jobs <N>(optional)";
+        return 0;
+    }
+
+    std::vector<std::string> file_names = CollectCaptureFiles(input);
+    if (file_names.empty())
+    {
+        std::cout << "No capture found in \"" << input << "\"!";
+        return 0;
+    }
+    std::cout << "Gathering Stats of " << file_names.size() << " captures with " << num_workers
+              << " workers...\n";
+
+    Dive::TraceStats                     trace_stats;
+    std::vector<Dive::BatchCaptureStats> batch_stats;
+    batch_stats = trace_stats.GatherBatchTraceStats(file_names, num_workers);
+
+    std::ostream *ostream = &std::cout;
+    std::ofstream ofstream;
+    if (!output_file_name.empty())
+    {
+        std::cout << "Output report to \"" << output_file_name << "\"" << std::endl;
+        ofstream.open(output_file_name);
+        ostream = &ofstream;
+    }
+    trace_stats.PrintBatchTraceStats(batch_stats, *ostream);
+
+    return 1;
+}
+
 int main(int argc, char **argv)
 {
     Pm4InfoInit();
 
+    if ((argc >= 2) && (std::string(argv[1]) == "--batch"))
+    {
+        return RunBatch(argc, argv);
+    }
+
     // Handle args
     if ((argc != 2) && (argc != 3))
     {
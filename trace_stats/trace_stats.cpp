@@ -15,11 +15,91 @@
 */
 
 #include "trace_stats.h"
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
 #include "dive_core/event_state.h"
 
 namespace Dive
 {
 
+namespace
+{
+
+template<typename T> void HashCombine(size_t &seed, const T &value)
+{
+    seed ^= std::hash<T>()(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+struct ViewportHash
+{
+    size_t operator()(const Viewport &viewport) const
+    {
+        size_t seed = 0;
+        HashCombine(seed, viewport.m_vk_viewport.x);
+        HashCombine(seed, viewport.m_vk_viewport.y);
+        HashCombine(seed, viewport.m_vk_viewport.width);
+        HashCombine(seed, viewport.m_vk_viewport.height);
+        HashCombine(seed, viewport.m_vk_viewport.minDepth);
+        HashCombine(seed, viewport.m_vk_viewport.maxDepth);
+        return seed;
+    }
+};
+
+struct WindowScissorHash
+{
+    size_t operator()(const WindowScissor &window_scissor) const
+    {
+        size_t seed = 0;
+        HashCombine(seed, window_scissor.m_tl_x);
+        HashCombine(seed, window_scissor.m_tl_y);
+        HashCombine(seed, window_scissor.m_br_x);
+        HashCombine(seed, window_scissor.m_br_y);
+        return seed;
+    }
+};
+
+struct ShaderReferenceHash
+{
+    size_t operator()(const ShaderReference &ref) const
+    {
+        size_t seed = 0;
+        HashCombine(seed, ref.m_shader_index);
+        HashCombine(seed, static_cast<uint32_t>(ref.m_stage));
+        HashCombine(seed, ref.m_enable_mask);
+        return seed;
+    }
+};
+
+// Move the distinct values to a vector in a deterministic order
+template<typename T, typename Hash>
+std::vector<T> ToSortedVector(const std::unordered_set<T, Hash> &values)
+{
+    std::vector<T> sorted(values.begin(), values.end());
+    std::sort(sorted.begin(), sorted.end());
+    return sorted;
+}
+
+// Quote a CSV field
+std::string CsvField(std::string_view field)
+{
+    std::string quoted = "\"";
+    for (char c : field)
+    {
+        if (c == '"')
+            quoted += '"';
+        quoted += c;
+    }
+    quoted += '"';
+    return quoted;
+}
+
+}  // namespace
+
 #define CHECK_AND_TRACK_STATE_1(stats_enum, state)                   \
     if (event_state_it->Is##state##Set() && event_state_it->state()) \
         stats_list[stats_enum]++;
@@ -57,18 +137,21 @@ namespace Dive
 #define CHECK_AND_TRACK_STATE(stats_enum, ...) \
     CHECK_AND_TRACK_STATE_N(__VA_ARGS__)(stats_enum, __VA_ARGS__)
 
+// The median is selected with std::nth_element rather than sorting the whole array. For an even
+// count, the lower middle value is the largest one of the lower half left by nth_element.
 #define GATHER_TOTAL_MIN_MAX_MEDIAN(array_name, type)                                         \
     {                                                                                         \
-        std::sort(array_name.begin(), array_name.end());                                      \
         size_t n = array_name.size();                                                         \
+        auto   mid = array_name.begin() + n / 2;                                              \
+        std::nth_element(array_name.begin(), mid, array_name.end());                          \
         if (n % 2 != 0)                                                                       \
         {                                                                                     \
-            stats_list[Dive::Stats::kMedian##type] = array_name[n / 2];                       \
+            stats_list[Dive::Stats::kMedian##type] = *mid;                                    \
         }                                                                                     \
         else                                                                                  \
         {                                                                                     \
-            auto mid1 = array_name[n / 2 - 1];                                                \
-            auto mid2 = array_name[n / 2];                                                    \
+            auto mid1 = *std::max_element(array_name.begin(), mid);                           \
+            auto mid2 = *mid;                                                                 \
             stats_list[Dive::Stats::kMedian##type] = (uint64_t)((float)(mid1 + mid2) / 2.0f); \
         }                                                                                     \
         stats_list[Dive::Stats::kMin##type] = *std::min_element(array_name.begin(),           \
@@ -101,6 +184,10 @@ void TraceStats::GatherTraceStats(const Dive::CaptureMetadata &meta_data,
     Dive::RenderModeType      cur_type = Dive::RenderModeType::kUnknown;
     [[maybe_unused]] uint32_t num_draws_in_pass = 0;
 
+    std::unordered_set<Dive::ShaderReference, ShaderReferenceHash> shader_refs;
+    std::unordered_set<Viewport, ViewportHash>                     viewports;
+    std::unordered_set<WindowScissor, WindowScissorHash>           window_scissors;
+
     for (size_t i = 0; i < event_count; ++i)
     {
         const Dive::EventInfo &info = meta_data.m_event_info[i];
@@ -188,7 +275,7 @@ void TraceStats::GatherTraceStats(const Dive::CaptureMetadata &meta_data,
                 {
                     Viewport viewport;
                     viewport.m_vk_viewport = event_state_it->Viewport(v);
-                    capture_stats.m_viewports.insert(viewport);
+                    viewports.insert(viewport);
                 }
             }
 
@@ -201,15 +288,19 @@ void TraceStats::GatherTraceStats(const Dive::CaptureMetadata &meta_data,
                 window_scissor.m_tl_y = event_state_it->WindowScissorTLY();
                 window_scissor.m_br_x = event_state_it->WindowScissorBRX();
                 window_scissor.m_br_y = event_state_it->WindowScissorBRY();
-                capture_stats.m_window_scissors.insert(window_scissor);
+                window_scissors.insert(window_scissor);
             }
         }
 
         for (size_t ref = 0; ref < info.m_shader_references.size(); ++ref)
             if (info.m_shader_references[ref].m_shader_index != UINT32_MAX)
-                capture_stats.m_shader_ref_set.insert(info.m_shader_references[ref]);
+                shader_refs.insert(info.m_shader_references[ref]);
     }
 
+    capture_stats.m_shader_refs = ToSortedVector(shader_refs);
+    capture_stats.m_viewports = ToSortedVector(viewports);
+    capture_stats.m_window_scissors = ToSortedVector(window_scissors);
+
     stats_list[Dive::Stats::kNumBinningPasses] = capture_stats.m_num_binning_passes;
     stats_list[Dive::Stats::kNumTilingPasses] = capture_stats.m_num_tiling_passes;
 
@@ -223,7 +314,7 @@ void TraceStats::GatherTraceStats(const Dive::CaptureMetadata &meta_data,
 
     stats_list[Dive::Stats::kShaders] = meta_data.m_shaders.size();
 
-    for (const Dive::ShaderReference &ref : capture_stats.m_shader_ref_set)
+    for (const Dive::ShaderReference &ref : capture_stats.m_shader_refs)
     {
         if (ref.m_stage == Dive::ShaderStage::kShaderStageVs)
         {
@@ -327,4 +418,94 @@ void TraceStats::PrintTraceStats(const CaptureStats &capture_stats, std::ostream
     }
 }
 
+//--------------------------------------------------------------------------------------------------
+std::vector<BatchCaptureStats> TraceStats::GatherBatchTraceStats(
+const std::vector<std::string> &file_names,
+uint32_t                        num_workers)
+{
+    std::vector<BatchCaptureStats> batch_stats(file_names.size());
+    std::atomic<size_t>             next_index = 0;
+
+    // Each worker loads and decodes its captures itself, so it keeps the GPU of the capture it
+    // loaded even if other workers load captures of other GPUs. Everything else is per DataCore,
+    // except the disassembler debug flags that DisassembleA3XX() sets under a lock.
+    // Each worker takes the next capture, so a large capture doesn't hold back a whole share
+    const auto Worker = [&]() {
+        for (size_t i = next_index++; i < file_names.size(); i = next_index++)
+        {
+            BatchCaptureStats &result = batch_stats[i];
+            result.m_file_name = file_names[i];
+
+            std::unique_ptr<Dive::DataCore> data_core = std::make_unique<Dive::DataCore>();
+            if (data_core->LoadPm4CaptureData(file_names[i]) !=
+                Dive::CaptureData::LoadResult::kSuccess)
+            {
+                result.m_status = BatchCaptureStats::Status::kLoadFailed;
+                continue;
+            }
+            if (!data_core->CreatePm4MetaData())
+            {
+                result.m_status = BatchCaptureStats::Status::kMetadataFailed;
+                continue;
+            }
+            GatherTraceStats(data_core->GetCaptureMetadata(), result.m_stats);
+        }
+    };
+
+    num_workers = std::max(1u, std::min(num_workers, static_cast<uint32_t>(file_names.size())));
+    std::vector<std::thread> workers;
+    for (uint32_t i = 1; i < num_workers; ++i)
+    {
+        workers.emplace_back(Worker);
+    }
+    Worker();
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+    return batch_stats;
+}
+
+//--------------------------------------------------------------------------------------------------
+void TraceStats::PrintBatchTraceStats(const std::vector<BatchCaptureStats> &batch_stats,
+                                      std::ostream                         &ostream)
+{
+    DIVE_ASSERT(kStatMap.size() == Stats::kNumStats);
+
+    ostream << CsvField("File") << "," << CsvField("Status");
+    for (const auto &[stat, description] : kStatMap)
+    {
+        // The tabs only indent the sub-statistics of PrintTraceStats()
+        std::string_view name = description;
+        name.remove_prefix(std::min(name.find_first_not_of('\t'), name.size()));
+        ostream << "," << CsvField(name);
+    }
+    ostream << "," << CsvField("Num Viewports") << "," << CsvField("Num Window Scissors") << "\n";
+
+    for (const BatchCaptureStats &result : batch_stats)
+    {
+        const char *status = "";
+        switch (result.m_status)
+        {
+        case BatchCaptureStats::Status::kSuccess:
+            status = "ok";
+            break;
+        case BatchCaptureStats::Status::kLoadFailed:
+            status = "load_failed";
+            break;
+        case BatchCaptureStats::Status::kMetadataFailed:
+            status = "metadata_failed";
+            break;
+        }
+
+        ostream << CsvField(result.m_file_name) << "," << status;
+        for (const auto &[stat, description] : kStatMap)
+        {
+            ostream << "," << result.m_stats.m_stats_list[stat];
+        }
+        ostream << "," << result.m_stats.m_viewports.size() << ","
+                << result.m_stats.m_window_scissors.size() << "\n";
+    }
+}
+
 }  // namespace Dive
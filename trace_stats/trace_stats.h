@@ -19,7 +19,8 @@
 
 #include "vulkan/vulkan_core.h"
 #include <array>
-#include <set>
+#include <ostream>
+#include <string>
 #include <vector>
 #include "dive_core/capture_event_info.h"
 #include "dive_core/data_core.h"
@@ -182,6 +183,15 @@ struct Viewport
             return m_vk_viewport.minDepth < other.m_vk_viewport.minDepth;
         return m_vk_viewport.maxDepth < other.m_vk_viewport.maxDepth;
     }
+    bool operator==(const Viewport &other) const
+    {
+        return m_vk_viewport.x == other.m_vk_viewport.x &&
+               m_vk_viewport.y == other.m_vk_viewport.y &&
+               m_vk_viewport.width == other.m_vk_viewport.width &&
+               m_vk_viewport.height == other.m_vk_viewport.height &&
+               m_vk_viewport.minDepth == other.m_vk_viewport.minDepth &&
+               m_vk_viewport.maxDepth == other.m_vk_viewport.maxDepth;
+    }
 };
 
 struct WindowScissor
@@ -204,6 +214,11 @@ struct WindowScissor
             return m_br_y < other.m_br_y;
         return m_br_x < other.m_br_x;
     }
+    bool operator==(const WindowScissor &other) const
+    {
+        return m_tl_x == other.m_tl_x && m_tl_y == other.m_tl_y && m_br_x == other.m_br_x &&
+               m_br_y == other.m_br_y;
+    }
 };
 
 // ---------------------------------------------------------------------
@@ -216,14 +231,30 @@ struct CaptureStats
 
     std::vector<uint32_t> m_event_num_indices;
 
-    std::set<Dive::ShaderReference> m_shader_ref_set;
-    std::set<Viewport>              m_viewports;
-    std::set<WindowScissor>         m_window_scissors;
+    // Distinct values used by the capture, sorted with their operator<
+    std::vector<Dive::ShaderReference> m_shader_refs;
+    std::vector<Viewport>              m_viewports;
+    std::vector<WindowScissor>         m_window_scissors;
 
     uint32_t m_num_binning_passes = 0;
     uint32_t m_num_tiling_passes = 0;
 };
 
+// Statistics of one capture of a batch
+struct BatchCaptureStats
+{
+    enum class Status
+    {
+        kSuccess,
+        kLoadFailed,
+        kMetadataFailed,
+    };
+
+    std::string  m_file_name;
+    Status       m_status = Status::kSuccess;
+    CaptureStats m_stats;
+};
+
 class TraceStats
 {
 public:
@@ -235,6 +266,16 @@ public:
 
     // Print the capture statistics to the output stream
     void PrintTraceStats(const CaptureStats &capture_stats, std::ostream &ostream);
+
+    // Load each capture and gather its statistics, using up to num_workers threads that each have
+    // their own DataCore. Pm4InfoInit() must be called first. The results are in the order of
+    // file_names.
+    std::vector<BatchCaptureStats> GatherBatchTraceStats(const std::vector<std::string> &file_names,
+                                                         uint32_t num_workers);
+
+    // Print the statistics of a batch as CSV, with a header row and one row per capture
+    void PrintBatchTraceStats(const std::vector<BatchCaptureStats> &batch_stats,
+                              std::ostream                         &ostream);
 };
 
 }  // namespace Dive
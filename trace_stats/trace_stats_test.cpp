@@ -0,0 +1,102 @@
+/*
+ Copyright 2025 Google LLC
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#include "trace_stats.h"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "pm4_info.h"
+
+namespace Dive
+{
+namespace
+{
+
+const std::string kCaptureFile = std::string(TEST_DATA_DIR) + "/bloom-frame-0080-compressed.rd";
+
+class TraceStatsBatchTest : public ::testing::Test
+{
+protected:
+    static void SetUpTestSuite() { Pm4InfoInit(); }
+
+    std::string GatherBatchCsv(const std::vector<std::string> &file_names, uint32_t num_workers)
+    {
+        TraceStats         trace_stats;
+        std::ostringstream csv;
+        trace_stats.PrintBatchTraceStats(trace_stats.GatherBatchTraceStats(file_names,
+                                                                           num_workers),
+                                         csv);
+        return csv.str();
+    }
+};
+
+TEST_F(TraceStatsBatchTest, ResultsFollowInputOrder)
+{
+    const std::vector<std::string> file_names = { kCaptureFile,
+                                                  std::string(TEST_DATA_DIR) + "/missing.rd" };
+
+    TraceStats                     trace_stats;
+    std::vector<BatchCaptureStats> batch_stats = trace_stats.GatherBatchTraceStats(file_names, 2);
+    ASSERT_EQ(batch_stats.size(), file_names.size());
+    EXPECT_EQ(batch_stats[0].m_file_name, file_names[0]);
+    EXPECT_EQ(batch_stats[0].m_status, BatchCaptureStats::Status::kSuccess);
+    const auto &stats_list = batch_stats[0].m_stats.m_stats_list;
+    EXPECT_GT(stats_list[Stats::kBinningDraws] + stats_list[Stats::kDirectDraws] +
+              stats_list[Stats::kTiledDraws],
+              0u);
+    EXPECT_EQ(batch_stats[1].m_file_name, file_names[1]);
+    EXPECT_EQ(batch_stats[1].m_status, BatchCaptureStats::Status::kLoadFailed);
+}
+
+// The workers create the metadata of their captures concurrently, which disassembles the shaders
+// from several threads at once. The report must match the one gathered on a single thread.
+TEST_F(TraceStatsBatchTest, WorkersMatchSingleThread)
+{
+    const std::vector<std::string> file_names(4, kCaptureFile);
+
+    std::string expected = GatherBatchCsv(file_names, 1);
+    EXPECT_EQ(GatherBatchCsv(file_names, 4), expected);
+}
+
+// Writes a capture of an a7xx, unlike the a6xx bloom capture, with no submits
+std::string WriteA7xxCapture()
+{
+    const std::string file_name = ::testing::TempDir() + "/trace_stats_a7xx.rd";
+    const uint32_t    kRdGpuId = 13;
+    const uint32_t    block[] = { kRdGpuId, sizeof(uint32_t), 740 };
+    std::ofstream     file(file_name, std::ios::binary);
+    file.write(reinterpret_cast<const char *>(block), sizeof(block));
+    return file_name;
+}
+
+// Loading a capture sets the GPU used to decode it. A worker loading an a7xx capture must not
+// change the GPU of the bloom captures the other workers are decoding.
+TEST_F(TraceStatsBatchTest, WorkersKeepTheGPUOfTheirCapture)
+{
+    const std::string              a7xx_file_name = WriteA7xxCapture();
+    const std::vector<std::string> file_names = { kCaptureFile, a7xx_file_name, kCaptureFile,
+                                                  a7xx_file_name, kCaptureFile, a7xx_file_name };
+
+    std::string expected = GatherBatchCsv(file_names, 1);
+    EXPECT_EQ(GatherBatchCsv(file_names, 3), expected);
+}
+
+}  // namespace
+}  // namespace Dive
@@ -817,6 +817,8 @@ void AnalyzeDialog::ReplayImpl()
                                                               Dive::kProfilingMetricsCsvSuffix);
     std::filesystem::path gpu_timing_csv = GetFullLocalPath(gfxr_filename_stem.string(),
                                                             Dive::kGpuTimingCsvSuffix);
+    std::filesystem::path gpu_timing_records = GetFullLocalPath(gfxr_filename_stem.string(),
+                                                                Dive::kGpuTimingRecordSuffix);
     std::filesystem::path pm4_rd = GetFullLocalPath(gfxr_filename_stem.string(),
                                                     Dive::kPm4RdSuffix);
     std::filesystem::path renderdoc_rdc = GetFullLocalPath(gfxr_filename_stem.string(),
@@ -824,6 +826,7 @@ void AnalyzeDialog::ReplayImpl()
     qDebug() << "Attempting to delete temporary artifacts from previous runs...";
     AttemptDeletingTemporaryLocalFile(perf_counter_csv);
     AttemptDeletingTemporaryLocalFile(gpu_timing_csv);
+    AttemptDeletingTemporaryLocalFile(gpu_timing_records);
     AttemptDeletingTemporaryLocalFile(pm4_rd);
     // Keep RenderDoc file since it's not part of the "Dive file"
 
@@ -897,8 +900,14 @@ void AnalyzeDialog::ReplayImpl()
             UpdateReplayStatus(ReplayStatusUpdateCode::kFailure, err_msg);
             return;
         }
-        qDebug() << "Loading gpu timing data: " << gpu_timing_csv.string().c_str();
-        emit OnDisplayGpuTimingResults(QString::fromStdString(gpu_timing_csv.string()));
+        // Prefer the binary records of every frame, the CSV only holds the stats
+        std::filesystem::path gpu_timing_file = gpu_timing_csv;
+        if (std::filesystem::exists(gpu_timing_records))
+        {
+            gpu_timing_file = gpu_timing_records;
+        }
+        qDebug() << "Loading gpu timing data: " << gpu_timing_file.string().c_str();
+        emit OnDisplayGpuTimingResults(QString::fromStdString(gpu_timing_file.string()));
     }
     else
     {
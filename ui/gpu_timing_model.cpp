@@ -36,7 +36,14 @@ void GpuTimingModel::OnGpuTimingResultsGenerated(const QString &file_path)
         return;
     }
 
-    ParseCsv(file_path);
+    if (std::filesystem::path(file_path.toStdString()).extension() == ".csv")
+    {
+        ParseCsv(file_path);
+    }
+    else
+    {
+        ParseRecords(file_path);
+    }
     emit endResetModel();
 }
 
@@ -51,6 +58,17 @@ void GpuTimingModel::ParseCsv(const QString &file_path)
     }
 }
 
+//--------------------------------------------------------------------------------------------------
+void GpuTimingModel::ParseRecords(const QString &file_path)
+{
+    std::filesystem::path fp = file_path.toStdString();
+    if (!m_available_gpu_timing_data.LoadFromRecords(fp))
+    {
+        qDebug() << "Could not load GPU timing info from record file: "
+                 << file_path.toStdString().c_str();
+    }
+}
+
 //--------------------------------------------------------------------------------------------------
 QModelIndex GpuTimingModel::index(int row, int column, const QModelIndex &parent) const
 {
@@ -40,5 +40,6 @@ public slots:
 
 private:
     void                     ParseCsv(const QString &file_path);
+    void                     ParseRecords(const QString &file_path);
     Dive::AvailableGpuTiming m_available_gpu_timing_data;
 };
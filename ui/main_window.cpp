@@ -43,6 +43,7 @@
 #include "about_window.h"
 #include "buffer_view.h"
 #include "capture_service/constants.h"
+#include "common/trace.h"
 #include "command_buffer_model.h"
 #include "command_buffer_view.h"
 #include "command_model.h"
@@ -829,6 +830,7 @@ void MainWindow::ResetTabWidget()
 //--------------------------------------------------------------------------------------------------
 void MainWindow::OnDiveFileLoaded()
 {
+    DIVE_TRACE_SCOPE("PopulateViews");
     // Reset models and views that display data from the capture
     m_left_group_box->setTitle(kFrameTitleStrings[1]);
     m_middle_group_box->show();
@@ -924,6 +926,7 @@ void MainWindow::OnDiveFileLoaded()
 //--------------------------------------------------------------------------------------------------
 void MainWindow::OnAdrenoRdFileLoaded()
 {
+    DIVE_TRACE_SCOPE("PopulateViews");
     // Reset models and views that display data from the capture
     m_left_group_box->setTitle(kFrameTitleStrings[2]);
     m_middle_group_box->setTitle(kFrameTitleStrings[0]);
@@ -993,6 +996,7 @@ void MainWindow::OnAdrenoRdFileLoaded()
 //--------------------------------------------------------------------------------------------------
 void MainWindow::OnGfxrFileLoaded()
 {
+    DIVE_TRACE_SCOPE("PopulateViews");
     // Reset models and views that display data from the capture
     m_left_group_box->setTitle(kFrameTitleStrings[1]);
     m_middle_group_box->setTitle(kFrameTitleStrings[0]);
@@ -1121,6 +1125,12 @@ bool MainWindow::LoadFile(const std::string &file_name, bool is_temp_file, bool
     // Discard associated timing results.
     m_perf_counter_model->OnPerfCounterResultsGenerated("", std::nullopt);
     m_gpu_timing_model->OnGpuTimingResultsGenerated("");
+
+    if (!m_load_trace_file_path.isEmpty())
+    {
+        Dive::Tracer::Get().Start();
+    }
+
     if (async)
     {
         // Start async file loading, at the end of loading FileLoaded will be triggered.
@@ -1232,6 +1242,7 @@ void MainWindow::OnPendingScreenshot(const QString &file_name)
 MainWindow::LoadedFileType MainWindow::LoadFileImpl(const std::string &file_name, bool is_temp_file)
 {
     // Note: this function might not run on UI thread, thus can't do any UI modification.
+    DIVE_TRACE_SCOPE("LoadFile");
 
     // Check the file type to determine what is loaded.
     std::string file_extension = std::filesystem::path(file_name).extension().generic_string();
@@ -1285,7 +1296,12 @@ MainWindow::LoadedFileType MainWindow::LoadFileImpl(const std::string &file_name
                                                         Dive::kProfilingMetricsCsvSuffix);
         std::filesystem::path gpu_time_file_path = capture_file_path.parent_path() /
                                                    (capture_file_path.stem().string() +
-                                                    Dive::kGpuTimingCsvSuffix);
+                                                    Dive::kGpuTimingRecordSuffix);
+        if (!std::filesystem::exists(gpu_time_file_path))
+        {
+            gpu_time_file_path = capture_file_path.parent_path() /
+                                 (capture_file_path.stem().string() + Dive::kGpuTimingCsvSuffix);
+        }
         std::filesystem::path screenshot_file_path = capture_file_path.parent_path() /
                                                      (capture_file_path.stem().string() +
                                                       Dive::kPngSuffix);
@@ -1438,6 +1454,7 @@ void MainWindow::OnFileLoaded()
     switch (result.file_type)
     {
     case LoadedFileType::kUnknown:
+        WriteLoadTrace();
         return;
     case LoadedFileType::kDiveFile:
         OnDiveFileLoaded();
@@ -1473,6 +1490,29 @@ void MainWindow::OnFileLoaded()
     ShowTempStatus(tr("File loaded successfully"));
 
     UpdateTabAvailability();
+    WriteLoadTrace();
+}
+
+//--------------------------------------------------------------------------------------------------
+void MainWindow::WriteLoadTrace()
+{
+    if (m_load_trace_file_path.isEmpty())
+    {
+        return;
+    }
+
+    Dive::Tracer::Get().Stop();
+    if (Dive::Tracer::Get().WriteChromeJson(m_load_trace_file_path.toStdString()))
+    {
+        ShowTempStatus(tr("Load trace written to %1").arg(m_load_trace_file_path));
+    }
+    else
+    {
+        QMessageBox::critical(this,
+                              tr("Load trace"),
+                              tr("Unable to write %1").arg(m_load_trace_file_path));
+    }
+    m_load_trace_file_path.clear();
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -1637,6 +1677,29 @@ void MainWindow::OnShortcuts()
     shortcuts->open();
 }
 
+//--------------------------------------------------------------------------------------------------
+void MainWindow::OnTraceNextLoad()
+{
+    QString file_name = QFileDialog::getSaveFileName(this,
+                                                     tr("Save the trace of the next capture load"),
+                                                     QDir::currentPath(),
+                                                     tr("Chrome JSON trace (*.json)"));
+    if (file_name.isEmpty())
+    {
+        return;
+    }
+
+    if (!Dive::Tracer::IsCompiledIn())
+    {
+        QMessageBox::warning(this,
+                             tr("Load trace"),
+                             tr("Dive was built without DIVE_ENABLE_TRACING, the trace will only "
+                                "contain metadata."));
+    }
+    m_load_trace_file_path = file_name;
+    ShowTempStatus(tr("The next capture load will be traced to %1").arg(file_name));
+}
+
 //--------------------------------------------------------------------------------------------------
 void MainWindow::closeEvent(QCloseEvent *closeEvent)
 {
@@ -2022,6 +2085,12 @@ void MainWindow::CreateActions()
     m_shortcuts_action->setStatusTip(tr("Display application keyboard shortcuts"));
     connect(m_shortcuts_action, &QAction::triggered, this, &MainWindow::OnShortcuts);
 
+    // Trace next load action
+    m_trace_load_action = new QAction(tr("&Trace Next Capture Load..."), this);
+    m_trace_load_action->setStatusTip(
+    tr("Write a Chrome JSON trace of the loading phases of the next capture, for ui.perfetto.dev"));
+    connect(m_trace_load_action, &QAction::triggered, this, &MainWindow::OnTraceNextLoad);
+
     // About action
     m_about_action = new QAction(tr("&About Dive"), this);
     m_about_action->setStatusTip(tr("Display application version information"));
@@ -2052,6 +2121,7 @@ void MainWindow::CreateMenus()
 
     m_help_menu = menuBar()->addMenu(tr("&Help"));
     m_help_menu->addAction(m_shortcuts_action);
+    m_help_menu->addAction(m_trace_load_action);
     m_help_menu->addAction(m_about_action);
 }
 
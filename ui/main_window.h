@@ -156,6 +156,7 @@ private slots:
     void OnExpandToLevel();
     void OnAbout();
     void OnShortcuts();
+    void OnTraceNextLoad();
     void OnSaveCapture();
     void OnSearchTrigger();
     void OpenRecentFile();
@@ -208,6 +209,8 @@ private:
     void OnLoadFailure(Dive::CaptureData::LoadResult result, const std::string &file_name);
     void OnParseFailure(const std::string &file_name);
     void OnUnsupportedFile(const std::string &file_name);
+    // Write the trace of the load requested with OnTraceNextLoad(), if any
+    void WriteLoadTrace();
 
     void    CreateActions();
     void    CreateMenus();
@@ -254,6 +257,7 @@ private:
     QMenu         *m_help_menu;
     QAction       *m_about_action;
     QAction       *m_shortcuts_action;
+    QAction       *m_trace_load_action;
     QToolBar      *m_file_tool_bar;
     QScrollArea   *m_file_tool_bar_scroll_area;
     TraceDialog   *m_trace_dig;
@@ -268,6 +272,8 @@ private:
     ProgressTrackerCallback         m_progress_tracker;
     std::unique_ptr<Dive::DataCore> m_data_core;
     QString                         m_capture_file;
+    // Chrome JSON trace file of the next capture load, empty if not tracing
+    QString                         m_load_trace_file_path;
     QString                         m_last_file_path;
     Dive::LogRecord                 m_log_record;
     Dive::LogConsole                m_log_console;
@@ -16,6 +16,7 @@
 #include <QTextStream>
 #include <QStringList>
 #include <QDebug>
+#include <cmath>
 #include <optional>
 
 #include "dive_core/available_metrics.h"
@@ -78,7 +79,6 @@ void PerfCounterModel::LoadData()
 
     m_headers = headers;
     m_column_count = static_cast<int>(m_headers.size());
-    m_perf_metrics_record = m_perf_metrics_data_provider->GetComputedRecords();
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -89,7 +89,7 @@ QModelIndex PerfCounterModel::index(int row, int column, const QModelIndex &pare
         return QModelIndex();
     }
 
-    const size_t num_rows = m_perf_metrics_record.size();
+    const size_t num_rows = m_perf_metrics_data_provider->GetComputedRecords().size();
 
     if (row < 0 || static_cast<size_t>(row) >= num_rows || column < 0 || column >= columnCount())
     {
@@ -111,7 +111,7 @@ int PerfCounterModel::rowCount(const QModelIndex &parent) const
     {
         return 0;
     }
-    return static_cast<int>(m_perf_metrics_record.size());
+    return static_cast<int>(m_perf_metrics_data_provider->GetComputedRecords().size());
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -130,12 +130,13 @@ QVariant PerfCounterModel::data(const QModelIndex &index, int role) const
     int row = index.row();
     int col = index.column();
 
-    if (static_cast<size_t>(row) >= m_perf_metrics_record.size())
+    const auto &records = m_perf_metrics_data_provider->GetComputedRecords();
+    if (static_cast<size_t>(row) >= records.size())
     {
         return QVariant();
     }
 
-    const auto &record = m_perf_metrics_record.at(row);
+    const auto &record = records[row];
 
     if (col >= m_headers.length())
     {
@@ -155,12 +156,15 @@ QVariant PerfCounterModel::data(const QModelIndex &index, int role) const
         }
     }
 
-    int metric_col_index = col - FixedHeader::kFixedHeaderCount;
-    if (static_cast<size_t>(metric_col_index) < record.m_metric_values.size())
+    // The values are read straight from the metric columns of the provider.
+    const auto &metric_columns = m_perf_metrics_data_provider->GetComputedMetricColumns();
+    int         metric_col_index = col - FixedHeader::kFixedHeaderCount;
+    if (static_cast<size_t>(metric_col_index) < metric_columns.size())
     {
-        const auto &metric_value = record.m_metric_values.at(metric_col_index);
+        const double metric_value = metric_columns[metric_col_index][row];
 
-        if (role == Qt::DisplayRole)
+        // NaN when no sample of the draw was captured.
+        if (role == Qt::DisplayRole && !std::isnan(metric_value))
         {
             return metric_value;
         }
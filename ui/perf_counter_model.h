@@ -62,5 +62,4 @@ private:
     QStringList                                    m_headers;
     int                                            m_column_count = 0;
     std::unique_ptr<Dive::PerfMetricsDataProvider> m_perf_metrics_data_provider;
-    std::vector<Dive::PerfMetricsRecord>           m_perf_metrics_record;
 };
@@ -960,31 +960,38 @@ void GfxrCaptureWorker::run()
     qDebug() << "Begin to download the trace file to "
              << m_target_capture_dir.generic_string().c_str();
 
-    int64_t     size = 0;
     std::string gfxr_stem;
     std::string original_screenshot_path;
 
     std::string gfxr_capture_file_path;
-    // Retrieve each file in the capture directory (capture file and asset file).
-    for (std::string file : m_file_list)
+    // Retrieve all the files in the capture directory (capture file and asset file) concurrently.
+    std::vector<Dive::FileRetrieval> files;
+    for (const std::string &file : m_file_list)
     {
-        std::filesystem::path filename = file.data();
-        std::filesystem::path target_path = m_target_capture_dir;
-        target_path /= filename;
-
         // Source path is intended for Android, cannot use std::filesystem here
-        std::string source_file = absl::StrCat(m_source_capture_dir, "/", filename.string());
+        Dive::FileRetrieval retrieval;
+        retrieval.remote_file_path = absl::StrCat(m_source_capture_dir, "/", file);
+        files.push_back(std::move(retrieval));
+    }
 
-        auto retrieve_file = device->RetrieveFile(source_file, m_target_capture_dir.string());
+    Dive::RetrieveFilesOptions options;
+    options.progress_callback = [this](size_t, size_t, uint64_t bytes_done) {
+        emit DownloadedSize(static_cast<int64_t>(bytes_done));
+    };
+    auto retrieve_files = device->RetrieveFiles(files, m_target_capture_dir.string(), options);
+    if (!retrieve_files.ok())
+    {
+        std::cout << "Failed to retrieve gfxr capture: " << retrieve_files.message() << std::endl;
+        qDebug() << retrieve_files.message().data();
+        emit ErrorMessage(QString::fromStdString(std::string(retrieve_files.message())));
+        return;
+    }
 
-        if (!retrieve_file.ok())
-        {
-            std::cout << "Failed to retrieve gfxr capture: " << retrieve_file.message()
-                      << std::endl;
-            qDebug() << retrieve_file.message().data();
-            emit ErrorMessage(QString::fromStdString(retrieve_file.message().data()));
-            return;
-        }
+    for (const std::string &file : m_file_list)
+    {
+        std::filesystem::path filename = file.data();
+        std::filesystem::path target_path = m_target_capture_dir;
+        target_path /= filename;
 
         if (filename.extension() == Dive::kGfxrSuffix)
         {
@@ -998,9 +1005,6 @@ void GfxrCaptureWorker::run()
         {
             original_screenshot_path = target_path.string();
         }
-
-        size += static_cast<int64_t>(std::filesystem::file_size(target_path.string()));
-        emit DownloadedSize(size);
     }
 
     if (!original_screenshot_path.empty() && !gfxr_stem.empty())